@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * libvlc_thumbnailer.h:  libvlc external API
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_LIBVLC_THUMBNAILER_H
+#define VLC_LIBVLC_THUMBNAILER_H 1
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/**
+ * @defgroup libvlc_thumbnailer LibVLC thumbnailer
+ * @ingroup libvlc
+ * LibVLC thumbnailer extracts thumbnails from medias, much faster than
+ * playing them and taking a snapshot: only keyframes are decoded, and nothing
+ * is output.
+ * @{
+ * @file
+ * LibVLC thumbnailer external API
+ */
+
+typedef struct libvlc_thumbnailer_t libvlc_thumbnailer_t;
+
+/** Thumbnail image formats */
+typedef enum libvlc_thumbnailer_format_t
+{
+    libvlc_thumbnailer_png,
+    libvlc_thumbnailer_jpg,
+} libvlc_thumbnailer_format_t;
+
+/**
+ * Callback prototype for thumbnails.
+ *
+ * It is called from a LibVLC thread, exactly once per request.
+ *
+ * \param opaque private pointer as passed to libvlc_thumbnailer_request()
+ * \param p_md media the thumbnail was requested for
+ * \param p_data encoded image, only valid during the call, or NULL if the
+ *               thumbnail could not be extracted
+ * \param i_size size of the encoded image in bytes
+ */
+typedef void (*libvlc_thumbnailer_cb)( void *opaque, libvlc_media_t *p_md,
+                                       const void *p_data, size_t i_size );
+
+/**
+ * Create a thumbnailer.
+ *
+ * \version LibVLC 3.0.0 or later
+ *
+ * \param p_inst libvlc instance
+ * \param i_workers number of thumbnails extracted in parallel, or 0 for one
+ *                  per CPU
+ * \param i_threads total number of decoding threads shared by the workers, or
+ *                  0 for one per CPU
+ * \return a thumbnailer, or NULL on error
+ */
+LIBVLC_API libvlc_thumbnailer_t *
+libvlc_thumbnailer_new( libvlc_instance_t *p_inst, unsigned i_workers,
+                        unsigned i_threads );
+
+/**
+ * Release a thumbnailer.
+ *
+ * Pending requests are dropped: their callbacks are called, without image,
+ * before this function returns.
+ *
+ * \version LibVLC 3.0.0 or later
+ *
+ * \param p_thumbnailer thumbnailer to release
+ */
+LIBVLC_API void
+libvlc_thumbnailer_release( libvlc_thumbnailer_t *p_thumbnailer );
+
+/**
+ * Request a thumbnail.
+ *
+ * The media is retained until the callback is called.
+ *
+ * \version LibVLC 3.0.0 or later
+ *
+ * \param p_thumbnailer thumbnailer
+ * \param p_md media
+ * \param i_time time of the thumbnail in milliseconds, the nearest keyframe
+ *               being used
+ * \param i_width thumbnail width, or 0 to keep the aspect ratio
+ * \param i_height thumbnail height, or 0 to keep the aspect ratio
+ * \param i_format image format
+ * \param i_timeout maximum duration of the extraction in milliseconds, or 0
+ *                  for no limit
+ * \param cb callback
+ * \param opaque private pointer for the callback
+ * \return 0 on success, -1 on error (the callback is not called then)
+ */
+LIBVLC_API int
+libvlc_thumbnailer_request( libvlc_thumbnailer_t *p_thumbnailer,
+                            libvlc_media_t *p_md, libvlc_time_t i_time,
+                            unsigned i_width, unsigned i_height,
+                            libvlc_thumbnailer_format_t i_format,
+                            libvlc_time_t i_timeout,
+                            libvlc_thumbnailer_cb cb, void *opaque );
+
+/** @} */
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
@@ -257,6 +257,48 @@ VLC_API block_t *block_mmap_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC
  */
 VLC_API block_t * block_shm_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC;
 
+/**
+ * Shares a block.
+ *
+ * Wraps a block so that parts of its data can be referenced by other blocks,
+ * see block_Slice(). The wrapped block is released when the returned block
+ * and all the slices have been released. If the block is already shared, it
+ * is returned as is.
+ *
+ * @param block block to share (must not be a chain)
+ * @return NULL in case of error (the block is released in that case), or the
+ * shared block.
+ */
+VLC_API block_t *block_Share(block_t *block) VLC_USED;
+
+/**
+ * References a part of the data of a shared block.
+ *
+ * The slice holds a reference to the shared data, but not to the shared
+ * block itself, which can be released independently. Slices may overlap, so
+ * their data should be treated as read-only. The owner of the shared block
+ * may however write to a part of the data before slicing it, as long as no
+ * slice references that part yet.
+ *
+ * @param block a block returned by block_Share() or block_Slice()
+ * @param p start of the slice
+ * @param length length of the slice
+ * @return NULL if the block is not shared, if the slice does not lie within
+ * the shared data, or in case of error, otherwise a new block (with default
+ * properties) referencing the data.
+ */
+VLC_API block_t *block_Slice(block_t *block, const uint8_t *p, size_t length)
+VLC_USED;
+
+/**
+ * Gathers a chain of blocks.
+ *
+ * Like block_ChainGather(), except that a chain of slices of consecutive
+ * data from the same shared block is merged into a single slice, without
+ * copying the data.
+ */
+VLC_API block_t *block_SliceGather(block_t *list) VLC_USED;
+
 /**
  * Maps a file handle in memory.
  *
@@ -26,6 +26,7 @@
 #define VLC_FILTER_H 1
 
 #include <vlc_es.h>
+#include <vlc_block.h>
 
 /**
  * \defgroup filter Filters
@@ -52,6 +53,10 @@ typedef struct filter_owner_t
         {
             subpicture_t * (*buffer_new)( filter_t * );
         } sub;
+        struct
+        {
+            block_t * (*buffer_new)( filter_t *, size_t );
+        } audio;
     };
 } filter_owner_t;
 
@@ -168,6 +173,26 @@ static inline picture_t *filter_NewPicture( filter_t *p_filter )
     return pic;
 }
 
+/**
+ * This function will return a new block usable by p_filter as an audio
+ * output buffer of i_size bytes. The buffer comes from the pool of the
+ * owner if there is one, so that filters which cannot work in place do not
+ * allocate memory for every audio period. You have to release it using
+ * block_Release or by returning it to the caller as a pf_audio_filter
+ * return value.
+ *
+ * \param p_filter filter_t object
+ * \param i_size payload size in bytes
+ * \return new block on success or NULL on failure
+ */
+static inline block_t *filter_NewAudioBuffer( filter_t *p_filter,
+                                              size_t i_size )
+{
+    if( p_filter->owner.audio.buffer_new != NULL )
+        return p_filter->owner.audio.buffer_new( p_filter, i_size );
+    return block_Alloc( i_size );
+}
+
 /**
  * Flush a filter
  *
@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * vlc_slices.h: slice threading
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SLICES_H
+#define VLC_SLICES_H 1
+
+/**
+ * \defgroup slices Slice threading
+ * \ingroup threads
+ * Runs independent parts of one job, typically bands of picture rows, on a
+ * set of worker threads, and waits for all of them.
+ *
+ * The calling thread takes part in the work, so that a pool of N threads
+ * only creates N - 1 workers.
+ * @{
+ * \file
+ * Slice threading functions
+ */
+
+/**
+ * Slice threading pool handle
+ */
+typedef struct vlc_slices vlc_slices_t;
+
+/**
+ * Creates a pool of threads to run slices.
+ *
+ * \param threads number of threads, including the caller of
+ *                vlc_slices_Run(), or 0 for one per CPU
+ * \return a pool, or NULL if it would have only one thread or on error
+ */
+VLC_API vlc_slices_t *vlc_slices_New( unsigned threads ) VLC_USED;
+
+/**
+ * Destroys a pool created by vlc_slices_New().
+ *
+ * NULL is accepted and ignored.
+ */
+VLC_API void vlc_slices_Delete( vlc_slices_t * );
+
+/**
+ * Returns the number of threads running the slices, including the caller.
+ *
+ * This is 1 for a NULL pool. It is a good default number of slices.
+ */
+VLC_API unsigned vlc_slices_Count( const vlc_slices_t * ) VLC_USED;
+
+/**
+ * Runs slices and waits for all of them to complete.
+ *
+ * The slice function is called once for each index in [0, count), in no
+ * particular order and possibly concurrently. With a NULL pool, all slices
+ * run one after another on the calling thread.
+ *
+ * Only one thread may run slices on a given pool at a time.
+ *
+ * \param count number of slices
+ * \param slice slice function, called with the opaque pointer, the slice
+ *              index and the number of slices
+ */
+VLC_API void vlc_slices_Run( vlc_slices_t *, unsigned count,
+                             void (*slice)( void *, unsigned, unsigned ),
+                             void *opaque );
+
+/**
+ * Computes the rows covered by a slice when splitting rows in even bands.
+ *
+ * \param align each band but the last starts at a multiple of this value
+ *              (for instance 2 to keep fields together)
+ */
+static inline void vlc_slices_Rows( unsigned index, unsigned count,
+                                    unsigned rows, unsigned align,
+                                    unsigned *start, unsigned *end )
+{
+    unsigned units = (rows + align - 1) / align;
+
+    *start = __MIN( rows, (units * index / count) * align );
+    *end = __MIN( rows, (units * (index + 1) / count) * align );
+}
+
+/** @} */
+
+#endif
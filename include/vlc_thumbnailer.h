@@ -0,0 +1,101 @@
+/*****************************************************************************
+ * vlc_thumbnailer.h: keyframe thumbnails extraction
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THUMBNAILER_H
+#define VLC_THUMBNAILER_H 1
+
+/**
+ * \defgroup thumbnailer Thumbnailer
+ * \ingroup input
+ * Extracts thumbnails from media, without any input thread or output.
+ *
+ * Each request opens the demuxer with only the first video track selected,
+ * seeks to the keyframe nearest to the requested time, and decodes keyframes
+ * only, without loop filter, until a picture comes out. That picture is then
+ * scaled and encoded into an image.
+ *
+ * Requests are processed by a pool of worker threads, which share a budget
+ * of decoder threads.
+ * @{
+ * \file
+ * Thumbnailer functions
+ */
+
+typedef struct vlc_thumbnailer_t vlc_thumbnailer_t;
+
+/**
+ * Thumbnail completion callback.
+ *
+ * It is called from a worker thread, exactly once per request.
+ *
+ * \param data opaque pointer passed to vlc_thumbnailer_Request()
+ * \param image encoded image, to release with block_Release(), or NULL if
+ *              the thumbnail could not be extracted or the request was
+ *              dropped
+ */
+typedef void (*vlc_thumbnailer_cb)( void *data, block_t *image );
+
+/**
+ * Creates a thumbnailer.
+ *
+ * \param parent parent object
+ * \param workers number of requests processed in parallel, or 0 for one per
+ *                CPU
+ * \param threads total number of decoder threads shared by the workers, or
+ *                0 for one per CPU
+ * \return a thumbnailer, or NULL on error
+ */
+VLC_API vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *parent,
+                                                   unsigned workers,
+                                                   unsigned threads ) VLC_USED;
+#define vlc_thumbnailer_Create(a,b,c) \
+    vlc_thumbnailer_Create(VLC_OBJECT(a),b,c)
+
+/**
+ * Requests a thumbnail.
+ *
+ * \param item media to extract the thumbnail from
+ * \param time time of the thumbnail, the nearest keyframe being used
+ * \param codec image format, such as VLC_CODEC_PNG or VLC_CODEC_JPEG
+ * \param width thumbnail width, or 0 to keep the aspect ratio
+ * \param height thumbnail height, or 0 to keep the aspect ratio
+ * \param timeout maximum duration of the extraction, or 0 for no limit
+ * \param cb completion callback
+ * \param data opaque pointer for the completion callback
+ * \return VLC_SUCCESS, or an error if the request could not be queued (the
+ * callback is not called in that case)
+ */
+VLC_API int vlc_thumbnailer_Request( vlc_thumbnailer_t *, input_item_t *item,
+                                     mtime_t time, vlc_fourcc_t codec,
+                                     unsigned width, unsigned height,
+                                     mtime_t timeout, vlc_thumbnailer_cb cb,
+                                     void *data );
+
+/**
+ * Destroys a thumbnailer.
+ *
+ * Requests being processed are aborted, and pending requests are dropped.
+ * The callbacks of all of them are called, with a NULL image, before this
+ * function returns.
+ */
+VLC_API void vlc_thumbnailer_Release( vlc_thumbnailer_t * );
+
+/** @} */
+#endif
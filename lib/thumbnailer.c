@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * thumbnailer.c: libvlc thumbnailer API
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <vlc/libvlc.h>
+#include <vlc/libvlc_media.h>
+#include <vlc/libvlc_thumbnailer.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_thumbnailer.h>
+
+#include "libvlc_internal.h"
+#include "media_internal.h"
+
+struct libvlc_thumbnailer_t
+{
+    libvlc_instance_t  *p_libvlc_instance;
+    vlc_thumbnailer_t  *p_thumbnailer;
+};
+
+typedef struct
+{
+    libvlc_media_t       *p_md;
+    libvlc_thumbnailer_cb cb;
+    void                 *opaque;
+} thumbnailer_request_t;
+
+static void thumbnailer_done( void *data, block_t *p_image )
+{
+    thumbnailer_request_t *p_req = data;
+
+    if( p_image != NULL )
+    {
+        p_req->cb( p_req->opaque, p_req->p_md, p_image->p_buffer,
+                   p_image->i_buffer );
+        block_Release( p_image );
+    }
+    else
+        p_req->cb( p_req->opaque, p_req->p_md, NULL, 0 );
+
+    libvlc_media_release( p_req->p_md );
+    free( p_req );
+}
+
+libvlc_thumbnailer_t *
+libvlc_thumbnailer_new( libvlc_instance_t *p_inst, unsigned i_workers,
+                        unsigned i_threads )
+{
+    libvlc_thumbnailer_t *p_lt = malloc( sizeof( *p_lt ) );
+    if( unlikely(p_lt == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    p_lt->p_thumbnailer = vlc_thumbnailer_Create( p_inst->p_libvlc_int,
+                                                  i_workers, i_threads );
+    if( p_lt->p_thumbnailer == NULL )
+    {
+        libvlc_printerr( "Cannot create the thumbnailer" );
+        free( p_lt );
+        return NULL;
+    }
+
+    libvlc_retain( p_inst );
+    p_lt->p_libvlc_instance = p_inst;
+    return p_lt;
+}
+
+void libvlc_thumbnailer_release( libvlc_thumbnailer_t *p_lt )
+{
+    vlc_thumbnailer_Release( p_lt->p_thumbnailer );
+    libvlc_release( p_lt->p_libvlc_instance );
+    free( p_lt );
+}
+
+int libvlc_thumbnailer_request( libvlc_thumbnailer_t *p_lt,
+                                libvlc_media_t *p_md, libvlc_time_t i_time,
+                                unsigned i_width, unsigned i_height,
+                                libvlc_thumbnailer_format_t i_format,
+                                libvlc_time_t i_timeout,
+                                libvlc_thumbnailer_cb cb, void *opaque )
+{
+    thumbnailer_request_t *p_req = malloc( sizeof( *p_req ) );
+    if( unlikely(p_req == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return -1;
+    }
+
+    libvlc_media_retain( p_md );
+    p_req->p_md = p_md;
+    p_req->cb = cb;
+    p_req->opaque = opaque;
+
+    vlc_fourcc_t i_codec = i_format == libvlc_thumbnailer_jpg ? VLC_CODEC_JPEG
+                                                              : VLC_CODEC_PNG;
+    if( vlc_thumbnailer_Request( p_lt->p_thumbnailer, p_md->p_input_item,
+                                 to_mtime( i_time ), i_codec,
+                                 i_width, i_height, to_mtime( i_timeout ),
+                                 thumbnailer_done, p_req ) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        libvlc_media_release( p_md );
+        free( p_req );
+        return -1;
+    }
+    return 0;
+}
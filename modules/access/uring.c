@@ -0,0 +1,495 @@
+/*****************************************************************************
+ * uring.c: asynchronous file input using Linux io_uring
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <liburing.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_access.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_interrupt.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define DEPTH_TEXT N_("Maximum reads in flight")
+#define DEPTH_LONGTEXT N_( \
+    "Maximum number of read requests queued to the kernel at once. " \
+    "The actual number adapts to the consumption rate.")
+#define READ_SIZE_TEXT N_("Maximum read size")
+#define READ_SIZE_LONGTEXT N_( \
+    "Maximum size in bytes of a single read request. " \
+    "The actual size adapts to the consumption rate.")
+#define DIRECT_TEXT N_("Direct I/O")
+#define DIRECT_LONGTEXT N_( \
+    "Bypass the page cache (O_DIRECT). This avoids evicting other data " \
+    "from the cache when reading many large files at once.")
+
+#define URING_MAX_DEPTH 64
+
+vlc_module_begin ()
+    set_shortname( N_("io_uring") )
+    set_description( N_("Asynchronous file input (io_uring)") )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_ACCESS )
+    set_capability( "access", 0 )
+    add_shortcut( "uring" )
+    add_integer_with_range( "uring-depth", 16, 2, URING_MAX_DEPTH,
+                            DEPTH_TEXT, DEPTH_LONGTEXT, true )
+    add_integer_with_range( "uring-read-size", 4 << 20, 1 << 16, 64 << 20,
+                            READ_SIZE_TEXT, READ_SIZE_LONGTEXT, true )
+    add_bool( "uring-direct", false, DIRECT_TEXT, DIRECT_LONGTEXT, true )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+#define URING_ALIGN       4096 /* offset and size alignment with O_DIRECT */
+#define URING_MIN_DEPTH   2
+#define URING_MIN_READ    (1 << 16)
+#define URING_SHRINK_HITS 32   /* reads found ready before shrinking */
+
+struct uring_read
+{
+    block_t  *p_block;
+    uint64_t  i_offset;
+    int       i_result;
+    bool      b_done;
+};
+
+struct access_sys_t
+{
+    int             fd;
+    int             efd;
+    struct io_uring ring;
+
+    /* reads in submission order, from i_head on */
+    struct uring_read reads[URING_MAX_DEPTH];
+    unsigned        i_head;
+    unsigned        i_count;
+
+    unsigned        i_depth;
+    unsigned        i_max_depth;
+    size_t          i_read_size;
+    size_t          i_max_read_size;
+    unsigned        i_hits;
+
+    size_t          i_align;  /* offset alignment, 1 without direct I/O */
+    uint64_t        i_offset; /* offset of the next read to submit */
+    uint64_t        i_pos;    /* offset of the next byte to return */
+    uint64_t        i_size;
+};
+
+static uint64_t GetSize( int fd )
+{
+    struct stat st;
+
+    if( fstat( fd, &st ) )
+        return 0;
+    if( S_ISBLK( st.st_mode ) )
+    {
+        off_t end = lseek( fd, 0, SEEK_END );
+        return ( end == (off_t)-1 ) ? 0 : end;
+    }
+    return st.st_size;
+}
+
+/**
+ * Queues reads ahead of the current offset, up to the current depth.
+ */
+static void Submit( stream_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    bool b_queued = false;
+
+    if( p_sys->i_offset >= p_sys->i_size )
+        p_sys->i_size = GetSize( p_sys->fd ); /* the file may be growing */
+    if( p_sys->i_offset >= p_sys->i_size )
+        return;
+
+    /* Direct I/O can only start at an aligned offset: the data before the
+     * current position is read again and skipped. */
+    p_sys->i_offset &= ~(uint64_t)(p_sys->i_align - 1);
+
+    while( p_sys->i_count < p_sys->i_depth
+        && p_sys->i_offset < p_sys->i_size )
+    {
+        struct io_uring_sqe *sqe = io_uring_get_sqe( &p_sys->ring );
+        if( sqe == NULL )
+            break;
+
+        /* The buffer is handed to the demuxer as is, it must be freeable */
+        void *p_buf = aligned_alloc( __MAX(p_sys->i_align, sizeof (void *)),
+                                     p_sys->i_read_size );
+        if( unlikely(p_buf == NULL) )
+            break;
+        block_t *p_block = block_heap_Alloc( p_buf, p_sys->i_read_size );
+        if( unlikely(p_block == NULL) )
+            break;
+
+        struct uring_read *p_read =
+            &p_sys->reads[(p_sys->i_head + p_sys->i_count) % URING_MAX_DEPTH];
+        p_read->p_block = p_block;
+        p_read->i_offset = p_sys->i_offset;
+        p_read->b_done = false;
+
+        io_uring_prep_read( sqe, p_sys->fd, p_block->p_buffer,
+                            p_block->i_buffer, p_read->i_offset );
+        io_uring_sqe_set_data( sqe, p_read );
+
+        p_sys->i_offset += p_block->i_buffer;
+        p_sys->i_count++;
+        b_queued = true;
+    }
+
+    if( b_queued )
+        io_uring_submit( &p_sys->ring );
+}
+
+/**
+ * Collects completed reads, waiting for one if b_wait is set.
+ */
+static void Reap( stream_t *p_access, bool b_wait )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct io_uring_cqe *cqe;
+
+    if( b_wait && io_uring_wait_cqe( &p_sys->ring, &cqe ) )
+        return;
+
+    while( io_uring_peek_cqe( &p_sys->ring, &cqe ) == 0 )
+    {
+        struct uring_read *p_read = io_uring_cqe_get_data( cqe );
+
+        p_read->i_result = cqe->res;
+        p_read->b_done = true;
+        io_uring_cqe_seen( &p_sys->ring, cqe );
+    }
+}
+
+/**
+ * Waits for all the reads in flight and discards them.
+ */
+static void Flush( stream_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    while( p_sys->i_count > 0 )
+    {
+        struct uring_read *p_read = &p_sys->reads[p_sys->i_head];
+
+        while( !p_read->b_done )
+            Reap( p_access, true );
+
+        block_Release( p_read->p_block );
+        p_sys->i_head = (p_sys->i_head + 1) % URING_MAX_DEPTH;
+        p_sys->i_count--;
+    }
+    p_sys->i_head = 0;
+}
+
+/**
+ * Follows the consumption rate: more and larger reads are queued whenever
+ * the demuxer had to wait, fewer when data is consistently ready in advance.
+ */
+static void Adapt( stream_t *p_access, bool b_starved )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( b_starved )
+    {
+        p_sys->i_hits = 0;
+        if( p_sys->i_depth < p_sys->i_max_depth )
+            p_sys->i_depth++;
+        p_sys->i_read_size = __MIN( p_sys->i_read_size * 2,
+                                    p_sys->i_max_read_size );
+    }
+    else
+    {
+        unsigned i_ready = 0;
+        for( unsigned i = 0; i < p_sys->i_count; i++ )
+            if( p_sys->reads[(p_sys->i_head + i) % URING_MAX_DEPTH].b_done )
+                i_ready++;
+
+        if( 2 * i_ready < p_sys->i_depth
+         || ++p_sys->i_hits < URING_SHRINK_HITS )
+            return;
+
+        p_sys->i_hits = 0;
+        if( p_sys->i_depth > URING_MIN_DEPTH )
+            p_sys->i_depth--;
+        /* read sizes must remain multiples of the direct I/O alignment */
+        p_sys->i_read_size = __MAX( ( p_sys->i_read_size / 2 )
+                                    & ~(size_t)(URING_ALIGN - 1),
+                                    URING_MIN_READ );
+    }
+}
+
+static block_t *Block( stream_t *p_access, bool *restrict eof )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->i_count == 0 )
+    {
+        Submit( p_access );
+        if( p_sys->i_count == 0 )
+        {
+            *eof = true;
+            return NULL;
+        }
+    }
+
+    struct uring_read *p_read = &p_sys->reads[p_sys->i_head];
+    bool b_starved = false;
+
+    Reap( p_access, false );
+    while( !p_read->b_done )
+    {
+        struct pollfd ufd = { .fd = p_sys->efd, .events = POLLIN };
+        uint64_t i_events;
+
+        b_starved = true;
+        if( vlc_poll_i11e( &ufd, 1, -1 ) < 0 )
+            return NULL;
+        if( read( p_sys->efd, &i_events, sizeof (i_events) ) < 0 && errno != EAGAIN )
+            msg_Warn( p_access, "event error: %s", vlc_strerror_c(errno) );
+        Reap( p_access, false );
+    }
+
+    block_t *p_block = p_read->p_block;
+    const uint64_t i_offset = p_read->i_offset;
+    const size_t i_requested = p_block->i_buffer;
+    const int i_result = p_read->i_result;
+
+    p_sys->i_head = (p_sys->i_head + 1) % URING_MAX_DEPTH;
+    p_sys->i_count--;
+
+    if( i_result <= 0 )
+    {
+        block_Release( p_block );
+        if( i_result == 0 )
+        {
+            *eof = true;
+            return NULL;
+        }
+        if( i_result == -EINTR || i_result == -EAGAIN )
+        {
+            /* read again from the current position */
+            Flush( p_access );
+            p_sys->i_offset = p_sys->i_pos;
+            Submit( p_access );
+            return NULL;
+        }
+        msg_Err( p_access, "read error: %s", vlc_strerror_c(-i_result) );
+        *eof = true;
+        return NULL;
+    }
+
+    p_block->i_buffer = i_result;
+    if( (size_t)i_result < i_requested )
+    {
+        /* The next reads were queued past this one: start over from its end,
+         * which is the end of the file unless it is growing. */
+        Flush( p_access );
+        p_sys->i_offset = i_offset + i_result;
+    }
+
+    /* Aligned reads start ahead of the requested position */
+    if( i_offset < p_sys->i_pos )
+    {
+        const uint64_t i_skip = p_sys->i_pos - i_offset;
+        if( i_skip >= p_block->i_buffer )
+        {
+            /* Nothing new: the file ended where the previous read stopped */
+            block_Release( p_block );
+            Flush( p_access );
+            *eof = true;
+            return NULL;
+        }
+        p_block->p_buffer += i_skip;
+        p_block->i_buffer -= i_skip;
+    }
+    p_sys->i_pos += p_block->i_buffer;
+
+    Adapt( p_access, b_starved );
+    Submit( p_access );
+    return p_block;
+}
+
+static int Seek( stream_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    Flush( p_access );
+    p_sys->i_pos = i_pos;
+    p_sys->i_offset = i_pos;
+    Submit( p_access );
+    return VLC_SUCCESS;
+}
+
+static int Control( stream_t *p_access, int i_query, va_list args )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    switch( i_query )
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg( args, bool * ) = true;
+            break;
+
+        case STREAM_GET_SIZE:
+            p_sys->i_size = GetSize( p_sys->fd );
+            *va_arg( args, uint64_t * ) = p_sys->i_size;
+            break;
+
+        case STREAM_GET_PTS_DELAY:
+            *va_arg( args, int64_t * ) = INT64_C(1000)
+                * var_InheritInteger( p_access, "file-caching" );
+            break;
+
+        case STREAM_SET_PAUSE_STATE:
+            /* Nothing to do */
+            break;
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int Open( vlc_object_t *p_this )
+{
+    stream_t *p_access = (stream_t *)p_this;
+
+    if( p_access->psz_filepath == NULL )
+        return VLC_EGENERIC;
+
+    bool b_direct = var_InheritBool( p_access, "uring-direct" );
+    int fd = vlc_open( p_access->psz_filepath,
+                       O_RDONLY | ( b_direct ? O_DIRECT : 0 ) );
+    if( fd == -1 && b_direct && errno == EINVAL )
+    {
+        msg_Warn( p_access, "direct I/O not supported" );
+        b_direct = false;
+        fd = vlc_open( p_access->psz_filepath, O_RDONLY );
+    }
+    if( fd == -1 )
+        return VLC_EGENERIC;
+
+    /* Leave directories, pipes and devices to the file system plugin */
+    struct stat st;
+    if( fstat( fd, &st ) || !( S_ISREG( st.st_mode ) || S_ISBLK( st.st_mode ) ) )
+    {
+        vlc_close( fd );
+        return VLC_EGENERIC;
+    }
+
+    access_sys_t *p_sys = vlc_malloc( p_this, sizeof (*p_sys) );
+    if( unlikely(p_sys == NULL) )
+    {
+        vlc_close( fd );
+        return VLC_ENOMEM;
+    }
+
+    p_sys->fd = fd;
+    p_sys->i_max_depth = var_InheritInteger( p_access, "uring-depth" );
+    p_sys->i_max_read_size = var_InheritInteger( p_access, "uring-read-size" );
+    p_sys->i_align = b_direct ? URING_ALIGN : 1;
+    /* with direct I/O, read sizes must remain multiples of the alignment */
+    p_sys->i_max_read_size &= ~(size_t)(URING_ALIGN - 1);
+    p_sys->i_depth = URING_MIN_DEPTH;
+    p_sys->i_read_size = URING_MIN_READ;
+    p_sys->i_hits = 0;
+    p_sys->i_head = 0;
+    p_sys->i_count = 0;
+    p_sys->i_offset = 0;
+    p_sys->i_pos = 0;
+    p_sys->i_size = GetSize( fd );
+
+    p_sys->efd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    if( p_sys->efd == -1 )
+        goto error;
+
+    int val = io_uring_queue_init( p_sys->i_max_depth, &p_sys->ring, 0 );
+    if( val )
+    {
+        msg_Dbg( p_access, "io_uring not available: %s", vlc_strerror_c(-val) );
+        vlc_close( p_sys->efd );
+        goto error;
+    }
+
+    if( io_uring_register_eventfd( &p_sys->ring, p_sys->efd ) )
+    {
+        io_uring_queue_exit( &p_sys->ring );
+        vlc_close( p_sys->efd );
+        goto error;
+    }
+
+    if( !b_direct )
+        /* In most cases, we only read the file once. */
+        posix_fadvise( fd, 0, 0, POSIX_FADV_NOREUSE );
+
+    p_access->pf_read = NULL;
+    p_access->pf_block = Block;
+    p_access->pf_seek = Seek;
+    p_access->pf_control = Control;
+    p_access->p_sys = p_sys;
+
+    /* Demuxers will need the beginning of the file for probing. */
+    Submit( p_access );
+    return VLC_SUCCESS;
+
+error:
+    vlc_close( fd );
+    return VLC_EGENERIC;
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    stream_t *p_access = (stream_t *)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
+
+    Flush( p_access );
+    io_uring_queue_exit( &p_sys->ring );
+    vlc_close( p_sys->efd );
+    vlc_close( p_sys->fd );
+}
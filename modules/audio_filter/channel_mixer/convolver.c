@@ -0,0 +1,435 @@
+/*****************************************************************************
+ * convolver.c : uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "convolver.h"
+
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# define CONVOLVER_X86 1
+#endif
+
+/*
+ * Overlap-save with a frequency domain delay line:
+ * - each block of input is transformed once, together with the previous
+ *   block (FFT size is twice the block size), and kept for as many blocks
+ *   as there are partitions,
+ * - each output is the inverse transform of the sum of the products of the
+ *   delayed input spectra with the matching impulse response partitions,
+ *   of which only the second half is kept.
+ *
+ * Spectra are stored split (real parts, then imaginary parts) and padded,
+ * so that the multiply-accumulate runs on whole vectors.
+ */
+struct convolver_t
+{
+    unsigned block;     /* B: block size, and complex FFT size */
+    unsigned stride;    /* B + 1 bins, padded */
+    unsigned inputs;
+    unsigned outputs;
+    unsigned parts;     /* partitions per impulse response */
+    unsigned head;      /* delay line slot of the latest spectrum */
+    unsigned pos;       /* frames into the current block */
+
+    float *twiddles;    /* B / 2 complex FFT factors */
+    float *rtwiddles;   /* B + 1 real FFT split factors */
+    unsigned *bitrev;
+
+    float *in;          /* per input, previous and current blocks */
+    float *out;         /* per output, current output block */
+    float *fdl;         /* per input, per partition spectrum */
+    float *ir;          /* per pair, per partition spectrum */
+    bool *active;       /* per pair, per partition: non-zero response */
+    float *acc;
+    float *work;
+
+    void (*cmac)( float *, const float *, const float *, unsigned );
+};
+
+/*****************************************************************************
+ * FFT
+ *****************************************************************************/
+/* In place, interleaved complex, unnormalized */
+static void FFT( const convolver_t *c, float *z, bool inverse )
+{
+    const unsigned n = c->block;
+
+    for( unsigned i = 0; i < n; i++ )
+    {
+        unsigned j = c->bitrev[i];
+        if( i < j )
+        {
+            float re = z[2 * i], im = z[2 * i + 1];
+            z[2 * i] = z[2 * j];
+            z[2 * i + 1] = z[2 * j + 1];
+            z[2 * j] = re;
+            z[2 * j + 1] = im;
+        }
+    }
+
+    const float sign = inverse ? -1.f : 1.f;
+    for( unsigned len = 2; len <= n; len <<= 1 )
+    {
+        const unsigned half = len / 2, step = n / len;
+        for( unsigned i = 0; i < n; i += len )
+            for( unsigned j = 0; j < half; j++ )
+            {
+                const float wr = c->twiddles[2 * j * step];
+                const float wi = sign * c->twiddles[2 * j * step + 1];
+                float *u = &z[2 * (i + j)], *v = &z[2 * (i + j + half)];
+                const float vr = v[0] * wr - v[1] * wi;
+                const float vi = v[0] * wi + v[1] * wr;
+                v[0] = u[0] - vr;
+                v[1] = u[1] - vi;
+                u[0] += vr;
+                u[1] += vi;
+            }
+    }
+}
+
+/* 2B real samples to B + 1 split bins */
+static void RealFFT( const convolver_t *c, const float *x, float *spec )
+{
+    const unsigned n = c->block;
+    float *z = c->work;
+    float *re = spec, *im = spec + c->stride;
+
+    memcpy( z, x, 2 * n * sizeof(float) );
+    FFT( c, z, false );
+
+    for( unsigned k = 0; k <= n; k++ )
+    {
+        const unsigned a = k % n, b = (n - k) % n;
+        const float er = (z[2 * a] + z[2 * b]) / 2;
+        const float ei = (z[2 * a + 1] - z[2 * b + 1]) / 2;
+        const float o_r = (z[2 * a] - z[2 * b]) / 2;
+        const float o_i = (z[2 * a + 1] + z[2 * b + 1]) / 2;
+        const float wr = c->rtwiddles[2 * k], wi = c->rtwiddles[2 * k + 1];
+        const float tr = wr * o_r - wi * o_i;
+        const float ti = wr * o_i + wi * o_r;
+        re[k] = er + ti;
+        im[k] = ei - tr;
+    }
+}
+
+/* B + 1 split bins to 2B real samples, scaled by B */
+static void RealIFFT( const convolver_t *c, const float *spec, float *x )
+{
+    const unsigned n = c->block;
+    const float *re = spec, *im = spec + c->stride;
+
+    for( unsigned k = 0; k < n; k++ )
+    {
+        const float er = (re[k] + re[n - k]) / 2;
+        const float ei = (im[k] - im[n - k]) / 2;
+        const float dr = (re[k] - re[n - k]) / 2;
+        const float di = (im[k] + im[n - k]) / 2;
+        /* times the conjugate factor */
+        const float wr = c->rtwiddles[2 * k], wi = -c->rtwiddles[2 * k + 1];
+        const float o_r = dr * wr - di * wi;
+        const float o_i = dr * wi + di * wr;
+        x[2 * k] = er - o_i;
+        x[2 * k + 1] = ei + o_r;
+    }
+    FFT( c, x, true );
+}
+
+/*****************************************************************************
+ * Complex multiply-accumulate: acc += x * h
+ *****************************************************************************/
+static void CMAC_c( float *acc, const float *x, const float *h, unsigned n )
+{
+    float *ar = acc, *ai = acc + n;
+    const float *xr = x, *xi = x + n, *hr = h, *hi = h + n;
+
+    for( unsigned k = 0; k < n; k++ )
+    {
+        ar[k] += xr[k] * hr[k] - xi[k] * hi[k];
+        ai[k] += xr[k] * hi[k] + xi[k] * hr[k];
+    }
+}
+
+#ifdef CONVOLVER_X86
+__attribute__ ((__target__ ("sse")))
+static void CMAC_sse( float *acc, const float *x, const float *h, unsigned n )
+{
+    float *ar = acc, *ai = acc + n;
+    const float *xr = x, *xi = x + n, *hr = h, *hi = h + n;
+
+    for( unsigned k = 0; k < n; k += 4 )
+    {
+        __m128 a = _mm_loadu_ps( xr + k ), b = _mm_loadu_ps( xi + k );
+        __m128 c = _mm_loadu_ps( hr + k ), d = _mm_loadu_ps( hi + k );
+        _mm_storeu_ps( ar + k, _mm_add_ps( _mm_loadu_ps( ar + k ),
+                       _mm_sub_ps( _mm_mul_ps( a, c ), _mm_mul_ps( b, d ) ) ) );
+        _mm_storeu_ps( ai + k, _mm_add_ps( _mm_loadu_ps( ai + k ),
+                       _mm_add_ps( _mm_mul_ps( a, d ), _mm_mul_ps( b, c ) ) ) );
+    }
+}
+
+__attribute__ ((__target__ ("avx")))
+static void CMAC_avx( float *acc, const float *x, const float *h, unsigned n )
+{
+    float *ar = acc, *ai = acc + n;
+    const float *xr = x, *xi = x + n, *hr = h, *hi = h + n;
+
+    for( unsigned k = 0; k < n; k += 8 )
+    {
+        __m256 a = _mm256_loadu_ps( xr + k ), b = _mm256_loadu_ps( xi + k );
+        __m256 c = _mm256_loadu_ps( hr + k ), d = _mm256_loadu_ps( hi + k );
+        _mm256_storeu_ps( ar + k, _mm256_add_ps( _mm256_loadu_ps( ar + k ),
+                _mm256_sub_ps( _mm256_mul_ps( a, c ), _mm256_mul_ps( b, d ) ) ) );
+        _mm256_storeu_ps( ai + k, _mm256_add_ps( _mm256_loadu_ps( ai + k ),
+                _mm256_add_ps( _mm256_mul_ps( a, d ), _mm256_mul_ps( b, c ) ) ) );
+    }
+}
+#endif
+
+/*****************************************************************************
+ * Convolver
+ *****************************************************************************/
+static inline size_t SpecSize( const convolver_t *c )
+{
+    return 2 * c->stride;
+}
+
+static float *DelaySlot( const convolver_t *c, unsigned input, unsigned slot )
+{
+    return c->fdl + ((size_t)input * c->parts + slot) * SpecSize( c );
+}
+
+static size_t PairIndex( const convolver_t *c, unsigned input,
+                         unsigned output, unsigned part )
+{
+    return ((size_t)input * c->outputs + output) * c->parts + part;
+}
+
+convolver_t *convolver_New( unsigned block, unsigned inputs,
+                            unsigned outputs, size_t length )
+{
+    if( block < 16 || (block & (block - 1)) || !inputs || !outputs )
+        return NULL;
+
+    convolver_t *c = calloc( 1, sizeof(*c) );
+    if( unlikely(c == NULL) )
+        return NULL;
+
+    c->block = block;
+    c->stride = (block + 1 + 7) & ~7u; /* whole AVX vectors */
+    c->inputs = inputs;
+    c->outputs = outputs;
+    c->parts = __MAX( 1, (length + block - 1) / block );
+
+    const size_t spec = SpecSize( c );
+    c->twiddles = malloc( block * sizeof(float) );
+    c->rtwiddles = malloc( 2 * (block + 1) * sizeof(float) );
+    c->bitrev = malloc( block * sizeof(unsigned) );
+    c->in = calloc( (size_t)inputs * 2 * block, sizeof(float) );
+    c->out = calloc( (size_t)outputs * block, sizeof(float) );
+    c->fdl = calloc( (size_t)inputs * c->parts * spec, sizeof(float) );
+    c->ir = calloc( (size_t)inputs * outputs * c->parts * spec, sizeof(float) );
+    c->active = calloc( (size_t)inputs * outputs * c->parts, sizeof(bool) );
+    c->acc = malloc( spec * sizeof(float) );
+    c->work = malloc( 2 * block * sizeof(float) );
+    if( !c->twiddles || !c->rtwiddles || !c->bitrev || !c->in || !c->out
+     || !c->fdl || !c->ir || !c->active || !c->acc || !c->work )
+    {
+        convolver_Delete( c );
+        return NULL;
+    }
+
+    for( unsigned k = 0; k < block / 2; k++ )
+    {
+        c->twiddles[2 * k] = cos( 2. * M_PI * k / block );
+        c->twiddles[2 * k + 1] = -sin( 2. * M_PI * k / block );
+    }
+    for( unsigned k = 0; k <= block; k++ )
+    {
+        c->rtwiddles[2 * k] = cos( M_PI * k / block );
+        c->rtwiddles[2 * k + 1] = -sin( M_PI * k / block );
+    }
+    unsigned bits = 0;
+    while( (1u << bits) < block )
+        bits++;
+    for( unsigned i = 0; i < block; i++ )
+    {
+        unsigned r = 0;
+        for( unsigned b = 0; b < bits; b++ )
+            if( i & (1u << b) )
+                r |= 1u << (bits - 1 - b);
+        c->bitrev[i] = r;
+    }
+
+    c->cmac = CMAC_c;
+#ifdef CONVOLVER_X86
+    if( vlc_CPU_AVX() )
+        c->cmac = CMAC_avx;
+    else if( vlc_CPU_SSE() )
+        c->cmac = CMAC_sse;
+#endif
+    return c;
+}
+
+void convolver_Delete( convolver_t *c )
+{
+    free( c->twiddles );
+    free( c->rtwiddles );
+    free( c->bitrev );
+    free( c->in );
+    free( c->out );
+    free( c->fdl );
+    free( c->ir );
+    free( c->active );
+    free( c->acc );
+    free( c->work );
+    free( c );
+}
+
+int convolver_SetResponse( convolver_t *c, unsigned input, unsigned output,
+                           const float *ir, size_t length )
+{
+    const unsigned block = c->block;
+    /* RealIFFT() scales by the block size */
+    const float scale = 1.f / block;
+    float *time = malloc( 2 * block * sizeof(float) );
+    if( unlikely(time == NULL) )
+        return VLC_ENOMEM;
+
+    length = __MIN( length, (size_t)c->parts * block );
+    for( unsigned p = 0; p < c->parts; p++ )
+    {
+        const size_t i = PairIndex( c, input, output, p );
+        float *spec = c->ir + i * SpecSize( c );
+        size_t len = 0;
+        bool nonzero = false;
+
+        if( (size_t)p * block < length )
+            len = __MIN( block, length - (size_t)p * block );
+        for( size_t j = 0; j < len; j++ )
+        {
+            time[j] = ir[(size_t)p * block + j] * scale;
+            nonzero |= time[j] != 0.f;
+        }
+        memset( time + len, 0, (2 * block - len) * sizeof(float) );
+
+        c->active[i] = nonzero;
+        memset( spec, 0, SpecSize( c ) * sizeof(float) );
+        if( nonzero )
+            RealFFT( c, time, spec );
+    }
+    free( time );
+    return VLC_SUCCESS;
+}
+
+static void ProcessBlock( convolver_t *c )
+{
+    const unsigned block = c->block;
+    const size_t spec = SpecSize( c );
+
+    c->head = (c->head + 1) % c->parts;
+    for( unsigned i = 0; i < c->inputs; i++ )
+    {
+        float *in = c->in + (size_t)i * 2 * block;
+        RealFFT( c, in, DelaySlot( c, i, c->head ) );
+        memcpy( in, in + block, block * sizeof(float) );
+    }
+
+    for( unsigned o = 0; o < c->outputs; o++ )
+    {
+        float *out = c->out + (size_t)o * block;
+        bool any = false;
+
+        memset( c->acc, 0, spec * sizeof(float) );
+        for( unsigned i = 0; i < c->inputs; i++ )
+            for( unsigned p = 0; p < c->parts; p++ )
+            {
+                const size_t idx = PairIndex( c, i, o, p );
+                if( !c->active[idx] )
+                    continue;
+                unsigned slot = (c->head + c->parts - p) % c->parts;
+                c->cmac( c->acc, DelaySlot( c, i, slot ),
+                         c->ir + idx * spec, c->stride );
+                any = true;
+            }
+
+        if( any )
+        {
+            RealIFFT( c, c->acc, c->work );
+            memcpy( out, c->work + block, block * sizeof(float) );
+        }
+        else
+            memset( out, 0, block * sizeof(float) );
+    }
+}
+
+void convolver_Process( convolver_t *c, const float *in, float *out,
+                        size_t frames )
+{
+    const unsigned block = c->block;
+
+    while( frames > 0 )
+    {
+        size_t n = __MIN( frames, block - c->pos );
+
+        for( unsigned i = 0; i < c->inputs; i++ )
+        {
+            float *dst = c->in + (size_t)i * 2 * block + block + c->pos;
+            for( size_t f = 0; f < n; f++ )
+                dst[f] = in[f * c->inputs + i];
+        }
+        for( unsigned o = 0; o < c->outputs; o++ )
+        {
+            const float *src = c->out + (size_t)o * block + c->pos;
+            for( size_t f = 0; f < n; f++ )
+                out[f * c->outputs + o] = src[f];
+        }
+
+        in += n * c->inputs;
+        out += n * c->outputs;
+        frames -= n;
+        c->pos += n;
+        if( c->pos == block )
+        {
+            ProcessBlock( c );
+            c->pos = 0;
+        }
+    }
+}
+
+void convolver_Reset( convolver_t *c )
+{
+    const size_t spec = SpecSize( c );
+
+    memset( c->in, 0, (size_t)c->inputs * 2 * c->block * sizeof(float) );
+    memset( c->out, 0, (size_t)c->outputs * c->block * sizeof(float) );
+    memset( c->fdl, 0, (size_t)c->inputs * c->parts * spec * sizeof(float) );
+    c->head = 0;
+    c->pos = 0;
+}
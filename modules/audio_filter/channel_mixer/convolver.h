@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * convolver.h : uniformly partitioned FFT convolution
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CONVOLVER_H
+#define VLC_CONVOLVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Convolves a set of input channels with a matrix of impulse responses, one
+ * per input and output channel pair, and sums the results per output
+ * channel. Impulse responses are cut in partitions of one block, so that
+ * the cost grows linearly with their length, and the latency is one block.
+ */
+typedef struct convolver_t convolver_t;
+
+/**
+ * Creates a convolver.
+ *
+ * \param block block size in frames, a power of two: this is the latency
+ * \param inputs number of input channels
+ * \param outputs number of output channels
+ * \param length maximum impulse response length in frames
+ * \return the convolver, or NULL on error
+ */
+convolver_t *convolver_New( unsigned block, unsigned inputs,
+                            unsigned outputs, size_t length );
+void convolver_Delete( convolver_t * );
+
+/**
+ * Sets the impulse response from an input to an output channel.
+ * Pairs without response do not cost anything.
+ *
+ * \param ir impulse response, up to the length given at creation
+ * \return VLC_SUCCESS or VLC_ENOMEM
+ */
+int convolver_SetResponse( convolver_t *, unsigned input, unsigned output,
+                           const float *ir, size_t length );
+
+/**
+ * Processes interleaved frames.
+ *
+ * Output frames lag the input frames by exactly one block.
+ */
+void convolver_Process( convolver_t *, const float *in, float *out,
+                        size_t frames );
+
+/**
+ * Clears the signal history.
+ */
+void convolver_Reset( convolver_t * );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -39,12 +39,15 @@
 #include <vlc_filter.h>
 #include <vlc_block.h>
 
+#include "convolver.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static int  OpenFilter ( vlc_object_t * );
 static void CloseFilter( vlc_object_t * );
 static block_t *Convert( filter_t *, block_t * );
+static void Flush( filter_t * );
 
 /*****************************************************************************
  * Module descriptor
@@ -72,6 +75,17 @@ static block_t *Convert( filter_t *, block_t * );
      "Dolby Surround encoded streams won't be decoded before being " \
      "processed by this filter. Enabling this setting is not recommended.")
 
+#define HEADPHONE_ROOM_TEXT N_("Room reverberation time")
+#define HEADPHONE_ROOM_LONGTEXT N_( \
+     "Reverberation time of the virtual room in milliseconds. Each speaker " \
+     "then gets a diffuse tail in addition to its direct path. 0 disables it.")
+
+#define HEADPHONE_BLOCK_TEXT N_("Block size")
+#define HEADPHONE_BLOCK_LONGTEXT N_( \
+     "Number of samples processed at once (rounded down to a power of two). " \
+     "This is also the latency added by the filter: smaller blocks lower " \
+     "the latency but cost more CPU time.")
+
 vlc_module_begin ()
     set_description( N_("Headphone virtual spatialization effect") )
     set_shortname( N_("Headphone effect") )
@@ -85,6 +99,11 @@ vlc_module_begin ()
               HEADPHONE_COMPENSATE_LONGTEXT, true )
     add_bool( "headphone-dolby", false, HEADPHONE_DOLBY_TEXT,
               HEADPHONE_DOLBY_LONGTEXT, true )
+    add_integer_with_range( "headphone-room", 0, 0, 5000, HEADPHONE_ROOM_TEXT,
+                            HEADPHONE_ROOM_LONGTEXT, true )
+    add_integer_with_range( "headphone-block", 256, 16, 8192,
+                            HEADPHONE_BLOCK_TEXT, HEADPHONE_BLOCK_LONGTEXT,
+                            true )
 
     set_capability( "audio filter", 0 )
     set_callbacks( OpenFilter, CloseFilter )
@@ -105,10 +124,9 @@ struct atomic_operation_t
 
 struct filter_sys_t
 {
-    size_t i_overflow_buffer_size;/* in bytes */
-    float * p_overflow_buffer;
     unsigned int i_nb_atomic_operations;
     struct atomic_operation_t * p_atomic_operations;
+    convolver_t * p_convolver;
 };
 
 /*****************************************************************************
@@ -196,7 +214,6 @@ static int Init( vlc_object_t *p_this, struct filter_sys_t * p_data
     double d_min = 0;
     unsigned int i_next_atomic_operation;
     int i_source_channel_offset;
-    unsigned int i;
 
     if( var_InheritBool( p_this, "headphone-compensate" ) )
     {
@@ -304,131 +321,99 @@ static int Init( vlc_object_t *p_this, struct filter_sys_t * p_data
         i_source_channel_offset++;
     }
 
-    /* Initialize the overflow buffer
-     * we need it because the process induce a delay in the samples */
-    p_data->i_overflow_buffer_size = 0;
-    for( i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
-    {
-        if( p_data->i_overflow_buffer_size
-                < p_data->p_atomic_operations[i].i_delay * 2 * sizeof (float) )
-        {
-            p_data->i_overflow_buffer_size
-                = p_data->p_atomic_operations[i].i_delay * 2 * sizeof (float);
-        }
-    }
-    p_data->p_overflow_buffer = malloc( p_data->i_overflow_buffer_size );
-    if( p_data->p_overflow_buffer == NULL )
-    {
-        free( p_data->p_atomic_operations );
-        return -1;
-    }
-    memset( p_data->p_overflow_buffer, 0 , p_data->i_overflow_buffer_size );
-
     return 0;
 }
 
 /*****************************************************************************
- * DoWork: convert a buffer
+ * InitResponses: turn the atomic operations into one impulse response per
+ * source channel and ear, and load them into the convolver
  *****************************************************************************/
-static void DoWork( filter_t * p_filter,
-                    block_t * p_in_buf, block_t * p_out_buf )
+static int InitResponses( vlc_object_t *p_this, struct filter_sys_t * p_data
+        , unsigned int i_nb_channels, unsigned int i_rate )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
-    int i_input_nb = aout_FormatNbChannels( &p_filter->fmt_in.audio );
-    int i_output_nb = aout_FormatNbChannels( &p_filter->fmt_out.audio );
-
-    float * p_in = (float*) p_in_buf->p_buffer;
-    float * p_out;
-    uint8_t * p_overflow;
-    uint8_t * p_end_overflow;
-    uint8_t * p_slide;
-
-    size_t i_overflow_size;     /* in bytes */
-    size_t i_out_size;          /* in bytes */
-
-    unsigned int i, j;
-
-    int i_source_channel_offset;
-    int i_dest_channel_offset;
-    unsigned int i_delay;
-    double d_amplitude_factor;
-
-    p_out = (float *)p_out_buf->p_buffer;
-    i_out_size = p_out_buf->i_buffer;
-
-    /* Slide the overflow buffer */
-    p_overflow = (uint8_t *) p_sys->p_overflow_buffer;
-    i_overflow_size = p_sys->i_overflow_buffer_size;
-    p_end_overflow = p_overflow + i_overflow_size;
-
-    memset( p_out, 0, i_out_size );
-    memcpy( p_out, p_overflow, __MIN( i_out_size, i_overflow_size ) );
-
-    p_slide = (uint8_t *) p_sys->p_overflow_buffer;
-    while( p_slide < p_end_overflow )
+    unsigned int i_room = var_InheritInteger( p_this, "headphone-room" );
+    unsigned int i_block = var_InheritInteger( p_this, "headphone-block" );
+    size_t i_direct = 0, i_tail, i_length;
+    float *p_ir;
+
+    /* the convolver works on power of two blocks */
+    i_block = __MAX( i_block, 16 );
+    while( i_block & (i_block - 1) )
+        i_block &= i_block - 1;
+
+    for( unsigned int i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
+        i_direct = __MAX( i_direct, p_data->p_atomic_operations[i].i_delay );
+    i_direct++;
+    i_tail = (size_t)i_room * i_rate / 1000;
+    i_length = i_direct + i_tail;
+
+    p_data->p_convolver = convolver_New( i_block, i_nb_channels, 2,
+                                         i_length );
+    p_ir = malloc( i_length * sizeof(float) );
+    if( p_data->p_convolver == NULL || p_ir == NULL )
     {
-        size_t i_bytes_copied;
-
-        if( p_slide + i_out_size < p_end_overflow )
-        {
-            memset( p_slide, 0, i_out_size );
-            if( p_slide + 2 * i_out_size < p_end_overflow )
-                i_bytes_copied = i_out_size;
-            else
-                i_bytes_copied = p_end_overflow - ( p_slide + i_out_size );
-            memcpy( p_slide, p_slide + i_out_size, i_bytes_copied );
-        }
-        else
-        {
-            i_bytes_copied = p_end_overflow - p_slide;
-            memset( p_slide, 0, i_bytes_copied );
-        }
-        p_slide += i_bytes_copied;
+        free( p_ir );
+        return -1;
     }
+    msg_Dbg( p_this, "%zu samples long responses, %u samples latency",
+             i_length, i_block );
 
-    /* apply the atomic operations */
-    for( i = 0; i < p_sys->i_nb_atomic_operations; i++ )
-    {
-        /* shorter variable names */
-        i_source_channel_offset
-            = p_sys->p_atomic_operations[i].i_source_channel_offset;
-        i_dest_channel_offset
-            = p_sys->p_atomic_operations[i].i_dest_channel_offset;
-        i_delay = p_sys->p_atomic_operations[i].i_delay;
-        d_amplitude_factor
-            = p_sys->p_atomic_operations[i].d_amplitude_factor;
-
-        if( p_out_buf->i_nb_samples > i_delay )
+    for( unsigned int i_source = 0 ; i_source < i_nb_channels ; i_source++ )
+        for( unsigned int i_ear = 0 ; i_ear < 2 ; i_ear++ )
         {
-            /* current buffer coefficients */
-            for( j = 0; j < p_out_buf->i_nb_samples - i_delay; j++ )
+            double d_direct = 0.;
+            bool b_used = false;
+
+            memset( p_ir, 0, i_length * sizeof(float) );
+            for( unsigned int i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
             {
-                ((float*)p_out)[ (i_delay+j)*i_output_nb + i_dest_channel_offset ]
-                    += p_in[ j * i_input_nb + i_source_channel_offset ]
-                       * d_amplitude_factor;
+                const struct atomic_operation_t *p_op =
+                    &p_data->p_atomic_operations[i];
+
+                if( p_op->i_source_channel_offset != (int)i_source
+                 || p_op->i_dest_channel_offset != (int)i_ear )
+                    continue;
+                /* the center channel has two virtual speakers */
+                p_ir[p_op->i_delay] += p_op->d_amplitude_factor;
+                d_direct += p_op->d_amplitude_factor;
+                b_used = true;
             }
+            if( !b_used )
+                continue;
 
-            /* overflow buffer coefficients */
-            for( j = 0; j < i_delay; j++ )
+            /* Diffuse tail: decaying noise, 60 dB down after i_tail samples,
+             * uncorrelated between the ears */
+            uint32_t i_seed = 0x9E3779B9u * (2 * i_source + i_ear + 1);
+            for( size_t j = 0 ; j < i_tail ; j++ )
             {
-                ((float*)p_overflow)[ j*i_output_nb + i_dest_channel_offset ]
-                    += p_in[ (p_out_buf->i_nb_samples - i_delay + j)
-                       * i_input_nb + i_source_channel_offset ]
-                       * d_amplitude_factor;
+                i_seed = i_seed * 1664525u + 1013904223u;
+                float f_noise = (int32_t)i_seed / 2147483648.f;
+                p_ir[i_direct + j] += 0.25f * d_direct * f_noise
+                                    * powf( 10.f, -3.f * j / i_tail );
             }
-        }
-        else
-        {
-            /* overflow buffer coefficients only */
-            for( j = 0; j < p_out_buf->i_nb_samples; j++ )
+
+            if( convolver_SetResponse( p_data->p_convolver, i_source, i_ear,
+                                       p_ir, i_length ) != VLC_SUCCESS )
             {
-                ((float*)p_overflow)[ (i_delay - p_out_buf->i_nb_samples + j)
-                                        * i_output_nb + i_dest_channel_offset ]
-                    += p_in[ j * i_input_nb + i_source_channel_offset ]
-                       * d_amplitude_factor;
+                free( p_ir );
+                return -1;
             }
         }
-    }
+
+    free( p_ir );
+    return 0;
+}
+
+/*****************************************************************************
+ * DoWork: convert a buffer
+ *****************************************************************************/
+static void DoWork( filter_t * p_filter,
+                    block_t * p_in_buf, block_t * p_out_buf )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    convolver_Process( p_sys->p_convolver, (const float *)p_in_buf->p_buffer,
+                       (float *)p_out_buf->p_buffer, p_in_buf->i_nb_samples );
 }
 
 /*
@@ -450,17 +435,30 @@ static int OpenFilter( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    /* Request a specific format if not already compatible, before the responses
+     * are computed for the input channels */
+    p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    p_filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
+    p_filter->fmt_out.audio.i_rate = p_filter->fmt_in.audio.i_rate;
+    p_filter->fmt_in.audio.i_chan_mode =
+                                   p_filter->fmt_out.audio.i_chan_mode;
+    if( p_filter->fmt_in.audio.i_physical_channels == AOUT_CHANS_STEREO
+     && (p_filter->fmt_in.audio.i_chan_mode & AOUT_CHANMODE_DOLBYSTEREO)
+     && !var_InheritBool( p_filter, "headphone-dolby" ) )
+    {
+        p_filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_5_0;
+    }
+
     /* Allocate the memory needed to store the module's structure */
     p_sys = p_filter->p_sys = malloc( sizeof(struct filter_sys_t) );
     if( p_sys == NULL )
         return VLC_ENOMEM;
-    p_sys->i_overflow_buffer_size = 0;
-    p_sys->p_overflow_buffer = NULL;
     p_sys->i_nb_atomic_operations = 0;
     p_sys->p_atomic_operations = NULL;
+    p_sys->p_convolver = NULL;
 
-    if( Init( VLC_OBJECT(p_filter), p_sys
-                , aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
+    unsigned i_nb_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    if( Init( VLC_OBJECT(p_filter), p_sys, i_nb_channels
                 , p_filter->fmt_in.audio.i_physical_channels
                 , p_filter->fmt_in.audio.i_rate ) < 0 )
     {
@@ -468,19 +466,22 @@ static int OpenFilter( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
-    /* Request a specific format if not already compatible */
-    p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
-    p_filter->fmt_out.audio.i_format = VLC_CODEC_FL32;
-    p_filter->fmt_out.audio.i_rate = p_filter->fmt_in.audio.i_rate;
-    p_filter->fmt_in.audio.i_chan_mode =
-                                   p_filter->fmt_out.audio.i_chan_mode;
-    if( p_filter->fmt_in.audio.i_physical_channels == AOUT_CHANS_STEREO
-     && (p_filter->fmt_in.audio.i_chan_mode & AOUT_CHANMODE_DOLBYSTEREO)
-     && !var_InheritBool( p_filter, "headphone-dolby" ) )
+    if( InitResponses( VLC_OBJECT(p_filter), p_sys, i_nb_channels
+                     , p_filter->fmt_in.audio.i_rate ) < 0 )
     {
-        p_filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_5_0;
+        if( p_sys->p_convolver != NULL )
+            convolver_Delete( p_sys->p_convolver );
+        free( p_sys->p_atomic_operations );
+        free( p_sys );
+        return VLC_EGENERIC;
     }
+    /* the responses now hold the atomic operations */
+    free( p_sys->p_atomic_operations );
+    p_sys->p_atomic_operations = NULL;
+    p_sys->i_nb_atomic_operations = 0;
+
     p_filter->pf_audio_filter = Convert;
+    p_filter->pf_flush = Flush;
 
     aout_FormatPrepare(&p_filter->fmt_in.audio);
     aout_FormatPrepare(&p_filter->fmt_out.audio);
@@ -495,11 +496,16 @@ static void CloseFilter( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
 
-    free( p_filter->p_sys->p_overflow_buffer );
+    convolver_Delete( p_filter->p_sys->p_convolver );
     free( p_filter->p_sys->p_atomic_operations );
     free( p_filter->p_sys );
 }
 
+static void Flush( filter_t *p_filter )
+{
+    convolver_Reset( p_filter->p_sys->p_convolver );
+}
+
 static block_t *Convert( filter_t *p_filter, block_t *p_block )
 {
     if( !p_block || !p_block->i_nb_samples )
@@ -513,7 +519,7 @@ static block_t *Convert( filter_t *p_filter, block_t *p_block )
         aout_FormatNbChannels( &(p_filter->fmt_out.audio) ) /
         aout_FormatNbChannels( &(p_filter->fmt_in.audio) );
 
-    block_t *p_out = block_Alloc( i_out_size );
+    block_t *p_out = filter_NewAudioBuffer( p_filter, i_out_size );
     if( !p_out )
     {
         msg_Warn( p_filter, "can't get output buffer" );
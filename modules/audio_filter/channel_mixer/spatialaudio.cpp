@@ -51,6 +51,11 @@
 #define HRTF_FILE_LONGTEXT N_("To use a custom HRTF (Head-related transfer function)" \
                               "in the SOFA format.")
 
+#define BLOCK_TEXT N_("Block size")
+#define BLOCK_LONGTEXT N_("Number of samples rendered at once. This is also " \
+                          "the latency of the renderer: smaller blocks lower " \
+                          "the latency but cost more CPU time.")
+
 #define HEADPHONES_TEXT N_("Headphones mode (binaural)")
 #define HEADPHONES_LONGTEXT N_("If the output is stereo, render ambisonics " \
                                "with the binaural decoder.")
@@ -70,6 +75,8 @@ vlc_module_begin()
              HEADPHONES_TEXT, HEADPHONES_LONGTEXT, true)
     add_loadfile("hrtf-file", NULL,
                  HRTF_FILE_TEXT, HRTF_FILE_LONGTEXT, true)
+    add_integer_with_range(CFG_PREFIX "block", 1024, 64, 8192,
+                           BLOCK_TEXT, BLOCK_LONGTEXT, true)
     add_shortcut("ambisonics")
 
     add_submodule()
@@ -79,8 +86,6 @@ vlc_module_begin()
     add_shortcut("binauralizer")
 vlc_module_end()
 
-#define AMB_BLOCK_TIME_LEN 1024
-
 struct filter_sys_t
 {
     filter_sys_t()
@@ -122,6 +127,7 @@ struct filter_sys_t
     mtime_t i_inputPTS;
     unsigned i_rate;
     unsigned i_order;
+    unsigned i_blockLen;
 
     float** inBuf;
     float** outBuf;
@@ -169,18 +175,18 @@ static block_t *Mix( filter_t *p_filter, block_t *p_buf )
     p_sys->inputSamples.resize(i_prevSize + p_buf->i_nb_samples * p_sys->i_inputNb);
     memcpy((char*)(p_sys->inputSamples.data() + i_prevSize), (char*)p_buf->p_buffer, p_buf->i_buffer);
 
-    const size_t i_inputBlockSize = sizeof(float) * p_sys->i_inputNb * AMB_BLOCK_TIME_LEN;
-    const size_t i_outputBlockSize = sizeof(float) * p_sys->i_outputNb * AMB_BLOCK_TIME_LEN;
+    const size_t i_inputBlockSize = sizeof(float) * p_sys->i_inputNb * p_sys->i_blockLen;
+    const size_t i_outputBlockSize = sizeof(float) * p_sys->i_outputNb * p_sys->i_blockLen;
     const size_t i_nbBlocks = p_sys->inputSamples.size() * sizeof(float) / i_inputBlockSize;
 
-    block_t *p_out_buf = block_Alloc(i_outputBlockSize * i_nbBlocks);
+    block_t *p_out_buf = filter_NewAudioBuffer(p_filter, i_outputBlockSize * i_nbBlocks);
     if (unlikely(p_out_buf == NULL))
     {
         block_Release(p_buf);
         return NULL;
     }
 
-    p_out_buf->i_nb_samples = i_nbBlocks * AMB_BLOCK_TIME_LEN;
+    p_out_buf->i_nb_samples = i_nbBlocks * p_sys->i_blockLen;
     if (p_sys->i_inputPTS == 0)
         p_out_buf->i_pts = p_buf->i_pts;
     else
@@ -195,9 +201,9 @@ static block_t *Mix( filter_t *p_filter, block_t *p_buf )
     {
         for (unsigned i = 0; i < p_sys->i_inputNb; ++i)
         {
-            for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
+            for (unsigned j = 0; j < p_sys->i_blockLen; ++j)
             {
-                float val = p_src[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_inputNb + i];
+                float val = p_src[(b * p_sys->i_blockLen + j) * p_sys->i_inputNb + i];
                 p_sys->inBuf[i][j] = val;
             }
         }
@@ -212,10 +218,10 @@ static block_t *Mix( filter_t *p_filter, block_t *p_buf )
             case filter_sys_t::AMBISONICS_BINAURAL_DECODER:
             {
                 CBFormat inData;
-                inData.Configure(p_sys->i_order, true, AMB_BLOCK_TIME_LEN);
+                inData.Configure(p_sys->i_order, true, p_sys->i_blockLen);
 
                 for (unsigned i = 0; i < p_sys->i_inputNb; ++i)
-                    inData.InsertStream(p_sys->inBuf[i], i, AMB_BLOCK_TIME_LEN);
+                    inData.InsertStream(p_sys->inBuf[i], i, p_sys->i_blockLen);
 
                 Orientation ori(p_sys->f_teta, p_sys->f_phi, p_sys->f_roll);
                 p_sys->processor.SetOrientation(ori);
@@ -238,8 +244,8 @@ static block_t *Mix( filter_t *p_filter, block_t *p_buf )
 
         // Interleave the results.
         for (unsigned i = 0; i < p_sys->i_outputNb; ++i)
-            for (unsigned j = 0; j < AMB_BLOCK_TIME_LEN; ++j)
-                p_dest[(b * AMB_BLOCK_TIME_LEN + j) * p_sys->i_outputNb + i] = p_sys->outBuf[i][j];
+            for (unsigned j = 0; j < p_sys->i_blockLen; ++j)
+                p_dest[(b * p_sys->i_blockLen + j) * p_sys->i_outputNb + i] = p_sys->outBuf[i][j];
     }
 
     p_sys->inputSamples.erase(p_sys->inputSamples.begin(),
@@ -284,7 +290,7 @@ static int allocateBuffers(filter_sys_t *p_sys)
 
     for (unsigned i = 0; i < p_sys->i_inputNb; ++i)
     {
-        p_sys->inBuf[i] = (float *)malloc(AMB_BLOCK_TIME_LEN * sizeof(float));
+        p_sys->inBuf[i] = (float *)malloc(p_sys->i_blockLen * sizeof(float));
         if (p_sys->inBuf[i] == NULL)
             return VLC_ENOMEM;
     }
@@ -295,7 +301,7 @@ static int allocateBuffers(filter_sys_t *p_sys)
 
     for (unsigned i = 0; i < p_sys->i_outputNb; ++i)
     {
-        p_sys->outBuf[i] = (float *)malloc(AMB_BLOCK_TIME_LEN * sizeof(float));
+        p_sys->outBuf[i] = (float *)malloc(p_sys->i_blockLen * sizeof(float));
         if (p_sys->outBuf[i] == NULL)
             return VLC_ENOMEM;
     }
@@ -316,6 +322,7 @@ static int OpenBinauralizer(vlc_object_t *p_this)
 
     p_sys->mode = filter_sys_t::BINAURALIZER;
     p_sys->i_rate = p_filter->fmt_in.audio.i_rate;
+    p_sys->i_blockLen = var_InheritInteger(p_filter, CFG_PREFIX "block");
     p_sys->i_inputNb = p_filter->fmt_in.audio.i_channels;
     p_sys->i_outputNb = 2;
 
@@ -360,7 +367,7 @@ static int OpenBinauralizer(vlc_object_t *p_this)
     msg_Dbg(p_filter, "Using the HRTF file: %s", HRTFPath.c_str());
 
     unsigned i_tailLength = 0;
-    if (!p_sys->binauralizer.Configure(p_sys->i_rate, AMB_BLOCK_TIME_LEN,
+    if (!p_sys->binauralizer.Configure(p_sys->i_rate, p_sys->i_blockLen,
                                        p_sys->speakers, infmt->i_channels, i_tailLength,
                                        HRTFPath))
     {
@@ -409,6 +416,10 @@ static int Open(vlc_object_t *p_this)
     p_sys->i_inputNb = p_filter->fmt_in.audio.i_channels;
     p_sys->i_outputNb = p_filter->fmt_out.audio.i_channels;
 
+    static const char *const options[] = { "headphones", "block", NULL };
+    config_ChainParse(p_filter, CFG_PREFIX, options, p_filter->p_cfg);
+    p_sys->i_blockLen = var_InheritInteger(p_filter, CFG_PREFIX "block");
+
     if (allocateBuffers(p_sys) != VLC_SUCCESS)
     {
         delete p_sys;
@@ -426,9 +437,6 @@ static int Open(vlc_object_t *p_this)
 
     msg_Dbg(p_filter, "Order: %d %d", p_sys->i_order, infmt->i_channels);
 
-    static const char *const options[] = { "headphones", NULL };
-    config_ChainParse(p_filter, CFG_PREFIX, options, p_filter->p_cfg);
-
     unsigned i_tailLength = 0;
     if (p_filter->fmt_out.audio.i_channels == 2
      && var_InheritBool(p_filter, CFG_PREFIX "headphones"))
@@ -439,7 +447,7 @@ static int Open(vlc_object_t *p_this)
         msg_Dbg(p_filter, "Using the HRTF file: %s", HRTFPath.c_str());
 
         if (!p_sys->binauralDecoder.Configure(p_sys->i_order, true,
-                p_sys->i_rate, AMB_BLOCK_TIME_LEN, i_tailLength,
+                p_sys->i_rate, p_sys->i_blockLen, i_tailLength,
                 HRTFPath))
         {
             msg_Err(p_filter, "Error creating the binaural decoder.");
@@ -495,7 +503,7 @@ static int Open(vlc_object_t *p_this)
         p_sys->speakerDecoder.Refresh();
     }
 
-    if (!p_sys->processor.Configure(p_sys->i_order, true, AMB_BLOCK_TIME_LEN, 0))
+    if (!p_sys->processor.Configure(p_sys->i_order, true, p_sys->i_blockLen, 0))
     {
         msg_Err(p_filter, "Error creating the ambisonic processor.");
         delete p_sys;
@@ -61,7 +61,7 @@ static block_t *Upmix( filter_t *p_filter, block_t *p_in_buf )
 
     assert( i_input_nb < i_output_nb );
 
-    block_t *p_out_buf = block_Alloc(
+    block_t *p_out_buf = filter_NewAudioBuffer( p_filter,
                               p_in_buf->i_buffer * i_output_nb / i_input_nb );
     if( unlikely(p_out_buf == NULL) )
     {
@@ -134,7 +134,7 @@ static block_t *Extract( filter_t *p_filter, block_t *p_in_buf )
                       * p_filter->fmt_out.audio.i_bitspersample
                       * i_out_channels / 8;
 
-    block_t *p_out_buf = block_Alloc( i_out_size );
+    block_t *p_out_buf = filter_NewAudioBuffer( p_filter, i_out_size );
     if( unlikely(p_out_buf == NULL) )
     {
         block_Release( p_in_buf );
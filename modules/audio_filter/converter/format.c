@@ -40,6 +40,8 @@
 #include <vlc_block.h>
 #include <vlc_filter.h>
 
+#include "format_simd.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -82,11 +84,37 @@ static int Open(vlc_object_t *object)
     return VLC_SUCCESS;
 }
 
+/* Conversions running the kernels of format_simd.h */
+#define NARROW_CVT(name, kernel, stype, dtype) \
+static block_t *name(filter_t *filter, block_t *b) \
+{ \
+    VLC_UNUSED(filter); \
+    size_t samples = b->i_buffer / sizeof(stype); \
+    kernel((dtype *)b->p_buffer, (const stype *)b->p_buffer, samples); \
+    b->i_buffer = samples * sizeof(dtype); \
+    return b; \
+}
+
+#define WIDEN_CVT(name, kernel, stype, dtype) \
+static block_t *name(filter_t *filter, block_t *bsrc) \
+{ \
+    size_t samples = bsrc->i_buffer / sizeof(stype); \
+    block_t *bdst = filter_NewAudioBuffer(filter, \
+                                          samples * sizeof(dtype)); \
+    if (likely(bdst != NULL)) \
+    { \
+        block_CopyProperties(bdst, bsrc); \
+        kernel((dtype *)bdst->p_buffer, (const stype *)bsrc->p_buffer, \
+               samples); \
+    } \
+    block_Release(bsrc); \
+    return bdst; \
+}
 
 /*** from U8 ***/
 static block_t *U8toS16(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -97,13 +125,12 @@ static block_t *U8toS16(filter_t *filter, block_t *bsrc)
         *dst++ = ((*src++) << 8) - 0x8000;
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *U8toFl32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -114,13 +141,12 @@ static block_t *U8toFl32(filter_t *filter, block_t *bsrc)
         *dst++ = ((float)((*src++) - 128)) / 128.f;
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *U8toS32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -131,13 +157,12 @@ static block_t *U8toS32(filter_t *filter, block_t *bsrc)
         *dst++ = ((*src++) << 24) - 0x80000000;
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *U8toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 8);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 8);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -148,7 +173,6 @@ static block_t *U8toFl64(filter_t *filter, block_t *bsrc)
         *dst++ = ((double)((*src++) - 128)) / 128.;
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
@@ -166,37 +190,11 @@ static block_t *S16toU8(filter_t *filter, block_t *b)
     return b;
 }
 
-static block_t *S16toFl32(filter_t *filter, block_t *bsrc)
-{
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
-    if (unlikely(bdst == NULL))
-        goto out;
-
-    block_CopyProperties(bdst, bsrc);
-    int16_t *src = (int16_t *)bsrc->p_buffer;
-    float   *dst = (float *)bdst->p_buffer;
-    for (size_t i = bsrc->i_buffer / 2; i--;)
-#if 0
-        /* Slow version */
-        *dst++ = (float)*src++ / 32768.f;
-#else
-    {   /* This is Walken's trick based on IEEE float format. On my PIII
-         * this takes 16 seconds to perform one billion conversions, instead
-         * of 19 seconds for the above division. */
-        union { float f; int32_t i; } u;
-        u.i = *src++ + 0x43c00000;
-        *dst++ = u.f - 384.f;
-    }
-#endif
-out:
-    block_Release(bsrc);
-    VLC_UNUSED(filter);
-    return bdst;
-}
+WIDEN_CVT(S16toFl32, pcm_s16_fl32_c, int16_t, float)
 
 static block_t *S16toS32(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -207,13 +205,12 @@ static block_t *S16toS32(filter_t *filter, block_t *bsrc)
         *dst++ = *src++ << 16;
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
 static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 4);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 4);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -224,7 +221,6 @@ static block_t *S16toFl64(filter_t *filter, block_t *bsrc)
         *dst++ = (double)*src++ / 32768.;
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
@@ -250,56 +246,12 @@ static block_t *Fl32toU8(filter_t *filter, block_t *b)
     return b;
 }
 
-static block_t *Fl32toS16(filter_t *filter, block_t *b)
-{
-    VLC_UNUSED(filter);
-    float   *src = (float *)b->p_buffer;
-    int16_t *dst = (int16_t *)src;
-    for (int i = b->i_buffer / 4; i--;) {
-#if 0
-        /* Slow version. */
-        if (*src >= 1.0) *dst = 32767;
-        else if (*src < -1.0) *dst = -32768;
-        else *dst = lroundf(*src * 32768.f);
-        src++; dst++;
-#else
-        /* This is Walken's trick based on IEEE float format. */
-        union { float f; int32_t i; } u;
-        u.f = *src++ + 384.f;
-        if (u.i > 0x43c07fff)
-            *dst++ = 32767;
-        else if (u.i < 0x43bf8000)
-            *dst++ = -32768;
-        else
-            *dst++ = u.i - 0x43c00000;
-#endif
-    }
-    b->i_buffer /= 2;
-    return b;
-}
-
-static block_t *Fl32toS32(filter_t *filter, block_t *b)
-{
-    float   *src = (float *)b->p_buffer;
-    int32_t *dst = (int32_t *)src;
-    for (size_t i = b->i_buffer / 4; i--;)
-    {
-        float s = *(src++) * 2147483648.f;
-        if (s >= 2147483647.f)
-            *(dst++) = 2147483647;
-        else
-        if (s <= -2147483648.f)
-            *(dst++) = -2147483648;
-        else
-            *(dst++) = lroundf(s);
-    }
-    VLC_UNUSED(filter);
-    return b;
-}
+NARROW_CVT(Fl32toS16, pcm_fl32_s16_c, float, int16_t)
+NARROW_CVT(Fl32toS32, pcm_fl32_s32_c, float, int32_t)
 
 static block_t *Fl32toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -310,7 +262,6 @@ static block_t *Fl32toFl64(filter_t *filter, block_t *bsrc)
         *(dst++) = *(src++);
 out:
     block_Release(bsrc);
-    VLC_UNUSED(filter);
     return bdst;
 }
 
@@ -340,19 +291,11 @@ static block_t *S32toS16(filter_t *filter, block_t *b)
     return b;
 }
 
-static block_t *S32toFl32(filter_t *filter, block_t *b)
-{
-    VLC_UNUSED(filter);
-    int32_t *src = (int32_t*)b->p_buffer;
-    float   *dst = (float *)src;
-    for (int i = b->i_buffer / 4; i--;)
-        *dst++ = (float)(*src++) / 2147483648.f;
-    return b;
-}
+NARROW_CVT(S32toFl32, pcm_s32_fl32_c, int32_t, float)
 
 static block_t *S32toFl64(filter_t *filter, block_t *bsrc)
 {
-    block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
+    block_t *bdst = filter_NewAudioBuffer(filter, bsrc->i_buffer * 2);
     if (unlikely(bdst == NULL))
         goto out;
 
@@ -362,7 +305,6 @@ static block_t *S32toFl64(filter_t *filter, block_t *bsrc)
     for (size_t i = bsrc->i_buffer / 4; i--;)
         *dst++ = (double)(*src++) / 2147483648.;
 out:
-    VLC_UNUSED(filter);
     block_Release(bsrc);
     return bdst;
 }
@@ -439,13 +381,36 @@ static block_t *Fl64toS32(filter_t *filter, block_t *b)
 }
 
 
+/*** SIMD ***/
+#ifdef PCM_SIMD_X86
+WIDEN_CVT(S16toFl32_sse2, pcm_s16_fl32_sse2, int16_t, float)
+NARROW_CVT(Fl32toS16_sse2, pcm_fl32_s16_sse2, float, int16_t)
+NARROW_CVT(Fl32toS32_sse2, pcm_fl32_s32_sse2, float, int32_t)
+NARROW_CVT(S32toFl32_sse2, pcm_s32_fl32_sse2, int32_t, float)
+
+WIDEN_CVT(S16toFl32_avx2, pcm_s16_fl32_avx2, int16_t, float)
+NARROW_CVT(Fl32toS16_avx2, pcm_fl32_s16_avx2, float, int16_t)
+NARROW_CVT(Fl32toS32_avx2, pcm_fl32_s32_avx2, float, int32_t)
+NARROW_CVT(S32toFl32_avx2, pcm_s32_fl32_avx2, int32_t, float)
+#endif
+#ifdef PCM_SIMD_NEON
+WIDEN_CVT(S16toFl32_neon, pcm_s16_fl32_neon, int16_t, float)
+NARROW_CVT(S32toFl32_neon, pcm_s32_fl32_neon, int32_t, float)
+# ifdef __aarch64__
+NARROW_CVT(Fl32toS16_neon, pcm_fl32_s16_neon, float, int16_t)
+NARROW_CVT(Fl32toS32_neon, pcm_fl32_s32_neon, float, int32_t)
+# endif
+#endif
+
 /* */
 /* */
-static const struct {
+typedef struct {
     vlc_fourcc_t src;
     vlc_fourcc_t dst;
     cvt_t convert;
-} cvt_directs[] = {
+} cvt_entry_t;
+
+static const cvt_entry_t cvt_directs[] = {
     { VLC_CODEC_U8,   VLC_CODEC_S16N, U8toS16    },
     { VLC_CODEC_U8,   VLC_CODEC_FL32, U8toFl32   },
     { VLC_CODEC_U8,   VLC_CODEC_S32N, U8toS32    },
@@ -474,12 +439,62 @@ static const struct {
     { 0, 0, NULL }
 };
 
-static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst)
+#ifdef PCM_SIMD_X86
+static const cvt_entry_t cvt_sse2[] = {
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, S16toFl32_sse2 },
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, Fl32toS16_sse2 },
+    { VLC_CODEC_FL32, VLC_CODEC_S32N, Fl32toS32_sse2 },
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, S32toFl32_sse2 },
+    { 0, 0, NULL }
+};
+
+static const cvt_entry_t cvt_avx2[] = {
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, S16toFl32_avx2 },
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, Fl32toS16_avx2 },
+    { VLC_CODEC_FL32, VLC_CODEC_S32N, Fl32toS32_avx2 },
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, S32toFl32_avx2 },
+    { 0, 0, NULL }
+};
+#endif
+
+#ifdef PCM_SIMD_NEON
+static const cvt_entry_t cvt_neon[] = {
+    { VLC_CODEC_S16N, VLC_CODEC_FL32, S16toFl32_neon },
+    { VLC_CODEC_S32N, VLC_CODEC_FL32, S32toFl32_neon },
+# ifdef __aarch64__
+    { VLC_CODEC_FL32, VLC_CODEC_S16N, Fl32toS16_neon },
+    { VLC_CODEC_FL32, VLC_CODEC_S32N, Fl32toS32_neon },
+# endif
+    { 0, 0, NULL }
+};
+#endif
+
+static cvt_t LookupConversion(const cvt_entry_t *table,
+                              vlc_fourcc_t src, vlc_fourcc_t dst)
 {
-    for (int i = 0; cvt_directs[i].convert; i++) {
-        if (cvt_directs[i].src == src &&
-            cvt_directs[i].dst == dst)
-            return cvt_directs[i].convert;
+    for (int i = 0; table[i].convert; i++) {
+        if (table[i].src == src &&
+            table[i].dst == dst)
+            return table[i].convert;
     }
     return NULL;
 }
+
+static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst)
+{
+    cvt_t convert = NULL;
+
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        convert = LookupConversion(cvt_avx2, src, dst);
+    if (convert == NULL && vlc_CPU_SSE2())
+        convert = LookupConversion(cvt_sse2, src, dst);
+#endif
+#ifdef PCM_SIMD_NEON /* NEON is a build requirement there */
+    if (convert == NULL)
+        convert = LookupConversion(cvt_neon, src, dst);
+#endif
+    if (convert == NULL)
+        convert = LookupConversion(cvt_directs, src, dst);
+    return convert;
+}
@@ -0,0 +1,364 @@
+/*****************************************************************************
+ * format_simd.h : vectorized PCM gain and sample format conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FORMAT_SIMD_H
+#define VLC_FORMAT_SIMD_H
+
+#include <vlc_cpu.h>
+
+/*
+ * All kernels take a sample count, and can work in place (dst == src) as
+ * long as the output samples are not larger than the input samples. They
+ * match the scalar versions below bit for bit, except FL32 to S32 which
+ * rounds half-way cases to even instead of away from zero.
+ *
+ * Float to integer conversions saturate.
+ */
+
+typedef void (*pcm_gain_fl32_t)(float *, size_t, float);
+typedef void (*pcm_s16_fl32_t)(float *, const int16_t *, size_t);
+typedef void (*pcm_fl32_s16_t)(int16_t *, const float *, size_t);
+typedef void (*pcm_s32_fl32_t)(float *, const int32_t *, size_t);
+typedef void (*pcm_fl32_s32_t)(int32_t *, const float *, size_t);
+
+/*** Scalar ***/
+static inline void pcm_gain_fl32_c(float *p, size_t n, float gain)
+{
+    while (n--)
+        *(p++) *= gain;
+}
+
+static inline void pcm_s16_fl32_c(float *dst, const int16_t *src, size_t n)
+{
+    while (n--)
+    {   /* Walken's trick based on IEEE float format */
+        union { float f; int32_t i; } u;
+        u.i = *src++ + 0x43c00000;
+        *dst++ = u.f - 384.f;
+    }
+}
+
+static inline void pcm_fl32_s16_c(int16_t *dst, const float *src, size_t n)
+{
+    while (n--)
+    {   /* Walken's trick based on IEEE float format */
+        union { float f; int32_t i; } u;
+        u.f = *src++ + 384.f;
+        if (u.i > 0x43c07fff)
+            *dst++ = 32767;
+        else if (u.i < 0x43bf8000)
+            *dst++ = -32768;
+        else
+            *dst++ = u.i - 0x43c00000;
+    }
+}
+
+static inline void pcm_s32_fl32_c(float *dst, const int32_t *src, size_t n)
+{
+    while (n--)
+        *dst++ = (float)(*src++) / 2147483648.f;
+}
+
+static inline void pcm_fl32_s32_c(int32_t *dst, const float *src, size_t n)
+{
+    while (n--)
+    {
+        float s = *(src++) * 2147483648.f;
+        if (s >= 2147483647.f)
+            *(dst++) = 2147483647;
+        else
+        if (s <= -2147483648.f)
+            *(dst++) = -2147483648;
+        else
+            *(dst++) = lroundf(s);
+    }
+}
+
+/*** x86 ***/
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# define PCM_SIMD_X86 1
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("sse")))
+static inline void pcm_gain_fl32_sse(float *p, size_t n, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), g));
+        _mm_storeu_ps(p + 4, _mm_mul_ps(_mm_loadu_ps(p + 4), g));
+    }
+    pcm_gain_fl32_c(p, n, gain);
+}
+
+__attribute__ ((__target__ ("avx")))
+static inline void pcm_gain_fl32_avx(float *p, size_t n, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    for (; n >= 16; n -= 16, p += 16)
+    {
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), g));
+        _mm256_storeu_ps(p + 8, _mm256_mul_ps(_mm256_loadu_ps(p + 8), g));
+    }
+    pcm_gain_fl32_c(p, n, gain);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_s16_fl32_sse2(float *dst, const int16_t *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)src);
+        /* sign extend to 32 bits */
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    pcm_s16_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_s16_fl32_avx2(float *dst, const int16_t *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+    for (; n >= 16; n -= 16, src += 16, dst += 16)
+    {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)src));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + 8)));
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    pcm_s16_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_fl32_s16_sse2(int16_t *dst, const float *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        /* clip before converting: out of range values would wrap */
+        __m128 a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(src), scale), max), min);
+        __m128 b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(src + 4), scale), max), min);
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    pcm_fl32_s16_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_fl32_s16_avx2(int16_t *dst, const float *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    for (; n >= 16; n -= 16, src += 16, dst += 16)
+    {
+        __m256 a = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(src), scale), max), min);
+        __m256 b = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(src + 8), scale), max), min);
+        /* packs works per 128-bit lane: restore the sample order */
+        __m256i v = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        _mm256_storeu_si256((__m256i *)dst, _mm256_permute4x64_epi64(v, 0xD8));
+    }
+    pcm_fl32_s16_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_s32_fl32_sse2(float *dst, const int32_t *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+        _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(
+                      _mm_loadu_si128((const __m128i *)src)), scale));
+    pcm_s32_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_s32_fl32_avx2(float *dst, const int32_t *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+        _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(
+                         _mm256_loadu_si256((const __m256i *)src)), scale));
+    pcm_s32_fl32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void pcm_fl32_s32_sse2(int32_t *dst, const float *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        /* overflows convert to INT32_MIN: flip the positive ones */
+        __m128i over = _mm_castps_si128(_mm_cmpge_ps(s, scale));
+        _mm_storeu_si128((__m128i *)dst, _mm_xor_si128(_mm_cvtps_epi32(s), over));
+    }
+    pcm_fl32_s32_c(dst, src, n);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void pcm_fl32_s32_avx2(int32_t *dst, const float *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256i over = _mm256_castps_si256(_mm256_cmp_ps(s, scale, _CMP_GE_OQ));
+        _mm256_storeu_si256((__m256i *)dst, _mm256_xor_si256(_mm256_cvtps_epi32(s), over));
+    }
+    pcm_fl32_s32_c(dst, src, n);
+}
+#endif
+
+/*** ARM ***/
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+# define PCM_SIMD_NEON 1
+# include <arm_neon.h>
+
+static inline void pcm_gain_fl32_neon(float *p, size_t n, float gain)
+{
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        vst1q_f32(p, vmulq_n_f32(vld1q_f32(p), gain));
+        vst1q_f32(p + 4, vmulq_n_f32(vld1q_f32(p + 4), gain));
+    }
+    pcm_gain_fl32_c(p, n, gain);
+}
+
+static inline void pcm_s16_fl32_neon(float *dst, const int16_t *src, size_t n)
+{
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        int16x8_t v = vld1q_s16(src);
+        /* fixed point conversion: exact division by 2^15 */
+        vst1q_f32(dst, vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(v)), 15));
+        vst1q_f32(dst + 4, vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(v)), 15));
+    }
+    pcm_s16_fl32_c(dst, src, n);
+}
+
+static inline void pcm_s32_fl32_neon(float *dst, const int32_t *src, size_t n)
+{
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+        vst1q_f32(dst, vcvtq_n_f32_s32(vld1q_s32(src), 31));
+    pcm_s32_fl32_c(dst, src, n);
+}
+
+# ifdef __aarch64__ /* round to nearest conversions */
+static inline void pcm_fl32_s16_neon(int16_t *dst, const float *src, size_t n)
+{
+    const float32x4_t scale = vdupq_n_f32(32768.f);
+    for (; n >= 8; n -= 8, src += 8, dst += 8)
+    {
+        /* the saturating conversion and narrowing do the clipping */
+        int32x4_t a = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src), scale));
+        int32x4_t b = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + 4), scale));
+        vst1q_s16(dst, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    pcm_fl32_s16_c(dst, src, n);
+}
+
+static inline void pcm_fl32_s32_neon(int32_t *dst, const float *src, size_t n)
+{
+    const float32x4_t scale = vdupq_n_f32(2147483648.f);
+    for (; n >= 4; n -= 4, src += 4, dst += 4)
+        vst1q_s32(dst, vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src), scale)));
+    pcm_fl32_s32_c(dst, src, n);
+}
+# endif
+#endif
+
+/*** Selection ***/
+static inline pcm_gain_fl32_t pcm_GetGainFl32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX())
+        return pcm_gain_fl32_avx;
+    if (vlc_CPU_SSE())
+        return pcm_gain_fl32_sse;
+#endif
+#ifdef PCM_SIMD_NEON
+    return pcm_gain_fl32_neon;
+#endif
+    return pcm_gain_fl32_c;
+}
+
+static inline pcm_s16_fl32_t pcm_GetS16toFl32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_s16_fl32_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_s16_fl32_sse2;
+#endif
+#ifdef PCM_SIMD_NEON
+    return pcm_s16_fl32_neon;
+#endif
+    return pcm_s16_fl32_c;
+}
+
+static inline pcm_fl32_s16_t pcm_GetFl32toS16(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_fl32_s16_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_fl32_s16_sse2;
+#endif
+#if defined(PCM_SIMD_NEON) && defined(__aarch64__)
+    return pcm_fl32_s16_neon;
+#endif
+    return pcm_fl32_s16_c;
+}
+
+static inline pcm_s32_fl32_t pcm_GetS32toFl32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_s32_fl32_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_s32_fl32_sse2;
+#endif
+#ifdef PCM_SIMD_NEON
+    return pcm_s32_fl32_neon;
+#endif
+    return pcm_s32_fl32_c;
+}
+
+static inline pcm_fl32_s32_t pcm_GetFl32toS32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_fl32_s32_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_fl32_s32_sse2;
+#endif
+#if defined(PCM_SIMD_NEON) && defined(__aarch64__)
+    return pcm_fl32_s32_neon;
+#endif
+    return pcm_fl32_s32_c;
+}
+
+#endif
@@ -32,16 +32,22 @@
 #include <math.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_plugin.h>
 #include <vlc_charset.h>
+#include <vlc_cpu.h>
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
 #include "equalizer_presets.h"
 
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# define EQZ_SSE 1
+#endif
+
 /* TODO:
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *    computation (not too hard once the Q is found).
  *  - support for external preset
@@ -101,35 +107,59 @@ vlc_module_end ()
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
+/* Bands are computed side by side, in whole SSE vectors */
+#define EQZ_LANES ((EQZ_BANDS_MAX + 3) & ~3)
+#define EQZ_CHANNELS_MAX 32
+
+typedef struct
+{
+    float y[2][EQZ_LANES]; /* per band, y[n-1] and y[n-2] */
+    float x[2];            /* x[n-1] and x[n-2] */
+} eqz_state_t;
+
+/* Gains for one block, linearly ramped from the current to the target */
+typedef struct
+{
+    float f_amp[EQZ_LANES];
+    float f_amp_step[EQZ_LANES];
+    float f_gamp;
+    float f_gamp_step;
+    bool b_2eqz;
+} eqz_ramp_t;
+
 struct filter_sys_t
 {
-    /* Filter static config */
+    /* Filter static config, padded with null bands */
     int i_band;
-    float *f_alpha;
-    float *f_beta;
-    float *f_gamma;
+    float f_alpha[EQZ_LANES];
+    float f_beta[EQZ_LANES];
+    float f_gamma[EQZ_LANES];
 
-    /* Filter dyn config */
-    float *f_amp;   /* Per band amp */
-    float f_gamp;   /* Global preamp */
-    bool b_2eqz;
+    /* Filter dyn config, as last applied by the audio thread */
+    float f_amp[EQZ_LANES]; /* Per band amp */
+    float f_gamp;           /* Global preamp */
+
+    /* Filter dyn config, as last set by the callbacks */
+    vlc_atomic_float amp_target[EQZ_BANDS_MAX];
+    vlc_atomic_float gamp_target;
+    atomic_bool b_2eqz;
 
     /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
+    eqz_state_t state[EQZ_CHANNELS_MAX];
 
     /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    eqz_state_t state2[EQZ_CHANNELS_MAX];
 
-    vlc_mutex_t lock;
+    void (*pf_channel)( const filter_sys_t *, eqz_state_t *, eqz_state_t *,
+                        float *, const float *, int, int,
+                        const eqz_ramp_t * );
 };
 
 static block_t *DoWork( filter_t *, block_t * );
 
 #define EQZ_IN_FACTOR (0.25f)
 static int  EqzInit( filter_t *, int );
-static void EqzFilter( filter_t *, float *, float *, int, int );
+static void EqzFilter( filter_t *, float *, const float *, int, int );
 static void EqzClean( filter_t * );
 
 static int PresetCallback ( vlc_object_t *, char const *, vlc_value_t,
@@ -155,10 +185,15 @@ static int Open( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
 
-    vlc_mutex_init( &p_sys->lock );
     if( EqzInit( p_filter, p_filter->fmt_in.audio.i_rate ) != VLC_SUCCESS )
     {
-        vlc_mutex_destroy( &p_sys->lock );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    if( aout_FormatNbChannels( &p_filter->fmt_in.audio ) > EQZ_CHANNELS_MAX )
+    {
+        EqzClean( p_filter );
         free( p_sys );
         return VLC_EGENERIC;
     }
@@ -180,7 +215,6 @@ static void Close( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     EqzClean( p_filter );
-    vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
 
@@ -277,66 +311,54 @@ static inline float EqzConvertdB( float db )
     return EQZ_IN_FACTOR * ( powf( 10.0f, db / 20.0f ) - 1.0f );
 }
 
+static void EqzChannel_c( const filter_sys_t *, eqz_state_t *, eqz_state_t *,
+                          float *, const float *, int, int, const eqz_ramp_t * );
+#ifdef EQZ_SSE
+static void EqzChannel_sse( const filter_sys_t *, eqz_state_t *, eqz_state_t *,
+                            float *, const float *, int, int,
+                            const eqz_ramp_t * );
+#endif
+
 static int EqzInit( filter_t *p_filter, int i_rate )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     eqz_config_t cfg;
-    int i, ch;
+    int i;
     vlc_value_t val1, val2, val3;
     vlc_object_t *p_aout = p_filter->obj.parent;
-    int i_ret = VLC_ENOMEM;
 
     bool b_vlcFreqs = var_InheritBool( p_aout, "equalizer-vlcfreqs" );
     EqzCoeffs( i_rate, 1.0f, b_vlcFreqs, &cfg );
 
     /* Create the static filter config */
     p_sys->i_band = cfg.i_band;
-    p_sys->f_alpha = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_beta  = malloc( p_sys->i_band * sizeof(float) );
-    p_sys->f_gamma = malloc( p_sys->i_band * sizeof(float) );
-    if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma )
-        goto error;
-
-    for( i = 0; i < p_sys->i_band; i++ )
+    for( i = 0; i < EQZ_LANES; i++ )
     {
-        p_sys->f_alpha[i] = cfg.band[i].f_alpha;
-        p_sys->f_beta[i]  = cfg.band[i].f_beta;
-        p_sys->f_gamma[i] = cfg.band[i].f_gamma;
+        p_sys->f_alpha[i] = i < p_sys->i_band ? cfg.band[i].f_alpha : 0.f;
+        p_sys->f_beta[i]  = i < p_sys->i_band ? cfg.band[i].f_beta : 0.f;
+        p_sys->f_gamma[i] = i < p_sys->i_band ? cfg.band[i].f_gamma : 0.f;
     }
 
     /* Filter dyn config */
-    p_sys->b_2eqz = false;
-    p_sys->f_gamp = 1.0f;
-    p_sys->f_amp  = malloc( p_sys->i_band * sizeof(float) );
-    if( !p_sys->f_amp )
-        goto error;
-
-    for( i = 0; i < p_sys->i_band; i++ )
-    {
-        p_sys->f_amp[i] = 0.0f;
-    }
+    for( i = 0; i < EQZ_BANDS_MAX; i++ )
+        vlc_atomic_init_float( &p_sys->amp_target[i], 0.f );
+    vlc_atomic_init_float( &p_sys->gamp_target, 1.f );
+    atomic_init( &p_sys->b_2eqz, false );
 
     /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
-    {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0f;
+    memset( p_sys->state, 0, sizeof(p_sys->state) );
+    memset( p_sys->state2, 0, sizeof(p_sys->state2) );
 
-        for( i = 0; i < p_sys->i_band; i++ )
-        {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
-        }
-    }
+    p_sys->pf_channel = EqzChannel_c;
+#ifdef EQZ_SSE
+    if( vlc_CPU_SSE() )
+        p_sys->pf_channel = EqzChannel_sse;
+#endif
 
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
     var_Create( p_aout, "equalizer-preset", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
 
-    p_sys->b_2eqz = var_CreateGetBool( p_aout, "equalizer-2pass" );
+    atomic_store( &p_sys->b_2eqz, var_CreateGetBool( p_aout, "equalizer-2pass" ) );
 
     var_Create( p_aout, "equalizer-preamp", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT );
 
@@ -357,12 +379,16 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     {
         msg_Err(p_filter, "No preset selected");
         free( val2.psz_string );
-        free( p_sys->f_amp );
-        i_ret = VLC_EGENERIC;
-        goto error;
+        return VLC_EGENERIC;
     }
     free( val2.psz_string );
 
+    /* Start at the requested gains, without ramping */
+    for( i = 0; i < EQZ_LANES; i++ )
+        p_sys->f_amp[i] = i < p_sys->i_band
+                        ? vlc_atomic_load_float( &p_sys->amp_target[i] ) : 0.f;
+    p_sys->f_gamp = vlc_atomic_load_float( &p_sys->gamp_target );
+
     /* Add our own callbacks */
     var_AddCallback( p_aout, "equalizer-preset", PresetCallback, p_sys );
     var_AddCallback( p_aout, "equalizer-bands", BandsCallback, p_sys );
@@ -370,7 +396,8 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     var_AddCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
     msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass",
-                        i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1 );
+                        i_rate, p_sys->i_band,
+                        atomic_load( &p_sys->b_2eqz ) ? 2 : 1 );
     for( i = 0; i < p_sys->i_band; i++ )
     {
         msg_Dbg( p_filter, "   %.2f Hz -> factor:%f alpha:%f beta:%f gamma:%f",
@@ -378,75 +405,207 @@ static int EqzInit( filter_t *p_filter, int i_rate )
                  p_sys->f_alpha[i], p_sys->f_beta[i], p_sys->f_gamma[i]);
     }
     return VLC_SUCCESS;
+}
+
+static inline float EqzBands_c( const filter_sys_t *p_sys, eqz_state_t *st,
+                                float x, const float *amp )
+{
+    float o = 0.0f;
+
+    for( int j = 0; j < p_sys->i_band; j++ )
+    {
+        float y = p_sys->f_alpha[j] * ( x - st->x[1] ) +
+                  p_sys->f_gamma[j] * st->y[0][j] -
+                  p_sys->f_beta[j]  * st->y[1][j];
 
-error:
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-    return i_ret;
+        st->y[1][j] = st->y[0][j];
+        st->y[0][j] = y;
+
+        o += y * amp[j];
+    }
+    st->x[1] = st->x[0];
+    st->x[0] = x;
+    return o;
 }
 
-static void EqzFilter( filter_t *p_filter, float *out, float *in,
-                       int i_samples, int i_channels )
+static void EqzChannel_c( const filter_sys_t *p_sys,
+                          eqz_state_t *st, eqz_state_t *st2,
+                          float *out, const float *in,
+                          int i_samples, int i_channels,
+                          const eqz_ramp_t *ramp )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
+    float amp[EQZ_LANES];
+    float gamp = ramp->f_gamp;
+
+    memcpy( amp, ramp->f_amp, sizeof(amp) );
+
+    for( int i = 0; i < i_samples; i++ )
+    {
+        const float x = *in;
+        float o = EqzBands_c( p_sys, st, x, amp );
+
+        /* Second filter */
+        if( ramp->b_2eqz )
+        {
+            const float x2 = EQZ_IN_FACTOR * x + o;
+            o = EqzBands_c( p_sys, st2, x2, amp );
+
+            /* We add source PCM + filtered PCM */
+            *out = gamp * gamp *( EQZ_IN_FACTOR * x2 + o );
+        }
+        else
+        {
+            /* We add source PCM + filtered PCM */
+            *out = gamp *( EQZ_IN_FACTOR * x + o );
+        }
 
-    vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+        for( int j = 0; j < p_sys->i_band; j++ )
+            amp[j] += ramp->f_amp_step[j];
+        gamp += ramp->f_gamp_step;
+
+        in  += i_channels;
+        out += i_channels;
+    }
+}
+
+#ifdef EQZ_SSE
+#define EQZ_VECTORS (EQZ_LANES / 4)
+
+/* One sample through all the bands, each lane being one band */
+__attribute__ ((__target__ ("sse")))
+static inline float EqzBands_sse( const __m128 *alpha, const __m128 *beta,
+                                  const __m128 *gamma, __m128 *y0, __m128 *y1,
+                                  float *px, float x, const __m128 *amp )
+{
+    const __m128 dx = _mm_set1_ps( x - px[1] );
+    __m128 o = _mm_setzero_ps();
+
+    for( int j = 0; j < EQZ_VECTORS; j++ )
     {
-        for( ch = 0; ch < i_channels; ch++ )
+        __m128 y = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( alpha[j], dx ),
+                                           _mm_mul_ps( gamma[j], y0[j] ) ),
+                               _mm_mul_ps( beta[j], y1[j] ) );
+        y1[j] = y0[j];
+        y0[j] = y;
+        o = _mm_add_ps( o, _mm_mul_ps( y, amp[j] ) );
+    }
+    px[1] = px[0];
+    px[0] = x;
+
+    o = _mm_add_ps( o, _mm_movehl_ps( o, o ) );
+    o = _mm_add_ss( o, _mm_shuffle_ps( o, o, 1 ) );
+    return _mm_cvtss_f32( o );
+}
+
+__attribute__ ((__target__ ("sse")))
+static void EqzChannel_sse( const filter_sys_t *p_sys,
+                            eqz_state_t *st, eqz_state_t *st2,
+                            float *out, const float *in,
+                            int i_samples, int i_channels,
+                            const eqz_ramp_t *ramp )
+{
+    __m128 alpha[EQZ_VECTORS], beta[EQZ_VECTORS], gamma[EQZ_VECTORS];
+    __m128 amp[EQZ_VECTORS], step[EQZ_VECTORS];
+    __m128 y0[EQZ_VECTORS], y1[EQZ_VECTORS], z0[EQZ_VECTORS], z1[EQZ_VECTORS];
+    float gamp = ramp->f_gamp;
+
+    for( int j = 0; j < EQZ_VECTORS; j++ )
+    {
+        alpha[j] = _mm_loadu_ps( p_sys->f_alpha + 4 * j );
+        beta[j]  = _mm_loadu_ps( p_sys->f_beta + 4 * j );
+        gamma[j] = _mm_loadu_ps( p_sys->f_gamma + 4 * j );
+        amp[j]   = _mm_loadu_ps( ramp->f_amp + 4 * j );
+        step[j]  = _mm_loadu_ps( ramp->f_amp_step + 4 * j );
+        y0[j] = _mm_loadu_ps( st->y[0] + 4 * j );
+        y1[j] = _mm_loadu_ps( st->y[1] + 4 * j );
+        z0[j] = _mm_loadu_ps( st2->y[0] + 4 * j );
+        z1[j] = _mm_loadu_ps( st2->y[1] + 4 * j );
+    }
+
+    for( int i = 0; i < i_samples; i++ )
+    {
+        const float x = *in;
+        float o = EqzBands_sse( alpha, beta, gamma, y0, y1, st->x, x, amp );
+
+        /* Second filter */
+        if( ramp->b_2eqz )
+        {
+            const float x2 = EQZ_IN_FACTOR * x + o;
+            o = EqzBands_sse( alpha, beta, gamma, z0, z1, st2->x, x2, amp );
+
+            /* We add source PCM + filtered PCM */
+            *out = gamp * gamp *( EQZ_IN_FACTOR * x2 + o );
+        }
+        else
         {
-            const float x = in[ch];
-            float o = 0.0f;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
-
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
-
-            /* Second filter */
-            if( p_sys->b_2eqz )
-            {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0f;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
-
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
-            }
-            else
-            {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
-            }
+            /* We add source PCM + filtered PCM */
+            *out = gamp *( EQZ_IN_FACTOR * x + o );
         }
 
+        for( int j = 0; j < EQZ_VECTORS; j++ )
+            amp[j] = _mm_add_ps( amp[j], step[j] );
+        gamp += ramp->f_gamp_step;
+
         in  += i_channels;
         out += i_channels;
     }
-    vlc_mutex_unlock( &p_sys->lock );
+
+    for( int j = 0; j < EQZ_VECTORS; j++ )
+    {
+        _mm_storeu_ps( st->y[0] + 4 * j, y0[j] );
+        _mm_storeu_ps( st->y[1] + 4 * j, y1[j] );
+        _mm_storeu_ps( st2->y[0] + 4 * j, z0[j] );
+        _mm_storeu_ps( st2->y[1] + 4 * j, z1[j] );
+    }
+}
+#endif
+
+/* Flush the decaying filter state to zero, before it turns denormal and
+ * slows every further sample down (silence after a loud passage) */
+static void EqzFlushDenormals( eqz_state_t *st )
+{
+    for( int k = 0; k < 2; k++ )
+        for( int j = 0; j < EQZ_LANES; j++ )
+            if( fabsf( st->y[k][j] ) < 1e-15f )
+                st->y[k][j] = 0.f;
+}
+
+static void EqzFilter( filter_t *p_filter, float *out, const float *in,
+                       int i_samples, int i_channels )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    eqz_ramp_t ramp;
+
+    if( i_samples <= 0 )
+        return;
+
+    /* Pick the gains last set by the callbacks, and move towards them over
+     * this block so that changes do not click */
+    const float f_scale = 1.f / i_samples;
+    float f_target[EQZ_LANES];
+
+    for( int j = 0; j < EQZ_LANES; j++ )
+    {
+        f_target[j] = j < p_sys->i_band
+                    ? vlc_atomic_load_float( &p_sys->amp_target[j] ) : 0.f;
+        ramp.f_amp[j] = p_sys->f_amp[j];
+        ramp.f_amp_step[j] = ( f_target[j] - p_sys->f_amp[j] ) * f_scale;
+    }
+    const float f_gamp_target = vlc_atomic_load_float( &p_sys->gamp_target );
+    ramp.f_gamp = p_sys->f_gamp;
+    ramp.f_gamp_step = ( f_gamp_target - p_sys->f_gamp ) * f_scale;
+    ramp.b_2eqz = atomic_load_explicit( &p_sys->b_2eqz, memory_order_relaxed );
+
+    for( int ch = 0; ch < i_channels; ch++ )
+    {
+        p_sys->pf_channel( p_sys, &p_sys->state[ch], &p_sys->state2[ch],
+                           out + ch, in + ch, i_samples, i_channels, &ramp );
+        EqzFlushDenormals( &p_sys->state[ch] );
+        EqzFlushDenormals( &p_sys->state2[ch] );
+    }
+
+    memcpy( p_sys->f_amp, f_target, sizeof(f_target) );
+    p_sys->f_gamp = f_gamp_target;
 }
 
 static void EqzClean( filter_t *p_filter )
@@ -458,12 +617,6 @@ static void EqzClean( filter_t *p_filter )
     var_DelCallback( p_aout, "equalizer-preset", PresetCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
-
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
-
-    free( p_sys->f_amp );
 }
 
 
@@ -528,9 +681,7 @@ static int PreampCallback( vlc_object_t *p_this, char const *psz_cmd,
     else
         preamp = 10.f;
 
-    vlc_mutex_lock( &p_sys->lock );
-    p_sys->f_gamp = preamp;
-    vlc_mutex_unlock( &p_sys->lock );
+    vlc_atomic_store_float( &p_sys->gamp_target, preamp );
     return VLC_SUCCESS;
 }
 
@@ -543,7 +694,6 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
     int i = 0;
 
     /* Same thing for bands */
-    vlc_mutex_lock( &p_sys->lock );
     while( i < p_sys->i_band )
     {
         char *next;
@@ -552,15 +702,14 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
         if( next == p || isnan( f ) )
             break; /* no conversion */
 
-        p_sys->f_amp[i++] = EqzConvertdB( f );
+        vlc_atomic_store_float( &p_sys->amp_target[i++], EqzConvertdB( f ) );
 
         if( *next == '\0' )
             break; /* end of line */
         p = &next[1];
     }
     while( i < p_sys->i_band )
-        p_sys->f_amp[i++] = EqzConvertdB( 0.f );
-    vlc_mutex_unlock( &p_sys->lock );
+        vlc_atomic_store_float( &p_sys->amp_target[i++], EqzConvertdB( 0.f ) );
     return VLC_SUCCESS;
 }
 static int TwoPassCallback( vlc_object_t *p_this, char const *psz_cmd,
@@ -569,9 +718,7 @@ static int TwoPassCallback( vlc_object_t *p_this, char const *psz_cmd,
     VLC_UNUSED(p_this); VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval);
     filter_sys_t *p_sys = p_data;
 
-    vlc_mutex_lock( &p_sys->lock );
-    p_sys->b_2eqz = newval.b_bool;
-    vlc_mutex_unlock( &p_sys->lock );
+    atomic_store( &p_sys->b_2eqz, newval.b_bool );
     return VLC_SUCCESS;
 }
 
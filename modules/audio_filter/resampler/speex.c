@@ -128,7 +128,7 @@ static block_t *Resample (filter_t *filter, block_t *in)
     spx_uint32_t olen = ((ilen + 2) * orate * UINT64_C(11))
                       / (irate * UINT64_C(10));
 
-    block_t *out = block_Alloc (olen * framesize);
+    block_t *out = filter_NewAudioBuffer (filter, olen * framesize);
     if (unlikely(out == NULL))
         goto error;
 
@@ -32,10 +32,16 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# define SCALETEMPO_X86 1
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -110,9 +116,87 @@ struct filter_sys_t
     unsigned  frames_search;
     void     *buf_pre_corr;
     void     *table_window;
+    float    *buf_corr;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    void    (*correlate)( const float *, const float *, unsigned,
+                          unsigned, unsigned, float * );
 };
 
+/*****************************************************************************
+ * correlate: cross correlation of pc against count positions of ps,
+ * step samples apart. This is where the search time goes.
+ *****************************************************************************/
+static void correlate_c( const float *pc, const float *ps, unsigned n,
+                         unsigned step, unsigned count, float *corr )
+{
+    for( unsigned off = 0; off < count; off++, ps += step ) {
+        float sum = 0;
+        for( unsigned i = 0; i < n; i++ )
+            sum += pc[i] * ps[i];
+        corr[off] = sum;
+    }
+}
+
+#ifdef SCALETEMPO_X86
+/* Four positions at once, so that each pre-correlation load is used four
+ * times. The partial sums are transposed and added in one go. */
+__attribute__ ((__target__ ("sse")))
+static void correlate_sse( const float *pc, const float *ps, unsigned n,
+                           unsigned step, unsigned count, float *corr )
+{
+    unsigned off = 0;
+    for( ; off + 4 <= count; off += 4, ps += 4 * step ) {
+        __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+        __m128 a2 = _mm_setzero_ps(), a3 = _mm_setzero_ps();
+        unsigned i = 0;
+        for( ; i + 4 <= n; i += 4 ) {
+            __m128 c = _mm_loadu_ps( pc + i );
+            a0 = _mm_add_ps( a0, _mm_mul_ps( c, _mm_loadu_ps( ps + i ) ) );
+            a1 = _mm_add_ps( a1, _mm_mul_ps( c, _mm_loadu_ps( ps + step + i ) ) );
+            a2 = _mm_add_ps( a2, _mm_mul_ps( c, _mm_loadu_ps( ps + 2 * step + i ) ) );
+            a3 = _mm_add_ps( a3, _mm_mul_ps( c, _mm_loadu_ps( ps + 3 * step + i ) ) );
+        }
+        _MM_TRANSPOSE4_PS( a0, a1, a2, a3 );
+        _mm_storeu_ps( corr + off,
+                       _mm_add_ps( _mm_add_ps( a0, a1 ), _mm_add_ps( a2, a3 ) ) );
+        for( ; i < n; i++ )
+            for( unsigned k = 0; k < 4; k++ )
+                corr[off + k] += pc[i] * ps[k * step + i];
+    }
+    correlate_c( pc, ps, n, step, count - off, corr + off );
+}
+
+__attribute__ ((__target__ ("avx")))
+static void correlate_avx( const float *pc, const float *ps, unsigned n,
+                           unsigned step, unsigned count, float *corr )
+{
+    unsigned off = 0;
+    for( ; off + 4 <= count; off += 4, ps += 4 * step ) {
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        unsigned i = 0;
+        for( ; i + 8 <= n; i += 8 ) {
+            __m256 c = _mm256_loadu_ps( pc + i );
+            a0 = _mm256_add_ps( a0, _mm256_mul_ps( c, _mm256_loadu_ps( ps + i ) ) );
+            a1 = _mm256_add_ps( a1, _mm256_mul_ps( c, _mm256_loadu_ps( ps + step + i ) ) );
+            a2 = _mm256_add_ps( a2, _mm256_mul_ps( c, _mm256_loadu_ps( ps + 2 * step + i ) ) );
+            a3 = _mm256_add_ps( a3, _mm256_mul_ps( c, _mm256_loadu_ps( ps + 3 * step + i ) ) );
+        }
+        __m128 b0 = _mm_add_ps( _mm256_castps256_ps128( a0 ), _mm256_extractf128_ps( a0, 1 ) );
+        __m128 b1 = _mm_add_ps( _mm256_castps256_ps128( a1 ), _mm256_extractf128_ps( a1, 1 ) );
+        __m128 b2 = _mm_add_ps( _mm256_castps256_ps128( a2 ), _mm256_extractf128_ps( a2, 1 ) );
+        __m128 b3 = _mm_add_ps( _mm256_castps256_ps128( a3 ), _mm256_extractf128_ps( a3, 1 ) );
+        _MM_TRANSPOSE4_PS( b0, b1, b2, b3 );
+        _mm_storeu_ps( corr + off,
+                       _mm_add_ps( _mm_add_ps( b0, b1 ), _mm_add_ps( b2, b3 ) ) );
+        for( ; i < n; i++ )
+            for( unsigned k = 0; k < 4; k++ )
+                corr[off + k] += pc[i] * ps[k * step + i];
+    }
+    correlate_c( pc, ps, n, step, count - off, corr + off );
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -133,18 +217,14 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     }
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
+    p->correlate( p->buf_pre_corr, search_start,
+                  p->samples_overlap - p->samples_per_frame,
+                  p->samples_per_frame, p->frames_search, p->buf_corr );
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
-      if( corr > best_corr ) {
-        best_corr = corr;
+      if( p->buf_corr[off] > best_corr ) {
+        best_corr = p->buf_corr[off];
         best_off  = off;
       }
-      search_start += p->samples_per_frame;
     }
 
     return best_off * p->bytes_per_frame;
@@ -328,7 +408,8 @@ static int reinit_buffers( filter_t *p_filter )
         unsigned bytes_pre_corr = ( p->samples_overlap - p->samples_per_frame ) * 4; /* sizeof (int32|float) */
         p->buf_pre_corr = malloc( bytes_pre_corr );
         p->table_window = malloc( bytes_pre_corr );
-        if( ! p->buf_pre_corr || ! p->table_window )
+        p->buf_corr     = malloc( p->frames_search * sizeof(float) );
+        if( ! p->buf_pre_corr || ! p->table_window || ! p->buf_corr )
             return VLC_ENOMEM;
         float *pw = p->table_window;
         for( i = 1; i<frames_overlap; i++ )
@@ -408,6 +489,14 @@ static int Open( vlc_object_t *p_this )
     p_sys->percent_overlap = var_InheritFloat( p_this, "scaletempo-overlap" );
     p_sys->ms_search       = var_InheritInteger( p_this, "scaletempo-search" );
 
+    p_sys->correlate = correlate_c;
+#ifdef SCALETEMPO_X86
+    if( vlc_CPU_AVX() )
+        p_sys->correlate = correlate_avx;
+    else if( vlc_CPU_SSE() )
+        p_sys->correlate = correlate_sse;
+#endif
+
     msg_Dbg( p_this, "params: %i stride, %.3f overlap, %i search",
              p_sys->ms_stride, p_sys->percent_overlap, p_sys->ms_search );
 
@@ -416,6 +505,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->buf_corr       = NULL;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -443,6 +533,7 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    free( p_sys->buf_corr );
     free( p_sys );
 }
 
@@ -469,7 +560,7 @@ static block_t *DoWork( filter_t * p_filter, block_t * p_in_buf )
     }
 
     size_t i_outsize = calculate_output_buffer_size ( p_filter, p_in_buf->i_buffer );
-    block_t *p_out_buf = block_Alloc( i_outsize );
+    block_t *p_out_buf = filter_NewAudioBuffer( p_filter, i_outsize );
     if( p_out_buf == NULL )
         return NULL;
 
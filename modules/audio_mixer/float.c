@@ -35,6 +35,8 @@
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#include "../audio_filter/converter/format_simd.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -67,6 +69,25 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
     (void) p_volume;
 }
 
+#define FILTER_FL32_SIMD(isa) \
+static void FilterFL32_##isa( audio_volume_t *p_volume, block_t *p_buffer, \
+                              float f_multiplier ) \
+{ \
+    if( f_multiplier != 1.f ) \
+        pcm_gain_fl32_##isa( (float *)p_buffer->p_buffer, \
+                             p_buffer->i_buffer / sizeof(float), \
+                             f_multiplier ); \
+    (void) p_volume; \
+}
+
+#ifdef PCM_SIMD_X86
+FILTER_FL32_SIMD(sse)
+FILTER_FL32_SIMD(avx)
+#endif
+#ifdef PCM_SIMD_NEON
+FILTER_FL32_SIMD(neon)
+#endif
+
 static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
@@ -92,6 +113,15 @@ static int Create( vlc_object_t *p_this )
     {
         case VLC_CODEC_FL32:
             p_volume->amplify = FilterFL32;
+#ifdef PCM_SIMD_X86
+            if( vlc_CPU_AVX() )
+                p_volume->amplify = FilterFL32_avx;
+            else if( vlc_CPU_SSE() )
+                p_volume->amplify = FilterFL32_sse;
+#endif
+#ifdef PCM_SIMD_NEON
+            p_volume->amplify = FilterFL32_neon;
+#endif
             break;
         case VLC_CODEC_FL64:
             p_volume->amplify = FilterFL64;
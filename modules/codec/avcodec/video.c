@@ -80,6 +80,8 @@ struct decoder_sys_t
     /* for direct rendering */
     bool        b_direct_rendering;
     atomic_bool b_dr_failure;
+    atomic_uint i_dr_pictures;     /* decoded straight into vout pictures */
+    atomic_uint i_copied_pictures; /* decoded into libavcodec buffers */
 
     /* Hack to force display of still pictures */
     bool b_first_frame;
@@ -127,6 +129,28 @@ static uint32_t ffmpeg_CodecTag( vlc_fourcc_t fcc )
  * Local Functions
  *****************************************************************************/
 
+/**
+ * Rounds the coded width up, so that the pitch of every plane of the pictures
+ * allocated for that width meets the libavcodec stride alignment. Otherwise,
+ * direct rendering fails, and each decoded picture has to be copied.
+ */
+static int lavc_AlignWidth(vlc_fourcc_t chroma, int width, const int *aligns)
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(chroma);
+    if (dsc == NULL)
+        return width;
+
+    /* the pitch of plane i is width * w.num / w.den * pixel_size bytes */
+    int64_t modulo = 1;
+    for (unsigned i = 0; i < dsc->plane_count; i++)
+    {
+        int64_t m = (aligns[i] > 0 ? aligns[i] : 1) * dsc->p[i].w.den;
+        modulo = modulo / GCD(modulo, m) * m;
+    }
+    return (width + modulo - 1) / modulo * modulo;
+}
+
 /**
  * Sets the decoder output format.
  */
@@ -154,6 +178,7 @@ static int lavc_GetVideoFormat(decoder_t *dec, video_format_t *restrict fmt,
             fmt->i_chroma = VLC_CODEC_RGB32;
 
         avcodec_align_dimensions2(ctx, &width, &height, aligns);
+        width = lavc_AlignWidth(fmt->i_chroma, width, aligns);
     }
     else /* hardware decoding */
         fmt->i_chroma = vlc_va_GetChroma(pix_fmt, sw_pix_fmt);
@@ -428,6 +453,14 @@ static int OpenVideoCodec( decoder_t *p_dec )
                       ctx->thread_count );
             break;
     }
+
+    /* On top of the DPB, frame threads each hold the picture they decode,
+     * and delay the output by as many pictures. If the pool is smaller,
+     * direct rendering stalls until the vout releases pictures. */
+    if( ctx->active_thread_type & FF_THREAD_FRAME )
+        p_dec->i_extra_picture_buffers = 2 * ctx->thread_count;
+    else
+        p_dec->i_extra_picture_buffers = 0;
     return 0;
 }
 
@@ -511,6 +544,8 @@ int InitVideoDec( vlc_object_t *obj )
     /* ***** libavcodec direct rendering ***** */
     p_sys->b_direct_rendering = false;
     atomic_init(&p_sys->b_dr_failure, false);
+    atomic_init(&p_sys->i_dr_pictures, 0);
+    atomic_init(&p_sys->i_copied_pictures, 0);
     if( var_CreateGetBool( p_dec, "avcodec-dr" ) &&
        (p_codec->capabilities & AV_CODEC_CAP_DR1) &&
         /* No idea why ... but this fixes flickering on some TSCC streams */
@@ -565,9 +600,6 @@ int InitVideoDec( vlc_object_t *obj )
             break;
     }
 
-    if( p_context->thread_type & FF_THREAD_FRAME )
-        p_dec->i_extra_picture_buffers = 2 * p_context->thread_count;
-
     /* ***** misc init ***** */
     date_Init(&p_sys->pts, 1, 30001);
     date_Set(&p_sys->pts, VLC_TS_INVALID);
@@ -1205,9 +1237,12 @@ static picture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block, bool *error
                 picture_Release( p_pic );
                 break;
             }
+            atomic_fetch_add( &p_sys->i_copied_pictures, 1 );
         }
         else
         {
+            if( p_sys->p_va == NULL )
+                atomic_fetch_add( &p_sys->i_dr_pictures, 1 );
             picture_Hold( p_pic );
         }
 
@@ -1285,6 +1320,11 @@ void EndVideoDec( vlc_object_t *obj )
 
     cc_Flush( &p_sys->cc );
 
+    unsigned i_copied = atomic_load( &p_sys->i_copied_pictures );
+    if( i_copied > 0 )
+        msg_Dbg( p_dec, "%u picture(s) copied, %u directly rendered",
+                 i_copied, atomic_load( &p_sys->i_dr_pictures ) );
+
     hwaccel_context = ctx->hwaccel_context;
     avcodec_free_context( &ctx );
 
@@ -35,6 +35,7 @@
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
 #include "logic/PredictiveAdaptationLogic.hpp"
 #include "logic/NearOptimalAdaptationLogic.hpp"
+#include "logic/BufferBasedAdaptationLogic.hpp"
 #include "tools/Debug.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
@@ -116,6 +117,7 @@ bool PlaylistManager::setupPeriod()
             SegmentTracker *tracker = new (std::nothrow) SegmentTracker(logic, set);
             if(!tracker)
                 continue;
+            tracker->registerListener(conManager);
 
             AbstractStream *st = streamFactory->create(p_demux, set->getStreamFormat(),
                                                        tracker, conManager);
@@ -758,6 +760,11 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
                 conn->setDownloadRateObserver(predictivelogic);
             logic = predictivelogic;
         }
+        break;
+
+        case AbstractAdaptationLogic::BufferBased:
+            logic = new (std::nothrow) BufferBasedAdaptationLogic(VLC_OBJECT(p_demux));
+            break;
 
         default:
             break;
@@ -74,10 +74,29 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
+#define ADAPT_DOWNLOADS_TEXT N_("Parallel downloads")
+#define ADAPT_DOWNLOADS_LONGTEXT N_("Number of segments downloaded at once. " \
+    "The stream with the lowest buffering level is served first.")
+
+#define ADAPT_HOSTCONN_TEXT N_("Maximum connections per server")
+#define ADAPT_HOSTCONN_LONGTEXT N_("Maximum number of segments requested " \
+    "at once from the same server (0 for unlimited).")
+
+#define ADAPT_CACHE_TEXT N_("Segment cache size (MiB)")
+#define ADAPT_CACHE_LONGTEXT N_("Memory kept for recently downloaded " \
+    "segments, so that seeking or switching back to them does not download " \
+    "them again (0 to disable).")
+
+#define ADAPT_LOWLATENCY_TEXT N_("Low latency live")
+#define ADAPT_LOWLATENCY_LONGTEXT N_("Start live streams on their most recent " \
+    "partial segment, and follow the live edge part by part, when the " \
+    "playlist provides them (Low-Latency HLS).")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
                                 AbstractAdaptationLogic::NearOptimal,
+                                AbstractAdaptationLogic::BufferBased,
                                 AbstractAdaptationLogic::RateBased,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
@@ -87,6 +106,7 @@ static const char *const ppsz_logics_values[] = {
                                 "",
                                 "predictive",
                                 "nearoptimal",
+                                "buffer",
                                 "rate",
                                 "fixedrate",
                                 "lowest",
@@ -95,6 +115,7 @@ static const char *const ppsz_logics_values[] = {
 static const char *const ppsz_logics[] = { N_("Default"),
                                            N_("Predictive"),
                                            N_("Near Optimal"),
+                                           N_("Buffer Based"),
                                            N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
@@ -120,6 +141,14 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-downloads", 3, 1, 8,
+                                ADAPT_DOWNLOADS_TEXT, ADAPT_DOWNLOADS_LONGTEXT, true )
+        add_integer( "adaptive-host-connections", 6,
+                     ADAPT_HOSTCONN_TEXT, ADAPT_HOSTCONN_LONGTEXT, true )
+        add_integer( "adaptive-cache-size", 16,
+                     ADAPT_CACHE_TEXT, ADAPT_CACHE_LONGTEXT, true )
+        add_bool   ( "adaptive-lowlatency", false,
+                     ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -29,6 +29,7 @@
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
 #include "Downloader.hpp"
+#include "ChunkCache.hpp"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -133,7 +134,7 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManag
 HTTPChunkSource::~HTTPChunkSource()
 {
     if(connection)
-        connection->setUsed(false);
+        connManager->recycleConnection(connection);
 }
 
 bool HTTPChunkSource::init(const std::string &url)
@@ -149,6 +150,11 @@ bool HTTPChunkSource::init(const std::string &url)
     return true;
 }
 
+const ConnectionParams & HTTPChunkSource::getConnectionParams() const
+{
+    return params;
+}
+
 bool HTTPChunkSource::hasMoreData() const
 {
     if(eof)
@@ -251,6 +257,10 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     eof = false;
     held = false;
     downloadstart = 0;
+    p_cache = NULL;
+    pp_cachetail = &p_cache;
+    cachesize = 0;
+    cacheable = (manager && manager->getChunkCache());
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -270,6 +280,8 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
         pp_tail = &p_head;
     }
     buffered = 0;
+    if(p_cache)
+        block_ChainRelease(p_cache);
     vlc_mutex_unlock(&lock);
 
     vlc_cond_destroy(&avail);
@@ -300,6 +312,34 @@ void HTTPChunkBufferedSource::release()
     vlc_mutex_unlock(&lock);
 }
 
+void HTTPChunkBufferedSource::fromCache(block_t *p_chain)
+{
+    vlc_mutex_lock(&lock);
+    p_head = p_chain;
+    pp_tail = &p_head;
+    while(*pp_tail)
+    {
+        buffered += (*pp_tail)->i_buffer;
+        pp_tail = &(*pp_tail)->p_next;
+    }
+    contentLength = buffered;
+    prepared = true;
+    done = true;
+    cacheable = false;
+    vlc_cond_signal(&avail);
+    vlc_mutex_unlock(&lock);
+}
+
+void HTTPChunkBufferedSource::storeToCache()
+{
+    ChunkCache *cache = connManager->getChunkCache();
+    block_t *p_data = block_ChainGather(p_cache);
+    p_cache = NULL;
+    pp_cachetail = &p_cache;
+    if(p_data)
+        cache->put(getConnectionParams().getUrl(), bytesRange, p_data);
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     vlc_mutex_lock(&lock);
@@ -348,6 +388,24 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     else
     {
         p_block->i_buffer = (size_t) ret;
+        if(cacheable)
+        {
+            block_t *p_copy = NULL;
+            if(cachesize + p_block->i_buffer <= connManager->getChunkCache()->getMaxEntrySize())
+                p_copy = block_Duplicate(p_block);
+            if(p_copy)
+            {
+                cachesize += p_copy->i_buffer;
+                block_ChainLastAppend(&pp_cachetail, p_copy);
+            }
+            else /* too large to be cached */
+            {
+                cacheable = false;
+                block_ChainRelease(p_cache);
+                p_cache = NULL;
+                pp_cachetail = &p_cache;
+            }
+        }
         vlc_mutex_lock(&lock);
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
@@ -363,7 +421,17 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
 
     if(rate.size)
     {
+        /* Only complete payloads can be served again */
+        if(cacheable && p_cache && ret >= 0 &&
+           (!contentLength || rate.size == contentLength))
+            storeToCache();
+        cacheable = false;
+
         connManager->updateDownloadRate(sourceid, rate.size, rate.time);
+        /* Response fully read: hand the connection over to the next
+           request for this host while our data is being consumed */
+        connManager->recycleConnection(connection);
+        connection = NULL;
     }
 
     vlc_cond_signal(&avail);
@@ -90,6 +90,7 @@ namespace adaptive
                 virtual block_t *   readBlock       (); /* impl */
                 virtual block_t *   read            (size_t); /* impl */
                 virtual bool        hasMoreData     () const; /* impl */
+                const ConnectionParams & getConnectionParams() const;
 
                 static const size_t CHUNK_SIZE = 32768;
 
@@ -120,11 +121,13 @@ namespace adaptive
                 virtual bool       hasMoreData     () const; /* impl */
                 void               hold();
                 void               release();
+                void               fromCache(block_t *);
 
             protected:
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                void               storeToCache();
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -136,6 +139,10 @@ namespace adaptive
                 vlc_mutex_t         lock;
                 vlc_cond_t          avail;
                 bool                held;
+                block_t            *p_cache; /* copy of the payload, for the cache */
+                block_t           **pp_cachetail;
+                size_t              cachesize;
+                bool                cacheable;
         };
 
         class HTTPChunk : public AbstractChunk
@@ -0,0 +1,161 @@
+/*
+ * ChunkCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "ChunkCache.hpp"
+
+#include <vlc_block.h>
+
+#include <sstream>
+
+using namespace adaptive::http;
+
+ChunkCache::Stats::Stats()
+{
+    hits = 0;
+    lookups = 0;
+    hitbytes = 0;
+    size = 0;
+    entries = 0;
+}
+
+ChunkCache::ChunkCache(size_t budget_)
+{
+    budget = budget_;
+    vlc_mutex_init(&lock);
+}
+
+ChunkCache::~ChunkCache()
+{
+    std::list<Entry>::iterator it;
+    for(it = entries.begin(); it != entries.end(); ++it)
+        block_Release((*it).p_data);
+    vlc_mutex_destroy(&lock);
+}
+
+std::string ChunkCache::makeKey(const std::string &url, const BytesRange &range)
+{
+    if(!range.isValid())
+        return url;
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << url << '@' << range.getStartByte() << '-' << range.getEndByte();
+    return os.str();
+}
+
+size_t ChunkCache::getMaxEntrySize() const
+{
+    /* a single segment must not flush everything else */
+    return budget / 4;
+}
+
+block_t * ChunkCache::get(const std::string &url, const BytesRange &range, size_t blocksize)
+{
+    const std::string key = makeKey(url, range);
+    block_t *p_chain = NULL;
+    block_t **pp_tail = &p_chain;
+
+    vlc_mutex_lock(&lock);
+    stats.lookups++;
+
+    std::map<std::string, std::list<Entry>::iterator>::iterator it = index.find(key);
+    if(it != index.end())
+    {
+        /* move to front */
+        entries.splice(entries.begin(), entries, it->second);
+
+        /* blocks are modified downstream (decryption), never hand ours */
+        const block_t *p_data = entries.front().p_data;
+        for(size_t offset = 0; offset < p_data->i_buffer; offset += blocksize)
+        {
+            const size_t size = __MIN(blocksize, p_data->i_buffer - offset);
+            block_t *p_block = block_Alloc(size);
+            if(!p_block)
+            {
+                block_ChainRelease(p_chain);
+                p_chain = NULL;
+                break;
+            }
+            memcpy(p_block->p_buffer, &p_data->p_buffer[offset], size);
+            block_ChainLastAppend(&pp_tail, p_block);
+        }
+
+        if(p_chain)
+        {
+            stats.hits++;
+            stats.hitbytes += p_data->i_buffer;
+        }
+    }
+
+    vlc_mutex_unlock(&lock);
+    return p_chain;
+}
+
+void ChunkCache::put(const std::string &url, const BytesRange &range, block_t *p_data)
+{
+    if(p_data->i_buffer > getMaxEntrySize())
+    {
+        block_Release(p_data);
+        return;
+    }
+
+    const std::string key = makeKey(url, range);
+
+    vlc_mutex_lock(&lock);
+    if(index.find(key) != index.end())
+    {
+        block_Release(p_data);
+    }
+    else
+    {
+        evict(p_data->i_buffer);
+        Entry entry;
+        entry.key = key;
+        entry.p_data = p_data;
+        entries.push_front(entry);
+        index[key] = entries.begin();
+        stats.size += p_data->i_buffer;
+        stats.entries++;
+    }
+    vlc_mutex_unlock(&lock);
+}
+
+void ChunkCache::evict(size_t needed)
+{
+    while(!entries.empty() && stats.size + needed > budget)
+    {
+        Entry &entry = entries.back();
+        stats.size -= entry.p_data->i_buffer;
+        stats.entries--;
+        block_Release(entry.p_data);
+        index.erase(entry.key);
+        entries.pop_back();
+    }
+}
+
+ChunkCache::Stats ChunkCache::getStats() const
+{
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    Stats ret = stats;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return ret;
+}
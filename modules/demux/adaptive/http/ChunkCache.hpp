@@ -0,0 +1,81 @@
+/*
+ * ChunkCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef CHUNKCACHE_HPP
+#define CHUNKCACHE_HPP
+
+#include "BytesRange.hpp"
+
+#include <vlc_common.h>
+#include <list>
+#include <map>
+#include <string>
+
+namespace adaptive
+{
+
+    namespace http
+    {
+
+        /* Least recently used payloads of completed downloads,
+         * keyed by url and byte range, within a memory budget */
+        class ChunkCache
+        {
+            public:
+                ChunkCache(size_t);
+                ~ChunkCache();
+                /* returns a copy, as a chain of at most blocksize blocks */
+                block_t * get(const std::string &, const BytesRange &, size_t);
+                void put(const std::string &, const BytesRange &, block_t *);
+                size_t getMaxEntrySize() const;
+
+                class Stats
+                {
+                    public:
+                        Stats();
+                        unsigned hits;
+                        unsigned lookups;
+                        uint64_t hitbytes;
+                        size_t   size;
+                        unsigned entries;
+                };
+                Stats getStats() const;
+
+            private:
+                static std::string makeKey(const std::string &, const BytesRange &);
+                void evict(size_t);
+
+                class Entry
+                {
+                    public:
+                        std::string key;
+                        block_t    *p_data;
+                };
+                std::list<Entry> entries; /* most recently used first */
+                std::map<std::string, std::list<Entry>::iterator> index;
+                size_t       budget;
+                Stats        stats;
+                vlc_mutex_t  lock;
+        };
+
+    }
+
+}
+
+#endif // CHUNKCACHE_HPP
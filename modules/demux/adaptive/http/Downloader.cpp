@@ -26,39 +26,46 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned slots_, unsigned hostslots_)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&donecond);
     killed = false;
-    thread_handle_valid = false;
+    slots = std::max(slots_, 1U);
+    hostslots = hostslots_;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < slots)
     {
-        return false;
+        vlc_thread_t thread;
+        if(vlc_clone(&thread, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&donecond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
@@ -72,8 +79,30 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for the slot to finish its current read */
+    while(std::find(active.begin(), active.end(), source) != active.end())
+        vlc_cond_wait(&donecond, &lock);
     source->release();
     chunks.remove(source);
+    if(std::find(started.begin(), started.end(), source) != started.end())
+    {
+        started.remove(source);
+        vlc_cond_broadcast(&waitcond); /* host slot freed */
+    }
+    vlc_mutex_unlock(&lock);
+}
+
+void Downloader::setBufferingLevel(const ID &id, mtime_t level)
+{
+    vlc_mutex_lock(&lock);
+    levels[id] = level;
+    vlc_mutex_unlock(&lock);
+}
+
+void Downloader::unsetBufferingLevel(const ID &id)
+{
+    vlc_mutex_lock(&lock);
+    levels.erase(id);
     vlc_mutex_unlock(&lock);
 }
 
@@ -92,27 +121,80 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+unsigned Downloader::hostUsage(const std::string &hostname) const
+{
+    unsigned count = 0;
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = started.begin(); it != started.end(); ++it)
+        if((*it)->getConnectionParams().getHostname() == hostname)
+            count++;
+    return count;
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource() const
+{
+    /* Serve the stream with the lowest buffering level first.
+       Streams without known level have nothing buffered yet. */
+    HTTPChunkBufferedSource *next = NULL;
+    mtime_t nextlevel = 0;
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+    {
+        HTTPChunkBufferedSource *source = *it;
+
+        /* a new request needs a free connection slot for its host */
+        if(hostslots &&
+           std::find(started.begin(), started.end(), source) == started.end() &&
+           hostUsage(source->getConnectionParams().getHostname()) >= hostslots)
+            continue;
+
+        std::map<ID, mtime_t>::const_iterator lit = levels.find(source->sourceid);
+        mtime_t level = (lit != levels.end()) ? (*lit).second : 0;
+        if(next == NULL || level < nextlevel)
+        {
+            next = source;
+            nextlevel = level;
+        }
+    }
+    return next;
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source = NULL;
+        while(!killed && !(source = getNextSource()))
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        chunks.remove(source);
+        active.push_back(source);
+        if(std::find(started.begin(), started.end(), source) == started.end())
+            started.push_back(source);
+
+        /* read without blocking the other slots */
+        vlc_mutex_unlock(&lock);
+        DownloadSource(source);
+        vlc_mutex_lock(&lock);
+
+        active.remove(source);
+        if(source->isDone())
+        {
+            started.remove(source);
+            source->release();
+            vlc_cond_broadcast(&waitcond); /* host slot freed */
+        }
+        else
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            /* round robin with same level sources */
+            chunks.push_back(source);
+            vlc_cond_signal(&waitcond);
         }
+        vlc_cond_broadcast(&donecond);
     }
     vlc_mutex_unlock(&lock);
 }
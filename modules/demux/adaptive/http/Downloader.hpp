@@ -24,6 +24,8 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,22 +36,31 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1, unsigned = 0);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
+                void setBufferingLevel(const ID &, mtime_t);
+                void unsetBufferingLevel(const ID &);
 
             private:
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getNextSource() const;
+                unsigned hostUsage(const std::string &) const;
+                std::vector<vlc_thread_t> threads;
+                unsigned     slots;
+                unsigned     hostslots; /* 0 for unlimited */
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   donecond;
                 bool         killed;
-                std::list<HTTPChunkBufferedSource *> chunks;
+                std::list<HTTPChunkBufferedSource *> chunks; /* waiting for a slot */
+                std::list<HTTPChunkBufferedSource *> active; /* in a slot */
+                std::list<HTTPChunkBufferedSource *> started; /* request sent */
+                std::map<ID, mtime_t> levels; /* demuxed amount per stream */
         };
 
     }
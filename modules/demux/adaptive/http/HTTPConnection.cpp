@@ -195,13 +195,16 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(ret >= 0)
         bytesRead += ret;
 
-    if(ret < 0 || (size_t)ret < len || /* set EOF */
-       contentLength == bytesRead )
+    if(ret < 0 || (size_t)ret < len) /* set EOF */
     {
         socket->disconnect();
         return ret;
     }
 
+    /* Response fully read: keep persistent connections for reuse */
+    if(contentLength == bytesRead && connectionClose)
+        socket->disconnect();
+
     return ret;
 }
 
@@ -25,11 +25,15 @@
 # include "config.h"
 #endif
 
+#include <vlc_fixups.h>
+#include <cinttypes>
+
 #include "HTTPConnectionManager.h"
 #include "HTTPConnection.hpp"
 #include "ConnectionParams.hpp"
 #include "Sockets.hpp"
 #include "Downloader.hpp"
+#include "ChunkCache.hpp"
 #include <vlc_url.h>
 
 using namespace adaptive::http;
@@ -61,8 +65,12 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    downloader = new (std::nothrow)
+            Downloader(var_InheritInteger(p_object, "adaptive-downloads"),
+                       var_InheritInteger(p_object, "adaptive-host-connections"));
     downloader->start();
+    const size_t cachesize = var_InheritInteger(p_object, "adaptive-cache-size");
+    cache = (cachesize) ? new (std::nothrow) ChunkCache(cachesize << 20) : NULL;
     if(!factory_)
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
@@ -76,6 +84,15 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     delete downloader;
+    if(cache)
+    {
+        const ChunkCache::Stats stats = cache->getStats();
+        msg_Dbg(p_object, "segment cache: %u hits out of %u lookups (%u%%), %" PRIu64 " bytes "
+                "not downloaded, %u entries (%zu bytes) left", stats.hits, stats.lookups,
+                stats.lookups ? 100 * stats.hits / stats.lookups : 0, stats.hitbytes,
+                stats.entries, stats.size);
+        delete cache;
+    }
     delete factory;
     this->closeAllConnections();
     vlc_mutex_destroy(&lock);
@@ -138,11 +155,60 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
     return conn;
 }
 
+void HTTPConnectionManager::recycleConnection(AbstractConnection *conn)
+{
+    /* Persistent connections stay open for the next request */
+    vlc_mutex_lock(&lock);
+    conn->setUsed(false);
+    vlc_mutex_unlock(&lock);
+}
+
+void HTTPConnectionManager::trackerEvent(const SegmentTrackerEvent &event)
+{
+    if(!downloader)
+        return;
+
+    switch(event.type)
+    {
+    case SegmentTrackerEvent::BUFFERING_STATE:
+        if(!event.u.buffering.enabled)
+            downloader->unsetBufferingLevel(*event.u.buffering.id);
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+        downloader->setBufferingLevel(*event.u.buffering.id,
+                                      event.u.buffering_level.current);
+        break;
+
+    default:
+        break;
+    }
+}
+
+ChunkCache * HTTPConnectionManager::getChunkCache() const
+{
+    return cache;
+}
+
 void HTTPConnectionManager::start(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
-    if(src)
-        downloader->schedule(src);
+    if(!src)
+        return;
+
+    /* Recently downloaded (seek back, switch back): no request */
+    if(cache)
+    {
+        block_t *p_chain = cache->get(src->getConnectionParams().getUrl(),
+                                      src->getBytesRange(), HTTPChunkSource::CHUNK_SIZE);
+        if(p_chain)
+        {
+            src->fromCache(p_chain);
+            return;
+        }
+    }
+
+    downloader->schedule(src);
 }
 
 void HTTPConnectionManager::cancel(AbstractChunkSource *source)
@@ -26,6 +26,7 @@
 #define HTTPCONNECTIONMANAGER_H_
 
 #include "../logic/IDownloadRateObserver.h"
+#include "../SegmentTracker.hpp"
 
 #include <vlc_common.h>
 #include <vector>
@@ -40,18 +41,23 @@ namespace adaptive
         class AbstractConnection;
         class Downloader;
         class AbstractChunkSource;
+        class ChunkCache;
 
-        class AbstractConnectionManager : public IDownloadRateObserver
+        class AbstractConnectionManager : public IDownloadRateObserver,
+                                          public SegmentTrackerListenerInterface
         {
             public:
                 AbstractConnectionManager(vlc_object_t *);
                 ~AbstractConnectionManager();
                 virtual void    closeAllConnections () = 0;
                 virtual AbstractConnection * getConnection(ConnectionParams &) = 0;
+                virtual void recycleConnection(AbstractConnection *) = 0;
                 virtual void start(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
+                virtual ChunkCache * getChunkCache() const { return NULL; }
 
                 virtual void updateDownloadRate(const ID &, size_t, mtime_t); /* impl */
+                virtual void trackerEvent(const SegmentTrackerEvent &) {} /* impl */
                 void setDownloadRateObserver(IDownloadRateObserver *);
 
             protected:
@@ -69,13 +75,18 @@ namespace adaptive
 
                 virtual void    closeAllConnections () /* impl */;
                 virtual AbstractConnection * getConnection(ConnectionParams &) /* impl */;
+                virtual void recycleConnection(AbstractConnection *) /* impl */;
 
                 virtual void start(AbstractChunkSource *) /* impl */;
                 virtual void cancel(AbstractChunkSource *) /* impl */;
 
+                virtual void trackerEvent(const SegmentTrackerEvent &); /* reimpl */
+                virtual ChunkCache * getChunkCache() const; /* reimpl */
+
             private:
                 void    releaseAllConnections ();
                 Downloader                                         *downloader;
+                ChunkCache                                         *cache;
                 vlc_mutex_t                                         lock;
                 std::vector<AbstractConnection *>                   connectionPool;
                 ConnectionFactory                                  *factory;
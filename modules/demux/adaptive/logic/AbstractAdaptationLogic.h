@@ -61,6 +61,7 @@ namespace adaptive
                     FixedRate,
                     Predictive,
                     NearOptimal,
+                    BufferBased,
                 };
 
             protected:
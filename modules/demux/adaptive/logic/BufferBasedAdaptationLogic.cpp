@@ -0,0 +1,171 @@
+/*
+ * BufferBasedAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BufferBasedAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../tools/Debug.hpp"
+
+#include <cmath>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+/*
+ * BOLA-BASIC: buffer occupancy only, no throughput estimation.
+ * Buffer levels are counted in segments, as in
+ * BOLA: Near-Optimal Bitrate Adaptation for Online Videos
+ * http://arxiv.org/abs/1601.06748
+ */
+
+#define minimumBufferS (CLOCK_FREQ * 6)  /* Qmin */
+#define bufferTargetS  (CLOCK_FREQ * 30) /* Qmax */
+
+BufferBasedContext::BufferBasedContext()
+    : buffering_min( minimumBufferS )
+    , buffering_level( 0 )
+    , buffering_target( bufferTargetS )
+    , segment_duration( 0 )
+{ }
+
+BufferBasedAdaptationLogic::BufferBasedAdaptationLogic( vlc_object_t *p_obj )
+    : AbstractAdaptationLogic()
+    , p_obj( p_obj )
+{
+    vlc_mutex_init(&lock);
+}
+
+BufferBasedAdaptationLogic::~BufferBasedAdaptationLogic()
+{
+    vlc_mutex_destroy(&lock);
+}
+
+BaseRepresentation *BufferBasedAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet, BaseRepresentation *)
+{
+    RepresentationSelector selector(maxwidth, maxheight);
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    if(lowest == NULL)
+        return NULL;
+
+    vlc_mutex_lock(&lock);
+    std::map<ID, BufferBasedContext>::const_iterator it = streams.find(adaptSet->getID());
+    if(it == streams.end())
+    {
+        vlc_mutex_unlock(&lock);
+        return lowest;
+    }
+    const BufferBasedContext ctx = (*it).second;
+    vlc_mutex_unlock(&lock);
+
+    /* Until the first segment duration is known, count in seconds */
+    const float p = (ctx.segment_duration > 0) ? (float) ctx.segment_duration / CLOCK_FREQ : 1.0;
+    const float Qmin = std::max((float) ctx.buffering_min / CLOCK_FREQ / p, 1.0f);
+    const float Qmax = std::max((float) ctx.buffering_target / CLOCK_FREQ / p, Qmin + 1);
+    const float Q = (float) ctx.buffering_level / CLOCK_FREQ / p;
+
+    /* utilities are ln(S/Smin) + 1, so the lowest one is 1 */
+    const float Smin = lowest->getBandwidth();
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    if(highest->getBandwidth() <= lowest->getBandwidth())
+        return lowest;
+    const float umax = std::log(highest->getBandwidth() / Smin) + 1;
+
+    /* Lowest quality below Qmin, highest one from Qmax */
+    const float gp = (umax - 1) / (Qmax / Qmin - 1);
+    const float Vp = Qmin / gp;
+
+    BaseRepresentation *ret = NULL;
+    BaseRepresentation *prev = NULL;
+    float argmax = 0;
+    for(BaseRepresentation *rep = lowest; rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        const float u = std::log(rep->getBandwidth() / Smin) + 1;
+        const float arg = (Vp * (u + gp) - Q) / rep->getBandwidth();
+        if(ret == NULL || argmax <= arg)
+        {
+            ret = rep;
+            argmax = arg;
+        }
+        prev = rep;
+    }
+
+    BwDebug( msg_Info(p_obj, "Stream %s buffering %.2f/%.2f segments, rep %zu KiB/s",
+                      adaptSet->getID().str().c_str(), Q, Qmax, ret->getBandwidth() / 8000); );
+
+    return ret;
+}
+
+void BufferBasedAdaptationLogic::trackerEvent(const SegmentTrackerEvent &event)
+{
+    switch(event.type)
+    {
+    case SegmentTrackerEvent::BUFFERING_STATE:
+        {
+            const ID &id = *event.u.buffering.id;
+            vlc_mutex_lock(&lock);
+            if(event.u.buffering.enabled)
+            {
+                if(streams.find(id) == streams.end())
+                {
+                    BufferBasedContext ctx;
+                    streams.insert(std::pair<ID, BufferBasedContext>(id, ctx));
+                }
+            }
+            else
+            {
+                std::map<ID, BufferBasedContext>::iterator it = streams.find(id);
+                if(it != streams.end())
+                    streams.erase(it);
+            }
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+        {
+            const ID &id = *event.u.buffering.id;
+            vlc_mutex_lock(&lock);
+            BufferBasedContext &ctx = streams[id];
+            ctx.buffering_min = event.u.buffering_level.minimum;
+            ctx.buffering_level = event.u.buffering_level.current;
+            ctx.buffering_target = event.u.buffering_level.target;
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::SEGMENT_CHANGE:
+        {
+            const ID &id = *event.u.segment.id;
+            vlc_mutex_lock(&lock);
+            BufferBasedContext &ctx = streams[id];
+            ctx.segment_duration = event.u.segment.duration;
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    default:
+            break;
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * BufferBasedAdaptationLogic.hpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef BUFFERBASEDADAPTATIONLOGIC_HPP
+#define BUFFERBASEDADAPTATIONLOGIC_HPP
+
+#include "AbstractAdaptationLogic.h"
+#include "Representationselectors.hpp"
+#include <map>
+
+namespace adaptive
+{
+    namespace logic
+    {
+        class BufferBasedContext
+        {
+            friend class BufferBasedAdaptationLogic;
+
+            public:
+                BufferBasedContext();
+
+            private:
+                mtime_t buffering_min;
+                mtime_t buffering_level;
+                mtime_t buffering_target;
+                mtime_t segment_duration;
+        };
+
+        class BufferBasedAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                BufferBasedAdaptationLogic(vlc_object_t *);
+                virtual ~BufferBasedAdaptationLogic();
+
+                virtual BaseRepresentation* getNextRepresentation(BaseAdaptationSet *, BaseRepresentation *);
+                virtual void                trackerEvent           (const SegmentTrackerEvent &); /* reimpl */
+
+            private:
+                std::map<adaptive::ID, BufferBasedContext> streams;
+                vlc_object_t *              p_obj;
+                vlc_mutex_t                 lock;
+        };
+    }
+}
+
+#endif // BUFFERBASEDADAPTATIONLOGIC_HPP
@@ -110,8 +110,8 @@ void SegmentList::pruneByPlaybackTime(mtime_t time)
 
 void SegmentList::pruneBySegmentNumber(uint64_t tobelownum)
 {
-    std::vector<ISegment *>::iterator it = segments.begin();
-    while(it != segments.end())
+    std::vector<ISegment *>::iterator it;
+    for(it = segments.begin(); it != segments.end(); ++it)
     {
         ISegment *seg = *it;
 
@@ -121,9 +121,9 @@ void SegmentList::pruneBySegmentNumber(uint64_t tobelownum)
         if(seg->chunksuse.Get()) /* can't prune from here, still in use */
             break;
 
-        delete *it;
-        it = segments.erase(it);
+        delete seg;
     }
+    segments.erase(segments.begin(), it);
 }
 
 bool SegmentList::getSegmentNumberByScaledTime(stime_t time, uint64_t *ret) const
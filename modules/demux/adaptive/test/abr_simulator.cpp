@@ -0,0 +1,420 @@
+/*
+ * abr_simulator.cpp: offline adaptation logic simulator
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Replays a bandwidth trace against the representations of a manifest,
+ * without any real download or decoding. Time is simulated, so runs are
+ * deterministic and instantaneous.
+ *
+ * The manifest (MPD, M3U8 or Smooth manifest) is read from disk or any
+ * URL an access module can open, such as a local HTTP server.
+ * The trace is a text file of "<duration ms> <kbit/s>" lines, the link
+ * bandwidth being constant over each line duration. Lines starting with '#'
+ * are ignored. The simulation ends with the trace.
+ *
+ * All adaptation sets of the first period share the link, and a single
+ * segment is downloaded at once, the stream with the lowest buffer first.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc/vlc.h>
+#include "../../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+#include "../playlist/AbstractPlaylist.hpp"
+#include "../playlist/BasePeriod.h"
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../logic/AlwaysBestAdaptationLogic.h"
+#include "../logic/AlwaysLowestAdaptationLogic.hpp"
+#include "../logic/BufferBasedAdaptationLogic.hpp"
+#include "../logic/NearOptimalAdaptationLogic.hpp"
+#include "../logic/PredictiveAdaptationLogic.hpp"
+#include "../logic/RateBasedAdaptationLogic.h"
+#include "../xml/DOMParser.h"
+#include "../../dash/DASHManager.h"
+#include "../../dash/mpd/IsoffMainParser.h"
+#include "../../hls/HLSManager.hpp"
+#include "../../hls/playlist/Parser.hpp"
+#include "../../smooth/SmoothManager.hpp"
+#include "../../smooth/playlist/Parser.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+using namespace adaptive;
+using namespace adaptive::logic;
+using namespace adaptive::playlist;
+using namespace adaptive::xml;
+
+struct TracePoint
+{
+    mtime_t  duration;
+    uint64_t bps;
+};
+
+class Trace
+{
+    public:
+        bool load(const char *);
+        /* time to transfer size bytes from date, or -1 past the trace end */
+        mtime_t transfer(mtime_t, uint64_t) const;
+
+    private:
+        std::vector<TracePoint> points;
+};
+
+bool Trace::load(const char *path)
+{
+    FILE *f = vlc_fopen(path, "rt");
+    if(f == NULL)
+        return false;
+
+    char line[256];
+    while(fgets(line, sizeof(line), f))
+    {
+        unsigned ms;
+        unsigned kbps;
+        if(line[0] == '#' || sscanf(line, "%u %u", &ms, &kbps) != 2)
+            continue;
+        TracePoint point;
+        point.duration = (mtime_t) ms * 1000;
+        point.bps = (uint64_t) kbps * 1000;
+        points.push_back(point);
+    }
+    fclose(f);
+    return !points.empty();
+}
+
+mtime_t Trace::transfer(mtime_t date, uint64_t size) const
+{
+    double bits = size * 8.0;
+    mtime_t start = 0;
+    mtime_t elapsed = 0;
+    std::vector<TracePoint>::const_iterator it;
+    for(it = points.begin(); it != points.end(); ++it)
+    {
+        const TracePoint &point = *it;
+        mtime_t end = start + point.duration;
+        if(end > date + elapsed)
+        {
+            mtime_t avail = end - (date + elapsed);
+            double capacity = (double) point.bps * avail / CLOCK_FREQ;
+            if(capacity >= bits)
+                return elapsed + (mtime_t)(bits * CLOCK_FREQ / point.bps);
+            bits -= capacity;
+            elapsed += avail;
+        }
+        start = end;
+    }
+    return -1;
+}
+
+struct SimStream
+{
+    BaseAdaptationSet  *set;
+    BaseRepresentation *rep;
+    uint64_t            number;
+    mtime_t             buffer;
+    uint64_t            bits;       /* media downloaded, at nominal bandwidth */
+    mtime_t             downloaded; /* media duration downloaded */
+    unsigned            switches;
+};
+
+struct SimPlayback
+{
+    bool     playing;
+    mtime_t  startup;
+    mtime_t  stalled;
+    unsigned stalls;
+};
+
+static AbstractPlaylist * OpenPlaylist(vlc_object_t *obj, const char *url)
+{
+    stream_t *s = vlc_stream_NewURL(obj, url);
+    if(s == NULL)
+        return NULL;
+
+    AbstractPlaylist *playlist = NULL;
+    if(hls::HLSManager::isHTTPLiveStreaming(s))
+    {
+        hls::playlist::M3U8Parser parser;
+        playlist = parser.parse(obj, s, url);
+    }
+    else
+    {
+        DOMParser xmlParser;
+        if(xmlParser.reset(s) && xmlParser.parse(true))
+        {
+            if(dash::DASHManager::isDASH(xmlParser.getRootNode()))
+            {
+                dash::mpd::IsoffMainParser parser(xmlParser.getRootNode(), obj, s, url);
+                playlist = parser.parse();
+            }
+            else if(smooth::SmoothManager::isSmoothStreaming(xmlParser.getRootNode()))
+            {
+                smooth::playlist::ManifestParser parser(xmlParser.getRootNode(), obj, s, url);
+                playlist = parser.parse();
+            }
+        }
+    }
+    vlc_stream_Delete(s);
+    return playlist;
+}
+
+static AbstractAdaptationLogic * CreateLogic(vlc_object_t *obj, const char *name)
+{
+    if(!strcmp(name, "") || !strcmp(name, "nearoptimal"))
+        return new (std::nothrow) NearOptimalAdaptationLogic(obj);
+    if(!strcmp(name, "predictive"))
+        return new (std::nothrow) PredictiveAdaptationLogic(obj);
+    if(!strcmp(name, "rate"))
+        return new (std::nothrow) RateBasedAdaptationLogic(obj);
+    if(!strcmp(name, "buffer"))
+        return new (std::nothrow) BufferBasedAdaptationLogic(obj);
+    if(!strcmp(name, "lowest"))
+        return new (std::nothrow) AlwaysLowestAdaptationLogic();
+    if(!strcmp(name, "highest"))
+        return new (std::nothrow) AlwaysBestAdaptationLogic();
+    return NULL;
+}
+
+static mtime_t SegmentDuration(const SimStream &st, mtime_t fallback)
+{
+    mtime_t time, duration;
+    if(st.rep && st.rep->getPlaybackTimeDurationBySegmentNumber(st.number, &time, &duration)
+       && duration > 0)
+        return duration;
+    return fallback;
+}
+
+/* Drains all buffers for the elapsed time, accounting stalls */
+static void Play(std::vector<SimStream> &streams, mtime_t elapsed, SimPlayback *pb)
+{
+    mtime_t played = 0;
+    if(pb->playing)
+    {
+        played = elapsed;
+        for(size_t i = 0; i < streams.size(); i++)
+            played = std::min(played, streams[i].buffer);
+        for(size_t i = 0; i < streams.size(); i++)
+            streams[i].buffer -= played;
+        if(played < elapsed)
+        {
+            pb->playing = false;
+            pb->stalls++;
+        }
+    }
+    if(pb->startup >= 0) /* not rebuffering before startup */
+        pb->stalled += elapsed - played;
+}
+
+static void Usage(const char *psz_name)
+{
+    fprintf(stderr, "Usage: %s [-l logic] [-d segment ms] [-m min buffer ms]"
+                    " [-t target buffer ms] [-r request latency ms]"
+                    " <trace> <manifest path or URL>\n"
+                    "logics: nearoptimal (default), predictive, rate, buffer,"
+                    " lowest, highest\n", psz_name);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *psz_logic = "";
+    mtime_t default_duration = 2 * CLOCK_FREQ;
+    mtime_t min_buffering = 6 * CLOCK_FREQ;
+    mtime_t target_buffering = 30 * CLOCK_FREQ;
+    mtime_t latency = 0;
+
+    int c;
+    while((c = getopt(argc, argv, "l:d:m:t:r:")) != -1)
+    {
+        switch(c)
+        {
+            case 'l': psz_logic = optarg; break;
+            case 'd': default_duration = atoll(optarg) * 1000; break;
+            case 'm': min_buffering = atoll(optarg) * 1000; break;
+            case 't': target_buffering = atoll(optarg) * 1000; break;
+            case 'r': latency = atoll(optarg) * 1000; break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+    if(argc - optind != 2 || default_duration <= 0 ||
+       target_buffering <= min_buffering)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    Trace trace;
+    if(!trace.load(argv[optind]))
+    {
+        fprintf(stderr, "cannot load trace %s\n", argv[optind]);
+        return 1;
+    }
+
+    const char *const vlc_argv[] = { "--quiet", "--ignore-config" };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(vlc_argv), vlc_argv);
+    if(vlc == NULL)
+        return 1;
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    int i_ret = 1;
+    char *psz_url = strstr(argv[optind + 1], "://") ? strdup(argv[optind + 1])
+                                                    : vlc_path2uri(argv[optind + 1], NULL);
+    AbstractPlaylist *playlist = psz_url ? OpenPlaylist(obj, psz_url) : NULL;
+    AbstractAdaptationLogic *logic = CreateLogic(obj, psz_logic);
+    BasePeriod *period = playlist ? playlist->getFirstPeriod() : NULL;
+    if(playlist == NULL || period == NULL || logic == NULL)
+    {
+        fprintf(stderr, "cannot open %s with logic '%s'\n", argv[optind + 1], psz_logic);
+        goto end;
+    }
+
+    {
+        std::vector<SimStream> streams;
+        const std::vector<BaseAdaptationSet *> &sets = period->getAdaptationSets();
+        for(size_t i = 0; i < sets.size(); i++)
+        {
+            if(sets[i]->getRepresentations().empty())
+                continue;
+            SimStream st;
+            st.set = sets[i];
+            st.rep = NULL;
+            st.number = 0;
+            st.buffer = 0;
+            st.bits = 0;
+            st.downloaded = 0;
+            st.switches = 0;
+            streams.push_back(st);
+            logic->trackerEvent(SegmentTrackerEvent(st.set->getID(), true));
+        }
+
+        mtime_t now = 0;
+        SimPlayback pb;
+        pb.playing = false;
+        pb.startup = -1;
+        pb.stalled = 0;
+        pb.stalls = 0;
+
+        while(!streams.empty())
+        {
+            /* Lowest buffer first, as the downloader does */
+            SimStream *next = NULL;
+            for(size_t i = 0; i < streams.size(); i++)
+            {
+                SimStream &st = streams[i];
+                logic->trackerEvent(SegmentTrackerEvent(st.set->getID(), min_buffering,
+                                                        st.buffer, target_buffering));
+                if(st.buffer < target_buffering && (!next || st.buffer < next->buffer))
+                    next = &st;
+            }
+
+            if(next == NULL) /* all buffers full: idle until one can take a segment */
+            {
+                mtime_t idle = target_buffering;
+                for(size_t i = 0; i < streams.size(); i++)
+                    idle = std::min(idle, streams[i].buffer - target_buffering +
+                                          SegmentDuration(streams[i], default_duration));
+                idle = std::max(idle, (mtime_t) 1000);
+                Play(streams, idle, &pb);
+                now += idle;
+                continue;
+            }
+
+            BaseRepresentation *rep = logic->getNextRepresentation(next->set, next->rep);
+            if(rep == NULL)
+                break;
+            if(rep != next->rep)
+            {
+                logic->trackerEvent(SegmentTrackerEvent(next->rep, rep));
+                if(next->rep)
+                    next->switches++;
+                next->rep = rep;
+            }
+
+            const mtime_t duration = SegmentDuration(*next, default_duration);
+            logic->trackerEvent(SegmentTrackerEvent(next->set->getID(), duration));
+
+            const uint64_t size = rep->getBandwidth() * duration / 8 / CLOCK_FREQ;
+            mtime_t elapsed = trace.transfer(now + latency, size);
+            if(elapsed < 0)
+                break;
+            elapsed += latency;
+
+            Play(streams, elapsed, &pb);
+            now += elapsed;
+
+            logic->updateDownloadRate(next->set->getID(), size, elapsed);
+            next->buffer += duration;
+            next->bits += rep->getBandwidth() * duration / CLOCK_FREQ;
+            next->downloaded += duration;
+            next->number++;
+
+            if(!pb.playing)
+            {
+                /* start or resume once every stream has its minimum */
+                bool ready = true;
+                for(size_t i = 0; i < streams.size(); i++)
+                    ready &= streams[i].buffer >= std::min(min_buffering,
+                                                           SegmentDuration(streams[i], default_duration));
+                if(ready)
+                {
+                    if(pb.startup < 0)
+                        pb.startup = now;
+                    pb.playing = true;
+                }
+            }
+        }
+
+        printf("logic: %s\n", *psz_logic ? psz_logic : "nearoptimal");
+        printf("simulated time: %.3f s\n", (double) now / CLOCK_FREQ);
+        printf("startup delay: %.3f s\n", (double) pb.startup / CLOCK_FREQ);
+        printf("rebuffering: %u times, %.3f s\n", pb.stalls, (double) pb.stalled / CLOCK_FREQ);
+        for(size_t i = 0; i < streams.size(); i++)
+        {
+            const SimStream &st = streams[i];
+            printf("stream %s: average bitrate %" PRIu64 " kbit/s, %u switches, "
+                   "%.3f s downloaded\n", st.set->getID().str().c_str(),
+                   st.downloaded ? st.bits * CLOCK_FREQ / st.downloaded / 1000 : 0,
+                   st.switches, (double) st.downloaded / CLOCK_FREQ);
+        }
+        i_ret = 0;
+    }
+
+end:
+    delete logic;
+    delete playlist;
+    free(psz_url);
+    libvlc_release(vlc);
+    return i_ret;
+}
@@ -107,6 +107,15 @@ bool DASHManager::updatePlaylist()
         if(!p_block)
             return false;
 
+        /* Unchanged document: nothing to parse nor merge */
+        if(lastmanifest.size() == p_block->i_buffer &&
+           !lastmanifest.compare(0, lastmanifest.size(),
+                                 (const char *) p_block->p_buffer, p_block->i_buffer))
+        {
+            block_Release(p_block);
+            return true;
+        }
+
         stream_t *mpdstream = vlc_stream_MemoryNew(p_demux, p_block->p_buffer, p_block->i_buffer, true);
         if(!mpdstream)
         {
@@ -138,6 +147,7 @@ bool DASHManager::updatePlaylist()
         {
             playlist->mergeWith(newmpd, minsegmentTime);
             delete newmpd;
+            lastmanifest.assign((const char *) p_block->p_buffer, p_block->i_buffer);
         }
         vlc_stream_Delete(mpdstream);
         block_Release(p_block);
@@ -57,6 +57,9 @@ namespace dash
 
         protected:
             virtual int doControl(int, va_list); /* reimpl */
+
+        private:
+            std::string lastmanifest; /* last merged update, as fetched */
     };
 
 }
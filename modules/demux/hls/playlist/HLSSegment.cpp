@@ -22,11 +22,18 @@
 #endif
 
 #include "HLSSegment.hpp"
+#include "Parser.hpp"
+#include "Representation.hpp"
 #include "../adaptive/playlist/SegmentChunk.hpp"
-#include "../adaptive/playlist/BaseRepresentation.h"
+#include "../adaptive/playlist/BaseAdaptationSet.h"
+#include "../adaptive/playlist/AbstractPlaylist.hpp"
+#include "../adaptive/http/HTTPConnectionManager.h"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_interrupt.h>
+
+#include <list>
 #ifdef HAVE_GCRYPT
  #include <vlc_gcrypt.h>
 #endif
@@ -38,11 +45,194 @@ SegmentEncryption::SegmentEncryption()
     method = SegmentEncryption::NONE;
 }
 
+SegmentPart::SegmentPart()
+{
+    duration = 0;
+    independent = false;
+    hint = false;
+}
+
+namespace hls
+{
+    namespace playlist
+    {
+        /* Reads the parts of a live edge segment in sequence, reloading
+         * the playlist for the parts that are not yet published. */
+        class PartsChunkSource : public AbstractChunkSource
+        {
+            public:
+                PartsChunkSource(vlc_object_t *, AbstractConnectionManager *, const ID &,
+                                 const Representation *, uint64_t,
+                                 const std::vector<SegmentPart> &, size_t);
+                virtual ~PartsChunkSource();
+
+                virtual block_t *   readBlock       (); /* impl */
+                virtual block_t *   read            (size_t); /* impl */
+                virtual bool        hasMoreData     () const; /* impl */
+
+            private:
+                void                startParts();
+                bool                nextPart();
+                bool                reload();
+
+                vlc_object_t       *p_obj;
+                AbstractConnectionManager *connManager;
+                ID                  sourceid;
+                std::string         playlisturl;
+                bool                b_blockingreload;
+                mtime_t             parttarget;
+                uint64_t            number;
+                std::vector<SegmentPart> parts;
+                size_t              started; /* parts index of the next source */
+                std::list<HTTPChunkBufferedSource *> sources;
+                bool                complete;
+                bool                eof;
+
+                static const unsigned MAX_RELOADS = 10;
+        };
+    }
+}
+
+PartsChunkSource::PartsChunkSource(vlc_object_t *obj, AbstractConnectionManager *manager,
+                                   const ID &id, const Representation *rep, uint64_t num,
+                                   const std::vector<SegmentPart> &list, size_t first) :
+    AbstractChunkSource(),
+    p_obj(obj),
+    connManager(manager),
+    sourceid(id),
+    number(num),
+    parts(list),
+    started(first)
+{
+    playlisturl = rep->getPlaylistUrl().toString();
+    b_blockingreload = rep->canBlockReload();
+    parttarget = rep->getPartTarget();
+    complete = false;
+    eof = false;
+    startParts();
+}
+
+PartsChunkSource::~PartsChunkSource()
+{
+    while(!sources.empty())
+    {
+        delete sources.front();
+        sources.pop_front();
+    }
+}
+
+void PartsChunkSource::startParts()
+{
+    /* Parts are small: queue all the known ones at once */
+    for(; started < parts.size(); started++)
+    {
+        const SegmentPart &part = parts[started];
+        HTTPChunkBufferedSource *source =
+                new (std::nothrow) HTTPChunkBufferedSource(part.url, connManager, sourceid);
+        if(!source)
+            break;
+        if(part.range.isValid())
+            source->setBytesRange(part.range);
+        connManager->start(source);
+        sources.push_back(source);
+    }
+}
+
+bool PartsChunkSource::reload()
+{
+    for(unsigned i = 0; i < MAX_RELOADS; i++)
+    {
+        std::string url = playlisturl;
+        if(b_blockingreload) /* server holds the request until the part exists */
+            url = M3U8Parser::getBlockingReloadUrl(playlisturl, number, started);
+        else if(vlc_msleep_i11e(parttarget ? parttarget : CLOCK_FREQ))
+            return false; /* seeking or stopping */
+
+        std::vector<SegmentPart> updated;
+        M3U8Parser parser;
+        if(!parser.getSegmentParts(p_obj, url, number, updated, &complete))
+            return false;
+
+        if(updated.size() > started)
+        {
+            parts = updated;
+            startParts();
+            return !sources.empty();
+        }
+
+        if(complete)
+            return false;
+    }
+
+    msg_Warn(p_obj, "no new part for segment #%" PRIu64 " after %u reloads",
+             number, MAX_RELOADS);
+    return false;
+}
+
+bool PartsChunkSource::nextPart()
+{
+    delete sources.front();
+    sources.pop_front();
+    if(sources.empty() && (complete || !reload()))
+    {
+        eof = true;
+        return false;
+    }
+    return true;
+}
+
+block_t * PartsChunkSource::readBlock()
+{
+    if(eof)
+        return NULL;
+
+    while(!sources.empty() || reload())
+    {
+        block_t *p_block = sources.front()->readBlock();
+        if(p_block && p_block->i_buffer)
+            return p_block;
+        if(p_block)
+            block_Release(p_block);
+        if(!nextPart())
+            break;
+    }
+
+    /* last empty block, as the single source does */
+    eof = true;
+    return block_Alloc(0);
+}
+
+block_t * PartsChunkSource::read(size_t size)
+{
+    if(eof)
+        return NULL;
+
+    while(!sources.empty() || reload())
+    {
+        block_t *p_block = sources.front()->read(size);
+        if(p_block && p_block->i_buffer)
+            return p_block;
+        if(p_block)
+            block_Release(p_block);
+        if(!nextPart())
+            break;
+    }
+
+    eof = true;
+    return NULL;
+}
+
+bool PartsChunkSource::hasMoreData() const
+{
+    return !eof;
+}
+
 HLSSegment::HLSSegment( ICanonicalUrl *parent, uint64_t seq ) :
     Segment( parent )
 {
     setSequenceNumber(seq);
     utcTime = 0;
+    b_livestart = false;
 #ifdef HAVE_GCRYPT
     ctx = NULL;
 #endif
@@ -151,3 +341,51 @@ int HLSSegment::compare(ISegment *segment) const
     }
     else return ISegment::compare(segment);
 }
+
+bool HLSSegment::isPartial() const
+{
+    return sourceUrl.empty() && !parts.empty();
+}
+
+void HLSSegment::setLiveStart()
+{
+    b_livestart = true;
+}
+
+void HLSSegment::updateWith(HLSSegment *updated)
+{
+    sourceUrl = updated->sourceUrl;
+    startByte = updated->startByte;
+    endByte = updated->endByte;
+    duration.Set(updated->duration.Get());
+    parts = updated->parts;
+}
+
+SegmentChunk* HLSSegment::toChunk(size_t index, BaseRepresentation *rep,
+                                  AbstractConnectionManager *connManager)
+{
+    Representation *hlsrep = dynamic_cast<Representation *>(rep);
+    if(!isPartial() || !hlsrep)
+        return Segment::toChunk(index, rep, connManager);
+
+    size_t first = 0;
+    if(b_livestart) /* start from the most recent decodable part */
+    {
+        for(size_t i = 0; i < parts.size(); i++)
+            if(parts[i].independent && !parts[i].hint)
+                first = i;
+        b_livestart = false;
+    }
+
+    PartsChunkSource *source = new (std::nothrow)
+            PartsChunkSource(rep->getPlaylist()->getVLCObject(), connManager,
+                             rep->getAdaptationSet()->getID(), hlsrep,
+                             getSequenceNumber(), parts, first);
+    if(!source)
+        return NULL;
+
+    SegmentChunk *chunk = new (std::nothrow) SegmentChunk(this, source, rep);
+    if(!chunk)
+        delete source;
+    return chunk;
+}
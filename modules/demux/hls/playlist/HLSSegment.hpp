@@ -46,6 +46,18 @@ namespace hls
                 std::vector<uint8_t> iv;
         };
 
+        /* LL-HLS partial segment (EXT-X-PART or EXT-X-PRELOAD-HINT) */
+        class SegmentPart
+        {
+            public:
+                SegmentPart();
+                std::string url;
+                BytesRange  range;
+                mtime_t     duration;
+                bool        independent;
+                bool        hint; /* not published yet, server blocks on it */
+        };
+
         class HLSSegment : public Segment
         {
             friend class M3U8Parser;
@@ -56,9 +68,17 @@ namespace hls
                 void setEncryption(SegmentEncryption &);
                 mtime_t getUTCTime() const;
                 virtual int compare(ISegment *) const; /* reimpl */
+                virtual SegmentChunk* toChunk(size_t, BaseRepresentation *,
+                                              AbstractConnectionManager *); /* reimpl */
+                bool isPartial() const;
+                void setLiveStart();
+                void updateWith(HLSSegment *);
 
             protected:
                 mtime_t utcTime;
+                /* Live edge segment only known from its parts */
+                std::vector<SegmentPart> parts;
+                bool b_livestart;
                 virtual void onChunkDownload(block_t **, SegmentChunk *, BaseRepresentation *); /* reimpl */
 
                 SegmentEncryption encryption;
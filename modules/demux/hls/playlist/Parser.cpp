@@ -158,9 +158,161 @@ void M3U8Parser::createAndFillRepresentation(vlc_object_t *p_obj, BaseAdaptation
     }
 }
 
+static std::string resolvePlaylistUri(const std::string &uri, const std::string &playlisturl)
+{
+    Url url(uri);
+    if(!url.hasScheme())
+        url.prepend(Helper::getDirectoryPath(playlisturl).append("/"));
+    return url.toString();
+}
+
+std::string M3U8Parser::getBlockingReloadUrl(const std::string &playlisturl,
+                                             uint64_t number, size_t part)
+{
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << playlisturl << ((playlisturl.find('?') == std::string::npos) ? '?' : '&')
+       << "_HLS_msn=" << number << "&_HLS_part=" << part;
+    return os.str();
+}
+
+bool M3U8Parser::parsePart(const AttributesTag *tag, const std::string &playlisturl,
+                           SegmentPart *part, std::size_t *prevoffset)
+{
+    const Attribute *uriAttr = tag->getAttributeByName("URI");
+    const Attribute *durationAttr = tag->getAttributeByName("DURATION");
+    if(!uriAttr || !durationAttr)
+        return false;
+
+    const std::string url = resolvePlaylistUri(uriAttr->quotedString(), playlisturl);
+    if(url != part->url) /* byte ranges only follow up within a resource */
+        *prevoffset = 0;
+    part->url = url;
+    part->duration = CLOCK_FREQ * durationAttr->floatingPoint();
+
+    const Attribute *attr = tag->getAttributeByName("INDEPENDENT");
+    part->independent = (attr && attr->value == "YES");
+
+    if((attr = tag->getAttributeByName("BYTERANGE")))
+    {
+        std::pair<std::size_t,std::size_t> range = attr->unescapeQuotes().getByteRange();
+        if(range.first == 0) /* first == offset, second = size */
+            range.first = *prevoffset;
+        *prevoffset = range.first + range.second;
+        part->range = BytesRange(range.first, *prevoffset - 1);
+    }
+    part->hint = false;
+    return true;
+}
+
+bool M3U8Parser::parsePreloadHint(const AttributesTag *tag, const std::string &playlisturl,
+                                  SegmentPart *part)
+{
+    const Attribute *typeAttr = tag->getAttributeByName("TYPE");
+    const Attribute *uriAttr = tag->getAttributeByName("URI");
+    if(!typeAttr || typeAttr->value != "PART" || !uriAttr)
+        return false;
+
+    part->url = resolvePlaylistUri(uriAttr->quotedString(), playlisturl);
+    part->duration = 0;
+    part->independent = false;
+    part->hint = true;
+
+    const Attribute *startAttr = tag->getAttributeByName("BYTERANGE-START");
+    if(startAttr)
+    {
+        const Attribute *lengthAttr = tag->getAttributeByName("BYTERANGE-LENGTH");
+        const std::size_t start = startAttr->decimal();
+        part->range = BytesRange(start, lengthAttr ? start + lengthAttr->decimal() - 1 : 0);
+    }
+    return true;
+}
+
+bool M3U8Parser::getSegmentParts(vlc_object_t *p_obj, const std::string &url, uint64_t number,
+                                 std::vector<SegmentPart> &parts, bool *pb_complete)
+{
+    block_t *p_block = Retrieve::HTTP(p_obj, url);
+    if(!p_block)
+        return false;
+
+    stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
+    if(!substream)
+    {
+        block_Release(p_block);
+        return false;
+    }
+
+    std::list<Tag *> tagslist = parseEntries(substream);
+    vlc_stream_Delete(substream);
+    block_Release(p_block);
+
+    /* Reloads may use a delivery directive: resolve against the base */
+    std::string playlisturl = url;
+    const std::size_t query = playlisturl.find("_HLS_msn=");
+    if(query != std::string::npos)
+        playlisturl.erase(query - 1);
+
+    uint64_t sequenceNumber = 0;
+    std::size_t prevpartoffset = 0;
+    SegmentPart part;
+    *pb_complete = false;
+    parts.clear();
+
+    std::list<Tag *>::const_iterator it;
+    for(it = tagslist.begin(); it != tagslist.end() && !*pb_complete; ++it)
+    {
+        const Tag *tag = *it;
+        switch(tag->getType())
+        {
+            case SingleValueTag::EXTXMEDIASEQUENCE:
+                sequenceNumber = (static_cast<const SingleValueTag*>(tag))->getValue().decimal();
+                /* expired segment: nothing more to get */
+                if(sequenceNumber > number)
+                    *pb_complete = true;
+                break;
+
+            case SingleValueTag::URI:
+                if(static_cast<const SingleValueTag *>(tag)->getValue().value.empty())
+                    break;
+                /* full segment published: no more parts */
+                if(sequenceNumber++ == number)
+                    *pb_complete = true;
+                parts.clear();
+                prevpartoffset = 0;
+                break;
+
+            case AttributesTag::EXTXPART:
+                if(sequenceNumber == number &&
+                   parsePart(static_cast<const AttributesTag *>(tag), playlisturl,
+                             &part, &prevpartoffset))
+                    parts.push_back(part);
+                break;
+
+            case AttributesTag::EXTXPRELOADHINT:
+                if(sequenceNumber == number &&
+                   parsePreloadHint(static_cast<const AttributesTag *>(tag), playlisturl, &part))
+                    parts.push_back(part);
+                break;
+
+            case Tag::EXTXENDLIST:
+                *pb_complete = true;
+                break;
+        }
+    }
+
+    releaseTagsList(tagslist);
+
+    return true;
+}
+
 bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representation *rep)
 {
-    block_t *p_block = Retrieve::HTTP(p_obj, rep->getPlaylistUrl().toString());
+    std::string url = rep->getPlaylistUrl().toString();
+    /* Low latency: wait on the server for the next part */
+    if(rep->b_blockingReload && rep->partTarget && rep->nextSequenceNumber)
+        url = getBlockingReloadUrl(url, rep->nextSequenceNumber, rep->nextPartNumber);
+
+    block_t *p_block = Retrieve::HTTP(p_obj, url);
     if(p_block)
     {
         stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
@@ -179,7 +331,7 @@ bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representati
     return false;
 }
 
-void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::list<Tag *> &tagslist)
+void M3U8Parser::parseSegments(vlc_object_t *p_obj, Representation *rep, const std::list<Tag *> &tagslist)
 {
     SegmentList *segmentList = new (std::nothrow) SegmentList(rep);
 
@@ -190,11 +342,20 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
     mtime_t nzStartTime = 0;
     mtime_t absReferenceTime = VLC_TS_INVALID;
     uint64_t sequenceNumber = 0;
+    /* On live refreshes, segments we already have are only accounted */
+    const uint64_t knownSequenceEnd = rep->nextSequenceNumber;
     bool discontinuity = false;
     std::size_t prevbyterangeoffset = 0;
     const SingleValueTag *ctx_byterange = NULL;
     SegmentEncryption encryption;
     const ValuesListTag *ctx_extinf = NULL;
+    /* LL-HLS parts, only kept for the live edge segment */
+    const bool b_lowlatency = var_InheritBool(p_obj, "adaptive-lowlatency");
+    const std::string playlisturl = rep->getPlaylistUrl().toString();
+    std::vector<SegmentPart> ctx_parts;
+    std::size_t prevpartoffset = 0;
+    SegmentPart ctx_hint;
+    bool b_hint = false;
 
     std::list<Tag *>::const_iterator it;
     for(it = tagslist.begin(); it != tagslist.end(); ++it)
@@ -218,6 +379,9 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
             case SingleValueTag::URI:
             {
                 const SingleValueTag *uritag = static_cast<const SingleValueTag *>(tag);
+                ctx_parts.clear();
+                prevpartoffset = 0;
+                b_hint = false;
                 if(uritag->getValue().value.empty())
                 {
                     ctx_extinf = NULL;
@@ -225,6 +389,34 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                     break;
                 }
 
+                if(sequenceNumber < knownSequenceEnd)
+                {
+                    if(ctx_extinf)
+                    {
+                        const Attribute *attribute = ctx_extinf->getAttributeByName("DURATION");
+                        if(attribute)
+                        {
+                            const mtime_t nzDuration = CLOCK_FREQ * attribute->floatingPoint();
+                            nzStartTime += nzDuration;
+                            totalduration += nzDuration;
+                            if(absReferenceTime > VLC_TS_INVALID)
+                                absReferenceTime += nzDuration;
+                        }
+                        ctx_extinf = NULL;
+                    }
+                    if(ctx_byterange)
+                    {
+                        std::pair<std::size_t,std::size_t> range = ctx_byterange->getValue().getByteRange();
+                        if(range.first == 0)
+                            range.first = prevbyterangeoffset;
+                        prevbyterangeoffset = range.first + range.second;
+                        ctx_byterange = NULL;
+                    }
+                    discontinuity = false;
+                    sequenceNumber++;
+                    break;
+                }
+
                 HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
                 if(!segment)
                     break;
@@ -353,6 +545,39 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
             }
             break;
 
+            case AttributesTag::EXTXPART:
+            {
+                SegmentPart part;
+                if(!ctx_parts.empty())
+                    part.url = ctx_parts.back().url;
+                if(b_lowlatency &&
+                   parsePart(static_cast<const AttributesTag *>(tag), playlisturl,
+                             &part, &prevpartoffset))
+                    ctx_parts.push_back(part);
+            }
+            break;
+
+            case AttributesTag::EXTXPRELOADHINT:
+                if(b_lowlatency)
+                    b_hint = parsePreloadHint(static_cast<const AttributesTag *>(tag),
+                                              playlisturl, &ctx_hint);
+                break;
+
+            case AttributesTag::EXTXPARTINF:
+            {
+                const Attribute *attr = static_cast<const AttributesTag *>(tag)->getAttributeByName("PART-TARGET");
+                if(b_lowlatency && attr)
+                    rep->partTarget = CLOCK_FREQ * attr->floatingPoint();
+            }
+            break;
+
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                const Attribute *attr = static_cast<const AttributesTag *>(tag)->getAttributeByName("CAN-BLOCK-RELOAD");
+                rep->b_blockingReload = (attr && attr->value == "YES");
+            }
+            break;
+
             case Tag::EXTXDISCONTINUITY:
                 discontinuity  = true;
                 break;
@@ -363,6 +588,33 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
         }
     }
 
+    /* Live edge segment, only published as parts so far */
+    rep->nextPartNumber = 0;
+    if(!ctx_parts.empty() && rep->isLive() && sequenceNumber >= knownSequenceEnd)
+    {
+        HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber);
+        if(segment)
+        {
+            mtime_t nzDuration = 0;
+            std::vector<SegmentPart>::const_iterator pit;
+            for(pit = ctx_parts.begin(); pit != ctx_parts.end(); ++pit)
+                nzDuration += (*pit).duration;
+            rep->nextPartNumber = ctx_parts.size();
+
+            segment->parts = ctx_parts;
+            if(b_hint)
+                segment->parts.push_back(ctx_hint);
+            segment->duration.Set(rep->getTimescale().ToScaled(nzDuration));
+            segment->startTime.Set(rep->getTimescale().ToScaled(nzStartTime));
+            if(absReferenceTime > VLC_TS_INVALID)
+                segment->utcTime = absReferenceTime;
+            segment->discontinuity = discontinuity;
+            if(encryption.method != SegmentEncryption::NONE)
+                segment->setEncryption(encryption);
+            segmentList->addSegment(segment);
+        }
+    }
+
     if(rep->isLive())
     {
         rep->getPlaylist()->duration.Set(0);
@@ -372,6 +624,19 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
         rep->getPlaylist()->duration.Set(totalduration);
     }
 
+    if(sequenceNumber > knownSequenceEnd)
+        rep->nextSequenceNumber = sequenceNumber;
+
+    /* Our previous live edge segment got more parts, or completed */
+    if(!segmentList->getSegments().empty())
+    {
+        HLSSegment *updated = static_cast<HLSSegment *>(segmentList->getSegments().front());
+        HLSSegment *tail = dynamic_cast<HLSSegment *>(
+                    rep->getSegment(SegmentInformation::INFOTYPE_MEDIA, updated->getSequenceNumber()));
+        if(tail && tail->isPartial())
+            tail->updateWith(updated);
+    }
+
     rep->appendSegmentList(segmentList, true);
 }
 M3U8 * M3U8Parser::parse(vlc_object_t *p_object, stream_t *p_stream, const std::string &playlisturl)
@@ -24,6 +24,7 @@
 
 #include <cstdlib>
 #include <sstream>
+#include <vector>
 
 #include <vlc_common.h>
 
@@ -48,6 +49,7 @@ namespace hls
         class AttributesTag;
         class Tag;
         class Representation;
+        class SegmentPart;
 
         class M3U8Parser
         {
@@ -57,6 +59,9 @@ namespace hls
 
                 M3U8 *             parse  (vlc_object_t *p_obj, stream_t *p_stream, const std::string &);
                 bool appendSegmentsFromPlaylistURI(vlc_object_t *, Representation *);
+                bool getSegmentParts(vlc_object_t *, const std::string &, uint64_t,
+                                     std::vector<SegmentPart> &, bool *);
+                static std::string getBlockingReloadUrl(const std::string &, uint64_t, size_t);
 
             private:
                 Representation * createRepresentation(BaseAdaptationSet *, const AttributesTag *);
@@ -65,6 +70,10 @@ namespace hls
                 void parseSegments(vlc_object_t *, Representation *, const std::list<Tag *>&);
                 void setFormatFromExtension(Representation *rep, const std::string &);
                 std::list<Tag *> parseEntries(stream_t *);
+                static bool parsePart(const AttributesTag *, const std::string &,
+                                      SegmentPart *, std::size_t *);
+                static bool parsePreloadHint(const AttributesTag *, const std::string &,
+                                             SegmentPart *);
         };
     }
 }
@@ -45,6 +45,10 @@ Representation::Representation  ( BaseAdaptationSet *set ) :
     switchpolicy = SegmentInformation::SWITCH_SEGMENT_ALIGNED; /* FIXME: based on streamformat */
     nextUpdateTime = 0;
     targetDuration = 0;
+    nextSequenceNumber = 0;
+    nextPartNumber = 0;
+    partTarget = 0;
+    b_blockingReload = false;
     streamFormat = StreamFormat::UNKNOWN;
 }
 
@@ -104,6 +108,14 @@ void Representation::scheduleNextUpdate(uint64_t number)
     const AbstractPlaylist *playlist = getPlaylist();
     const time_t now = time(NULL);
 
+    /* Low latency: follow the parts, reloads being held by the server
+     * when it supports blocking, until the next one is published */
+    if(partTarget)
+    {
+        nextUpdateTime = now;
+        return;
+    }
+
     /* Compute new update time */
     mtime_t minbuffer = getMinAheadTime(number);
 
@@ -156,6 +168,32 @@ bool Representation::runLocalUpdates(mtime_t, uint64_t number, bool prune)
     return true;
 }
 
+uint64_t Representation::getLiveStartSegmentNumber(uint64_t def) const
+{
+    if(partTarget)
+    {
+        /* Start on the live edge part */
+        HLSSegment *segment = dynamic_cast<HLSSegment *>(
+                    getSegment(SegmentInfoType::INFOTYPE_MEDIA, nextSequenceNumber));
+        if(segment && segment->isPartial())
+        {
+            segment->setLiveStart();
+            return segment->getSequenceNumber();
+        }
+    }
+    return BaseRepresentation::getLiveStartSegmentNumber(def);
+}
+
+bool Representation::canBlockReload() const
+{
+    return b_blockingReload;
+}
+
+mtime_t Representation::getPartTarget() const
+{
+    return partTarget;
+}
+
 uint64_t Representation::translateSegmentNumber(uint64_t num, const SegmentInformation *from) const
 {
     if(consistentSegmentNumber())
@@ -52,6 +52,9 @@ namespace hls
                 virtual void debug(vlc_object_t *, int) const;  /* reimpl */
                 virtual bool runLocalUpdates(mtime_t, uint64_t, bool); /* reimpl */
                 virtual uint64_t translateSegmentNumber(uint64_t, const SegmentInformation *) const; /* reimpl */
+                virtual uint64_t getLiveStartSegmentNumber(uint64_t) const; /* reimpl */
+                bool canBlockReload() const;
+                mtime_t getPartTarget() const;
 
             private:
                 StreamFormat streamFormat;
@@ -59,6 +62,10 @@ namespace hls
                 bool b_loaded;
                 time_t nextUpdateTime;
                 time_t targetDuration;
+                uint64_t nextSequenceNumber; /* past the last parsed segment */
+                size_t nextPartNumber; /* parts known of the live edge segment */
+                mtime_t partTarget; /* LL-HLS, 0 if not in low latency mode */
+                bool b_blockingReload;
                 Url playlistUrl;
         };
     }
@@ -299,6 +299,10 @@ Tag * TagFactory::createTagByName(const std::string &name, const std::string &va
         {"EXT-X-I-FRAMES-ONLY",             Tag::EXTXIFRAMESONLY},
         {"EXT-X-MEDIA",                     AttributesTag::EXTXMEDIA},
         {"EXT-X-STREAM-INF",                AttributesTag::EXTXSTREAMINF},
+        {"EXT-X-PART",                      AttributesTag::EXTXPART},
+        {"EXT-X-PART-INF",                  AttributesTag::EXTXPARTINF},
+        {"EXT-X-PRELOAD-HINT",              AttributesTag::EXTXPRELOADHINT},
+        {"EXT-X-SERVER-CONTROL",            AttributesTag::EXTXSERVERCONTROL},
         {"EXTINF",                          ValuesListTag::EXTINF},
         {"",                                SingleValueTag::URI},
         {NULL,                              0},
@@ -334,6 +338,10 @@ Tag * TagFactory::createTagByName(const std::string &name, const std::string &va
         case AttributesTag::EXTXMAP:
         case AttributesTag::EXTXMEDIA:
         case AttributesTag::EXTXSTREAMINF:
+        case AttributesTag::EXTXPART:
+        case AttributesTag::EXTXPARTINF:
+        case AttributesTag::EXTXPRELOADHINT:
+        case AttributesTag::EXTXSERVERCONTROL:
             return new (std::nothrow) AttributesTag(exttagmapping[i].i, value);
         }
 
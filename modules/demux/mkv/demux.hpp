@@ -342,6 +342,7 @@ public:
         ,f_duration(-1.0)
         ,p_input(NULL)
         ,p_ev(NULL)
+        ,stats()
     {
         vlc_mutex_init( &lock_demuxer );
     }
@@ -397,6 +398,14 @@ public:
 
     /* event */
     event_thread_t *p_ev;
+
+    /* frame payload delivery, reported when closing */
+    struct
+    {
+        uint64_t i_frames;
+        uint64_t i_allocs;
+        uint64_t i_copies;
+    } stats;
 };
 
 
@@ -47,6 +47,7 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,i_attachments_position(-1)
     ,cluster(NULL)
     ,i_block_pos(0)
+    ,p_block_data(NULL)
     ,p_segment_uid(NULL)
     ,p_prev_segment_uid(NULL)
     ,p_next_segment_uid(NULL)
@@ -72,6 +73,8 @@ matroska_segment_c::~matroska_segment_c()
     free( psz_title );
     free( psz_date_utc );
 
+    BlockReleaseData();
+
     delete ep;
     delete segment;
     delete p_segment_uid;
@@ -1143,11 +1146,76 @@ void matroska_segment_c::ESDestroy( )
     }
 }
 
+void matroska_segment_c::BlockReleaseData()
+{
+    if( p_block_data != NULL )
+    {
+        block_Release( p_block_data );
+        p_block_data = NULL;
+    }
+}
+
+/* Only the block header and lacing are parsed by libmatroska, the frames are
+ * read straight from the stream into a single block_t, which BlockDecode()
+ * then slices per frame instead of copying each of them. */
+bool matroska_segment_c::BlockReadData( KaxInternalBlock & block )
+{
+    BlockReleaseData();
+
+    block.ReadData( es.I_O(), SCOPE_PARTIAL_DATA );
+
+    const unsigned int i_frames = block.NumberFrames();
+    if( i_frames == 0 )
+        return false;
+
+    uint64 i_size = 0;
+    for( unsigned int i = 0; i < i_frames; i++ )
+        i_size += block.GetFrameSize( i );
+
+    const uint64 i_start = block.GetDataPosition( 0 );
+    if( i_size == 0 || i_size >= SIZE_MAX ||
+        i_start < block.GetElementPosition() ||
+        i_start + i_size > block.GetEndPosition() )
+    {
+        msg_Warn( &sys.demuxer, "invalid block frame sizes" );
+        return false;
+    }
+
+    block_t *p_data = block_Alloc( i_size );
+    if( unlikely( p_data == NULL ) )
+        return false;
+    sys.stats.i_allocs++;
+
+    /* the lacing parser may have read ahead of the first frame */
+    if( es.I_O().getFilePointer() != i_start )
+        es.I_O().setFilePointer( i_start, seek_beginning );
+
+    if( es.I_O().read( p_data->p_buffer, i_size ) != i_size )
+    {
+        msg_Warn( &sys.demuxer, "cannot read block frames" );
+        block_Release( p_data );
+        return false;
+    }
+
+    p_block_data = p_data;
+    return true;
+}
+
+/* The caller owns the returned frames data */
+block_t *matroska_segment_c::BlockGetData()
+{
+    block_t *p_data = p_block_data;
+    p_block_data = NULL;
+    return p_data;
+}
+
 int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_simpleblock, bool *pb_key_picture, bool *pb_discardable_picture, int64_t *pi_duration )
 {
     pp_simpleblock = NULL;
     pp_block = NULL;
 
+    BlockReleaseData();
+
     *pb_key_picture         = true;
     *pb_discardable_picture = false;
     *pi_duration = 0;
@@ -1221,8 +1289,10 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
                 return;
             }
 
+            if( !vars.obj->BlockReadData( ksblock ) )
+                return;
+
             vars.simpleblock = &ksblock;
-            vars.simpleblock->ReadData( vars.obj->es.I_O() );
             vars.simpleblock->SetParent( *vars.obj->cluster );
 
             if( ksblock.IsKeyframe() )
@@ -1241,8 +1311,10 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
 
         E_CASE( KaxBlock, kblock )
         {
+            if( !vars.obj->BlockReadData( kblock ) )
+                return;
+
             vars.block = &kblock;
-            vars.block->ReadData( vars.obj->es.I_O() );
             vars.block->SetParent( *vars.obj->cluster );
 
             const mkv_track_t *p_track = vars.obj->FindTrackByBlock( &kblock, NULL );
@@ -1317,6 +1389,7 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
                 ep->Unkeep();
                 pp_simpleblock = NULL;
                 pp_block = NULL;
+                BlockReleaseData();
                 continue;
             }
             if( pp_simpleblock != NULL )
@@ -1329,13 +1402,11 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
             {
                 if( p_track->fmt.i_codec == VLC_CODEC_THEORA )
                 {
-                    DataBuffer *    p_data = &pp_block->GetBuffer(0);
-                    const uint8_t * p_buff = p_data->Buffer();
                     /* if the second bit of a Theora frame is 1
                        it's not a keyframe */
-                    if( p_data->Size() && p_buff )
+                    if( p_block_data != NULL && pp_block->GetFrameSize(0) > 0 )
                     {
-                        if( p_buff[0] & 0x40 )
+                        if( p_block_data->p_buffer[0] & 0x40 )
                             *pb_key_picture = false;
                     }
                     else
@@ -1391,6 +1462,7 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
                         ep->Unkeep();
                         pp_simpleblock = NULL;
                         pp_block = NULL;
+                        BlockReleaseData();
 
                         break;
                     }
@@ -1417,6 +1489,7 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
             ep->Unkeep();
             pp_simpleblock = NULL;
             pp_block = NULL;
+            BlockReleaseData();
         }
     }
 }
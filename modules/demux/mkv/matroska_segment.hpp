@@ -106,6 +106,7 @@ public:
 
     KaxCluster              *cluster;
     uint64                  i_block_pos;
+    block_t                 *p_block_data; /* frames of the last block returned by BlockGet */
     KaxSegmentUID           *p_segment_uid;
     KaxPrevUID              *p_prev_segment_uid;
     KaxNextUID              *p_next_segment_uid;
@@ -143,6 +144,7 @@ public:
     bool Seek( demux_t &, mtime_t i_mk_date, mtime_t i_mk_time_offset );
 
     int BlockGet( KaxBlock * &, KaxSimpleBlock * &, bool *, bool *, int64_t *);
+    block_t *BlockGetData();
 
     mkv_track_t * FindTrackByBlock(const KaxBlock *, const KaxSimpleBlock * );
 
@@ -154,6 +156,8 @@ public:
     bool SameFamily( const matroska_segment_c & of_segment ) const;
 
 private:
+    bool BlockReadData( KaxInternalBlock & );
+    void BlockReleaseData();
     void LoadCues( KaxCues *cues );
     void LoadTags( KaxTags *tags );
     bool LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int64_t i_element_position );
@@ -274,6 +274,14 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = reinterpret_cast<demux_t*>( p_this );
     demux_sys_t *p_sys   = p_demux->p_sys;
     virtual_segment_c *p_vsegment = p_sys->p_current_vsegment;
+
+    if( p_sys->stats.i_frames > 0 )
+        msg_Dbg( p_demux, "%" PRIu64 " frames, %" PRIu64 " allocations "
+                 "(%.2f per frame), %" PRIu64 " copies", p_sys->stats.i_frames,
+                 p_sys->stats.i_allocs,
+                 (double) p_sys->stats.i_allocs / p_sys->stats.i_frames,
+                 p_sys->stats.i_copies );
+
     if( p_vsegment )
     {
         matroska_segment_c *p_segment = p_vsegment->CurrentSegment();
@@ -501,10 +509,15 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
 
     if( !p_segment ) return;
 
+    block_t *p_data = p_segment->BlockGetData();
+    if( p_data == NULL )
+        return;
+
     mkv_track_t *p_track = p_segment->FindTrackByBlock( block, simpleblock );
     if( p_track == NULL )
     {
         msg_Err( p_demux, "invalid track number" );
+        block_Release( p_data );
         return;
     }
 
@@ -513,6 +526,7 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
     if( track.fmt.i_cat != DATA_ES && track.p_es == NULL )
     {
         msg_Err( p_demux, "unknown track number" );
+        block_Release( p_data );
         return;
     }
 
@@ -527,53 +541,73 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
         {
             if( track.fmt.i_cat == VIDEO_ES || track.fmt.i_cat == AUDIO_ES )
                 track.i_last_dts = VLC_TS_INVALID;
+            block_Release( p_data );
             return;
         }
     }
 
-    size_t frame_size = 0;
-    size_t block_size = 0;
+    KaxInternalBlock & internal_block = simpleblock != NULL ?
+        static_cast<KaxInternalBlock &>( *simpleblock ) :
+        static_cast<KaxInternalBlock &>( *block );
+
+    const unsigned int i_number_frames = internal_block.NumberFrames();
 
-    if( simpleblock != NULL )
-        block_size = simpleblock->GetSize();
-    else
-        block_size = block->GetSize();
+    /* laced frames are slices of the block data, a single frame is sent
+     * with the data read by BlockGet() */
+    const bool b_sliced = i_number_frames > 1;
+    if( b_sliced )
+    {
+        p_data = block_Share( p_data );
+        if( p_data == NULL )
+            return;
+    }
 
-    const unsigned int i_number_frames = block != NULL ? block->NumberFrames() :
-            ( simpleblock != NULL ? simpleblock->NumberFrames() : 0 );
+    size_t i_offset = 0;
 
     for( unsigned int i_frame = 0; i_frame < i_number_frames; i_frame++ )
     {
         block_t *p_block;
-        DataBuffer *data;
-        if( simpleblock != NULL )
-        {
-            data = &simpleblock->GetBuffer(i_frame);
-        }
-        else
-        {
-            data = &block->GetBuffer(i_frame);
-        }
-        frame_size += data->Size();
-        if( !data->Buffer() || data->Size() > frame_size || frame_size > block_size  )
+        const size_t i_frame_size = internal_block.GetFrameSize( i_frame );
+        uint8_t *p_frame = p_data->p_buffer + i_offset;
+
+        if( i_frame_size > p_data->i_buffer - i_offset )
         {
             msg_Warn( p_demux, "Cannot read frame (too long or no frame)" );
             break;
         }
+        i_offset += i_frame_size;
 
         if( track.i_compression_type == MATROSKA_COMPRESSION_HEADER &&
             track.p_compression_data != NULL &&
             track.i_encoding_scope & MATROSKA_ENCODING_SCOPE_ALL_FRAMES )
-            p_block = MemToBlock( data->Buffer(), data->Size(), track.p_compression_data->GetSize() );
+        {
+            p_block = MemToBlock( p_frame, i_frame_size, track.p_compression_data->GetSize() );
+            p_sys->stats.i_allocs++;
+            p_sys->stats.i_copies++;
+        }
         else if( unlikely( track.fmt.i_codec == VLC_CODEC_WAVPACK ) )
-            p_block = packetize_wavpack( track, data->Buffer(), data->Size() );
+        {
+            p_block = packetize_wavpack( track, p_frame, i_frame_size );
+            p_sys->stats.i_allocs++;
+            p_sys->stats.i_copies++;
+        }
+        else if( b_sliced )
+        {
+            p_block = block_Slice( p_data, p_frame, i_frame_size );
+            p_sys->stats.i_allocs++;
+        }
         else
-            p_block = MemToBlock( data->Buffer(), data->Size(), 0 );
+        {
+            p_block = p_data;
+            p_block->i_buffer = i_frame_size;
+            p_data = NULL;
+        }
 
         if( p_block == NULL )
         {
             break;
         }
+        p_sys->stats.i_frames++;
 
 #if defined(HAVE_ZLIB_H)
         if( track.i_compression_type == MATROSKA_COMPRESSION_ZLIB &&
@@ -623,7 +657,7 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
                 // TODO handle the start/stop times of this packet
                 p_sys->p_ev->SetPci( (const pci_t *)&p_block->p_buffer[1]);
                 block_Release( p_block );
-                return;
+                break;
             }
             p_block->i_dts = p_block->i_pts = i_pts;
         }
@@ -660,6 +694,9 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
                  i_pts + ( mtime_t )track.i_default_duration:
                  ( track.fmt.b_packetized ) ? VLC_TS_INVALID : i_pts + 1;
     }
+
+    if( p_data != NULL )
+        block_Release( p_data );
 }
 
 /*****************************************************************************
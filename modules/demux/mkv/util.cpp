@@ -161,7 +161,6 @@ block_t *MemToBlock( uint8_t *p_mem, size_t i_mem, size_t offset)
     return p_block;
 }
 
-
 void handle_real_audio(demux_t * p_demux, mkv_track_t * p_tk, block_t * p_blk, mtime_t i_pts)
 {
     uint8_t * p_frame = p_blk->p_buffer;
@@ -49,6 +49,11 @@ static void Close( vlc_object_t * );
 #define MP4_M4A_TEXT     "M4A audio only"
 #define MP4_M4A_LONGTEXT "Ignore non audio tracks from iTunes audio files"
 
+#define MP4_TRACK_STREAMS_TEXT     N_("Read tracks separately")
+#define MP4_TRACK_STREAMS_LONGTEXT N_("Open one input per track when the " \
+    "media is not interleaved and seeking is slow, so that each track is " \
+    "read sequentially with its own buffer.")
+
 vlc_module_begin ()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_DEMUX )
@@ -59,6 +64,8 @@ vlc_module_begin ()
 
     add_category_hint("Hacks", NULL, true)
     add_bool( CFG_PREFIX"m4a-audioonly", false, MP4_M4A_TEXT, MP4_M4A_LONGTEXT, true )
+    add_bool( CFG_PREFIX"track-streams", true, MP4_TRACK_STREAMS_TEXT,
+              MP4_TRACK_STREAMS_LONGTEXT, true )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -88,6 +95,7 @@ struct demux_sys_t
     bool         b_fragmented;   /* fMP4 */
     bool         b_seekable;
     bool         b_fastseekable;
+    bool         b_track_streams; /* one reader per track (not interleaved) */
     bool         b_error;        /* unrecoverable */
 
     bool            b_index_probed;     /* mFra sync points index */
@@ -125,6 +133,7 @@ struct demux_sys_t
 
 #define DEMUX_INCREMENT (CLOCK_FREQ / 4) /* How far the pcr will go, each round */
 #define DEMUX_TRACK_MAX_PRELOAD (CLOCK_FREQ * 15) /* maximum preloading, to deal with interleaving */
+#define DEMUX_MAX_READTHROUGH (1 << 17) /* gap read instead of seeking on slow sources */
 
 #define VLC_DEMUXER_EOS (VLC_DEMUXER_EGENERIC - 1)
 
@@ -147,6 +156,7 @@ static void MP4_TrackClean( es_out_t *, mp4_track_t * );
 static void MP4_Block_Send( demux_t *, mp4_track_t *, block_t * );
 
 static void MP4_TrackSelect  ( demux_t *, mp4_track_t *, bool );
+static void MP4_TrackStreamRelease( demux_t *, mp4_track_t * );
 static int  MP4_TrackSeek   ( demux_t *, mp4_track_t *, mtime_t );
 
 static uint64_t MP4_TrackGetPos    ( mp4_track_t * );
@@ -1036,6 +1046,16 @@ static int Open( vlc_object_t * p_this )
             msg_Warn( p_demux, "that media doesn't look interleaved, will need to seek");
         else if( i_max_continuity > DEMUX_TRACK_MAX_PRELOAD )
             msg_Warn( p_demux, "that media doesn't look properly interleaved, will need to seek");
+
+        /* Read each track sequentially from its own stream, instead of
+         * seeking back and forth on the single one */
+        if( ( b_flat || i_max_continuity > DEMUX_TRACK_MAX_PRELOAD ) &&
+            p_sys->b_seekable && p_demux->psz_access && p_demux->psz_location &&
+            var_InheritBool( p_demux, CFG_PREFIX"track-streams" ) )
+        {
+            p_sys->b_track_streams = true;
+            msg_Dbg( p_demux, "using one reader per track" );
+        }
     }
 
     /* */
@@ -1195,6 +1215,71 @@ static block_t * MP4_RTPHint_Convert( demux_t *p_demux, block_t *p_block, vlc_fo
     return p_converted;
 }
 
+/* Returns the stream to read the track from. Non interleaved media get one
+ * stream per track, opened from the same location, so that every track has
+ * its own read-ahead buffer and is read without seeking. The demuxer stream
+ * is handed to the first track needing one. */
+static stream_t * MP4_TrackStream( demux_t *p_demux, mp4_track_t *tk )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->b_track_streams )
+        return p_demux->s;
+    if( tk->p_stream )
+        return tk->p_stream;
+
+    bool b_used = false;
+    for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+        b_used |= ( p_sys->track[i].p_stream == p_demux->s );
+    if( !b_used )
+        return tk->p_stream = p_demux->s;
+
+    char *psz_url;
+    if( asprintf( &psz_url, "%s://%s", p_demux->psz_access,
+                  p_demux->psz_location ) == -1 )
+        return p_demux->s;
+
+    tk->p_stream = vlc_stream_NewURL( p_demux, psz_url );
+    free( psz_url );
+    if( tk->p_stream == NULL )
+    {
+        msg_Warn( p_demux, "track[0x%x] can't have its own reader, "
+                           "falling back to seeking", tk->i_track_ID );
+        p_sys->b_track_streams = false;
+        return p_demux->s;
+    }
+
+    msg_Dbg( p_demux, "track[0x%x] has its own reader", tk->i_track_ID );
+    return tk->p_stream;
+}
+
+static void MP4_TrackStreamRelease( demux_t *p_demux, mp4_track_t *tk )
+{
+    if( tk->p_stream && tk->p_stream != p_demux->s )
+        vlc_stream_Delete( tk->p_stream );
+    tk->p_stream = NULL;
+}
+
+/* Moves the track stream to the read position. Small forward gaps are read
+ * through, as a seek costs a new request on slow seeking sources. */
+static int MP4_TrackStreamSeek( demux_t *p_demux, stream_t *s, uint64_t i_readpos )
+{
+    int64_t i_pos = vlc_stream_Tell( s );
+    if( i_pos >= 0 && (uint64_t)i_pos == i_readpos )
+        return VLC_SUCCESS;
+
+    if( !p_demux->p_sys->b_fastseekable && i_pos >= 0 &&
+        (uint64_t)i_pos < i_readpos &&
+        i_readpos - i_pos <= DEMUX_MAX_READTHROUGH )
+    {
+        size_t i_gap = i_readpos - i_pos;
+        if( vlc_stream_Read( s, NULL, i_gap ) == (ssize_t)i_gap )
+            return VLC_SUCCESS;
+    }
+
+    return MP4_Seek( s, i_readpos );
+}
+
 /*****************************************************************************
  * Demux: read packet and send them to decoders
  *****************************************************************************
@@ -1234,21 +1319,19 @@ static int DemuxTrack( demux_t *p_demux, mp4_track_t *tk, uint64_t i_readpos,
         {
             block_t *p_block;
             int64_t i_delta;
+            stream_t *s = MP4_TrackStream( p_demux, tk );
 
-            if( vlc_stream_Tell( p_demux->s ) != i_readpos )
+            if( MP4_TrackStreamSeek( p_demux, s, i_readpos ) != VLC_SUCCESS )
             {
-                if( MP4_Seek( p_demux->s, i_readpos ) != VLC_SUCCESS )
-                {
-                    msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
-                                       ": Failed to seek to %"PRIu64,
-                              tk->i_track_ID, i_readpos );
-                    MP4_TrackSelect( p_demux, tk, false );
-                    goto end;
-                }
+                msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
+                                   ": Failed to seek to %"PRIu64,
+                          tk->i_track_ID, i_readpos );
+                MP4_TrackSelect( p_demux, tk, false );
+                goto end;
             }
 
             /* now read pes */
-            if( !(p_block = vlc_stream_Block( p_demux->s, i_samplessize )) )
+            if( !(p_block = vlc_stream_Block( s, i_samplessize )) )
             {
                 msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)"
                                    ": Failed to read %d bytes sample at %"PRIu64,
@@ -2132,7 +2215,10 @@ static void Close ( vlc_object_t * p_this )
     MP4_Fragments_Index_Delete( p_sys->p_fragsindex );
 
     for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+    {
+        MP4_TrackStreamRelease( p_demux, &p_sys->track[i_track] );
         MP4_TrackClean( p_demux->out, &p_sys->track[i_track] );
+    }
     free( p_sys->track );
 
     free( p_sys );
@@ -3537,6 +3623,9 @@ static void MP4_TrackSelect( demux_t *p_demux, mp4_track_t *p_track, bool b_sele
                         p_track->p_es, false );
     }
 
+    if( !b_select )
+        MP4_TrackStreamRelease( p_demux, p_track );
+
     p_track->b_selected = b_select;
 }
 
@@ -87,6 +87,8 @@ typedef struct
 
     bool b_mac_encoding;
 
+    stream_t *p_stream; /* dedicated reader, for non interleaved media */
+
     es_format_t fmt;
     uint32_t    i_block_flags;
     uint32_t    i_next_block_flags;
@@ -46,6 +46,7 @@
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
 #include "ts_metadata.h"
+#include "ts_workers.h"
 #include "sections.h"
 #include "pes.h"
 #include "timestamps.h"
@@ -114,6 +115,11 @@ static void Close ( vlc_object_t * );
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
+#define THREADS_TEXT N_("Demux threads")
+#define THREADS_LONGTEXT N_( \
+    "Number of threads demuxing the programs of live multi-program " \
+    "streams in parallel. 0 demuxes everything on the input thread." )
+
 static const char *const ts_standards_list[] =
     { "auto", "mpeg", "dvb", "arib", "atsc", "tdmb" };
 static const char *const ts_standards_list_text[] =
@@ -148,6 +154,7 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_integer_with_range( "ts-threads", 0, 0, 16, THREADS_TEXT, THREADS_LONGTEXT, true )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -178,6 +185,7 @@ static mtime_t GetPCR( const block_t * );
 static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, int * );
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t );
 static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
+static bool GatherStreamData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
@@ -186,6 +194,14 @@ static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 
+static void WorkersProcessPacket( demux_t *, ts_pid_t *, block_t * );
+static void WorkersMapPrograms( demux_t * );
+static inline void WorkersDrain( demux_sys_t *p_sys )
+{
+    if( p_sys->workers )
+        ts_workers_Drain( p_sys->workers );
+}
+
 #define TS_PACKET_SIZE_188 188
 #define TS_PACKET_SIZE_192 192
 #define TS_PACKET_SIZE_204 204
@@ -522,6 +538,22 @@ static int Open( vlc_object_t *p_this )
     else
         p_sys->es_creation = ( p_sys->b_access_control ? CREATE_ES : DELAY_ES );
 
+    /* Only live inputs: with pace control, a worker would block on the
+     * decoders while the input thread waits for it */
+    atomic_init( &p_sys->b_filters_update, false );
+    bool b_can_pace = true;
+    unsigned i_threads = var_InheritInteger( p_demux, "ts-threads" );
+    vlc_stream_Control( p_sys->stream, STREAM_CAN_CONTROL_PACE, &b_can_pace );
+    if( i_threads > 0 && !b_can_pace )
+    {
+        p_sys->workers = ts_workers_New( p_demux, i_threads, WorkersProcessPacket );
+        if( p_sys->workers )
+        {
+            msg_Dbg( p_demux, "demuxing programs with %u threads", i_threads );
+            WorkersMapPrograms( p_demux );
+        }
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -539,6 +571,9 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    if( p_sys->workers )
+        ts_workers_Delete( p_sys->workers );
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     vlc_mutex_lock( &p_sys->csa_lock );
@@ -619,6 +654,7 @@ static int Demux( demux_t *p_demux )
         block_t     *p_pkt;
         if( !(p_pkt = ReadTSPacket( p_demux )) )
         {
+            WorkersDrain( p_sys );
             return VLC_DEMUXER_EOF;
         }
 
@@ -657,6 +693,23 @@ static int Demux( demux_t *p_demux )
                 p_sys->b_valid_scrambling = true;
         }
 
+        /* Program demuxed by a worker thread */
+        if( p_sys->workers && p_pid->type == TYPE_STREAM &&
+            p_pid->u.p_stream->i_worker >= 0 )
+        {
+            p_sys->b_end_preparse = true;
+            if( p_sys->es_creation == DELAY_ES )
+            {
+                msg_Dbg( p_demux, "Creating delayed ES" );
+                ts_workers_Drain( p_sys->workers );
+                AddAndCreateES( p_demux, p_pid, true );
+                UpdatePESFilters( p_demux, p_sys->b_es_all );
+            }
+            ts_workers_Push( p_sys->workers, p_pid->u.p_stream->i_worker, p_pid,
+                             p_pkt, vlc_stream_Tell( p_sys->stream ) );
+            continue;
+        }
+
         /* Drop duplicates and invalid (DOES NOT drop corrupted) */
         p_pkt = ProcessTSPacket( p_demux, p_pid, p_pkt, &i_header );
         if( !p_pkt )
@@ -697,31 +750,12 @@ static int Demux( demux_t *p_demux )
             if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
             {
                 msg_Dbg( p_demux, "Creating delayed ES" );
+                WorkersDrain( p_sys );
                 AddAndCreateES( p_demux, p_pid, true );
                 UpdatePESFilters( p_demux, p_sys->b_es_all );
             }
 
-            /* Emulate HW filter */
-            if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
-            {
-                /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
-                continue;
-            }
-
-            if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
-            {
-                b_frame = GatherPESData( p_demux, p_pid, p_pkt, i_header );
-            }
-            else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
-            {
-                b_frame = GatherSectionsData( p_demux, p_pid, p_pkt, i_header );
-            }
-            else // pid->u.p_pes->transport == TS_TRANSPORT_IGNORE
-            {
-                block_Release( p_pkt );
-            }
-
+            b_frame = GatherStreamData( p_demux, p_pid, p_pkt, i_header );
             break;
 
         case TYPE_SI:
@@ -747,6 +781,10 @@ static int Demux( demux_t *p_demux )
             break;
     }
 
+    /* PCR fixup from a worker changed the program pids */
+    if( p_sys->workers && atomic_exchange( &p_sys->b_filters_update, false ) )
+        UpdatePESFilters( p_demux, p_sys->b_es_all );
+
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -793,6 +831,8 @@ void UpdatePESFilters( demux_t *p_demux, bool b_all )
     demux_sys_t *p_sys = p_demux->p_sys;
     ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
 
+    WorkersDrain( p_sys );
+
     /* We need 3 pass to avoid loss on deselect/relesect with hw filters and
        because pid could be shared and its state altered by another unselected pmt
        First clear flag on every referenced pid
@@ -867,6 +907,9 @@ void UpdatePESFilters( demux_t *p_demux, bool b_all )
         }
         UpdateHWFilter( p_sys, GetPID(p_sys, p_pmt->i_pid_pcr) );
     }
+
+    if( p_sys->workers )
+        WorkersMapPrograms( p_demux );
 }
 
 static int Control( demux_t *p_demux, int i_query, va_list args )
@@ -880,6 +923,24 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     const ts_pmt_t *p_pmt = NULL;
     const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
 
+    switch( i_query )
+    {
+    case DEMUX_GET_POSITION:
+    case DEMUX_SET_POSITION:
+    case DEMUX_GET_TIME:
+    case DEMUX_SET_TIME:
+    case DEMUX_GET_LENGTH:
+    case DEMUX_SET_GROUP:
+    case DEMUX_SET_ES:
+    case DEMUX_SET_TITLE:
+    case DEMUX_SET_SEEKPOINT:
+        /* programs state is owned by the workers */
+        WorkersDrain( p_sys );
+        break;
+    default:
+        break;
+    }
+
     for( int i=0; i<p_pat->programs.i_size && !p_pmt; i++ )
     {
         if( p_pat->programs.p_elems[i]->u.p_pmt->b_selected )
@@ -2141,6 +2202,8 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
         for( int i=0; i< p_pat->programs.i_size; i++ )
         {
             ts_pmt_t *p_opmt = p_pat->programs.p_elems[i]->u.p_pmt;
+            if( p_opmt->i_worker != p_pmt->i_worker ) /* owned by another thread */
+                continue;
             for( int j=0; j<p_opmt->e_streams.i_size; j++ )
             {
                 ts_pid_t *p_pid = p_opmt->e_streams.p_elems[j];
@@ -2171,11 +2234,16 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
     {
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
-        if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+        if( p_sys->b_access_control == false )
         {
-            p_pmt->i_last_dts = i_pcr;
-            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+            uint64_t i_pos = ( p_pmt->i_worker >= 0 )
+                           ? ts_workers_Position( p_sys->workers, p_pmt->i_worker )
+                           : vlc_stream_Tell( p_sys->stream );
+            if( i_pos > p_pmt->i_last_dts_byte )
+            {
+                p_pmt->i_last_dts = i_pcr;
+                p_pmt->i_last_dts_byte = i_pos;
+            }
         }
     }
 }
@@ -2277,12 +2345,15 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, mtime_t i_pcr )
     if(unlikely(GetPID(p_sys, 0)->type != TYPE_PAT))
         return;
 
+    /* Only programs demuxed by the same thread */
+    const int i_worker = ( pid->type == TYPE_STREAM ) ? pid->u.p_stream->i_worker : -1;
+
     /* Search program and set the PCR */
     ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
     for( int i = 0; i < p_pat->programs.i_size; i++ )
     {
         ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
-        if( p_pmt->pcr.b_disable )
+        if( p_pmt->i_worker != i_worker || p_pmt->pcr.b_disable )
             continue;
         mtime_t i_program_pcr = TimeStampWrapAround( p_pmt->pcr.i_first, i_pcr );
 
@@ -2346,6 +2417,20 @@ int FindPCRCandidate( ts_pmt_t *p_pmt )
         return 0x1FFF;
 }
 
+/* Workers can't use the pid list, but the programs they demux carry
+ * their PCR on their own pids */
+static const ts_pid_t * ProgramGetPCRPID( demux_t *p_demux, const ts_pmt_t *p_pmt )
+{
+    if( p_pmt->i_worker < 0 )
+        return GetPID( p_demux->p_sys, p_pmt->i_pid_pcr );
+
+    for( int i=0; i<p_pmt->e_streams.i_size; i++ )
+        if( p_pmt->e_streams.p_elems[i]->i_pid == p_pmt->i_pid_pcr )
+            return p_pmt->e_streams.p_elems[i];
+
+    return NULL;
+}
+
 /* Tries to reselect a new PCR when none has been received */
 static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
 {
@@ -2360,16 +2445,21 @@ static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
     }
     else if( p_block->i_dts - p_pmt->pcr.i_first_dts > CLOCK_FREQ / 2 ) /* "PCR repeat rate shall not exceed 100ms" */
     {
+        const ts_pid_t *p_pcrpid = ProgramGetPCRPID( p_demux, p_pmt );
         if( p_pmt->pcr.i_current < 0 &&
-            GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
+            ( !p_pcrpid || p_pcrpid->probed.i_pcr_count == 0 ) )
         {
             int i_cand = FindPCRCandidate( p_pmt );
             p_pmt->i_pid_pcr = i_cand;
-            if ( GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
+            p_pcrpid = ProgramGetPCRPID( p_demux, p_pmt );
+            if ( !p_pcrpid || p_pcrpid->probed.i_pcr_count == 0 )
                 p_pmt->pcr.b_disable = true;
             msg_Warn( p_demux, "No PCR received for program %d, set up workaround using pid %d",
                       p_pmt->i_number, i_cand );
-            UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
+            if( p_pmt->i_worker >= 0 ) /* done later by the input thread */
+                atomic_store( &p_demux->p_sys->b_filters_update, true );
+            else
+                UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
         }
         p_pmt->pcr.b_fix_done = true;
     }
@@ -2736,6 +2826,116 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pk
     return b_ret;
 }
 
+static bool GatherStreamData( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt, size_t i_skip )
+{
+    /* Emulate HW filter */
+    if( !p_demux->p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
+    {
+        /* That packet is for an unselected ES, don't waste time/memory gathering its data */
+        block_Release( p_pkt );
+        return false;
+    }
+
+    if( p_pid->u.p_stream->transport == TS_TRANSPORT_PES )
+    {
+        return GatherPESData( p_demux, p_pid, p_pkt, i_skip );
+    }
+    else if( p_pid->u.p_stream->transport == TS_TRANSPORT_SECTIONS )
+    {
+        return GatherSectionsData( p_demux, p_pid, p_pkt, i_skip );
+    }
+    else // pid->u.p_pes->transport == TS_TRANSPORT_IGNORE
+    {
+        block_Release( p_pkt );
+        return false;
+    }
+}
+
+/****************************************************************************
+ * Worker threads
+ ****************************************************************************/
+/* A program can be demuxed on a worker thread when none of its state is
+ * shared with other programs: no shared pid, and PCR from its own pids */
+static bool ProgramIsStandalone( const ts_pat_t *p_pat, const ts_pmt_t *p_pmt )
+{
+    if( p_pmt->iod ) /* object descriptors updates alter the ES */
+        return false;
+
+    bool b_pcr = ( p_pmt->i_pid_pcr == 0x1FFF );
+    for( int i=0; i<p_pmt->e_streams.i_size; i++ )
+    {
+        const ts_pid_t *p_pid = p_pmt->e_streams.p_elems[i];
+        if( p_pid->type != TYPE_STREAM || p_pid->i_refcount > 1 ||
+            p_pid->u.p_stream->p_es->p_next )
+            return false;
+        b_pcr |= ( p_pid->i_pid == p_pmt->i_pid_pcr );
+    }
+    if( !b_pcr )
+        return false;
+
+    for( int i=0; i<p_pat->programs.i_size; i++ )
+    {
+        const ts_pmt_t *p_other = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_other != p_pmt && p_other->i_pid_pcr != 0x1FFF &&
+            PIDReferencedByProgram( p_pmt, p_other->i_pid_pcr ) )
+            return false;
+    }
+
+    return true;
+}
+
+/* Assigns standalone programs to the workers. Requires drained workers. */
+static void WorkersMapPrograms( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_count = ts_workers_Count( p_sys->workers );
+    unsigned i_next = 0;
+
+    if( GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i=0; i<p_pat->programs.i_size; i++ )
+    {
+        ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        int i_worker = -1;
+
+        if( ProgramIsStandalone( p_pat, p_pmt ) )
+            i_worker = i_next++ % i_count;
+
+        if( p_pmt->i_worker != i_worker )
+            msg_Dbg( p_demux, "program %d demuxed by %s %d", p_pmt->i_number,
+                     i_worker >= 0 ? "worker" : "input thread", i_worker );
+        p_pmt->i_worker = i_worker;
+
+        for( int j=0; j<p_pmt->e_streams.i_size; j++ )
+        {
+            ts_pid_t *p_pid = p_pmt->e_streams.p_elems[j];
+            if( p_pid->type == TYPE_STREAM )
+                p_pid->u.p_stream->i_worker = i_worker;
+        }
+    }
+}
+
+/* Same as Demux() for a packet of a program owned by the calling worker */
+static void WorkersProcessPacket( demux_t *p_demux, ts_pid_t *p_pid, block_t *p_pkt )
+{
+    int i_header = 0;
+
+    p_pkt = ProcessTSPacket( p_demux, p_pid, p_pkt, &i_header );
+    if( !p_pkt )
+        return;
+
+    if( !SCRAMBLED(*p_pid) != !(p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED) )
+        UpdatePIDScrambledState( p_demux, p_pid, p_pkt->i_flags & BLOCK_FLAG_SCRAMBLED );
+
+    mtime_t i_pcr = GetPCR( p_pkt );
+    if( i_pcr > VLC_TS_INVALID )
+        PCRHandle( p_demux, p_pid, i_pcr );
+
+    GatherStreamData( p_demux, p_pid, p_pkt, i_header );
+}
+
 void TsChangeStandard( demux_sys_t *p_sys, ts_standards_e v )
 {
     if( p_sys->standard != TS_STANDARD_AUTO &&
@@ -24,6 +24,9 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_workers_t ts_workers_t;
+
+#include <vlc_atomic.h>
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -125,6 +128,10 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+
+    /* per program demux threads */
+    ts_workers_t *workers;
+    atomic_bool   b_filters_update; /* requested from a worker */
 };
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
@@ -117,6 +117,7 @@ ts_pmt_t *ts_pmt_New( demux_t *p_demux )
     pmt->i_number   = -1;
     pmt->i_pid_pcr  = 0x1FFF;
     pmt->b_selected = false;
+    pmt->i_worker   = -1;
     pmt->iod        = NULL;
     pmt->od.i_version = -1;
     ARRAY_INIT( pmt->od.objects );
@@ -287,6 +288,7 @@ ts_stream_t *ts_stream_New( demux_t *p_demux, ts_pmt_t *p_program )
     pes->gather.i_saved = 0;
     pes->b_broken_PUSI_conformance = false;
     pes->b_always_receive = false;
+    pes->i_worker = -1;
     pes->p_sections_proc = NULL;
     pes->p_proc = NULL;
     pes->prepcr.p_head = NULL;
@@ -43,6 +43,7 @@ struct ts_pmt_t
     int             i_number;
     int             i_pid_pcr;
     bool            b_selected;
+    int             i_worker; /* demuxing thread, -1 for the input one */
     /* IOD stuff (mpeg4) */
     od_descriptor_t *iod;
     od_descriptors_t od;
@@ -128,6 +129,7 @@ struct ts_stream_t
 
     bool        b_always_receive;
     bool        b_broken_PUSI_conformance;
+    int         i_worker; /* same as the program, -1 for the input thread */
     ts_sections_processor_t *p_sections_proc;
     ts_stream_processor_t   *p_proc;
 
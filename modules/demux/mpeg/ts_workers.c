@@ -0,0 +1,227 @@
+/*****************************************************************************
+ * ts_workers.c: TS Demux per program worker threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_block.h>
+
+#include "ts_workers.h"
+
+#include <assert.h>
+
+#define TS_WORKER_QUEUE 2048 /* packets, ~385KB */
+#define TS_WORKER_BATCH 64
+
+typedef struct
+{
+    ts_pid_t *p_pid;
+    block_t  *p_pkt;
+    uint64_t  i_pos;
+} ts_worker_item_t;
+
+typedef struct
+{
+    ts_workers_t *p_owner;
+    vlc_thread_t  thread;
+
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;     /* packets were queued, or exiting */
+    vlc_cond_t    done;     /* queue room was freed, or idle */
+
+    ts_worker_item_t queue[TS_WORKER_QUEUE];
+    unsigned      i_head;
+    unsigned      i_count;
+    bool          b_busy;
+    bool          b_exit;
+
+    /* only accessed by the worker itself, or while drained */
+    uint64_t      i_pos;
+} ts_worker_t;
+
+struct ts_workers_t
+{
+    demux_t                      *p_demux;
+    ts_workers_process_callback_t pf_process;
+    unsigned                      i_count;
+    ts_worker_t                  *p_workers;
+};
+
+static void *WorkerThread( void *data )
+{
+    ts_worker_t *p_worker = data;
+    ts_workers_t *p_owner = p_worker->p_owner;
+    ts_worker_item_t batch[TS_WORKER_BATCH];
+
+    vlc_mutex_lock( &p_worker->lock );
+    for( ;; )
+    {
+        while( p_worker->i_count == 0 && !p_worker->b_exit )
+        {
+            p_worker->b_busy = false;
+            vlc_cond_broadcast( &p_worker->done );
+            vlc_cond_wait( &p_worker->wait, &p_worker->lock );
+        }
+
+        if( p_worker->i_count == 0 )
+            break;
+
+        unsigned i_batch = __MIN(p_worker->i_count, TS_WORKER_BATCH);
+        for( unsigned i = 0; i < i_batch; i++ )
+        {
+            batch[i] = p_worker->queue[p_worker->i_head];
+            p_worker->i_head = (p_worker->i_head + 1) % TS_WORKER_QUEUE;
+        }
+        p_worker->i_count -= i_batch;
+        p_worker->b_busy = true;
+        vlc_cond_broadcast( &p_worker->done );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        for( unsigned i = 0; i < i_batch; i++ )
+        {
+            p_worker->i_pos = batch[i].i_pos;
+            p_owner->pf_process( p_owner->p_demux, batch[i].p_pid, batch[i].p_pkt );
+        }
+
+        vlc_mutex_lock( &p_worker->lock );
+    }
+    p_worker->b_busy = false;
+    vlc_mutex_unlock( &p_worker->lock );
+
+    return NULL;
+}
+
+ts_workers_t * ts_workers_New( demux_t *p_demux, unsigned i_count,
+                               ts_workers_process_callback_t pf_process )
+{
+    ts_workers_t *p_workers = malloc( sizeof(*p_workers) );
+    if( unlikely(p_workers == NULL) )
+        return NULL;
+
+    p_workers->p_workers = calloc( i_count, sizeof(ts_worker_t) );
+    if( unlikely(p_workers->p_workers == NULL) )
+    {
+        free( p_workers );
+        return NULL;
+    }
+    p_workers->p_demux = p_demux;
+    p_workers->pf_process = pf_process;
+    p_workers->i_count = 0;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->p_workers[i];
+        p_worker->p_owner = p_workers;
+        vlc_mutex_init( &p_worker->lock );
+        vlc_cond_init( &p_worker->wait );
+        vlc_cond_init( &p_worker->done );
+        p_worker->i_head = 0;
+        p_worker->i_count = 0;
+        p_worker->b_busy = false;
+        p_worker->b_exit = false;
+        p_worker->i_pos = 0;
+
+        if( vlc_clone( &p_worker->thread, WorkerThread, p_worker,
+                       VLC_THREAD_PRIORITY_INPUT ) )
+        {
+            vlc_cond_destroy( &p_worker->done );
+            vlc_cond_destroy( &p_worker->wait );
+            vlc_mutex_destroy( &p_worker->lock );
+            break;
+        }
+        p_workers->i_count++;
+    }
+
+    if( p_workers->i_count == 0 )
+    {
+        ts_workers_Delete( p_workers );
+        return NULL;
+    }
+
+    return p_workers;
+}
+
+void ts_workers_Delete( ts_workers_t *p_workers )
+{
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->p_workers[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->b_exit = true;
+        vlc_cond_signal( &p_worker->wait );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        /* remaining packets are processed before exiting */
+        vlc_join( p_worker->thread, NULL );
+
+        vlc_cond_destroy( &p_worker->done );
+        vlc_cond_destroy( &p_worker->wait );
+        vlc_mutex_destroy( &p_worker->lock );
+    }
+    free( p_workers->p_workers );
+    free( p_workers );
+}
+
+unsigned ts_workers_Count( const ts_workers_t *p_workers )
+{
+    return p_workers->i_count;
+}
+
+void ts_workers_Push( ts_workers_t *p_workers, unsigned i_worker,
+                      ts_pid_t *p_pid, block_t *p_pkt, uint64_t i_pos )
+{
+    assert( i_worker < p_workers->i_count );
+    ts_worker_t *p_worker = &p_workers->p_workers[i_worker];
+
+    vlc_mutex_lock( &p_worker->lock );
+    while( p_worker->i_count == TS_WORKER_QUEUE )
+        vlc_cond_wait( &p_worker->done, &p_worker->lock );
+
+    ts_worker_item_t *p_item = &p_worker->queue[(p_worker->i_head +
+                                                 p_worker->i_count) % TS_WORKER_QUEUE];
+    p_item->p_pid = p_pid;
+    p_item->p_pkt = p_pkt;
+    p_item->i_pos = i_pos;
+    if( p_worker->i_count++ == 0 )
+        vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+void ts_workers_Drain( ts_workers_t *p_workers )
+{
+    for( unsigned i = 0; i < p_workers->i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_workers->p_workers[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        while( p_worker->i_count > 0 || p_worker->b_busy )
+            vlc_cond_wait( &p_worker->done, &p_worker->lock );
+        vlc_mutex_unlock( &p_worker->lock );
+    }
+}
+
+uint64_t ts_workers_Position( const ts_workers_t *p_workers, unsigned i_worker )
+{
+    assert( i_worker < p_workers->i_count );
+    return p_workers->p_workers[i_worker].i_pos;
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************
+ * ts_workers.h: TS Demux per program worker threads
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_WORKERS_H
+#define VLC_TS_WORKERS_H
+
+#include "ts_pid_fwd.h"
+
+typedef struct ts_workers_t ts_workers_t;
+
+typedef void (* ts_workers_process_callback_t)( demux_t *, ts_pid_t *, block_t * );
+
+/* Each worker processes, in order, the packets pushed to it. Packets of
+ * a given program must always be pushed to the same worker. */
+ts_workers_t * ts_workers_New( demux_t *, unsigned i_count,
+                               ts_workers_process_callback_t );
+void ts_workers_Delete( ts_workers_t * );
+
+unsigned ts_workers_Count( const ts_workers_t * );
+
+/* Queues a packet, blocks while the worker queue is full.
+ * i_pos is the stream position following the packet */
+void ts_workers_Push( ts_workers_t *, unsigned i_worker,
+                      ts_pid_t *, block_t *, uint64_t i_pos );
+
+/* Waits for all queued packets to be processed. Any state shared with the
+ * workers can then be modified until the next push. */
+void ts_workers_Drain( ts_workers_t * );
+
+/* Stream position following the packet being processed by the worker */
+uint64_t ts_workers_Position( const ts_workers_t *, unsigned i_worker );
+
+#endif
@@ -309,6 +309,7 @@ static int Open( vlc_object_t *p_this )
                      p_h264_startcode, sizeof(p_h264_startcode), startcode_FindAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
+    p_sys->packetizer.b_slices = true;
 
     p_sys->b_slice = false;
     p_sys->p_frame = NULL;
@@ -797,7 +798,7 @@ static block_t *OutputPicture( decoder_t *p_dec )
     p_sys->p_sei = NULL;
     p_sys->pp_sei_last = &p_sys->p_sei;
 
-    p_pic = block_ChainGather( p_pic );
+    p_pic = block_SliceGather( p_pic );
 
     if( !p_pic )
         return NULL;
@@ -992,7 +993,11 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
     if( !p_sys->sps[p_sps->i_id].p_sps )
         msg_Dbg( p_dec, "found NAL_SPS (sps_id=%d)", p_sps->i_id );
 
-    StoreSPS( p_sys, p_sps->i_id, p_frag, p_sps );
+    /* Keep a copy, rather than a slice holding the whole input block */
+    block_t *p_copy = block_Duplicate( p_frag );
+    block_Release( p_frag );
+
+    StoreSPS( p_sys, p_sps->i_id, p_copy, p_sps );
 }
 
 static void PutPPS( decoder_t *p_dec, block_t *p_frag )
@@ -1019,7 +1024,11 @@ static void PutPPS( decoder_t *p_dec, block_t *p_frag )
     if( !p_sys->pps[p_pps->i_id].p_pps )
         msg_Dbg( p_dec, "found NAL_PPS (pps_id=%d sps_id=%d)", p_pps->i_id, p_pps->i_sps_id );
 
-    StorePPS( p_sys, p_pps->i_id, p_frag, p_pps );
+    /* Keep a copy, rather than a slice holding the whole input block */
+    block_t *p_copy = block_Duplicate( p_frag );
+    block_Release( p_frag );
+
+    StorePPS( p_sys, p_pps->i_id, p_copy, p_pps );
 }
 
 static void GetSPSPPS( uint8_t i_pps_id, void *priv,
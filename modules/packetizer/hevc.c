@@ -185,6 +185,7 @@ static int Open(vlc_object_t *p_this)
                     p_hevc_startcode, sizeof(p_hevc_startcode), startcode_FindAnnexB,
                     p_hevc_startcode, 1, 5,
                     PacketizeReset, PacketizeParse, PacketizeValidate, p_dec);
+    p_sys->packetizer.b_slices = true;
 
     /* Copy properties */
     es_format_Copy(&p_dec->fmt_out, &p_dec->fmt_in);
@@ -716,7 +717,7 @@ static block_t *GatherAndValidateChain(block_t *p_outputchain)
         if(p_outputchain->i_flags & BLOCK_FLAG_DROP)
             p_output = p_outputchain; /* Avoid useless gather */
         else
-            p_output = block_ChainGather(p_outputchain);
+            p_output = block_SliceGather(p_outputchain);
     }
 
     if(p_output && (p_output->i_flags & BLOCK_FLAG_DROP))
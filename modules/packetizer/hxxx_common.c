@@ -126,6 +126,17 @@ block_t *PacketizeXXC1( decoder_t *p_dec, uint8_t i_nal_length_size,
     p_block = *pp_block;
     *pp_block = NULL;
 
+    /* With 4 bytes lengths, the NALs are slices of the input block, with
+     * their length field overwritten by the startcode. The input block
+     * belongs to the packetizer and the NALs do not overlap: each startcode
+     * is written before the slice referencing it is created. */
+    if( i_nal_length_size == 4 )
+    {
+        p_block = block_Share( p_block );
+        if( !p_block )
+            return NULL;
+    }
+
     for( p = p_block->p_buffer; p < &p_block->p_buffer[p_block->i_buffer]; )
     {
         bool b_dummy;
@@ -149,8 +160,23 @@ block_t *PacketizeXXC1( decoder_t *p_dec, uint8_t i_nal_length_size,
 
         /* Convert AVC to AnnexB */
         block_t *p_nal;
+        if( i_nal_length_size == 4 )
+        {
+            /* Add start code, before the NAL is referenced */
+            p[-4] = 0x00;
+            p[-3] = 0x00;
+            p[-2] = 0x00;
+            p[-1] = 0x01;
+            p_nal = block_Slice( p_block, p - 4, 4 + i_size );
+            if( p_nal )
+            {
+                p_nal->i_dts = p_block->i_dts;
+                p_nal->i_pts = p_block->i_pts;
+            }
+            p += i_size;
+        }
         /* If data exactly match remaining bytes (1 NAL only or trailing one) */
-        if( i_size == p_block->p_buffer + p_block->i_buffer - p )
+        else if( i_size == p_block->p_buffer + p_block->i_buffer - p )
         {
             p_block->i_buffer = i_size;
             p_block->p_buffer = p;
@@ -175,10 +201,13 @@ block_t *PacketizeXXC1( decoder_t *p_dec, uint8_t i_nal_length_size,
             break;
 
         /* Add start code */
-        p_nal->p_buffer[0] = 0x00;
-        p_nal->p_buffer[1] = 0x00;
-        p_nal->p_buffer[2] = 0x00;
-        p_nal->p_buffer[3] = 0x01;
+        if( i_nal_length_size != 4 )
+        {
+            p_nal->p_buffer[0] = 0x00;
+            p_nal->p_buffer[1] = 0x00;
+            p_nal->p_buffer[2] = 0x00;
+            p_nal->p_buffer[3] = 0x01;
+        }
 
         /* Parse the NAL */
         block_t *p_pic;
@@ -55,6 +55,10 @@ typedef struct
 
     unsigned i_au_min_size;
 
+    /* Fragments reference the input blocks instead of copying them, and
+     * must then not be modified (see block_Slice()) */
+    bool b_slices;
+
     void *p_private;
     packetizer_reset_t    pf_reset;
     packetizer_parse_t    pf_parse;
@@ -79,6 +83,7 @@ static inline void packetizer_Init( packetizer_t *p_pack,
     p_pack->i_au_prepend = i_au_prepend;
     p_pack->p_au_prepend = p_au_prepend;
     p_pack->i_au_min_size = i_au_min_size;
+    p_pack->b_slices = false;
 
     p_pack->i_startcode = i_startcode;
     p_pack->p_startcode = p_startcode;
@@ -102,6 +107,33 @@ static inline void packetizer_Flush( packetizer_t *p_pack )
     p_pack->pf_reset( p_pack->p_private, true );
 }
 
+/* References the next fragment within its input block, if it does not span
+ * several blocks. The AU prefix must match the bytes preceding the fragment,
+ * typically the leading zero of 4 bytes startcodes. */
+static inline block_t *packetizer_Slice( packetizer_t *p_pack )
+{
+    block_bytestream_t *p_bytestream = &p_pack->bytestream;
+    block_t *p_block = p_bytestream->p_block;
+
+    if( p_bytestream->i_block_offset + p_pack->i_offset > p_block->i_buffer )
+        return NULL;
+
+    const uint8_t *p = &p_block->p_buffer[p_bytestream->i_block_offset];
+    block_t *p_pic = block_Slice( p_block, p - p_pack->i_au_prepend,
+                                  p_pack->i_offset + p_pack->i_au_prepend );
+    if( p_pic == NULL )
+        return NULL;
+
+    if( memcmp( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend ) )
+    {
+        block_Release( p_pic );
+        return NULL;
+    }
+
+    block_SkipBytes( p_bytestream, p_pack->i_offset );
+    return p_pic;
+}
+
 static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_block )
 {
     block_t *p_block = ( pp_block ) ? *pp_block : NULL;
@@ -128,7 +160,15 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
     }
 
     if( p_block )
+    {
+        if( p_pack->b_slices )
+        {
+            p_block = block_Share( p_block );
+            if( unlikely(p_block == NULL) )
+                return NULL;
+        }
         block_BytestreamPush( &p_pack->bytestream, p_block );
+    }
 
     for( ;; )
     {
@@ -180,15 +220,19 @@ static inline block_t *packetizer_Packetize( packetizer_t *p_pack, block_t **pp_
             /* Get the new fragment and set the pts/dts */
             block_t *p_block_bytestream = p_pack->bytestream.p_block;
 
-            p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+            p_pic = p_pack->b_slices ? packetizer_Slice( p_pack ) : NULL;
+            if( p_pic == NULL )
+            {
+                p_pic = block_Alloc( p_pack->i_offset + p_pack->i_au_prepend );
+
+                block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
+                                p_pic->i_buffer - p_pack->i_au_prepend );
+                if( p_pack->i_au_prepend > 0 )
+                    memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
+            }
             p_pic->i_pts = p_block_bytestream->i_pts;
             p_pic->i_dts = p_block_bytestream->i_dts;
 
-            block_GetBytes( &p_pack->bytestream, &p_pic->p_buffer[p_pack->i_au_prepend],
-                            p_pic->i_buffer - p_pack->i_au_prepend );
-            if( p_pack->i_au_prepend > 0 )
-                memcpy( p_pic->p_buffer, p_pack->p_au_prepend, p_pack->i_au_prepend );
-
             p_pack->i_offset = 0;
 
             /* Parse the NAL */
@@ -34,6 +34,8 @@
 #include <vlc_stream.h>
 #include <vlc_interrupt.h>
 
+#include "readahead.h"
+
 /* TODO:
  *  - tune the 2 methods (block/stream)
  *  - compute cost for seek
@@ -45,13 +47,15 @@
  * One linked list of data read
  */
 
-/* How many tracks we have, currently only used for stream mode */
+/* The cache size follows the consumption rate, within these bounds */
 #ifdef OPTIMIZE_MEMORY
     /* Max size of our cache 128KiB per stream */
 #   define STREAM_CACHE_SIZE  (1024*128)
+#   define STREAM_CACHE_MIN_SIZE STREAM_CACHE_SIZE
 #else
     /* Max size of our cache 48MiB per stream */
 #   define STREAM_CACHE_SIZE  (4*12*1024*1024)
+#   define STREAM_CACHE_MIN_SIZE (1024*1024)
 #endif
 
 /* How many data we try to prebuffer
@@ -61,7 +65,7 @@
 
 /* Method: Simple, for pf_block.
  *  We get blocks and put them in the linked list.
- *  We release blocks once the total size is bigger than STREAM_CACHE_SIZE
+ *  We release blocks once the total size is bigger than the read-ahead window
  */
 
 struct stream_sys_t
@@ -83,14 +87,18 @@ struct stream_sys_t
         uint64_t i_bytes;
         uint64_t i_read_time;
     } stat;
+
+    struct readahead readahead;
 };
 
 static int AStreamRefillBlock(stream_t *s)
 {
     stream_sys_t *sys = s->p_sys;
 
+    readahead_Update(&sys->readahead);
+
     /* Release data */
-    while (sys->i_size >= STREAM_CACHE_SIZE &&
+    while (sys->i_size >= sys->readahead.size &&
            sys->p_first != sys->p_current)
     {
         block_t *b = sys->p_first;
@@ -101,7 +109,7 @@ static int AStreamRefillBlock(stream_t *s)
 
         block_Release(b);
     }
-    if (sys->i_size >= STREAM_CACHE_SIZE &&
+    if (sys->i_size >= sys->readahead.size &&
         sys->p_current == sys->p_first &&
         sys->p_current->p_next)    /* At least 2 packets */
     {
@@ -126,6 +134,7 @@ static int AStreamRefillBlock(stream_t *s)
     }
 
     sys->stat.i_read_time += mdate() - start;
+    readahead_Read(&sys->readahead, b->i_buffer, mdate() - start);
     while (b)
     {
         /* Append the block */
@@ -251,6 +260,7 @@ static int AStreamSeekBlock(stream_t *s, uint64_t i_pos)
         sys->i_offset = i_offset - i_current;
 
         sys->i_pos = i_pos;
+        readahead_Seek(&sys->readahead, false);
 
         return VLC_SUCCESS;
     }
@@ -292,7 +302,7 @@ static int AStreamSeekBlock(stream_t *s, uint64_t i_pos)
             int i_th = b_aseekfast ? 1 : 5;
 
             if (i_skip <= i_th * i_avg &&
-                i_skip < STREAM_CACHE_SIZE)
+                i_skip < (int64_t)sys->readahead.size)
                 b_seek = false;
             else
                 b_seek = true;
@@ -302,6 +312,8 @@ static int AStreamSeekBlock(stream_t *s, uint64_t i_pos)
         }
     }
 
+    readahead_Seek(&sys->readahead, b_seek);
+
     if (b_seek)
     {
         /* Do the access seek */
@@ -367,6 +379,7 @@ static ssize_t AStreamReadBlock(stream_t *s, void *buf, size_t len)
     memcpy(buf, &sys->p_current->p_buffer[sys->i_offset], i_copy);
 
     sys->i_offset += i_copy;
+    readahead_Consumed(&sys->readahead, i_copy);
     if (sys->i_offset >= sys->p_current->i_buffer)
     {   /* Current block is now empty, switch to next */
         sys->i_offset = 0;
@@ -461,6 +474,9 @@ static int Open(vlc_object_t *obj)
     sys->p_first = NULL;
     sys->pp_last = &sys->p_first;
 
+    readahead_Init(&sys->readahead, obj, STREAM_CACHE_MIN_SIZE,
+                   STREAM_CACHE_MIN_SIZE, STREAM_CACHE_SIZE, 0, 0);
+
     s->p_sys = sys;
     /* Do the prebuffering */
     AStreamPrebufferBlock(s);
@@ -468,6 +484,8 @@ static int Open(vlc_object_t *obj)
     if (sys->i_size <= 0)
     {
         msg_Err(s, "cannot pre fill buffer");
+        block_ChainRelease(sys->p_first);
+        readahead_Clean(&sys->readahead);
         free(sys);
         return VLC_EGENERIC;
     }
@@ -487,6 +505,7 @@ static void Close(vlc_object_t *obj)
     stream_sys_t *sys = s->p_sys;
 
     block_ChainRelease(sys->p_first);
+    readahead_Clean(&sys->readahead);
     free(sys);
 }
 
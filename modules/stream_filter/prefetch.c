@@ -35,6 +35,8 @@
 #include <vlc_fs.h>
 #include <vlc_interrupt.h>
 
+#include "readahead.h"
+
 struct stream_sys_t
 {
     vlc_mutex_t  lock;
@@ -59,8 +61,9 @@ struct stream_sys_t
     size_t       buffer_length;
     size_t       buffer_size;
     char        *buffer;
-    size_t       read_size;
     size_t       seek_threshold;
+
+    struct readahead readahead;
 };
 
 static ssize_t ThreadRead(stream_t *stream, void *buf, size_t length)
@@ -114,8 +117,56 @@ static int ThreadControl(stream_t *stream, int query, ...)
     return ret;
 }
 
-#define MAX_READ 65536
-#define SEEK_THRESHOLD MAX_READ
+#define MAX_READ (1 << 20)
+#define MIN_BUFFER_SIZE (1 << 18)
+
+/**
+ * Resizes the circular buffer, keeping as much buffered data as possible.
+ * Unread data is never discarded.
+ */
+static void BufferResize(stream_t *stream, size_t size)
+{
+    stream_sys_t *sys = stream->p_sys;
+    uint64_t end = sys->buffer_offset + sys->buffer_length;
+    uint64_t unread = 0;
+
+    if (sys->stream_offset >= sys->buffer_offset && sys->stream_offset < end)
+        unread = end - sys->stream_offset;
+    if (size < unread)
+        size = unread;
+    if (size == sys->buffer_size)
+        return;
+
+    char *buffer = malloc(size);
+    if (unlikely(buffer == NULL))
+        return;
+
+    if (sys->buffer_length > size)
+    {   /* Discard the oldest historical data */
+        sys->buffer_offset = end - size;
+        sys->buffer_length = size;
+    }
+
+    for (uint64_t offset = sys->buffer_offset; offset < end;)
+    {
+        size_t from = offset % sys->buffer_size;
+        size_t to = offset % size;
+        size_t len = end - offset;
+
+        /* Do not step past the sharp edge of either circular buffer */
+        if (len > sys->buffer_size - from)
+            len = sys->buffer_size - from;
+        if (len > size - to)
+            len = size - to;
+
+        memcpy(buffer + to, sys->buffer + from, len);
+        offset += len;
+    }
+
+    free(sys->buffer);
+    sys->buffer = buffer;
+    sys->buffer_size = size;
+}
 
 static void *Thread(void *data)
 {
@@ -143,6 +194,9 @@ static void *Thread(void *data)
             continue;
         }
 
+        if (readahead_Update(&sys->readahead))
+            BufferResize(stream, sys->readahead.size);
+
         uint_fast64_t stream_offset = sys->stream_offset;
 
         if (stream_offset < sys->buffer_offset)
@@ -215,8 +269,8 @@ static void *Thread(void *data)
 
             /* Discard some historical data to make room. */
             len = history;
-            if (len > sys->read_size)
-                len = sys->read_size;
+            if (len > sys->readahead.read_size)
+                len = sys->readahead.read_size;
 
             assert(len <= sys->buffer_length);
             sys->buffer_offset += len;
@@ -227,8 +281,8 @@ static void *Thread(void *data)
              * all requested data to become available (e.g. regular files). So
              * we have to limit the data read in a single operation to avoid
              * blocking for too long. */
-            if (len > sys->read_size)
-                len = sys->read_size;
+            if (len > sys->readahead.read_size)
+                len = sys->readahead.read_size;
         }
 
         size_t offset = (sys->buffer_offset + sys->buffer_length)
@@ -237,9 +291,11 @@ static void *Thread(void *data)
         if (offset + len > sys->buffer_size)
             len = sys->buffer_size - offset;
 
+        mtime_t start = mdate();
         ssize_t val = ThreadRead(stream, sys->buffer + offset, len);
         if (val < 0)
             continue;
+        readahead_Read(&sys->readahead, val, mdate() - start);
         if (val == 0)
         {
             assert(len > 0);
@@ -264,6 +320,9 @@ static int Seek(stream_t *stream, uint64_t offset)
     stream_sys_t *sys = stream->p_sys;
 
     vlc_mutex_lock(&sys->lock);
+    readahead_Seek(&sys->readahead, offset < sys->buffer_offset
+        || offset > sys->buffer_offset + sys->buffer_length
+                    + sys->seek_threshold);
     sys->stream_offset = offset;
     sys->error = false;
     vlc_cond_signal(&sys->wait_space);
@@ -328,6 +387,7 @@ static ssize_t Read(stream_t *stream, void *buf, size_t buflen)
 
     memcpy(buf, sys->buffer + offset, copy);
     sys->stream_offset += copy;
+    readahead_Consumed(&sys->readahead, copy);
     vlc_cond_signal(&sys->wait_space);
     vlc_mutex_unlock(&sys->lock);
     return copy;
@@ -449,28 +509,44 @@ static int Open(vlc_object_t *obj)
     sys->buffer_offset = 0;
     sys->stream_offset = 0;
     sys->buffer_length = 0;
-    sys->buffer_size = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
-    sys->read_size = var_InheritInteger(obj, "prefetch-read-size");
     sys->seek_threshold = var_InheritInteger(obj, "prefetch-seek-threshold");
 
+    /* The buffer and read sizes follow the consumption rate, the settings
+     * are the upper buffer size and the lower read size. */
+    size_t max_size = var_InheritInteger(obj, "prefetch-buffer-size") << 10u;
+    size_t min_read = var_InheritInteger(obj, "prefetch-read-size");
+
     uint64_t size = stream_Size(stream->p_source);
     if (size > 0)
     {   /* No point allocating a buffer larger than the source stream */
-        if (sys->buffer_size > size)
-            sys->buffer_size = size;
-        if (sys->read_size > size)
-            sys->read_size = size;
+        if (max_size > size)
+            max_size = size;
+        if (min_read > size)
+            min_read = size;
     }
-    if (sys->buffer_size < sys->read_size)
-        sys->buffer_size = sys->read_size;
+    if (max_size < min_read)
+        max_size = min_read;
+
+    size_t max_read = __MAX(min_read, __MIN(MAX_READ, max_size / 4));
+    size_t min_size = __MAX(max_read, __MIN(MIN_BUFFER_SIZE, max_size));
+
+    readahead_Init(&sys->readahead, obj, min_size, max_size / 4, max_size,
+                   min_read, max_read);
+    sys->buffer_size = sys->readahead.size;
 
     sys->buffer = malloc(sys->buffer_size);
     if (sys->buffer == NULL)
+    {
+        readahead_Clean(&sys->readahead);
         goto error;
+    }
 
     sys->interrupt = vlc_interrupt_create();
     if (unlikely(sys->interrupt == NULL))
+    {
+        readahead_Clean(&sys->readahead);
         goto error;
+    }
 
     vlc_mutex_init(&sys->lock);
     vlc_cond_init(&sys->wait_data);
@@ -484,11 +560,12 @@ static int Open(vlc_object_t *obj)
         vlc_cond_destroy(&sys->wait_data);
         vlc_mutex_destroy(&sys->lock);
         vlc_interrupt_destroy(sys->interrupt);
+        readahead_Clean(&sys->readahead);
         goto error;
     }
 
-    msg_Dbg(stream, "using %zu bytes buffer, %zu bytes read",
-            sys->buffer_size, sys->read_size);
+    msg_Dbg(stream, "using %zu bytes buffer (up to %zu), %zu bytes read",
+            sys->buffer_size, max_size, sys->readahead.read_size);
     stream->pf_read = Read;
     stream->pf_readdir = ReadDir;
     stream->pf_control = Control;
@@ -517,6 +594,7 @@ static void Close (vlc_object_t *obj)
     vlc_cond_destroy(&sys->wait_space);
     vlc_cond_destroy(&sys->wait_data);
     vlc_mutex_destroy(&sys->lock);
+    readahead_Clean(&sys->readahead);
 
     free(sys->buffer);
     free(sys->content_type);
@@ -532,10 +610,10 @@ vlc_module_begin()
     set_callbacks(Open, Close)
 
     add_integer("prefetch-buffer-size", 1 << 14, N_("Buffer size"),
-                N_("Prefetch buffer size (KiB)"), false)
+                N_("Maximum prefetch buffer size (KiB)"), false)
         change_integer_range(4, 1 << 20)
     add_integer("prefetch-read-size", 1 << 14, N_("Read size"),
-                N_("Prefetch background read size (bytes)"), true)
+                N_("Minimum prefetch background read size (bytes)"), true)
         change_integer_range(1, 1 << 29)
     add_integer("prefetch-seek-threshold", 1 << 14, N_("Seek threshold"),
                 N_("Prefetch forward seek threshold (bytes)"), true)
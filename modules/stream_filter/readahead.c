@@ -0,0 +1,161 @@
+/*****************************************************************************
+ * readahead.c: rate-adaptive read-ahead window for stream filters
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_variables.h>
+
+#include "readahead.h"
+
+#define READAHEAD_PERIOD (CLOCK_FREQ / 2)
+#define READAHEAD_USED   "readahead-used"
+
+/**
+ * Moves the reservation of this window to the given size, within the
+ * process-wide budget. The minimum size is always granted.
+ */
+static size_t Reserve(struct readahead *ra, size_t size)
+{
+    vlc_object_t *libvlc = VLC_OBJECT(ra->obj->obj.libvlc);
+    vlc_value_t val;
+
+    val.i_int = (int64_t)size - (int64_t)ra->size;
+    if (val.i_int == 0
+     || var_GetAndSet(libvlc, READAHEAD_USED, VLC_VAR_INTEGER_ADD, &val))
+        return size;
+
+    int64_t excess = val.i_int - (int64_t)ra->budget;
+    if (size > ra->size && excess > 0)
+    {   /* Over budget: only keep what is left of the growth */
+        size_t giveback = __MIN((uint64_t)excess, size - ra->size);
+        if (size - giveback < ra->min_size)
+            giveback = size - __MAX(ra->min_size, ra->size);
+
+        val.i_int = -(int64_t)giveback;
+        var_GetAndSet(libvlc, READAHEAD_USED, VLC_VAR_INTEGER_ADD, &val);
+        size -= giveback;
+    }
+    return size;
+}
+
+void readahead_Init(struct readahead *ra, vlc_object_t *obj, size_t min_size,
+                    size_t initial_size, size_t max_size,
+                    size_t min_read, size_t max_read)
+{
+    assert(min_size <= max_size && min_read <= max_read);
+
+    ra->obj = obj;
+    ra->duration = var_InheritInteger(obj, "readahead-duration") * 1000;
+    ra->budget = (size_t)var_InheritInteger(obj, "readahead-memory") << 20;
+    ra->min_size = min_size;
+    ra->max_size = max_size;
+    ra->size = 0;
+    ra->min_read = min_read;
+    ra->max_read = max_read;
+    ra->read_size = min_read;
+    ra->last_update = mdate();
+    ra->consumed = 0;
+    ra->rate = 0;
+    ra->latency = 0;
+    ra->run = 0;
+    ra->avg_run = 0;
+    ra->seeks = 0;
+    ra->seeky = false;
+
+    var_Create(obj->obj.libvlc, READAHEAD_USED, VLC_VAR_INTEGER);
+    ra->size = Reserve(ra, VLC_CLIP(initial_size, min_size, max_size));
+}
+
+void readahead_Clean(struct readahead *ra)
+{
+    Reserve(ra, 0);
+    var_Destroy(ra->obj->obj.libvlc, READAHEAD_USED);
+}
+
+void readahead_Read(struct readahead *ra, size_t len, mtime_t latency)
+{
+    ra->latency = (3 * ra->latency + latency) / 4;
+
+    /* Sequential full-sized reads: try larger ones */
+    if (!ra->seeky && len >= ra->read_size && ra->read_size < ra->max_read)
+        ra->read_size = __MIN(2 * ra->read_size, ra->max_read);
+}
+
+void readahead_Seek(struct readahead *ra, bool far)
+{
+    if (!far)
+        return;
+
+    ra->avg_run = ra->avg_run ? (ra->avg_run + ra->run) / 2 : ra->run;
+    ra->run = 0;
+    ra->seeks++;
+
+    /* Whatever is read ahead of a far seek is wasted: read less at once */
+    ra->read_size = __MAX(ra->read_size / 2, ra->min_read);
+}
+
+bool readahead_Update(struct readahead *ra)
+{
+    mtime_t now = mdate();
+    mtime_t elapsed = now - ra->last_update;
+
+    if (elapsed < READAHEAD_PERIOD)
+        return false;
+
+    uint64_t rate = ra->consumed * CLOCK_FREQ / elapsed;
+    ra->rate = ra->rate ? (3 * ra->rate + rate) / 4 : rate;
+
+    /* More than one far seek per period, or seeks closer than the window:
+     * the stream is read at scattered offsets (e.g. badly interleaved). */
+    ra->seeky = ra->seeks > 1
+             || (ra->seeks > 0 && ra->avg_run < ra->size / 2);
+    if (!ra->seeky && ra->run > ra->size)
+        ra->avg_run = 0;
+
+    ra->last_update = now;
+    ra->consumed = 0;
+    ra->seeks = 0;
+
+    uint64_t want = ra->rate * (ra->duration + ra->latency) / CLOCK_FREQ;
+    if (ra->seeky && ra->avg_run > 0)
+        want = __MIN(want, 2 * ra->avg_run);
+    if (ra->rate == 0)
+        want = ra->size; /* paused or stalled: keep the window as is */
+    want = VLC_CLIP(want, ra->min_size, ra->max_size);
+
+    /* Hysteresis: do not chase small variations */
+    if (want < ra->size + ra->size / 4 && want + ra->size / 4 > ra->size)
+        return false;
+
+    size_t size = Reserve(ra, want);
+    if (size == ra->size)
+        return false;
+
+    msg_Dbg(ra->obj, "read-ahead window %zu -> %zu bytes "
+            "(%"PRIu64" bytes/s, %"PRId64" us latency%s)", ra->size, size,
+            ra->rate, ra->latency, ra->seeky ? ", seeking" : "");
+    ra->size = size;
+    return true;
+}
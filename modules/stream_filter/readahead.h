@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * readahead.h: rate-adaptive read-ahead window for stream filters
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STREAM_FILTER_READAHEAD_H
+#define VLC_STREAM_FILTER_READAHEAD_H
+
+/**
+ * Read-ahead window controller.
+ *
+ * The window is sized to hold "readahead-duration" of data at the measured
+ * consumption rate, plus the measured read latency. Streams with frequent far
+ * seeks get a window matching the data actually read between seeks, and a
+ * smaller read size. All the windows of the process share a memory budget
+ * ("readahead-memory"), accounted on the LibVLC instance.
+ *
+ * The controller is not thread-safe: callers serialize the calls.
+ */
+struct readahead
+{
+    vlc_object_t *obj;
+    mtime_t  duration;     /**< data to keep ahead, in microseconds */
+    size_t   budget;       /**< process-wide memory budget, in bytes */
+
+    size_t   min_size;
+    size_t   max_size;
+    size_t   size;         /**< current window size (reserved) */
+
+    size_t   min_read;
+    size_t   max_read;
+    size_t   read_size;    /**< current read size */
+
+    mtime_t  last_update;
+    uint64_t consumed;     /**< bytes consumed since last_update */
+    uint64_t rate;         /**< smoothed consumption rate, bytes/s */
+    mtime_t  latency;      /**< smoothed read latency */
+
+    uint64_t run;          /**< bytes consumed since the last far seek */
+    uint64_t avg_run;      /**< smoothed data consumed between far seeks */
+    unsigned seeks;        /**< far seeks since last_update */
+    bool     seeky;
+};
+
+void readahead_Init(struct readahead *, vlc_object_t *, size_t min_size,
+                    size_t initial_size, size_t max_size,
+                    size_t min_read, size_t max_read);
+void readahead_Clean(struct readahead *);
+
+/** Accounts data returned to the reader. */
+static inline void readahead_Consumed(struct readahead *ra, size_t len)
+{
+    ra->consumed += len;
+    ra->run += len;
+}
+
+/** Accounts one read from the source. */
+void readahead_Read(struct readahead *, size_t len, mtime_t latency);
+
+/** Accounts a seek, far if it could not be served from the buffered data. */
+void readahead_Seek(struct readahead *, bool far);
+
+/**
+ * Recomputes the window and read sizes, at most a few times per second.
+ * \return true if the window size changed
+ */
+bool readahead_Update(struct readahead *);
+
+#endif
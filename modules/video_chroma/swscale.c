@@ -35,6 +35,7 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include <vlc_cpu.h>
+#include <vlc_slices.h>
 
 #include <libswscale/swscale.h>
 #include <libswscale/version.h>
@@ -44,6 +45,7 @@
 #endif
 
 #include "../codec/avcodec/chroma.h" // Chroma Avutil <-> VLC conversion
+#include "copy.h"
 
 /* Gruikkkkkkkkkk!!!!! */
 #undef AVPALETTE_SIZE
@@ -65,6 +67,10 @@ const char *const ppsz_mode_descriptions[] =
   N_("Area"), N_("Luma bicubic / chroma bilinear"), N_("Gauss"),
   N_("SincR"), N_("Lanczos"), N_("Bicubic spline") };
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads sharing the rows of large "\
+                            "pictures (0 = one per CPU, 1 = no threading).")
+
 vlc_module_begin ()
     set_description( N_("Video scaling filter") )
     set_shortname( N_("Swscale" ) )
@@ -74,6 +80,8 @@ vlc_module_begin ()
     set_callbacks( OpenScaler, CloseScaler )
     add_integer( "swscale-mode", 2, SCALEMODE_TEXT, SCALEMODE_LONGTEXT, true )
         change_integer_list( pi_mode_values, ppsz_mode_descriptions )
+    add_integer_with_range( "swscale-threads", 0, 0, 16,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 vlc_module_end ()
 
 /* Version checking */
@@ -82,6 +90,36 @@ vlc_module_end ()
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Scaler context, with the parameters it was created for.
+ */
+typedef struct
+{
+    int i_src_width, i_src_height, i_src_fmt;
+    int i_dst_width, i_dst_height, i_dst_fmt;
+    int i_flags;
+} scaler_key_t;
+
+typedef struct scaler_ctx_t
+{
+    struct scaler_ctx_t *p_next;
+    scaler_key_t key;
+    struct SwsContext *ctx;
+} scaler_ctx_t;
+
+/* Same size 4:2:0 conversions done by the copy.c functions */
+enum
+{
+    FAST_COPY_NONE,
+    FAST_COPY_I420_NV12,
+    FAST_COPY_YV12_NV12,
+    FAST_COPY_NV12_I420,
+    FAST_COPY_NV12_YV12,
+};
+
+/* Maximum number of bands of a picture scaled in parallel */
+#define BANDS_MAX 16
+
 /**
  * Internal swscale filter structure.
  */
@@ -95,8 +133,15 @@ struct filter_sys_t
     const vlc_chroma_description_t *desc_in;
     const vlc_chroma_description_t *desc_out;
 
-    struct SwsContext *ctx;
-    struct SwsContext *ctxA;
+    scaler_ctx_t *ctx;
+    scaler_ctx_t *ctxA;
+    unsigned i_threads;
+    vlc_slices_t *slices;
+    unsigned i_bands;
+    scaler_ctx_t *bands[BANDS_MAX];
+    int i_fast_copy;
+    copy_cache_t cache;
+    unsigned i_cache_width;
     picture_t *p_src_a;
     picture_t *p_dst_a;
     int i_extend_factor;
@@ -140,6 +185,120 @@ static int GetSwsCpuMask(void);
 /* XXX is it always 3 even for BIG_ENDIAN (blend.c seems to think so) ? */
 #define OFFSET_A (3)
 
+/* Pictures smaller than this are not worth splitting in bands */
+#define BANDS_MIN_PIXELS (1280 * 720)
+/* Rows of each band but the last, a multiple of the chroma subsampling and
+ * of the dithering matrices height */
+#define BANDS_ALIGN (16)
+
+/*****************************************************************************
+ * Scaler contexts cache
+ *****************************************************************************
+ * Creating a context computes the filter coefficients and allocates the
+ * intermediate buffers, which is slow for large pictures. Idle contexts are
+ * kept for all the filters of the process, so that going back to a previous
+ * size, or rebuilding a filter chain, does not create them again. They are
+ * freed when the last filter is closed.
+ *****************************************************************************/
+#define CACHE_MAX (16)
+
+static vlc_mutex_t cache_lock = VLC_STATIC_MUTEX;
+static scaler_ctx_t *cache_first; /* most recently used first */
+static unsigned cache_users;
+
+static void HoldCache( void )
+{
+    vlc_mutex_lock( &cache_lock );
+    cache_users++;
+    vlc_mutex_unlock( &cache_lock );
+}
+
+static void ReleaseCache( void )
+{
+    scaler_ctx_t *p_list = NULL;
+
+    vlc_mutex_lock( &cache_lock );
+    assert( cache_users > 0 );
+    if( --cache_users == 0 )
+    {
+        p_list = cache_first;
+        cache_first = NULL;
+    }
+    vlc_mutex_unlock( &cache_lock );
+
+    while( p_list != NULL )
+    {
+        scaler_ctx_t *p_next = p_list->p_next;
+
+        sws_freeContext( p_list->ctx );
+        free( p_list );
+        p_list = p_next;
+    }
+}
+
+static scaler_ctx_t *GetContext( const scaler_key_t *p_key )
+{
+    vlc_mutex_lock( &cache_lock );
+    for( scaler_ctx_t **pp = &cache_first; *pp != NULL; pp = &(*pp)->p_next )
+    {
+        scaler_ctx_t *p_ctx = *pp;
+
+        if( !memcmp( &p_ctx->key, p_key, sizeof( *p_key ) ) )
+        {
+            *pp = p_ctx->p_next;
+            vlc_mutex_unlock( &cache_lock );
+            p_ctx->p_next = NULL;
+            return p_ctx;
+        }
+    }
+    vlc_mutex_unlock( &cache_lock );
+
+    scaler_ctx_t *p_ctx = malloc( sizeof( *p_ctx ) );
+    if( unlikely(p_ctx == NULL) )
+        return NULL;
+
+    p_ctx->ctx = sws_getContext( p_key->i_src_width, p_key->i_src_height,
+                                 p_key->i_src_fmt,
+                                 p_key->i_dst_width, p_key->i_dst_height,
+                                 p_key->i_dst_fmt,
+                                 p_key->i_flags, NULL, NULL, 0 );
+    if( p_ctx->ctx == NULL )
+    {
+        free( p_ctx );
+        return NULL;
+    }
+    p_ctx->p_next = NULL;
+    p_ctx->key = *p_key;
+    return p_ctx;
+}
+
+static void PutContext( scaler_ctx_t *p_ctx )
+{
+    scaler_ctx_t *p_old = NULL;
+    unsigned i_count = 0;
+
+    vlc_mutex_lock( &cache_lock );
+    p_ctx->p_next = cache_first;
+    cache_first = p_ctx;
+
+    /* Evict the least recently used context */
+    for( scaler_ctx_t **pp = &cache_first; *pp != NULL; pp = &(*pp)->p_next )
+        if( ++i_count > CACHE_MAX )
+        {
+            p_old = *pp;
+            *pp = NULL;
+            break;
+        }
+    vlc_mutex_unlock( &cache_lock );
+
+    if( p_old != NULL )
+    {
+        assert( p_old->p_next == NULL );
+        sws_freeContext( p_old->ctx );
+        free( p_old );
+    }
+}
+
 /*****************************************************************************
  * OpenScaler: probe the filter and return score
  *****************************************************************************/
@@ -184,8 +343,17 @@ static int OpenScaler( vlc_object_t *p_this )
     memset( &p_sys->fmt_in,  0, sizeof(p_sys->fmt_in) );
     memset( &p_sys->fmt_out, 0, sizeof(p_sys->fmt_out) );
 
+    /* The bands of large pictures are scaled by the threads of a pool,
+     * started by Init() for the first picture large enough. */
+    p_sys->i_threads = var_InheritInteger( p_filter, "swscale-threads" );
+    if( p_sys->i_threads == 0 )
+        p_sys->i_threads = vlc_GetCPUCount();
+
+    HoldCache();
     if( Init( p_filter ) )
     {
+        ReleaseCache();
+        vlc_slices_Delete( p_sys->slices );
         if( p_sys->p_filter )
             sws_freeFilter( p_sys->p_filter );
         free( p_sys );
@@ -216,6 +384,10 @@ static void CloseScaler( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     Clean( p_filter );
+    ReleaseCache();
+    if( p_sys->i_cache_width > 0 )
+        CopyCleanCache( &p_sys->cache );
+    vlc_slices_Delete( p_sys->slices );
     if( p_sys->p_filter )
         sws_freeFilter( p_sys->p_filter );
     free( p_sys );
@@ -350,6 +522,53 @@ static int GetParameters( ScalerConfiguration *p_cfg,
     return VLC_SUCCESS;
 }
 
+/* Vertical subsampling of the chroma planes, 1 for packed formats */
+static unsigned GetChromaRatio( const vlc_chroma_description_t *desc )
+{
+    if( desc->plane_count < 2 )
+        return 1;
+    return desc->p[1].h.den / desc->p[1].h.num;
+}
+
+static void ReleaseBands( filter_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_bands; i++ )
+        PutContext( p_sys->bands[i] );
+    p_sys->i_bands = 0;
+}
+
+static int GetFastCopy( const video_format_t *p_fmti,
+                        const video_format_t *p_fmto )
+{
+    if( p_fmti->i_visible_width != p_fmto->i_visible_width ||
+        p_fmti->i_visible_height != p_fmto->i_visible_height ||
+        p_fmti->i_x_offset != p_fmto->i_x_offset ||
+        p_fmti->i_y_offset != p_fmto->i_y_offset ||
+        ((p_fmti->i_x_offset + p_fmti->i_visible_width) & 1) ||
+        ((p_fmti->i_y_offset + p_fmti->i_visible_height) & 1) ||
+        p_fmti->i_visible_width < MINIMUM_WIDTH )
+        return FAST_COPY_NONE;
+
+    switch( p_fmti->i_chroma )
+    {
+        case VLC_CODEC_I420:
+            if( p_fmto->i_chroma == VLC_CODEC_NV12 )
+                return FAST_COPY_I420_NV12;
+            break;
+        case VLC_CODEC_YV12:
+            if( p_fmto->i_chroma == VLC_CODEC_NV12 )
+                return FAST_COPY_YV12_NV12;
+            break;
+        case VLC_CODEC_NV12:
+            if( p_fmto->i_chroma == VLC_CODEC_I420 )
+                return FAST_COPY_NV12_I420;
+            if( p_fmto->i_chroma == VLC_CODEC_YV12 )
+                return FAST_COPY_NV12_YV12;
+            break;
+    }
+    return FAST_COPY_NONE;
+}
+
 static int Init( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -398,19 +617,66 @@ static int Init( filter_t *p_filter )
     const unsigned i_fmto_visible_width = p_fmto->i_visible_width * p_sys->i_extend_factor;
     for( int n = 0; n < (cfg.b_has_a ? 2 : 1); n++ )
     {
-        const int i_fmti = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8;
-        const int i_fmto = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8;
-        struct SwsContext *ctx;
+        const scaler_key_t key = {
+            .i_src_width = i_fmti_visible_width,
+            .i_src_height = p_fmti->i_visible_height,
+            .i_src_fmt = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8,
+            .i_dst_width = i_fmto_visible_width,
+            .i_dst_height = p_fmto->i_visible_height,
+            .i_dst_fmt = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8,
+            .i_flags = cfg.i_sws_flags | p_sys->i_cpu_mask,
+        };
+        scaler_ctx_t *ctx = GetContext( &key );
 
-        ctx = sws_getContext( i_fmti_visible_width, p_fmti->i_visible_height, i_fmti,
-                              i_fmto_visible_width, p_fmto->i_visible_height, i_fmto,
-                              cfg.i_sws_flags | p_sys->i_cpu_mask,
-                              p_sys->p_filter, NULL, 0 );
         if( n == 0 )
             p_sys->ctx = ctx;
         else
             p_sys->ctxA = ctx;
     }
+
+    /* Large pictures are split in bands of rows, each one scaled by its own
+     * context. This is only exact if no filtering crosses the bands, that is
+     * without vertical scaling nor vertical chroma resampling. */
+    unsigned i_bands = __MIN( p_sys->i_threads, BANDS_MAX );
+    if( i_bands > 1 && !cfg.b_copy && p_sys->i_extend_factor == 1 &&
+        p_fmti->i_chroma != VLC_CODEC_RGBP &&
+        p_fmti->i_visible_height == p_fmto->i_visible_height &&
+        p_fmti->i_visible_height >= i_bands * BANDS_ALIGN &&
+        p_fmto->i_visible_width * p_fmto->i_visible_height >= BANDS_MIN_PIXELS &&
+        GetChromaRatio( p_sys->desc_in ) == GetChromaRatio( p_sys->desc_out ) )
+    {
+        if( p_sys->slices == NULL )
+            p_sys->slices = vlc_slices_New( p_sys->i_threads );
+        i_bands = p_sys->slices != NULL
+                ? __MIN( vlc_slices_Count( p_sys->slices ), BANDS_MAX ) : 0;
+
+        for( unsigned i = 0; i < i_bands; i++ )
+        {
+            unsigned i_start, i_end;
+
+            vlc_slices_Rows( i, i_bands, p_fmti->i_visible_height,
+                             BANDS_ALIGN, &i_start, &i_end );
+
+            const scaler_key_t key = {
+                .i_src_width = i_fmti_visible_width,
+                .i_src_height = i_end - i_start,
+                .i_src_fmt = cfg.i_fmti,
+                .i_dst_width = i_fmto_visible_width,
+                .i_dst_height = i_end - i_start,
+                .i_dst_fmt = cfg.i_fmto,
+                .i_flags = cfg.i_sws_flags | p_sys->i_cpu_mask,
+            };
+
+            p_sys->bands[i] = GetContext( &key );
+            if( p_sys->bands[i] == NULL )
+                break;
+            p_sys->i_bands++;
+        }
+        if( p_sys->i_bands < i_bands )
+            ReleaseBands( p_sys );
+    }
+
+    p_sys->i_fast_copy = GetFastCopy( p_fmti, p_fmto );
     if( p_sys->ctxA )
     {
         p_sys->p_src_a = picture_New( VLC_CODEC_GREY, i_fmti_visible_width, p_fmti->i_visible_height, 0, 1 );
@@ -481,10 +747,12 @@ static void Clean( filter_t *p_filter )
         picture_Release( p_sys->p_dst_a );
 
     if( p_sys->ctxA )
-        sws_freeContext( p_sys->ctxA );
+        PutContext( p_sys->ctxA );
 
     if( p_sys->ctx )
-        sws_freeContext( p_sys->ctx );
+        PutContext( p_sys->ctx );
+
+    ReleaseBands( p_sys );
 
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
@@ -499,7 +767,7 @@ static void GetPixels( uint8_t *pp_pixel[4], int pi_pitch[4],
                        const vlc_chroma_description_t *desc,
                        const video_format_t *fmt,
                        const picture_t *p_picture, unsigned planes,
-                       bool b_swap_uv )
+                       bool b_swap_uv, unsigned i_y )
 {
     unsigned i = 0;
 
@@ -516,7 +784,7 @@ static void GetPixels( uint8_t *pp_pixel[4], int pi_pitch[4],
         pp_pixel[i] = p->p_pixels
             + (((fmt->i_x_offset * desc->p[i].w.num) / desc->p[i].w.den)
                 * p->i_pixel_pitch)
-            + (((fmt->i_y_offset * desc->p[i].h.num) / desc->p[i].h.den)
+            + ((((fmt->i_y_offset + i_y) * desc->p[i].h.num) / desc->p[i].h.den)
                 * p->i_pitch);
         pi_pitch[i] = p->i_pitch;
     }
@@ -583,7 +851,7 @@ static void SwapUV( picture_t *p_dst, const picture_t *p_src )
 }
 
 static void Convert( filter_t *p_filter, struct SwsContext *ctx,
-                     picture_t *p_dst, picture_t *p_src, int i_height,
+                     picture_t *p_dst, picture_t *p_src, int i_y, int i_height,
                      int i_plane_count, bool b_swap_uvi, bool b_swap_uvo )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -592,7 +860,7 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
     uint8_t *dst[4]; int dst_stride[4];
 
     GetPixels( src, src_stride, p_sys->desc_in, &p_filter->fmt_in.video,
-               p_src, i_plane_count, b_swap_uvi );
+               p_src, i_plane_count, b_swap_uvi, i_y );
     if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_RGBP )
     {
         memset( palette, 0, sizeof(palette) );
@@ -604,7 +872,7 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
     }
 
     GetPixels( dst, dst_stride, p_sys->desc_out, &p_filter->fmt_out.video,
-               p_dst, i_plane_count, b_swap_uvo );
+               p_dst, i_plane_count, b_swap_uvo, i_y );
 
 #if LIBSWSCALE_VERSION_INT  >= ((0<<16)+(5<<8)+0)
     sws_scale( ctx, src, src_stride, 0, i_height,
@@ -615,6 +883,98 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+typedef struct
+{
+    filter_t  *p_filter;
+    picture_t *p_dst;
+    picture_t *p_src;
+    int        i_plane_count;
+} band_job_t;
+
+static void ConvertBand( void *opaque, unsigned i_index, unsigned i_count )
+{
+    band_job_t *job = opaque;
+    filter_sys_t *p_sys = job->p_filter->p_sys;
+    unsigned i_start, i_end;
+
+    vlc_slices_Rows( i_index, i_count,
+                     job->p_filter->fmt_in.video.i_visible_height,
+                     BANDS_ALIGN, &i_start, &i_end );
+    Convert( job->p_filter, p_sys->bands[i_index]->ctx, job->p_dst,
+             job->p_src, i_start, i_end - i_start, job->i_plane_count,
+             p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+}
+
+/* Same size 4:2:0 conversions with the copy.c functions, which copy whole
+ * lines of the source: they are only used if they fit in the destination */
+static bool FastCopy( filter_t *p_filter, picture_t *p_dst,
+                      const picture_t *p_src )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_height = p_filter->fmt_in.video.i_y_offset +
+                              p_filter->fmt_in.video.i_visible_height;
+    const bool b_planar_in = p_sys->i_fast_copy == FAST_COPY_I420_NV12 ||
+                             p_sys->i_fast_copy == FAST_COPY_YV12_NV12;
+    const plane_t *s = p_src->p;
+    const plane_t *d = p_dst->p;
+
+    if( p_src->i_planes != (b_planar_in ? 3 : 2) ||
+        p_dst->i_planes != (b_planar_in ? 2 : 3) ||
+        s[0].i_pitch > d[0].i_pitch || (unsigned)d[0].i_lines < i_height )
+        return false;
+
+    if( b_planar_in )
+    {
+        if( s[1].i_pitch != s[2].i_pitch || 2 * s[1].i_pitch > d[1].i_pitch ||
+            (unsigned)d[1].i_lines < i_height / 2 )
+            return false;
+    }
+    else
+    {
+        if( s[1].i_pitch / 2 > __MIN( d[1].i_pitch, d[2].i_pitch ) ||
+            (unsigned)__MIN( d[1].i_lines, d[2].i_lines ) < i_height / 2 )
+            return false;
+    }
+
+    if( p_sys->i_cache_width < (unsigned)s[0].i_pitch )
+    {
+        if( p_sys->i_cache_width > 0 )
+            CopyCleanCache( &p_sys->cache );
+        p_sys->i_cache_width = 0;
+        if( CopyInitCache( &p_sys->cache, s[0].i_pitch ) )
+            return false;
+        p_sys->i_cache_width = s[0].i_pitch;
+    }
+
+    uint8_t *planes[3] = { s[0].p_pixels, s[1].p_pixels,
+                           p_src->i_planes > 2 ? s[2].p_pixels : NULL };
+    size_t pitches[3] = { s[0].i_pitch, s[1].i_pitch,
+                          p_src->i_planes > 2 ? s[2].i_pitch : 0 };
+
+    switch( p_sys->i_fast_copy )
+    {
+        case FAST_COPY_YV12_NV12:
+            planes[1] = s[2].p_pixels;
+            planes[2] = s[1].p_pixels;
+            /* fall through */
+        case FAST_COPY_I420_NV12:
+            CopyFromI420ToNv12( p_dst, planes, pitches, i_height,
+                                &p_sys->cache );
+            break;
+        case FAST_COPY_NV12_I420:
+            CopyFromNv12ToI420( p_dst, planes, pitches, i_height,
+                                &p_sys->cache );
+            break;
+        case FAST_COPY_NV12_YV12:
+            CopyFromNv12ToYv12( p_dst, planes, pitches, i_height,
+                                &p_sys->cache );
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+    return true;
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -657,13 +1017,29 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         picture_CopyPixels( p_dst, p_src );
     else if( p_sys->b_copy )
         SwapUV( p_dst, p_src );
+    else if( p_sys->i_fast_copy != FAST_COPY_NONE &&
+             FastCopy( p_filter, p_dst, p_src ) )
+        ;
     else
     {
         /* Even if alpha is unused, swscale expects the pointer to be set */
         const int n_planes = !p_sys->ctxA && (p_src->i_planes == 4 ||
                              p_dst->i_planes == 4) ? 4 : 3;
-        Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_visible_height,
-                 n_planes, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+
+        if( p_sys->i_bands > 1 )
+        {
+            band_job_t job = {
+                .p_filter = p_filter,
+                .p_dst = p_dst,
+                .p_src = p_src,
+                .i_plane_count = n_planes,
+            };
+            vlc_slices_Run( p_sys->slices, p_sys->i_bands, ConvertBand, &job );
+        }
+        else
+            Convert( p_filter, p_sys->ctx->ctx, p_dst, p_src, 0,
+                     p_fmti->i_visible_height, n_planes,
+                     p_sys->b_swap_uvi, p_sys->b_swap_uvo );
     }
     if( p_sys->ctxA )
     {
@@ -675,8 +1051,8 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         else
             plane_CopyPixels( p_sys->p_src_a->p, p_src->p+A_PLANE );
 
-        Convert( p_filter, p_sys->ctxA, p_sys->p_dst_a, p_sys->p_src_a,
-                 p_fmti->i_visible_height, 1, false, false );
+        Convert( p_filter, p_sys->ctxA->ctx, p_sys->p_dst_a, p_sys->p_src_a,
+                 0, p_fmti->i_visible_height, 1, false, false );
         if( p_fmto->i_chroma == VLC_CODEC_RGBA || p_fmto->i_chroma == VLC_CODEC_BGRA )
             InjectA( p_dst, p_sys->p_dst_a, OFFSET_A );
         else if( p_fmto->i_chroma == VLC_CODEC_ARGB )
@@ -130,57 +130,60 @@ int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
  * RenderLinear: BOB with linear interpolation
  *****************************************************************************/
 
-int RenderLinear( filter_t *p_filter,
-                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+struct linear_job
 {
-    VLC_UNUSED(p_filter);
-    VLC_UNUSED(order);
-    int i_plane;
+    filter_t *p_filter;
+    picture_t *p_outpic;
+    const picture_t *p_pic;
+    int i_field;
+};
+
+/* Renders one band of rows in every plane */
+static void LinearSlice( void *opaque, unsigned index, unsigned count )
+{
+    const struct linear_job *job = opaque;
+    filter_t *p_filter = job->p_filter;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < job->p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
+        const plane_t *in = &job->p_pic->p[i_plane];
+        plane_t *out = &job->p_outpic->p[i_plane];
+        const int i_lines = out->i_visible_lines;
+        unsigned start, end;
 
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+        vlc_slices_Rows( index, count, i_lines, 2, &start, &end );
 
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
+        for( int y = start; y < (int)end; y++ )
         {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+            uint8_t *p_out = &out->p_pixels[y * out->i_pitch];
+            const uint8_t *p_in = &in->p_pixels[y * in->i_pitch];
+
+            /* Lines of the kept field, and the first and last lines of the
+             * other one, are copied */
+            if( (y % 2) == job->i_field || y == 0 || y == i_lines - 1 )
+                memcpy( p_out, p_in, in->i_pitch );
+            else
+                Merge( p_out, p_in - in->i_pitch, p_in + in->i_pitch,
+                       in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderLinear( filter_t *p_filter,
+                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+{
+    VLC_UNUSED(order);
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct linear_job job = {
+        .p_filter = p_filter,
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+        .i_field = i_field,
+    };
+
+    vlc_slices_Run( p_sys->slices, vlc_slices_Count( p_sys->slices ),
+                    LinearSlice, &job );
     return VLC_SUCCESS;
 }
 
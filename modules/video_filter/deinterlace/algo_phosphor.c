@@ -47,6 +47,28 @@
  * Internal functions
  *****************************************************************************/
 
+/**
+ * Internal helper function: first and end lines of the given field
+ * within a slice of the plane.
+ *
+ * Slices start on even lines, so that the field parity is kept.
+ */
+static void SliceField( const plane_t *p_plane, int i_field,
+                        unsigned index, unsigned count,
+                        uint8_t **pp_out, uint8_t **pp_out_end )
+{
+    unsigned start, end;
+
+    vlc_slices_Rows( index, count, p_plane->i_visible_lines, 2,
+                     &start, &end );
+    *pp_out = p_plane->p_pixels + start * p_plane->i_pitch;
+    *pp_out_end = p_plane->p_pixels + end * p_plane->i_pitch;
+
+    /* skip first line for bottom field */
+    if( i_field == 1 )
+        *pp_out += p_plane->i_pitch;
+}
+
 /**
  * Internal helper function: dims (darkens) the given field
  * of the given picture.
@@ -66,12 +88,14 @@
  * @param p_dst Input/output picture. Will be modified in-place.
  * @param i_field Darken which field? 0 = top, 1 = bottom.
  * @param i_strength Strength of effect: 1, 2 or 3 (division by 2, 4 or 8).
+ * @param index Slice of the rows to process, see vlc_slices_Rows().
+ * @param count Number of slices.
  * @see RenderPhosphor()
  * @see ComposeFrame()
  */
 static void DarkenField( picture_t *p_dst,
                          const int i_field, const int i_strength,
-                         bool process_chroma )
+                         bool process_chroma, unsigned index, unsigned count )
 {
     assert( p_dst != NULL );
     assert( i_field == 0 || i_field == 1 );
@@ -93,13 +117,8 @@ static void DarkenField( picture_t *p_dst,
     int i_plane = Y_PLANE;
     uint8_t *p_out, *p_out_end;
     int w = p_dst->p[i_plane].i_visible_pitch;
-    p_out = p_dst->p[i_plane].p_pixels;
-    p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                      * p_dst->p[i_plane].i_visible_lines;
-
-    /* skip first line for bottom field */
-    if( i_field == 1 )
-        p_out += p_dst->p[i_plane].i_pitch;
+    SliceField( &p_dst->p[i_plane], i_field, index, count,
+                &p_out, &p_out_end );
 
     int wm8 = w % 8;   /* remainder */
     int w8  = w - wm8; /* part of width that is divisible by 8 */
@@ -130,13 +149,8 @@ static void DarkenField( picture_t *p_dst,
              i_plane++ )
         {
             int w = p_dst->p[i_plane].i_visible_pitch;
-            p_out = p_dst->p[i_plane].p_pixels;
-            p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                              * p_dst->p[i_plane].i_visible_lines;
-
-            /* skip first line for bottom field */
-            if( i_field == 1 )
-                p_out += p_dst->p[i_plane].i_pitch;
+            SliceField( &p_dst->p[i_plane], i_field, index, count,
+                        &p_out, &p_out_end );
 
             for( ; p_out < p_out_end ; p_out += 2*p_dst->p[i_plane].i_pitch )
             {
@@ -153,7 +167,8 @@ static void DarkenField( picture_t *p_dst,
 VLC_MMX
 static void DarkenFieldMMX( picture_t *p_dst,
                             const int i_field, const int i_strength,
-                            bool process_chroma )
+                            bool process_chroma,
+                            unsigned index, unsigned count )
 {
     assert( p_dst != NULL );
     assert( i_field == 0 || i_field == 1 );
@@ -167,13 +182,8 @@ static void DarkenFieldMMX( picture_t *p_dst,
     int i_plane = Y_PLANE;
     uint8_t *p_out, *p_out_end;
     int w = p_dst->p[i_plane].i_visible_pitch;
-    p_out = p_dst->p[i_plane].p_pixels;
-    p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                      * p_dst->p[i_plane].i_visible_lines;
-
-    /* skip first line for bottom field */
-    if( i_field == 1 )
-        p_out += p_dst->p[i_plane].i_pitch;
+    SliceField( &p_dst->p[i_plane], i_field, index, count,
+                &p_out, &p_out_end );
 
     int wm8 = w % 8;   /* remainder */
     int w8  = w - wm8; /* part of width that is divisible by 8 */
@@ -216,13 +226,8 @@ static void DarkenFieldMMX( picture_t *p_dst,
             int wm8 = w % 8;   /* remainder */
             int w8  = w - wm8; /* part of width that is divisible by 8 */
 
-            p_out = p_dst->p[i_plane].p_pixels;
-            p_out_end = p_out + p_dst->p[i_plane].i_pitch
-                              * p_dst->p[i_plane].i_visible_lines;
-
-            /* skip first line for bottom field */
-            if( i_field == 1 )
-                p_out += p_dst->p[i_plane].i_pitch;
+            SliceField( &p_dst->p[i_plane], i_field, index, count,
+                        &p_out, &p_out_end );
 
             for( ; p_out < p_out_end ; p_out += 2*p_dst->p[i_plane].i_pitch )
             {
@@ -272,6 +277,28 @@ static void DarkenFieldMMX( picture_t *p_dst,
 }
 #endif
 
+struct darken_job
+{
+    picture_t *p_dst;
+    int i_field;
+    int i_strength;
+    bool process_chroma;
+};
+
+static void DarkenSlice( void *opaque, unsigned index, unsigned count )
+{
+    const struct darken_job *job = opaque;
+
+#ifdef CAN_COMPILE_MMXEXT
+    if( vlc_CPU_MMXEXT() )
+        DarkenFieldMMX( job->p_dst, job->i_field, job->i_strength,
+                        job->process_chroma, index, count );
+    else
+#endif
+        DarkenField( job->p_dst, job->i_field, job->i_strength,
+                     job->process_chroma, index, count );
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -358,16 +385,17 @@ int RenderPhosphor( filter_t *p_filter,
     */
     if( p_sys->phosphor.i_dimmer_strength > 0 )
     {
-#ifdef CAN_COMPILE_MMXEXT
-        if( vlc_CPU_MMXEXT() )
-            DarkenFieldMMX( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
+        struct darken_job job = {
+            .p_dst = p_dst,
+            .i_field = !i_field,
+            .i_strength = p_sys->phosphor.i_dimmer_strength,
+            .process_chroma =
                 p_sys->chroma->p[1].h.num == p_sys->chroma->p[1].h.den &&
-                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den );
-        else
-#endif
-            DarkenField( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
-                p_sys->chroma->p[1].h.num == p_sys->chroma->p[1].h.den &&
-                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den );
+                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den,
+        };
+
+        vlc_slices_Run( p_sys->slices, vlc_slices_Count( p_sys->slices ),
+                        DarkenSlice, &job );
     }
     return VLC_SUCCESS;
 }
@@ -512,32 +512,44 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+struct x_job
+{
+    picture_t *p_outpic;
+    const picture_t *p_pic;
+};
+
+/* Renders one range of 8-line bands in every plane */
+static void XSlice( void *opaque, unsigned index, unsigned count )
 {
-    VLC_UNUSED(p_filter);
-    int i_plane;
+    const struct x_job *job = opaque;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
 #endif
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < job->p_pic->i_planes ; i_plane++ )
     {
-        const int i_mby = ( p_outpic->p[i_plane].i_visible_lines + 7 )/8 - 1;
-        const int i_mbx = p_outpic->p[i_plane].i_visible_pitch/8;
+        const plane_t *out = &job->p_outpic->p[i_plane];
+        const plane_t *in = &job->p_pic->p[i_plane];
 
-        const int i_mody = p_outpic->p[i_plane].i_visible_lines - 8*i_mby;
-        const int i_modx = p_outpic->p[i_plane].i_visible_pitch - 8*i_mbx;
+        const int i_mby = ( out->i_visible_lines + 7 )/8 - 1;
+        const int i_mbx = out->i_visible_pitch/8;
 
-        const int i_dst = p_outpic->p[i_plane].i_pitch;
-        const int i_src = p_pic->p[i_plane].i_pitch;
+        const int i_mody = out->i_visible_lines - 8*i_mby;
+        const int i_modx = out->i_visible_pitch - 8*i_mbx;
 
+        const int i_dst = out->i_pitch;
+        const int i_src = in->i_pitch;
+
+        unsigned start, end;
         int y, x;
 
-        for( y = 0; y < i_mby; y++ )
+        /* The last, partial, band is the one at i_mby */
+        vlc_slices_Rows( index, count, i_mby + 1, 1, &start, &end );
+
+        for( y = start; y < __MIN( (int)end, i_mby ); y++ )
         {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+            uint8_t *dst = &out->p_pixels[8*y*i_dst];
+            uint8_t *src = &in->p_pixels[8*y*i_src];
 
 #ifdef CAN_COMPILE_MMXEXT
             if( mmxext )
@@ -548,10 +560,10 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         }
 
         /* Last line (C only)*/
-        if( i_mody )
+        if( i_mody && (int)end == i_mby + 1 && (int)start <= i_mby )
         {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+            uint8_t *dst = &out->p_pixels[8*i_mby*i_dst];
+            uint8_t *src = &in->p_pixels[8*i_mby*i_src];
 
             for( x = 0; x < i_mbx; x++ )
             {
@@ -570,5 +582,17 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
     if( mmxext )
         emms();
 #endif
+}
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct x_job job = {
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+    };
+
+    vlc_slices_Run( p_sys->slices, vlc_slices_Count( p_sys->slices ),
+                    XSlice, &job );
     return VLC_SUCCESS;
 }
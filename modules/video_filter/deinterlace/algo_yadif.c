@@ -33,6 +33,7 @@
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
 #include <vlc_filter.h>
+#include <vlc_slices.h>
 
 #include "deinterlace.h" /* filter_sys_t  */
 #include "common.h"      /* FFMIN3 et al. */
@@ -46,6 +47,122 @@
 /* yadif.h comes from yadif.c of FFmpeg project.
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
+#include "yadif_simd.h"
+
+typedef void (*yadif_line_t)( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                              uint8_t *next, int w, int prefs, int mrefs,
+                              int parity, int mode );
+
+static yadif_line_t GetLineFilter( unsigned pixel_size )
+{
+    if( pixel_size == 2 )
+    {
+#if defined(HAVE_YADIF_AVX2)
+        if( vlc_CPU_AVX2() )
+            return yadif_filter_line_16bit_avx2;
+#endif
+#if defined(HAVE_YADIF_SSE4_1)
+        if( vlc_CPU_SSE4_1() )
+            return yadif_filter_line_16bit_sse4;
+#endif
+#if defined(HAVE_YADIF_NEON)
+        return yadif_filter_line_16bit_neon;
+#endif
+        return yadif_filter_line_c_16bit;
+    }
+
+#if defined(HAVE_YADIF_AVX2)
+    if( vlc_CPU_AVX2() )
+        return yadif_filter_line_avx2;
+#endif
+#if defined(HAVE_YADIF_SSSE3)
+    if( vlc_CPU_SSSE3() )
+        return yadif_filter_line_ssse3;
+#endif
+#if defined(HAVE_YADIF_SSE2)
+    if( vlc_CPU_SSE2() )
+        return yadif_filter_line_sse2;
+#endif
+#if defined(HAVE_YADIF_MMX)
+    if( vlc_CPU_MMX() )
+        return yadif_filter_line_mmx;
+#endif
+#if defined(HAVE_YADIF_NEON)
+    return yadif_filter_line_neon;
+#endif
+    return yadif_filter_line_c;
+}
+
+struct yadif_job
+{
+    yadif_line_t filter;
+    unsigned pixel_size;
+    picture_t *p_dst;
+    const picture_t *p_prev, *p_cur, *p_next;
+    int i_field;
+    int yadif_parity;
+};
+
+/* Filters one band of rows in every plane */
+static void YadifSlice( void *opaque, unsigned index, unsigned count )
+{
+    const struct yadif_job *job = opaque;
+
+    for( int n = 0; n < job->p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &job->p_prev->p[n];
+        const plane_t *curp  = &job->p_cur->p[n];
+        const plane_t *nextp = &job->p_next->p[n];
+        plane_t *dstp        = &job->p_dst->p[n];
+        unsigned start, end;
+
+        vlc_slices_Rows( index, count, dstp->i_visible_lines, 2,
+                         &start, &end );
+
+        for( int y = __MAX( start, 1u );
+             y < __MIN( (int)end, dstp->i_visible_lines - 1 ); y++ )
+        {
+            if( (y % 2) == job->i_field  ||  job->yadif_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                job->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                             &prevp->p_pixels[y * prevp->i_pitch],
+                             &curp->p_pixels[y * curp->i_pitch],
+                             &nextp->p_pixels[y * nextp->i_pitch],
+                             dstp->i_visible_pitch / job->pixel_size,
+                             y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                             y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                             job->yadif_parity,
+                             mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+
+#if defined(HAVE_YADIF_MMX)
+    /* the MMX line filter leaves the FPU in MMX state, on this thread */
+    if( job->filter == yadif_filter_line_mmx )
+        __asm__ __volatile__ ("emms");
+#endif
+}
 
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
@@ -109,73 +226,19 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        struct yadif_job job = {
+            .filter = GetLineFilter( p_sys->chroma->pixel_size ),
+            .pixel_size = p_sys->chroma->pixel_size,
+            .p_dst = p_dst,
+            .p_prev = p_prev,
+            .p_cur = p_cur,
+            .p_next = p_next,
+            .i_field = i_field,
+            .yadif_parity = yadif_parity,
+        };
 
-#if defined(HAVE_YADIF_SSSE3)
-        if( vlc_CPU_SSSE3() )
-            filter = yadif_filter_line_ssse3;
-        else
-#endif
-#if defined(HAVE_YADIF_SSE2)
-        if( vlc_CPU_SSE2() )
-            filter = yadif_filter_line_sse2;
-        else
-#endif
-#if defined(HAVE_YADIF_MMX)
-        if( vlc_CPU_MMX() )
-            filter = yadif_filter_line_mmx;
-        else
-#endif
-            filter = yadif_filter_line_c;
-
-        if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
-
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        vlc_slices_Run( p_sys->slices, vlc_slices_Count( p_sys->slices ),
+                        YadifSlice, &job );
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
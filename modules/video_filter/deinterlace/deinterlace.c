@@ -93,6 +93,10 @@
                                     "in the Phosphor framerate doubler. "\
                                     "Default: Low.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads sharing the rows of each "\
+                            "picture (0 = one per CPU, 1 = no threading).")
+
 vlc_module_begin ()
     set_description( N_("Deinterlacing video filter") )
     set_shortname( N_("Deinterlace" ))
@@ -112,6 +116,8 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "threads", 0, 0, 16,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -127,7 +133,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -325,6 +331,11 @@ notsupp:
     char *psz_mode = var_InheritString( p_filter, FILTER_CFG_PREFIX "mode" );
     SetFilterMethod( p_filter, psz_mode, packed );
 
+    /* The rows of each picture are shared by the threads of this pool;
+     * NULL means everything runs on the calling thread. */
+    p_sys->slices = vlc_slices_New( var_GetInteger( p_filter,
+                                        FILTER_CFG_PREFIX "threads" ) );
+
     IVTCClearState( p_filter );
 
 #if defined(CAN_COMPILE_C_ALTIVEC)
@@ -448,5 +459,6 @@ void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
 
     Flush( p_filter );
+    vlc_slices_Delete( p_filter->p_sys->slices );
     free( p_filter->p_sys );
 }
@@ -25,11 +25,6 @@
 #   include "config.h"
 #endif
 
-#ifdef CAN_COMPILE_MMXEXT
-#   include "mmx.h"
-#   include <stdalign.h>
-#endif
-
 #include <stdint.h>
 #include <assert.h>
 
@@ -37,10 +32,12 @@
 #include <vlc_cpu.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_atomic.h>
 
 #include "deinterlace.h" /* definition of p_sys, needed for Merge() */
 #include "common.h"      /* FFMIN3 et al. */
 #include "merge.h"
+#include "metrics_simd.h"
 
 #include "helpers.h"
 
@@ -95,158 +92,109 @@ static void FieldFromPlane( plane_t *p_dst, const plane_t *p_src, int i_field )
         p_dst->p_pixels += p_src->i_pitch;
 }
 
-#define T 10
 /**
- * Internal helper function for EstimateNumBlocksWithMotion():
- * estimates whether there is motion in the given 8x8 block on one plane
- * between two images. The block as a whole and its fields are evaluated
- * separately, and use different motion thresholds.
- *
- * This is a low-level function only used by EstimateNumBlocksWithMotion().
- * There is no need to call this function manually.
- *
- * For interpretation of pi_top and pi_bot, it is assumed that the block
- * starts on an even-numbered line (belonging to the top field).
- *
- * The b_mmx parameter avoids the need to call vlc_CPU() separately
- * for each block.
- *
- * @param[in] p_pix_p Base pointer to the block in previous picture
- * @param[in] p_pix_c Base pointer to the same block in current picture
- * @param i_pitch_prev i_pitch of previous picture
- * @param i_pitch_curr i_pitch of current picture
- * @param[out] pi_top 1 if top field of the block had motion, 0 if no
- * @param[out] pi_bot 1 if bottom field of the block had motion, 0 if no
- * @return 1 if the block had motion, 0 if no
- * @see EstimateNumBlocksWithMotion()
+ * Internal helper for the metrics: checks that both pictures have the same
+ * number of planes, and the same number of lines in each plane.
  */
-static int TestForMotionInBlock( uint8_t *p_pix_p, uint8_t *p_pix_c,
-                                 int i_pitch_prev, int i_pitch_curr,
-                                 int* pi_top, int* pi_bot )
+static bool MetricsPlanesMatch( const picture_t *p_a, const picture_t *p_b )
 {
-/* Pixel luma/chroma difference threshold to detect motion. */
+    if( p_a->i_planes != p_b->i_planes )
+        return false;
+    for( int i_plane = 0 ; i_plane < p_a->i_planes ; i_plane++ )
+        if( p_a->p[i_plane].i_visible_lines !=
+            p_b->p[i_plane].i_visible_lines )
+            return false;
+    return true;
+}
 
-    int32_t i_motion = 0;
-    int32_t i_top_motion = 0;
-    int32_t i_bot_motion = 0;
+struct motion_job
+{
+    const picture_t *p_prev;
+    const picture_t *p_curr;
+    deint_motion_blocks_t motion_blocks;
+    atomic_uint counts[3];
+};
 
-    for( int y = 0; y < 8; ++y )
+/**
+ * Internal helper function for EstimateNumBlocksWithMotion():
+ * tests one band of rows of 8x8 blocks in every plane.
+ */
+static void MotionSlice( void *opaque, unsigned index, unsigned count )
+{
+    struct motion_job *job = opaque;
+    unsigned counts[3] = { 0, 0, 0 };
+
+    for( int i_plane = 0 ; i_plane < job->p_prev->i_planes ; i_plane++ )
     {
-        uint8_t *pc = p_pix_c;
-        uint8_t *pp = p_pix_p;
-        int score = 0;
-        for( int x = 0; x < 8; ++x )
-        {
-            int_fast16_t C = abs((*pc) - (*pp));
-            if( C > T )
-                ++score;
+        const plane_t *prev = &job->p_prev->p[i_plane];
+        const plane_t *curr = &job->p_curr->p[i_plane];
 
-            ++pc;
-            ++pp;
-        }
+        /* Last pixels and lines (which do not make whole blocks) are ignored.
+           Shouldn't really matter for our purposes. */
+        const int i_mby = prev->i_visible_lines / 8;
+        const int w = FFMIN( prev->i_visible_pitch, curr->i_visible_pitch );
+        unsigned start, end;
 
-        i_motion += score;
-        if( y % 2 == 0 )
-            i_top_motion += score;
-        else
-            i_bot_motion += score;
+        vlc_slices_Rows( index, count, i_mby, 1, &start, &end );
 
-        p_pix_c += i_pitch_curr;
-        p_pix_p += i_pitch_prev;
+        for( unsigned by = start; by < end; ++by )
+            job->motion_blocks( &prev->p_pixels[prev->i_pitch*8*by],
+                                prev->i_pitch,
+                                &curr->p_pixels[curr->i_pitch*8*by],
+                                curr->i_pitch, w / 8, counts );
     }
 
-    /* Field motion thresholds.
-
-       Empirical value - works better in practice than the "4" that
-       would be consistent with the full-block threshold.
-
-       Especially the opening scene of The Third ep. 1 (just after the OP)
-       works better with this. It also fixes some talking scenes in
-       Stellvia ep. 1, where the cadence would otherwise catch on incorrectly,
-       leading to more interlacing artifacts than by just using the emergency
-       mode frame composer.
-    */
-    (*pi_top) = ( i_top_motion >= 8 );
-    (*pi_bot) = ( i_bot_motion >= 8 );
-
-    /* Full-block threshold = (8*8)/8: motion is detected if 1/8 of the block
-       changes "enough". */
-    return (i_motion >= 8);
+    for( int i = 0; i < 3; i++ )
+        atomic_fetch_add( &job->counts[i], counts[i] );
 }
 
-#ifdef CAN_COMPILE_MMXEXT
-VLC_MMX
-static int TestForMotionInBlockMMX( uint8_t *p_pix_p, uint8_t *p_pix_c,
-                                    int i_pitch_prev, int i_pitch_curr,
-                                    int* pi_top, int* pi_bot )
+struct comb_job
 {
-    int32_t i_motion = 0;
-    int32_t i_top_motion = 0;
-    int32_t i_bot_motion = 0;
+    const picture_t *p_pic_top;
+    const picture_t *p_pic_bot;
+    deint_comb_line_t comb_line;
+    atomic_uint score;
+};
 
-    static alignas (8) const mmx_t bT   = { .ub = { T, T, T, T, T, T, T, T } };
-    pxor_r2r( mm6, mm6 ); /* zero, used in psadbw */
-    movq_m2r( bT,  mm5 );
+/**
+ * Internal helper function for CalculateInterlaceScore():
+ * scores one band of lines in every plane.
+ */
+static void CombSlice( void *opaque, unsigned index, unsigned count )
+{
+    struct comb_job *job = opaque;
+    unsigned i_score = 0;
 
-    pxor_r2r( mm3, mm3 ); /* score (top field) */
-    pxor_r2r( mm4, mm4 ); /* score (bottom field) */
-    for( int y = 0; y < 8; y+=2 )
+    for( int i_plane = 0 ; i_plane < job->p_pic_top->i_planes ; ++i_plane )
     {
-        /* top field */
-        movq_m2r( *((uint64_t*)p_pix_c), mm0 );
-        movq_m2r( *((uint64_t*)p_pix_p), mm1 );
-        movq_r2r( mm0, mm2 );
-        psubusb_r2r( mm1, mm2 );
-        psubusb_r2r( mm0, mm1 );
-
-        pcmpgtb_r2r( mm5, mm2 );
-        pcmpgtb_r2r( mm5, mm1 );
-        psadbw_r2r(  mm6, mm2 );
-        psadbw_r2r(  mm6, mm1 );
-
-        paddd_r2r( mm2, mm1 );
-        paddd_r2r( mm1, mm3 ); /* add to top field score */
-
-        p_pix_c += i_pitch_curr;
-        p_pix_p += i_pitch_prev;
-
-        /* bottom field - handling identical to top field, except... */
-        movq_m2r( *((uint64_t*)p_pix_c), mm0 );
-        movq_m2r( *((uint64_t*)p_pix_p), mm1 );
-        movq_r2r( mm0, mm2 );
-        psubusb_r2r( mm1, mm2 );
-        psubusb_r2r( mm0, mm1 );
-
-        pcmpgtb_r2r( mm5, mm2 );
-        pcmpgtb_r2r( mm5, mm1 );
-        psadbw_r2r(  mm6, mm2 );
-        psadbw_r2r(  mm6, mm1 );
-
-        paddd_r2r( mm2, mm1 );
-        paddd_r2r( mm1, mm4 ); /* ...here we add to bottom field score */
-
-        p_pix_c += i_pitch_curr;
-        p_pix_p += i_pitch_prev;
+        const plane_t *top = &job->p_pic_top->p[i_plane];
+        const plane_t *bot = &job->p_pic_bot->p[i_plane];
+        const int w = FFMIN( top->i_visible_pitch, bot->i_visible_pitch );
+        unsigned start, end;
+
+        vlc_slices_Rows( index, count, top->i_visible_lines, 1, &start, &end );
+
+        /* Transcode 1.1.5 only checks every other line. Checking every line
+           works better for anime, which may contain horizontal,
+           one pixel thick cartoon outlines.
+        */
+        for( int y = __MAX( start, 1u );
+             y < __MIN( (int)end, top->i_visible_lines - 1 ); ++y )
+        {
+            /* Current line from one field, neighbouring lines from the
+               other one */
+            const plane_t *cur = (y % 2) ? bot : top;
+            const plane_t *ngh = (y % 2) ? top : bot;
+
+            i_score += job->comb_line( &cur->p_pixels[y*cur->i_pitch],
+                                       &ngh->p_pixels[(y-1)*ngh->i_pitch],
+                                       &ngh->p_pixels[(y+1)*ngh->i_pitch],
+                                       w );
+        }
     }
-    movq_r2r(  mm3, mm7 ); /* score (total) */
-    paddd_r2r( mm4, mm7 );
-    movd_r2m( mm3, i_top_motion );
-    movd_r2m( mm4, i_bot_motion );
-    movd_r2m( mm7, i_motion );
-
-    /* The loop counts actual score * 255. */
-    i_top_motion /= 255;
-    i_bot_motion /= 255;
-    i_motion     /= 255;
-
-    emms();
-
-    (*pi_top) = ( i_top_motion >= 8 );
-    (*pi_bot) = ( i_bot_motion >= 8 );
-    return (i_motion >= 8);
+
+    atomic_fetch_add( &job->score, i_score );
 }
-#endif
-#undef T
 
 /*****************************************************************************
  * Public functions
@@ -382,213 +330,38 @@ void ComposeFrame( filter_t *p_filter,
 /* See header for function doc. */
 int EstimateNumBlocksWithMotion( const picture_t* p_prev,
                                  const picture_t* p_curr,
-                                 int *pi_top, int *pi_bot)
+                                 int *pi_top, int *pi_bot,
+                                 vlc_slices_t *slices )
 {
     assert( p_prev != NULL );
     assert( p_curr != NULL );
 
-    int i_score_top = 0;
-    int i_score_bot = 0;
-
-    if( p_prev->i_planes != p_curr->i_planes )
+    /* Sanity check */
+    if( !MetricsPlanesMatch( p_prev, p_curr ) )
         return -1;
 
-    int (*motion_in_block)(uint8_t *, uint8_t *, int , int, int *, int *) =
-        TestForMotionInBlock;
-    /* We must tell our inline helper whether to use MMX acceleration. */
-#ifdef CAN_COMPILE_MMXEXT
-    if (vlc_CPU_MMXEXT())
-        motion_in_block = TestForMotionInBlockMMX;
-#endif
+    struct motion_job job = {
+        .p_prev = p_prev,
+        .p_curr = p_curr,
+        .motion_blocks = deint_GetMotionBlocks(),
+    };
+    for( int i = 0; i < 3; i++ )
+        atomic_init( &job.counts[i], 0 );
 
-    int i_score = 0;
-    for( int i_plane = 0 ; i_plane < p_prev->i_planes ; i_plane++ )
-    {
-        /* Sanity check */
-        if( p_prev->p[i_plane].i_visible_lines !=
-            p_curr->p[i_plane].i_visible_lines )
-            return -1;
-
-        const int i_pitch_prev = p_prev->p[i_plane].i_pitch;
-        const int i_pitch_curr = p_curr->p[i_plane].i_pitch;
-
-        /* Last pixels and lines (which do not make whole blocks) are ignored.
-           Shouldn't really matter for our purposes. */
-        const int i_mby = p_prev->p[i_plane].i_visible_lines / 8;
-        const int w = FFMIN( p_prev->p[i_plane].i_visible_pitch,
-                             p_curr->p[i_plane].i_visible_pitch );
-        const int i_mbx = w / 8;
-
-        for( int by = 0; by < i_mby; ++by )
-        {
-            uint8_t *p_pix_p = &p_prev->p[i_plane].p_pixels[i_pitch_prev*8*by];
-            uint8_t *p_pix_c = &p_curr->p[i_plane].p_pixels[i_pitch_curr*8*by];
-
-            for( int bx = 0; bx < i_mbx; ++bx )
-            {
-                int i_top_temp, i_bot_temp;
-                i_score += motion_in_block( p_pix_p, p_pix_c,
-                                            i_pitch_prev, i_pitch_curr,
-                                            &i_top_temp, &i_bot_temp );
-                i_score_top += i_top_temp;
-                i_score_bot += i_bot_temp;
-
-                p_pix_p += 8;
-                p_pix_c += 8;
-            }
-        }
-    }
+    vlc_slices_Run( slices, vlc_slices_Count( slices ), MotionSlice, &job );
 
     if( pi_top )
-        (*pi_top) = i_score_top;
+        (*pi_top) = atomic_load( &job.counts[1] );
     if( pi_bot )
-        (*pi_bot) = i_score_bot;
+        (*pi_bot) = atomic_load( &job.counts[2] );
 
-    return i_score;
+    return atomic_load( &job.counts[0] );
 }
 
-/* Threshold (value from Transcode 1.1.5) */
-#define T 100
-
-#ifdef CAN_COMPILE_MMXEXT
-VLC_MMX
-static int CalculateInterlaceScoreMMX( const picture_t* p_pic_top,
-                                       const picture_t* p_pic_bot )
-{
-    assert( p_pic_top->i_planes == p_pic_bot->i_planes );
-
-    /* Amount of bits must be known for MMX, thus int32_t.
-       Doesn't hurt the C implementation. */
-    int32_t i_score_mmx = 0; /* this must be divided by 255 when finished  */
-    int32_t i_score_c   = 0; /* this counts as-is (used for non-MMX parts) */
-
-    pxor_r2r( mm7, mm7 ); /* we will keep score in mm7 */
-
-    for( int i_plane = 0 ; i_plane < p_pic_top->i_planes ; ++i_plane )
-    {
-        /* Sanity check */
-        if( p_pic_top->p[i_plane].i_visible_lines !=
-            p_pic_bot->p[i_plane].i_visible_lines )
-            return -1;
-
-        const int i_lasty = p_pic_top->p[i_plane].i_visible_lines-1;
-        const int w = FFMIN( p_pic_top->p[i_plane].i_visible_pitch,
-                             p_pic_bot->p[i_plane].i_visible_pitch );
-        const int wm8 = w % 8;   /* remainder */
-        const int w8  = w - wm8; /* part of width that is divisible by 8 */
-
-        /* Current line / neighbouring lines picture pointers */
-        const picture_t *cur = p_pic_bot;
-        const picture_t *ngh = p_pic_top;
-        int wc = cur->p[i_plane].i_pitch;
-        int wn = ngh->p[i_plane].i_pitch;
-
-        /* Transcode 1.1.5 only checks every other line. Checking every line
-           works better for anime, which may contain horizontal,
-           one pixel thick cartoon outlines.
-        */
-        for( int y = 1; y < i_lasty; ++y )
-        {
-            uint8_t *p_c = &cur->p[i_plane].p_pixels[y*wc];     /* this line */
-            uint8_t *p_p = &ngh->p[i_plane].p_pixels[(y-1)*wn]; /* prev line */
-            uint8_t *p_n = &ngh->p[i_plane].p_pixels[(y+1)*wn]; /* next line */
-
-            int x = 0;
-
-            /* Easy-to-read C version further below.
-
-               Assumptions: 0 < T < 127
-                            # of pixels < (2^32)/255
-               Note: calculates score * 255
-            */
-            static alignas (8) const mmx_t b0 = {
-                .uq = 0x0000000000000000ULL };
-            static alignas (8) const mmx_t b128 = {
-                .uq = 0x8080808080808080ULL };
-            static alignas (8) const mmx_t bT = {
-                .ub = { T, T, T, T, T, T, T, T } };
-
-            for( ; x < w8; x += 8 )
-            {
-                movq_m2r( *((int64_t*)p_c), mm0 );
-                movq_m2r( *((int64_t*)p_p), mm1 );
-                movq_m2r( *((int64_t*)p_n), mm2 );
-
-                psubb_m2r( b128, mm0 );
-                psubb_m2r( b128, mm1 );
-                psubb_m2r( b128, mm2 );
-
-                psubsb_r2r( mm0, mm1 );
-                psubsb_r2r( mm0, mm2 );
-
-                pxor_r2r( mm3, mm3 );
-                pxor_r2r( mm4, mm4 );
-                pxor_r2r( mm5, mm5 );
-                pxor_r2r( mm6, mm6 );
-
-                punpcklbw_r2r( mm1, mm3 );
-                punpcklbw_r2r( mm2, mm4 );
-                punpckhbw_r2r( mm1, mm5 );
-                punpckhbw_r2r( mm2, mm6 );
-
-                pmulhw_r2r( mm3, mm4 );
-                pmulhw_r2r( mm5, mm6 );
-
-                packsswb_r2r(mm4, mm6);
-                pcmpgtb_m2r( bT, mm6 );
-                psadbw_m2r( b0, mm6 );
-                paddd_r2r( mm6, mm7 );
-
-                p_c += 8;
-                p_p += 8;
-                p_n += 8;
-            }
-
-            for( ; x < w; ++x )
-            {
-                /* Worst case: need 17 bits for "comb". */
-                int_fast32_t C = *p_c;
-                int_fast32_t P = *p_p;
-                int_fast32_t N = *p_n;
-
-                /* Comments in Transcode's filter_ivtc.c attribute this
-                   combing metric to Gunnar Thalin.
-
-                    The idea is that if the picture is interlaced, both
-                    expressions will have the same sign, and this comes
-                    up positive. The value T = 100 has been chosen such
-                    that a pixel difference of 10 (on average) will
-                    trigger the detector.
-                */
-                int_fast32_t comb = (P - C) * (N - C);
-                if( comb > T )
-                    ++i_score_c;
-
-                ++p_c;
-                ++p_p;
-                ++p_n;
-            }
-
-            /* Now the other field - swap current and neighbour pictures */
-            const picture_t *tmp = cur;
-            cur = ngh;
-            ngh = tmp;
-            int tmp_pitch = wc;
-            wc = wn;
-            wn = tmp_pitch;
-        }
-    }
-
-    movd_r2m( mm7, i_score_mmx );
-    emms();
-
-    return i_score_mmx/255 + i_score_c;
-}
-#endif
-
 /* See header for function doc. */
 int CalculateInterlaceScore( const picture_t* p_pic_top,
-                             const picture_t* p_pic_bot )
+                             const picture_t* p_pic_bot,
+                             vlc_slices_t *slices )
 {
     /*
         We use the comb metric from the IVTC filter of Transcode 1.1.5.
@@ -603,78 +376,18 @@ int CalculateInterlaceScore( const picture_t* p_pic_top,
     assert( p_pic_top != NULL );
     assert( p_pic_bot != NULL );
 
-    if( p_pic_top->i_planes != p_pic_bot->i_planes )
+    /* Sanity check */
+    if( !MetricsPlanesMatch( p_pic_top, p_pic_bot ) )
         return -1;
 
-#ifdef CAN_COMPILE_MMXEXT
-    if (vlc_CPU_MMXEXT())
-        return CalculateInterlaceScoreMMX( p_pic_top, p_pic_bot );
-#endif
+    struct comb_job job = {
+        .p_pic_top = p_pic_top,
+        .p_pic_bot = p_pic_bot,
+        .comb_line = deint_GetCombLine(),
+    };
+    atomic_init( &job.score, 0 );
 
-    int32_t i_score = 0;
-
-    for( int i_plane = 0 ; i_plane < p_pic_top->i_planes ; ++i_plane )
-    {
-        /* Sanity check */
-        if( p_pic_top->p[i_plane].i_visible_lines !=
-            p_pic_bot->p[i_plane].i_visible_lines )
-            return -1;
-
-        const int i_lasty = p_pic_top->p[i_plane].i_visible_lines-1;
-        const int w = FFMIN( p_pic_top->p[i_plane].i_visible_pitch,
-                             p_pic_bot->p[i_plane].i_visible_pitch );
-
-        /* Current line / neighbouring lines picture pointers */
-        const picture_t *cur = p_pic_bot;
-        const picture_t *ngh = p_pic_top;
-        int wc = cur->p[i_plane].i_pitch;
-        int wn = ngh->p[i_plane].i_pitch;
-
-        /* Transcode 1.1.5 only checks every other line. Checking every line
-           works better for anime, which may contain horizontal,
-           one pixel thick cartoon outlines.
-        */
-        for( int y = 1; y < i_lasty; ++y )
-        {
-            uint8_t *p_c = &cur->p[i_plane].p_pixels[y*wc];     /* this line */
-            uint8_t *p_p = &ngh->p[i_plane].p_pixels[(y-1)*wn]; /* prev line */
-            uint8_t *p_n = &ngh->p[i_plane].p_pixels[(y+1)*wn]; /* next line */
-
-            for( int x = 0; x < w; ++x )
-            {
-                /* Worst case: need 17 bits for "comb". */
-                int_fast32_t C = *p_c;
-                int_fast32_t P = *p_p;
-                int_fast32_t N = *p_n;
-
-                /* Comments in Transcode's filter_ivtc.c attribute this
-                   combing metric to Gunnar Thalin.
-
-                    The idea is that if the picture is interlaced, both
-                    expressions will have the same sign, and this comes
-                    up positive. The value T = 100 has been chosen such
-                    that a pixel difference of 10 (on average) will
-                    trigger the detector.
-                */
-                int_fast32_t comb = (P - C) * (N - C);
-                if( comb > T )
-                    ++i_score;
-
-                ++p_c;
-                ++p_p;
-                ++p_n;
-            }
-
-            /* Now the other field - swap current and neighbour pictures */
-            const picture_t *tmp = cur;
-            cur = ngh;
-            ngh = tmp;
-            int tmp_pitch = wc;
-            wc = wn;
-            wn = tmp_pitch;
-        }
-    }
+    vlc_slices_Run( slices, vlc_slices_Count( slices ), CombSlice, &job );
 
-    return i_score;
+    return atomic_load( &job.score );
 }
-#undef T
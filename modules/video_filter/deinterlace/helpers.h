@@ -125,14 +125,16 @@ void ComposeFrame( filter_t *p_filter,
  * @param[in] p_curr Current picture
  * @param[out] pi_top Number of 8x8 blocks where top field has motion.
  * @param[out] pi_bot Number of 8x8 blocks where bottom field has motion.
+ * @param slices Threads sharing the rows of blocks, or NULL.
  * @return Number of 8x8 blocks that have motion.
  * @retval -1 Error: incompatible input pictures.
- * @see TestForMotionInBlock()
+ * @see deint_motion_blocks_c()
  * @see RenderIVTC()
  */
 int EstimateNumBlocksWithMotion( const picture_t* p_prev,
                                  const picture_t* p_curr,
-                                 int *pi_top, int *pi_bot);
+                                 int *pi_top, int *pi_bot,
+                                 vlc_slices_t *slices );
 
 /**
  * Helper function: estimates "how much interlaced" the given field pair is.
@@ -158,12 +160,14 @@ int EstimateNumBlocksWithMotion( const picture_t* p_prev,
  *
  * @param p_pic_top Picture to take the top field from.
  * @param p_pic_bot Picture to take the bottom field from (same or different).
+ * @param slices Threads sharing the lines, or NULL.
  * @return Interlace score, >= 0. Higher values mean more interlaced.
  * @retval -1 Error: incompatible input pictures.
  * @see RenderIVTC()
  * @see ComposeFrame()
  */
 int CalculateInterlaceScore( const picture_t* p_pic_top,
-                             const picture_t* p_pic_bot );
+                             const picture_t* p_pic_bot,
+                             vlc_slices_t *slices );
 
 #endif
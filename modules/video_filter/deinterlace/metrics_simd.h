@@ -0,0 +1,331 @@
+/*****************************************************************************
+ * metrics_simd.h : comb and motion metrics kernels for the IVTC detectors
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEINTERLACE_METRICS_SIMD_H
+#define VLC_DEINTERLACE_METRICS_SIMD_H
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include <vlc_cpu.h>
+
+/*
+ * The IVTC detectors count pixels, so the vector kernels return exactly the
+ * same values as the scalar ones: the cadence decisions do not depend on the
+ * instruction set.
+ *
+ * The comb kernel counts the pixels of one line (C) whose differences to the
+ * lines above (P) and below (N) satisfy (P - C) * (N - C) > 100. The motion
+ * kernel tests a row of 8x8 blocks, and counts the blocks where at least 8
+ * pixels, 8 pixels of the top field or 8 pixels of the bottom field changed
+ * by more than 10.
+ */
+
+#define DEINT_COMB_T   100
+#define DEINT_MOTION_T 10
+
+typedef unsigned (*deint_comb_line_t)(const uint8_t *c, const uint8_t *p,
+                                      const uint8_t *n, int w);
+typedef void (*deint_motion_blocks_t)(const uint8_t *prev, int prev_pitch,
+                                      const uint8_t *curr, int curr_pitch,
+                                      int blocks, unsigned counts[3]);
+
+/*** Scalar ***/
+static inline unsigned deint_comb_line_c(const uint8_t *c, const uint8_t *p,
+                                         const uint8_t *n, int w)
+{
+    unsigned score = 0;
+    for (int x = 0; x < w; x++)
+    {
+        /* Worst case: need 17 bits for "comb". */
+        int_fast32_t comb = (p[x] - c[x]) * (n[x] - c[x]);
+        if (comb > DEINT_COMB_T)
+            score++;
+    }
+    return score;
+}
+
+/* Adds the 8x8 block scores to counts: any motion, top field, bottom field */
+static inline void deint_motion_add(unsigned counts[3], unsigned top,
+                                    unsigned bot)
+{
+    counts[0] += top + bot >= 8;
+    counts[1] += top >= 8;
+    counts[2] += bot >= 8;
+}
+
+static inline void deint_motion_blocks_c(const uint8_t *prev, int prev_pitch,
+                                         const uint8_t *curr, int curr_pitch,
+                                         int blocks, unsigned counts[3])
+{
+    for (int b = 0; b < blocks; b++, prev += 8, curr += 8)
+    {
+        unsigned score[2] = { 0, 0 };
+        for (int y = 0; y < 8; y++)
+            for (int x = 0; x < 8; x++)
+                if (abs(curr[y * curr_pitch + x] - prev[y * prev_pitch + x])
+                        > DEINT_MOTION_T)
+                    score[y & 1]++;
+        deint_motion_add(counts, score[0], score[1]);
+    }
+}
+
+/*** x86 ***/
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# define DEINT_SIMD_X86 1
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static inline unsigned deint_comb_line_sse2(const uint8_t *c, const uint8_t *p,
+                                            const uint8_t *n, int w)
+{
+    /* Clipping the differences to +/-127 keeps the products within 16 bits
+     * and does not change the comparison against the threshold. */
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(127), min = _mm_set1_epi16(-127);
+    const __m128i t = _mm_set1_epi16(DEINT_COMB_T);
+    __m128i acc = zero;
+    int x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m128i vc = _mm_loadu_si128((const __m128i *)&c[x]);
+        __m128i vp = _mm_loadu_si128((const __m128i *)&p[x]);
+        __m128i vn = _mm_loadu_si128((const __m128i *)&n[x]);
+
+        for (int h = 0; h < 2; h++)
+        {
+            __m128i c16 = h ? _mm_unpackhi_epi8(vc, zero)
+                            : _mm_unpacklo_epi8(vc, zero);
+            __m128i p16 = h ? _mm_unpackhi_epi8(vp, zero)
+                            : _mm_unpacklo_epi8(vp, zero);
+            __m128i n16 = h ? _mm_unpackhi_epi8(vn, zero)
+                            : _mm_unpacklo_epi8(vn, zero);
+            __m128i dp = _mm_max_epi16(_mm_min_epi16(_mm_sub_epi16(p16, c16),
+                                                     max), min);
+            __m128i dn = _mm_max_epi16(_mm_min_epi16(_mm_sub_epi16(n16, c16),
+                                                     max), min);
+            acc = _mm_sub_epi16(acc, _mm_cmpgt_epi16(_mm_mullo_epi16(dp, dn),
+                                                     t));
+        }
+    }
+    /* each lane counts at most w / 8 pixels */
+    acc = _mm_madd_epi16(acc, _mm_set1_epi16(1));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(acc) + deint_comb_line_c(c + x, p + x, n + x,
+                                                      w - x);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline unsigned deint_comb_line_avx2(const uint8_t *c, const uint8_t *p,
+                                            const uint8_t *n, int w)
+{
+    const __m256i max = _mm256_set1_epi16(127), min = _mm256_set1_epi16(-127);
+    const __m256i t = _mm256_set1_epi16(DEINT_COMB_T);
+    __m256i acc = _mm256_setzero_si256();
+    int x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m256i c16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&c[x]));
+        __m256i p16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&p[x]));
+        __m256i n16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&n[x]));
+        __m256i dp = _mm256_max_epi16(_mm256_min_epi16(
+                                    _mm256_sub_epi16(p16, c16), max), min);
+        __m256i dn = _mm256_max_epi16(_mm256_min_epi16(
+                                    _mm256_sub_epi16(n16, c16), max), min);
+        acc = _mm256_sub_epi16(acc, _mm256_cmpgt_epi16(
+                                    _mm256_mullo_epi16(dp, dn), t));
+    }
+    acc = _mm256_madd_epi16(acc, _mm256_set1_epi16(1));
+
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(sum) + deint_comb_line_c(c + x, p + x, n + x,
+                                                      w - x);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void deint_motion_blocks_sse2(const uint8_t *prev, int prev_pitch,
+                                            const uint8_t *curr, int curr_pitch,
+                                            int blocks, unsigned counts[3])
+{
+    const __m128i t = _mm_set1_epi8(DEINT_MOTION_T);
+    const __m128i one = _mm_set1_epi8(1);
+    int b = 0;
+
+    /* two blocks at a time */
+    for (; b + 2 <= blocks; b += 2, prev += 16, curr += 16)
+    {
+        __m128i field[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+
+        for (int y = 0; y < 8; y++)
+        {
+            __m128i vp = _mm_loadu_si128((const __m128i *)&prev[y * prev_pitch]);
+            __m128i vc = _mm_loadu_si128((const __m128i *)&curr[y * curr_pitch]);
+            __m128i ad = _mm_or_si128(_mm_subs_epu8(vp, vc),
+                                      _mm_subs_epu8(vc, vp));
+            /* 1 where the difference exceeds the threshold */
+            field[y & 1] = _mm_add_epi8(field[y & 1],
+                                 _mm_min_epu8(_mm_subs_epu8(ad, t), one));
+        }
+        /* one sum per block */
+        __m128i top = _mm_sad_epu8(field[0], _mm_setzero_si128());
+        __m128i bot = _mm_sad_epu8(field[1], _mm_setzero_si128());
+
+        deint_motion_add(counts, _mm_cvtsi128_si32(top),
+                         _mm_cvtsi128_si32(bot));
+        deint_motion_add(counts, _mm_extract_epi16(top, 4),
+                         _mm_extract_epi16(bot, 4));
+    }
+    deint_motion_blocks_c(prev, prev_pitch, curr, curr_pitch, blocks - b,
+                          counts);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void deint_motion_blocks_avx2(const uint8_t *prev, int prev_pitch,
+                                            const uint8_t *curr, int curr_pitch,
+                                            int blocks, unsigned counts[3])
+{
+    const __m256i t = _mm256_set1_epi8(DEINT_MOTION_T);
+    const __m256i one = _mm256_set1_epi8(1);
+    int b = 0;
+
+    /* four blocks at a time */
+    for (; b + 4 <= blocks; b += 4, prev += 32, curr += 32)
+    {
+        __m256i field[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+        for (int y = 0; y < 8; y++)
+        {
+            __m256i vp = _mm256_loadu_si256((const __m256i *)&prev[y * prev_pitch]);
+            __m256i vc = _mm256_loadu_si256((const __m256i *)&curr[y * curr_pitch]);
+            __m256i ad = _mm256_or_si256(_mm256_subs_epu8(vp, vc),
+                                         _mm256_subs_epu8(vc, vp));
+            field[y & 1] = _mm256_add_epi8(field[y & 1],
+                                 _mm256_min_epu8(_mm256_subs_epu8(ad, t), one));
+        }
+        __m256i top = _mm256_sad_epu8(field[0], _mm256_setzero_si256());
+        __m256i bot = _mm256_sad_epu8(field[1], _mm256_setzero_si256());
+        alignas (32) uint64_t top_sums[4], bot_sums[4];
+
+        _mm256_store_si256((__m256i *)top_sums, top);
+        _mm256_store_si256((__m256i *)bot_sums, bot);
+        for (int i = 0; i < 4; i++)
+            deint_motion_add(counts, top_sums[i], bot_sums[i]);
+    }
+    deint_motion_blocks_sse2(prev, prev_pitch, curr, curr_pitch, blocks - b,
+                             counts);
+}
+#endif
+
+/*** ARM ***/
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+# define DEINT_SIMD_NEON 1
+# include <arm_neon.h>
+
+static inline unsigned deint_comb_line_neon(const uint8_t *c, const uint8_t *p,
+                                            const uint8_t *n, int w)
+{
+    const int16x8_t max = vdupq_n_s16(127), min = vdupq_n_s16(-127);
+    const int16x8_t t = vdupq_n_s16(DEINT_COMB_T);
+    uint16x8_t acc = vdupq_n_u16(0);
+    int x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        uint8x8_t vc = vld1_u8(&c[x]);
+        int16x8_t dp = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(&p[x]), vc));
+        int16x8_t dn = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(&n[x]), vc));
+
+        dp = vmaxq_s16(vminq_s16(dp, max), min);
+        dn = vmaxq_s16(vminq_s16(dn, max), min);
+        acc = vsubq_u16(acc, vcgtq_s16(vmulq_s16(dp, dn), t));
+    }
+    uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+
+    return vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1)
+         + deint_comb_line_c(c + x, p + x, n + x, w - x);
+}
+
+static inline void deint_motion_blocks_neon(const uint8_t *prev, int prev_pitch,
+                                            const uint8_t *curr, int curr_pitch,
+                                            int blocks, unsigned counts[3])
+{
+    const uint8x16_t t = vdupq_n_u8(DEINT_MOTION_T);
+    int b = 0;
+
+    for (; b + 2 <= blocks; b += 2, prev += 16, curr += 16)
+    {
+        uint8x16_t field[2] = { vdupq_n_u8(0), vdupq_n_u8(0) };
+
+        for (int y = 0; y < 8; y++)
+        {
+            uint8x16_t ad = vabdq_u8(vld1q_u8(&prev[y * prev_pitch]),
+                                     vld1q_u8(&curr[y * curr_pitch]));
+            field[y & 1] = vsubq_u8(field[y & 1], vcgtq_u8(ad, t));
+        }
+        uint64x2_t top = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(field[0])));
+        uint64x2_t bot = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(field[1])));
+
+        deint_motion_add(counts, vgetq_lane_u64(top, 0),
+                         vgetq_lane_u64(bot, 0));
+        deint_motion_add(counts, vgetq_lane_u64(top, 1),
+                         vgetq_lane_u64(bot, 1));
+    }
+    deint_motion_blocks_c(prev, prev_pitch, curr, curr_pitch, blocks - b,
+                          counts);
+}
+#endif
+
+/*** Selection ***/
+static inline deint_comb_line_t deint_GetCombLine(void)
+{
+#ifdef DEINT_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return deint_comb_line_avx2;
+    if (vlc_CPU_SSE2())
+        return deint_comb_line_sse2;
+#endif
+#ifdef DEINT_SIMD_NEON
+    return deint_comb_line_neon;
+#endif
+    return deint_comb_line_c;
+}
+
+static inline deint_motion_blocks_t deint_GetMotionBlocks(void)
+{
+#ifdef DEINT_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return deint_motion_blocks_avx2;
+    if (vlc_CPU_SSE2())
+        return deint_motion_blocks_sse2;
+#endif
+#ifdef DEINT_SIMD_NEON
+    return deint_motion_blocks_neon;
+#endif
+    return deint_motion_blocks_c;
+}
+
+#endif
@@ -0,0 +1,230 @@
+/*****************************************************************************
+ * yadif_simd.h : Yadif line filters with vector intrinsics
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Must be included after yadif.h, for the C line filters. 8-bit pixels are
+ * computed in 16-bit lanes, 16-bit pixels in 32-bit lanes. */
+
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+#include <immintrin.h>
+
+/* ================ AVX2, 8 bits ================ */
+#define HAVE_YADIF_AVX2
+#define PIXEL       uint8_t
+#define VT          __m256i
+#define VM          __m256i
+#define V_STEP      16
+#define V_LOAD(p)   _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)(p) ) )
+#define V_STORE(p,v) \
+    _mm_storeu_si128( (__m128i *)(p), _mm256_castsi256_si128( \
+        _mm256_permute4x64_epi64( _mm256_packus_epi16( v, v ), 0x08 ) ) )
+#define V_SET1(i)   _mm256_set1_epi16( i )
+#define V_ADD       _mm256_add_epi16
+#define V_SUB       _mm256_sub_epi16
+#define V_ABS       _mm256_abs_epi16
+#define V_MAX       _mm256_max_epi16
+#define V_MIN       _mm256_min_epi16
+#define V_SRA1(v)   _mm256_srai_epi16( v, 1 )
+#define V_LT(a,b)   _mm256_cmpgt_epi16( b, a )
+#define V_AND       _mm256_and_si256
+#define V_SEL(m,a,b) _mm256_blendv_epi8( b, a, m )
+#define V_TARGET    __attribute__ ((__target__ ("avx2")))
+#define V_TAIL      yadif_filter_line_c
+#define RENAME(a)   a ## _avx2
+#include "yadif_simd_template.h"
+#undef RENAME
+#undef V_TAIL
+#undef V_STORE
+#undef V_LOAD
+#undef V_STEP
+#undef PIXEL
+
+/* ================ AVX2, 16 bits ================ */
+#define PIXEL       uint16_t
+#define V_STEP      8
+#define V_LOAD(p)   _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i *)(p) ) )
+#define V_STORE(p,v) \
+    _mm_storeu_si128( (__m128i *)(p), _mm256_castsi256_si128( \
+        _mm256_permute4x64_epi64( _mm256_packus_epi32( v, v ), 0x08 ) ) )
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_ABS
+#undef V_MAX
+#undef V_MIN
+#undef V_SRA1
+#undef V_LT
+#define V_SET1(i)   _mm256_set1_epi32( i )
+#define V_ADD       _mm256_add_epi32
+#define V_SUB       _mm256_sub_epi32
+#define V_ABS       _mm256_abs_epi32
+#define V_MAX       _mm256_max_epi32
+#define V_MIN       _mm256_min_epi32
+#define V_SRA1(v)   _mm256_srai_epi32( v, 1 )
+#define V_LT(a,b)   _mm256_cmpgt_epi32( b, a )
+#define V_TAIL      yadif_filter_line_c_16bit
+#define RENAME(a)   a ## _16bit_avx2
+#include "yadif_simd_template.h"
+#undef RENAME
+#undef V_TAIL
+#undef V_TARGET
+#undef V_SEL
+#undef V_AND
+#undef V_LT
+#undef V_SRA1
+#undef V_MIN
+#undef V_MAX
+#undef V_ABS
+#undef V_SUB
+#undef V_ADD
+#undef V_SET1
+#undef V_STORE
+#undef V_LOAD
+#undef V_STEP
+#undef VM
+#undef VT
+#undef PIXEL
+
+/* ================ SSE4.1, 16 bits ================ */
+#define HAVE_YADIF_SSE4_1
+#define PIXEL       uint16_t
+#define VT          __m128i
+#define VM          __m128i
+#define V_STEP      4
+#define V_LOAD(p)   _mm_cvtepu16_epi32( _mm_loadl_epi64( (const __m128i *)(p) ) )
+#define V_STORE(p,v) _mm_storel_epi64( (__m128i *)(p), _mm_packus_epi32( v, v ) )
+#define V_SET1(i)   _mm_set1_epi32( i )
+#define V_ADD       _mm_add_epi32
+#define V_SUB       _mm_sub_epi32
+#define V_ABS       _mm_abs_epi32
+#define V_MAX       _mm_max_epi32
+#define V_MIN       _mm_min_epi32
+#define V_SRA1(v)   _mm_srai_epi32( v, 1 )
+#define V_LT(a,b)   _mm_cmpgt_epi32( b, a )
+#define V_AND       _mm_and_si128
+#define V_SEL(m,a,b) _mm_blendv_epi8( b, a, m )
+#define V_TARGET    __attribute__ ((__target__ ("sse4.1")))
+#define V_TAIL      yadif_filter_line_c_16bit
+#define RENAME(a)   a ## _16bit_sse4
+#include "yadif_simd_template.h"
+#undef RENAME
+#undef V_TAIL
+#undef V_TARGET
+#undef V_SEL
+#undef V_AND
+#undef V_LT
+#undef V_SRA1
+#undef V_MIN
+#undef V_MAX
+#undef V_ABS
+#undef V_SUB
+#undef V_ADD
+#undef V_SET1
+#undef V_STORE
+#undef V_LOAD
+#undef V_STEP
+#undef VM
+#undef VT
+#undef PIXEL
+#endif
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+
+/* ================ NEON, 8 bits ================ */
+#define HAVE_YADIF_NEON
+#define PIXEL       uint8_t
+#define VT          int16x8_t
+#define VM          uint16x8_t
+#define V_STEP      8
+#define V_LOAD(p)   vreinterpretq_s16_u16( vmovl_u8( vld1_u8( p ) ) )
+#define V_STORE(p,v) vst1_u8( p, vqmovun_s16( v ) )
+#define V_SET1(i)   vdupq_n_s16( i )
+#define V_ADD       vaddq_s16
+#define V_SUB       vsubq_s16
+#define V_ABS       vabsq_s16
+#define V_MAX       vmaxq_s16
+#define V_MIN       vminq_s16
+#define V_SRA1(v)   vshrq_n_s16( v, 1 )
+#define V_LT        vcltq_s16
+#define V_AND       vandq_u16
+#define V_SEL       vbslq_s16
+#define V_TARGET
+#define V_TAIL      yadif_filter_line_c
+#define RENAME(a)   a ## _neon
+#include "yadif_simd_template.h"
+#undef RENAME
+#undef V_TAIL
+#undef V_SEL
+#undef V_AND
+#undef V_LT
+#undef V_SRA1
+#undef V_MIN
+#undef V_MAX
+#undef V_ABS
+#undef V_SUB
+#undef V_ADD
+#undef V_SET1
+#undef V_STORE
+#undef V_LOAD
+#undef V_STEP
+#undef VM
+#undef VT
+#undef PIXEL
+
+/* ================ NEON, 16 bits ================ */
+#define PIXEL       uint16_t
+#define VT          int32x4_t
+#define VM          uint32x4_t
+#define V_STEP      4
+#define V_LOAD(p)   vreinterpretq_s32_u32( vmovl_u16( vld1_u16( p ) ) )
+#define V_STORE(p,v) vst1_u16( p, vqmovun_s32( v ) )
+#define V_SET1(i)   vdupq_n_s32( i )
+#define V_ADD       vaddq_s32
+#define V_SUB       vsubq_s32
+#define V_ABS       vabsq_s32
+#define V_MAX       vmaxq_s32
+#define V_MIN       vminq_s32
+#define V_SRA1(v)   vshrq_n_s32( v, 1 )
+#define V_LT        vcltq_s32
+#define V_AND       vandq_u32
+#define V_SEL       vbslq_s32
+#define V_TAIL      yadif_filter_line_c_16bit
+#define RENAME(a)   a ## _16bit_neon
+#include "yadif_simd_template.h"
+#undef RENAME
+#undef V_TAIL
+#undef V_TARGET
+#undef V_SEL
+#undef V_AND
+#undef V_LT
+#undef V_SRA1
+#undef V_MIN
+#undef V_MAX
+#undef V_ABS
+#undef V_SUB
+#undef V_ADD
+#undef V_SET1
+#undef V_STORE
+#undef V_LOAD
+#undef V_STEP
+#undef VM
+#undef VT
+#undef PIXEL
+#endif
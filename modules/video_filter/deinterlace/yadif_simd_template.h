@@ -0,0 +1,141 @@
+/*****************************************************************************
+ * yadif_simd_template.h : Yadif line filter, vector intrinsics template
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This is the FILTER macro of yadif.h, one vector of pixels at a time, with
+ * the same integer arithmetic so that the output is bit-exact.
+ *
+ * The includer defines:
+ *  PIXEL           pixel type
+ *  VT, VM          vector and comparison mask types
+ *  V_STEP          pixels per vector
+ *  V_LOAD(p)       loads V_STEP pixels, widened to signed lanes
+ *  V_STORE(p,v)    narrows and stores V_STEP pixels
+ *  V_SET1(i)       broadcasts an integer
+ *  V_ADD, V_SUB, V_ABS, V_MAX, V_MIN, V_SRA1 (arithmetic shift by one)
+ *  V_LT(a,b)       mask of a < b
+ *  V_AND(m,n)      mask intersection
+ *  V_SEL(m,a,b)    m ? a : b
+ *  V_TARGET        function attributes
+ *  V_TAIL          C line filter for the remaining pixels
+ *  RENAME(a)       function name suffix
+ */
+
+#define V_ABSDIFF(a,b) V_ABS( V_SUB( a, b ) )
+#define V_AVG(a,b)     V_SRA1( V_ADD( a, b ) )
+#define V_SCORE(j) \
+    V_ADD( V_ADD( V_ABSDIFF( V_LOAD( &cur[x + m - 1 + (j)] ), \
+                             V_LOAD( &cur[x + p - 1 - (j)] ) ), \
+                  V_ABSDIFF( V_LOAD( &cur[x + m + (j)] ), \
+                             V_LOAD( &cur[x + p - (j)] ) ) ), \
+           V_ABSDIFF( V_LOAD( &cur[x + m + 1 + (j)] ), \
+                      V_LOAD( &cur[x + p + 1 - (j)] ) ) )
+#define V_PRED(j) \
+    V_AVG( V_LOAD( &cur[x + m + (j)] ), V_LOAD( &cur[x + p - (j)] ) )
+#define V_CHECK(mask, j) \
+    do { \
+        VT score = V_SCORE(j); \
+        mask = V_AND( mask, V_LT( score, spatial_score ) ); \
+        spatial_score = V_SEL( mask, score, spatial_score ); \
+        spatial_pred = V_SEL( mask, V_PRED(j), spatial_pred ); \
+    } while(0)
+
+V_TARGET
+static void RENAME(yadif_filter_line)( uint8_t *dst8, uint8_t *prev8,
+                                       uint8_t *cur8, uint8_t *next8,
+                                       int w, int prefs, int mrefs,
+                                       int parity, int mode )
+{
+    PIXEL *dst = (PIXEL *)dst8;
+    const PIXEL *prev = (const PIXEL *)prev8;
+    const PIXEL *cur  = (const PIXEL *)cur8;
+    const PIXEL *next = (const PIXEL *)next8;
+    const PIXEL *prev2 = parity ? prev : cur;
+    const PIXEL *next2 = parity ? cur  : next;
+    const int p = prefs / (int)sizeof(PIXEL);
+    const int m = mrefs / (int)sizeof(PIXEL);
+    const VT one = V_SET1( 1 );
+    const VT zero = V_SET1( 0 );
+    const VM all = V_LT( zero, one );
+    int x;
+
+    for( x = 0; x + V_STEP <= w; x += V_STEP )
+    {
+        const VT c = V_LOAD( &cur[x + m] );
+        const VT e = V_LOAD( &cur[x + p] );
+        const VT p2 = V_LOAD( &prev2[x] );
+        const VT n2 = V_LOAD( &next2[x] );
+        const VT d = V_AVG( p2, n2 );
+
+        VT temporal_diff0 = V_ABSDIFF( p2, n2 );
+        VT temporal_diff1 = V_SRA1( V_ADD(
+                                V_ABSDIFF( V_LOAD( &prev[x + m] ), c ),
+                                V_ABSDIFF( V_LOAD( &prev[x + p] ), e ) ) );
+        VT temporal_diff2 = V_SRA1( V_ADD(
+                                V_ABSDIFF( V_LOAD( &next[x + m] ), c ),
+                                V_ABSDIFF( V_LOAD( &next[x + p] ), e ) ) );
+        VT diff = V_MAX( V_MAX( V_SRA1( temporal_diff0 ), temporal_diff1 ),
+                         temporal_diff2 );
+        VT spatial_pred = V_AVG( c, e );
+        VT spatial_score = V_SUB( V_ADD( V_ADD(
+                   V_ABSDIFF( V_LOAD( &cur[x + m - 1] ),
+                              V_LOAD( &cur[x + p - 1] ) ),
+                   V_ABSDIFF( c, e ) ),
+                   V_ABSDIFF( V_LOAD( &cur[x + m + 1] ),
+                              V_LOAD( &cur[x + p + 1] ) ) ), one );
+        VM mask;
+
+        /* each second check only where the first one succeeded */
+        mask = all;
+        V_CHECK( mask, -1 );
+        V_CHECK( mask, -2 );
+        mask = all;
+        V_CHECK( mask, 1 );
+        V_CHECK( mask, 2 );
+
+        if( mode < 2 )
+        {
+            const VT b = V_AVG( V_LOAD( &prev2[x + 2 * m] ),
+                                V_LOAD( &next2[x + 2 * m] ) );
+            const VT f = V_AVG( V_LOAD( &prev2[x + 2 * p] ),
+                                V_LOAD( &next2[x + 2 * p] ) );
+            const VT de = V_SUB( d, e ), dc = V_SUB( d, c );
+            const VT bc = V_SUB( b, c ), fe = V_SUB( f, e );
+            const VT max = V_MAX( V_MAX( de, dc ), V_MIN( bc, fe ) );
+            const VT min = V_MIN( V_MIN( de, dc ), V_MAX( bc, fe ) );
+
+            diff = V_MAX( V_MAX( diff, min ), V_SUB( zero, max ) );
+        }
+
+        /* diff is never negative, so this is the clipping of yadif.h */
+        spatial_pred = V_MAX( V_MIN( spatial_pred, V_ADD( d, diff ) ),
+                              V_SUB( d, diff ) );
+        V_STORE( &dst[x], spatial_pred );
+    }
+
+    if( x < w )
+        V_TAIL( (uint8_t *)&dst[x], (uint8_t *)&prev[x], (uint8_t *)&cur[x],
+                (uint8_t *)&next[x], w - x, prefs, mrefs, parity, mode );
+}
+
+#undef V_CHECK
+#undef V_PRED
+#undef V_SCORE
+#undef V_AVG
+#undef V_ABSDIFF
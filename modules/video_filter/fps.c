@@ -32,6 +32,8 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_slices.h>
+#include "motion_search.h"
 
 static int Open( vlc_object_t *p_this);
 static void Close( vlc_object_t *p_this);
@@ -40,6 +42,12 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_picture);
 #define CFG_PREFIX "fps-"
 
 #define FPS_TEXT N_( "Frame rate" )
+#define INTERPOLATE_TEXT N_( "Motion interpolation" )
+#define INTERPOLATE_LONGTEXT N_( "Interpolate the added pictures along " \
+    "the motion rather than duplicating the previous one (planar YUV only)." )
+#define THREADS_TEXT N_( "Threads" )
+#define THREADS_LONGTEXT N_( "Number of threads used for motion " \
+    "interpolation (0 = one per CPU, 1 = no threading)." )
 
 vlc_module_begin ()
     set_description( N_("FPS conversion video filter") )
@@ -50,14 +58,21 @@ vlc_module_begin ()
 
     add_shortcut( "fps" )
     add_string( CFG_PREFIX "fps", NULL, FPS_TEXT, FPS_TEXT, false )
+    add_bool( CFG_PREFIX "interpolate", false, INTERPOLATE_TEXT,
+              INTERPOLATE_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "threads", 0, 0, 16,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "fps",
+    "fps", "interpolate", "threads",
     NULL
 };
 
+typedef void (*fps_average_t)( uint8_t *dst, const uint8_t *a,
+                               const uint8_t *b, int w, unsigned weight );
+
 /* We'll store pointer for previous picture we have received
    and copy that if needed on framerate increase (not preferred)*/
 struct filter_sys_t
@@ -65,8 +80,324 @@ struct filter_sys_t
     date_t          next_output_pts; /**< output calculated PTS */
     picture_t       *p_previous_pic;
     int             i_output_frame_interval;
+    int             i_input_frame_interval; /**< 0 if unknown */
+
+    /* Motion interpolation, if enabled */
+    bool            b_interpolate;
+    bool            b_fields;       /**< last fields are valid predictors */
+    unsigned        i_field;        /**< index of the current fields */
+    me_vector_t     *forward[2];    /**< blocks of a picture in the previous */
+    me_vector_t     *backward[2];   /**< blocks of a picture in the next */
+    const vlc_chroma_description_t *chroma;
+    vlc_slices_t    *slices;
+    me_sad_t        sad;
+    fps_average_t   average;
 };
 
+/*****************************************************************************
+ * Motion interpolation
+ *****************************************************************************
+ * The 8x8 blocks of each new picture are searched in the previous one, and
+ * the other way round. Each block of an interpolated picture then takes the
+ * motion, among the vectors of both fields around it, that best matches the
+ * two pictures on either side of it, and averages them along that motion.
+ *
+ * If no motion matches well, the block is probably covered or uncovered
+ * between the two pictures. Where the block of the next picture was not
+ * found in the previous one, the area is being uncovered and is taken from
+ * the next picture; where the block of the previous picture was not found in
+ * the next one, it is being covered and is taken from the previous picture.
+ * Either is taken in place, as the background of a moving object mostly
+ * stays still. Failing that, the two pictures are blended without motion,
+ * which does not look worse than duplication.
+ *****************************************************************************/
+
+/* Largest SAD of a reliably matched 8x8 block */
+#define FPS_SAD_MAX (ME_BLOCK * ME_BLOCK * 12)
+#define FPS_RANGE   32
+
+/* dst = (a * (256 - weight) + b * weight) / 256 */
+static void AverageC( uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                      int w, unsigned weight )
+{
+    for( int x = 0; x < w; x++ )
+        dst[x] = ( a[x] * ( 256 - weight ) + b[x] * weight + 128 ) >> 8;
+}
+
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static void AverageSSE2( uint8_t *dst, const uint8_t *a, const uint8_t *b,
+                         int w, unsigned weight )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wa = _mm_set1_epi16( 256 - weight );
+    const __m128i wb = _mm_set1_epi16( weight );
+    const __m128i round = _mm_set1_epi16( 128 );
+    int x = 0;
+
+    /* a * (256 - weight) + b * weight fits in 16 unsigned bits */
+    for( ; x + 8 <= w; x += 8 )
+    {
+        __m128i va = _mm_unpacklo_epi8(
+            _mm_loadl_epi64( (const __m128i *)&a[x] ), zero );
+        __m128i vb = _mm_unpacklo_epi8(
+            _mm_loadl_epi64( (const __m128i *)&b[x] ), zero );
+        __m128i o = _mm_add_epi16( _mm_mullo_epi16( va, wa ),
+                                   _mm_mullo_epi16( vb, wb ) );
+
+        o = _mm_srli_epi16( _mm_add_epi16( o, round ), 8 );
+        _mm_storel_epi64( (__m128i *)&dst[x], _mm_packus_epi16( o, o ) );
+    }
+    AverageC( dst + x, a + x, b + x, w - x, weight );
+}
+#endif
+
+typedef struct
+{
+    filter_sys_t    *p_sys;
+    me_search_t     forward;
+    me_search_t     backward;
+} fps_search_job_t;
+
+static void SearchSlice( void *opaque, unsigned index, unsigned count )
+{
+    const fps_search_job_t *job = opaque;
+    filter_sys_t *p_sys = job->p_sys;
+    unsigned start, end;
+
+    vlc_slices_Rows( index, count, me_BlocksY( job->forward.cur ), 1,
+                     &start, &end );
+    for( unsigned by = start; by < end; by++ )
+    {
+        me_SearchRow( &job->forward, by, p_sys->forward[p_sys->i_field ^ 1] );
+        me_SearchRow( &job->backward, by, p_sys->backward[p_sys->i_field ^ 1] );
+    }
+}
+
+static void EstimateMotion( filter_sys_t *p_sys, const picture_t *p_prev,
+                            const picture_t *p_cur )
+{
+    const unsigned last = p_sys->i_field;
+    fps_search_job_t job = {
+        .p_sys = p_sys,
+        .forward = {
+            .cur = &p_cur->p[Y_PLANE],
+            .ref = &p_prev->p[Y_PLANE],
+            .prev = p_sys->b_fields ? p_sys->forward[last] : NULL,
+            .range = FPS_RANGE,
+            .sad = p_sys->sad,
+        },
+        .backward = {
+            .cur = &p_prev->p[Y_PLANE],
+            .ref = &p_cur->p[Y_PLANE],
+            .prev = p_sys->b_fields ? p_sys->backward[last] : NULL,
+            .range = FPS_RANGE,
+            .sad = p_sys->sad,
+        },
+    };
+
+    vlc_slices_Run( p_sys->slices, vlc_slices_Count( p_sys->slices ),
+                    SearchSlice, &job );
+    p_sys->i_field ^= 1;
+    p_sys->b_fields = true;
+}
+
+typedef struct
+{
+    filter_sys_t    *p_sys;
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    picture_t       *p_dst;
+    unsigned        i_weight;   /**< of the next picture, out of 256 */
+} fps_interpolate_job_t;
+
+/* Part of the motion v before the interpolated picture, rounded */
+static inline int ScaleVector( int v, unsigned weight )
+{
+    return ( v * (int)weight + ( v < 0 ? -128 : 128 ) ) / 256;
+}
+
+static void InterpolateBlock( const fps_interpolate_job_t *job, int bx, int by )
+{
+    filter_sys_t *p_sys = job->p_sys;
+    const plane_t *p_luma = &job->p_prev->p[Y_PLANE];
+    const int i_width = p_luma->i_visible_pitch;
+    const int i_height = p_luma->i_visible_lines;
+    const int i_blocks_x = me_BlocksX( p_luma );
+    const int i_blocks_y = me_BlocksY( p_luma );
+    const me_vector_t *forward = p_sys->forward[p_sys->i_field];
+    const me_vector_t *backward = p_sys->backward[p_sys->i_field];
+    int x, y, w, h;
+
+    me_BlockArea( p_luma, bx, by, &x, &y, &w, &h );
+
+    /* Candidate motions, from the previous to the next picture */
+    int candidates[11][2] = { { 0, 0 } };
+    unsigned count = 1;
+    static const int8_t around[5][2] = {
+        { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }
+    };
+    for( int i = 0; i < 5; i++ )
+    {
+        int nx = bx + around[i][0], ny = by + around[i][1];
+
+        if( nx < 0 || nx >= i_blocks_x || ny < 0 || ny >= i_blocks_y )
+            continue;
+        const me_vector_t *f = &forward[ny * i_blocks_x + nx];
+        const me_vector_t *b = &backward[ny * i_blocks_x + nx];
+        const int v[2][2] = { { -f->x, -f->y }, { b->x, b->y } };
+
+        /* Neighbours mostly share their vectors, try each one once */
+        for( int j = 0; j < 2; j++ )
+        {
+            unsigned k = 0;
+
+            while( k < count && ( candidates[k][0] != v[j][0]
+                               || candidates[k][1] != v[j][1] ) )
+                k++;
+            if( k == count )
+            {
+                candidates[count][0] = v[j][0];
+                candidates[count][1] = v[j][1];
+                count++;
+            }
+        }
+    }
+
+    /* Pick the motion matching the two pictures best around the block */
+    int mx = 0, my = 0;
+    unsigned best_sad = UINT_MAX, best_cost = UINT_MAX;
+    for( unsigned i = 0; i < count; i++ )
+    {
+        int vx = candidates[i][0], vy = candidates[i][1];
+        int px = x - ScaleVector( vx, job->i_weight );
+        int py = y - ScaleVector( vy, job->i_weight );
+
+        if( px < 0 || px + w > i_width || py < 0 || py + h > i_height
+         || px + vx < 0 || px + vx + w > i_width
+         || py + vy < 0 || py + vy + h > i_height )
+            continue;
+
+        const plane_t *p_cur = &job->p_cur->p[Y_PLANE];
+        unsigned sad = p_sys->sad(
+            &p_luma->p_pixels[py * p_luma->i_pitch + px], p_luma->i_pitch,
+            &p_cur->p_pixels[(py + vy) * p_cur->i_pitch + px + vx],
+            p_cur->i_pitch );
+        unsigned cost = sad + ME_LAMBDA * ( abs( vx ) + abs( vy ) );
+
+        if( cost < best_cost )
+        {
+            mx = vx;
+            my = vy;
+            best_sad = sad;
+            best_cost = cost;
+        }
+    }
+
+    unsigned weight = job->i_weight;
+    if( best_sad > FPS_SAD_MAX )
+    {
+        const int i_block = by * i_blocks_x + bx;
+        bool prev_ok = backward[i_block].sad <= FPS_SAD_MAX;
+        bool cur_ok = forward[i_block].sad <= FPS_SAD_MAX;
+
+        /* Only the next picture shows what is being uncovered, and only
+         * the previous one what is being covered */
+        if( prev_ok && !cur_ok )
+            weight = 256;       /* being uncovered */
+        else if( cur_ok && !prev_ok )
+            weight = 0;         /* being covered */
+        mx = my = 0;            /* otherwise, no confidence: blend */
+    }
+
+    const int dx = ScaleVector( mx, job->i_weight );
+    const int dy = ScaleVector( my, job->i_weight );
+
+    for( int i = 0; i < job->p_dst->i_planes; i++ )
+    {
+        const plane_t *p_a = &job->p_prev->p[i];
+        const plane_t *p_b = &job->p_cur->p[i];
+        plane_t *p_out = &job->p_dst->p[i];
+        const int wn = p_sys->chroma->p[i].w.num, wd = p_sys->chroma->p[i].w.den;
+        const int hn = p_sys->chroma->p[i].h.num, hd = p_sys->chroma->p[i].h.den;
+
+        /* The last blocks extend to the edges of the plane */
+        int x0 = x * wn / wd, y0 = y * hn / hd;
+        int x1 = ( x + w == i_width ) ? p_out->i_visible_pitch
+                                      : ( x + w ) * wn / wd;
+        int y1 = ( y + h == i_height ) ? p_out->i_visible_lines
+                                       : ( y + h ) * hn / hd;
+        int ax = -dx * wn / wd, ay = -dy * hn / hd;
+        int cx = ( mx - dx ) * wn / wd, cy = ( my - dy ) * hn / hd;
+
+        ax = VLC_CLIP( ax, -x0, p_a->i_visible_pitch - x1 );
+        ay = VLC_CLIP( ay, -y0, p_a->i_visible_lines - y1 );
+        cx = VLC_CLIP( cx, -x0, p_b->i_visible_pitch - x1 );
+        cy = VLC_CLIP( cy, -y0, p_b->i_visible_lines - y1 );
+
+        for( int py = y0; py < y1; py++ )
+            p_sys->average( &p_out->p_pixels[py * p_out->i_pitch + x0],
+                            &p_a->p_pixels[(py + ay) * p_a->i_pitch + x0 + ax],
+                            &p_b->p_pixels[(py + cy) * p_b->i_pitch + x0 + cx],
+                            x1 - x0, weight );
+    }
+}
+
+static void InterpolateSlice( void *opaque, unsigned index, unsigned count )
+{
+    const fps_interpolate_job_t *job = opaque;
+    const plane_t *p_luma = &job->p_prev->p[Y_PLANE];
+    unsigned start, end;
+
+    vlc_slices_Rows( index, count, me_BlocksY( p_luma ), 1, &start, &end );
+    for( unsigned by = start; by < end; by++ )
+        for( int bx = 0; bx < me_BlocksX( p_luma ); bx++ )
+            InterpolateBlock( job, bx, by );
+}
+
+/**
+ * Creates the picture between two others at the next output date, or
+ * returns NULL if it would be the previous picture. The motion between the
+ * two pictures is estimated for the first picture created.
+ */
+static picture_t *Interpolate( filter_t *p_filter, const picture_t *p_prev,
+                               mtime_t i_prev_date, const picture_t *p_cur,
+                               bool *pb_estimated )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const mtime_t i_span = p_cur->date - i_prev_date;
+    mtime_t i_offset = date_Get( &p_sys->next_output_pts ) - i_prev_date;
+
+    i_offset = VLC_CLIP( i_offset, 0, i_span );
+    unsigned i_weight = ( i_offset * 256 + i_span / 2 ) / i_span;
+    if( i_weight == 0 )
+        return NULL;
+
+    if( !*pb_estimated )
+    {
+        EstimateMotion( p_sys, p_prev, p_cur );
+        *pb_estimated = true;
+    }
+
+    picture_t *p_dst = picture_NewFromFormat( &p_filter->fmt_out.video );
+    if( unlikely( !p_dst ) )
+        return NULL;
+    picture_CopyProperties( p_dst, p_prev );
+
+    fps_interpolate_job_t job = {
+        .p_sys = p_sys,
+        .p_prev = p_prev,
+        .p_cur = p_cur,
+        .p_dst = p_dst,
+        .i_weight = i_weight,
+    };
+    vlc_slices_Run( p_sys->slices, vlc_slices_Count( p_sys->slices ),
+                    InterpolateSlice, &job );
+    return p_dst;
+}
+
 static picture_t *Filter( filter_t *p_filter, picture_t *p_picture)
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -86,7 +417,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_picture)
     /* First time we get some valid timestamp, we'll take it as base for output
         later on we retake new timestamp if it has jumped too much */
     if( unlikely( ( date_Get( &p_sys->next_output_pts ) == VLC_TS_INVALID ) ||
-                   ( p_picture->date > ( date_Get( &p_sys->next_output_pts ) + (mtime_t)p_sys->i_output_frame_interval ) )
+                   ( p_picture->date > ( date_Get( &p_sys->next_output_pts ) + (mtime_t)p_sys->i_output_frame_interval + p_sys->i_input_frame_interval ) )
                 ) )
     {
         msg_Dbg( p_filter, "Resetting timestamps" );
@@ -94,6 +425,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_picture)
         if( p_sys->p_previous_pic )
             picture_Release( p_sys->p_previous_pic );
         p_sys->p_previous_pic = picture_Hold( p_picture );
+        p_sys->b_fields = false;
         date_Increment( &p_sys->next_output_pts, 1 );
         return p_picture;
     }
@@ -108,18 +440,41 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_picture)
         return NULL;
     }
 
-    p_sys->p_previous_pic->date = date_Get( &p_sys->next_output_pts );
+    picture_t *p_prev = p_sys->p_previous_pic;
+    const mtime_t i_prev_date = p_prev->date;
+    /* Only the pictures added between two input pictures are interpolated,
+     * allowing for the rounding of the timestamps */
+    const bool b_interpolate = p_sys->b_interpolate &&
+        p_picture->date - i_prev_date > (mtime_t)( p_sys->i_output_frame_interval
+                                     + p_sys->i_output_frame_interval / 16 );
+    bool b_estimated = false;
+    picture_t *p_first = NULL;
+
+    if( b_interpolate )
+        p_first = Interpolate( p_filter, p_prev, i_prev_date, p_picture,
+                               &b_estimated );
+    if( p_first == NULL )
+        p_first = picture_Hold( p_prev );
+
+    p_first->date = date_Get( &p_sys->next_output_pts );
     date_Increment( &p_sys->next_output_pts, 1 );
 
-    picture_t *last_pic = p_sys->p_previous_pic;
+    picture_t *last_pic = p_first;
     /* Duplicating pictures are not that effective and framerate increase
         should be avoided, it's only here as filter should work in that direction too*/
     while( unlikely( (date_Get( &p_sys->next_output_pts ) + p_sys->i_output_frame_interval ) < p_picture->date ) )
     {
         picture_t *p_tmp = NULL;
-        p_tmp = picture_NewFromFormat( &p_filter->fmt_out.video );
-
-        picture_Copy( p_tmp, p_sys->p_previous_pic);
+        if( b_interpolate )
+            p_tmp = Interpolate( p_filter, p_prev, i_prev_date, p_picture,
+                                 &b_estimated );
+        if( p_tmp == NULL )
+        {
+            p_tmp = picture_NewFromFormat( &p_filter->fmt_out.video );
+            if( unlikely( !p_tmp ) )
+                break;
+            picture_Copy( p_tmp, p_prev );
+        }
         p_tmp->date = date_Get( &p_sys->next_output_pts );
         p_tmp->p_next = NULL;
 
@@ -128,9 +483,74 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_picture)
         date_Increment( &p_sys->next_output_pts, 1 );
     }
 
-    last_pic = p_sys->p_previous_pic;
+    picture_Release( p_prev );
     p_sys->p_previous_pic = p_picture;
-    return last_pic;
+    return p_first;
+}
+
+static void CloseInterpolation( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_slices_Delete( p_sys->slices );
+    p_sys->slices = NULL;
+    for( int i = 0; i < 2; i++ )
+    {
+        free( p_sys->forward[i] );
+        free( p_sys->backward[i] );
+        p_sys->forward[i] = p_sys->backward[i] = NULL;
+    }
+}
+
+static int OpenInterpolation( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_fmt = &p_filter->fmt_in.video;
+    const video_format_t *p_fmt_out = &p_filter->fmt_out.video;
+
+    if( p_fmt->i_frame_rate && p_fmt->i_frame_rate_base &&
+        (uint64_t)p_fmt_out->i_frame_rate * p_fmt->i_frame_rate_base <=
+        (uint64_t)p_fmt->i_frame_rate * p_fmt_out->i_frame_rate_base )
+    {
+        msg_Dbg( p_filter, "frame rate not increased, nothing to interpolate" );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->chroma = vlc_fourcc_GetChromaDescription( p_fmt->i_chroma );
+    if( !p_sys->chroma || p_sys->chroma->plane_count != 3
+     || p_sys->chroma->pixel_size != 1
+     || p_fmt->i_visible_width < ME_BLOCK
+     || p_fmt->i_visible_height < ME_BLOCK )
+    {
+        msg_Warn( p_filter, "cannot interpolate %4.4s, duplicating pictures",
+                  (const char *)&p_fmt->i_chroma );
+        return VLC_EGENERIC;
+    }
+
+    size_t blocks = ( p_fmt->i_visible_width / ME_BLOCK )
+                  * ( p_fmt->i_visible_height / ME_BLOCK );
+    for( int i = 0; i < 2; i++ )
+    {
+        p_sys->forward[i] = malloc( blocks * sizeof(me_vector_t) );
+        p_sys->backward[i] = malloc( blocks * sizeof(me_vector_t) );
+        if( !p_sys->forward[i] || !p_sys->backward[i] )
+        {
+            CloseInterpolation( p_filter );
+            return VLC_ENOMEM;
+        }
+    }
+
+    p_sys->slices = vlc_slices_New( var_InheritInteger( p_filter,
+                                                CFG_PREFIX "threads" ) );
+    p_sys->sad = me_GetSAD();
+    p_sys->average = AverageC;
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+    if( vlc_CPU_SSE2() )
+        p_sys->average = AverageSSE2;
+#endif
+    msg_Dbg( p_filter, "motion interpolation with %u thread(s)",
+             vlc_slices_Count( p_sys->slices ) );
+    return VLC_SUCCESS;
 }
 
 static int Open( vlc_object_t *p_this)
@@ -138,7 +558,7 @@ static int Open( vlc_object_t *p_this)
     filter_t *p_filter = (filter_t*)p_this;
     filter_sys_t *p_sys;
 
-    p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
+    p_sys = p_filter->p_sys = calloc( 1, sizeof( *p_sys ) );
 
     if( unlikely( !p_sys ) )
         return VLC_ENOMEM;
@@ -162,6 +582,8 @@ static int Open( vlc_object_t *p_this)
             p_filter->fmt_out.video.i_frame_rate, p_filter->fmt_out.video.i_frame_rate_base );
 
     p_sys->i_output_frame_interval = p_filter->fmt_out.video.i_frame_rate_base * CLOCK_FREQ / p_filter->fmt_out.video.i_frame_rate;
+    if( p_filter->fmt_in.video.i_frame_rate )
+        p_sys->i_input_frame_interval = p_filter->fmt_in.video.i_frame_rate_base * CLOCK_FREQ / p_filter->fmt_in.video.i_frame_rate;
 
     date_Init( &p_sys->next_output_pts,
                p_filter->fmt_out.video.i_frame_rate, p_filter->fmt_out.video.i_frame_rate_base );
@@ -169,6 +591,10 @@ static int Open( vlc_object_t *p_this)
     date_Set( &p_sys->next_output_pts, VLC_TS_INVALID );
     p_sys->p_previous_pic = NULL;
 
+    p_sys->b_interpolate = var_InheritBool( p_filter, CFG_PREFIX "interpolate" );
+    if( p_sys->b_interpolate && OpenInterpolation( p_filter ) )
+        p_sys->b_interpolate = false;
+
     p_filter->pf_video_filter = Filter;
     return VLC_SUCCESS;
 }
@@ -178,5 +604,6 @@ static void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
     if( p_filter->p_sys->p_previous_pic )
         picture_Release( p_filter->p_sys->p_previous_pic );
+    CloseInterpolation( p_filter );
     free( p_filter->p_sys );
 }
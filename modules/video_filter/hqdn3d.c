@@ -58,6 +58,9 @@ static int DenoiseCallback( vlc_object_t *p_this, char const *psz_var,
 #define CHROMA_SPAT_TEXT        N_("Spatial chroma strength (0-254)")
 #define LUMA_TEMP_TEXT          N_("Temporal luma strength (0-254)")
 #define CHROMA_TEMP_TEXT        N_("Temporal chroma strength (0-254)")
+#define THREADS_TEXT            N_("Threads")
+#define THREADS_LONGTEXT        N_("Number of threads used to filter " \
+    "each picture (0 = one per CPU, 1 = no threading).")
 
 vlc_module_begin()
     set_shortname(N_("HQ Denoiser 3D"))
@@ -74,6 +77,8 @@ vlc_module_begin()
             LUMA_TEMP_TEXT, LUMA_TEMP_TEXT, false)
     add_float_with_range(FILTER_PREFIX "chroma-temp", 4.5, 0.0, 254.0,
             CHROMA_TEMP_TEXT, CHROMA_TEMP_TEXT, false)
+    add_integer_with_range(FILTER_PREFIX "threads", 0, 0, 16,
+            THREADS_TEXT, THREADS_LONGTEXT, true)
 
     add_shortcut("hqdn3d")
 
@@ -91,8 +96,13 @@ struct filter_sys_t
 {
     const vlc_chroma_description_t *chroma;
     int w[3], h[3];
+    unsigned bits;
 
     struct vf_priv_s cfg;
+    bool   b_init;
+    vlc_slices_t *slices;
+    hqdn3d_horizontal_t horizontal;
+    hqdn3d_vertical_t vertical;
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
@@ -110,11 +120,12 @@ static int Open(vlc_object_t *this)
     const video_format_t *fmt_out = &filter->fmt_out.video;
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
-    int wmax = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
-    if (!chroma || chroma->plane_count != 3 || chroma->pixel_size != 1) {
+    if (!chroma || chroma->plane_count != 3
+     || (chroma->pixel_size != 1 && chroma->pixel_size != 2)
+     || chroma->pixel_bits > 16) {
         msg_Err(filter, "Unsupported chroma (%4.4s)", (char*)&fourcc_in);
         return VLC_EGENERIC;
     }
@@ -132,21 +143,36 @@ static int Open(vlc_object_t *this)
     cfg = &sys->cfg;
 
     sys->chroma = chroma;
+    sys->bits = chroma->pixel_size == 1 ? 8 : chroma->pixel_bits;
+    sys->b_init = true;
 
+    /* The state is per plane, as the planes are filtered concurrently */
     for (int i = 0; i < 3; ++i) {
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-    }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
-        free(sys);
-        return VLC_ENOMEM;
+
+        size_t pixels = (size_t)sys->w[i] * sys->h[i];
+        cfg->Line[i] = malloc(sys->w[i] * sizeof(*cfg->Line[i]));
+        cfg->Frame[i] = malloc(pixels * sizeof(*cfg->Frame[i]));
+        cfg->Spatial[i] = malloc(pixels * sizeof(*cfg->Spatial[i]));
+        if (!cfg->Line[i] || !cfg->Frame[i] || !cfg->Spatial[i]) {
+            for (int j = 0; j <= i; ++j) {
+                free(cfg->Line[j]);
+                free(cfg->Frame[j]);
+                free(cfg->Spatial[j]);
+            }
+            free(sys);
+            return VLC_ENOMEM;
+        }
     }
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
 
+    sys->slices = vlc_slices_New(var_InheritInteger(filter,
+                                                    FILTER_PREFIX "threads"));
+    sys->horizontal = hqdn3d_GetHorizontal();
+    sys->vertical = hqdn3d_GetVertical();
 
     vlc_mutex_init( &sys->coefs_mutex );
     sys->b_recalc_coefs = true;
@@ -182,10 +208,12 @@ static void Close(vlc_object_t *this)
 
     vlc_mutex_destroy( &sys->coefs_mutex );
 
+    vlc_slices_Delete( sys->slices );
     for (int i = 0; i < 3; ++i) {
+        free(cfg->Line[i]);
         free(cfg->Frame[i]);
+        free(cfg->Spatial[i]);
     }
-    free(cfg->Line);
     free(sys);
 }
 
@@ -221,31 +249,26 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
-    {
-        picture_Release( src );
-        picture_Release( dst );
-        return NULL;
+    hqdn3d_job_t job = {
+        .priv = cfg,
+        .bits = sys->bits,
+        .init = sys->b_init,
+        .horizontal = sys->horizontal,
+        .vertical = sys->vertical,
+    };
+
+    for (int i = 0; i < 3; ++i) {
+        job.planes[i].src = src->p[i].p_pixels;
+        job.planes[i].src_pitch = src->p[i].i_pitch;
+        job.planes[i].dst = dst->p[i].p_pixels;
+        job.planes[i].dst_pitch = dst->p[i].i_pitch;
+        job.planes[i].w = sys->w[i];
+        job.planes[i].h = sys->h[i];
+        job.planes[i].spatial_coefs = cfg->Coefs[i == 0 ? 0 : 2];
+        job.planes[i].temporal_coefs = cfg->Coefs[i == 0 ? 1 : 3];
     }
+    hqdn3d_Run(sys->slices, &job);
+    sys->b_init = false;
 
     return CopyInfoAndRelease(dst, src);
 }
@@ -24,160 +24,480 @@
 #include <inttypes.h>
 #include <math.h>
 
+#include <vlc_cpu.h>
+#include <vlc_slices.h>
+
 #define PARAM1_DEFAULT 4.0
 #define PARAM2_DEFAULT 3.0
 #define PARAM3_DEFAULT 6.0
 
 //===========================================================================//
 
+/*
+ * The filter is the cascade of three first order low-pass filters: along the
+ * rows (horizontal), then along the columns (vertical), then along the time
+ * (temporal). Each one only depends on its own previous output, so that:
+ *  - the horizontal pass is independent for each row,
+ *  - the vertical and temporal passes are independent for each column.
+ * Hence the rows are split among threads for the first pass, and the columns
+ * for the second one.
+ *
+ * Samples are 8.16 fixed point numbers in the 8-bit range, whatever their
+ * depth, so that the same coefficients tables apply. The vector kernels look
+ * the coefficients up with gathers, and return exactly the same values as
+ * the scalar ones.
+ */
+
 struct vf_priv_s {
         int Coefs[4][512*16];
-        unsigned int *Line;
-        unsigned short *Frame[3];
+        unsigned int *Line[3];      /* vertical pass state, one row */
+        unsigned short *Frame[3];   /* temporal pass state, 8.8 */
+        unsigned int *Spatial[3];   /* horizontal pass output */
 };
 
+/* Coefficients outside of this range are zero, or out of the tables with
+ * more than 8 bits per sample (Coefs[][0] is the "enabled" flag). */
+#define HQDN3D_COEF_MIN (16)
+#define HQDN3D_COEF_MAX (16*511)
+
+static inline uint32_t hqdn3d_LowPass(uint32_t prev, uint32_t cur,
+                                      const int *coef)
+{
+    int d = ((int)(prev - cur) + 0x10007FF) >> 12;
 
-/***************************************************************************/
+    return cur + coef[VLC_CLIP(d, HQDN3D_COEF_MIN, HQDN3D_COEF_MAX)];
+}
 
-static /*inline*/ unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul, int* Coef){
-//    int dMul= (PrevMul&0xFFFFFF)-(CurrMul&0xFFFFFF);
-    int dMul= PrevMul-CurrMul;
-    unsigned int d=((dMul+0x10007FF)>>12);
-    return CurrMul + Coef[d];
+static inline uint32_t hqdn3d_Load(const uint8_t *p, int x, unsigned bits)
+{
+    if (bits == 8)
+        return p[x] << 16;
+    return ((const uint16_t *)p)[x] << (24 - bits);
 }
 
-static void deNoiseTemporal(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned short *FrameAnt,
-                    int W, int H, int sStride, int dStride,
-                    int *Temporal)
+static inline void hqdn3d_Store(uint8_t *p, int x, uint32_t v, unsigned bits)
 {
-    unsigned int PixelDst;
+    if (bits == 8)
+        p[x] = (v + 0x10007FFF) >> 16;
+    else
+    {
+        int32_t s = ((int32_t)v + (1 << (23 - bits)) - 1) >> (24 - bits);
+        ((uint16_t *)p)[x] = VLC_CLIP(s, 0, (1 << bits) - 1);
+    }
+}
 
-    for (long Y = 0; Y < H; Y++){
-        for (long X = 0; X < W; X++){
-            PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
-            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-        }
-        Frame += sStride;
-        FrameDest += dStride;
-        FrameAnt += W;
+/**
+ * Horizontal pass of rows: spatial[y][x] is the filtered row.
+ */
+typedef void (*hqdn3d_horizontal_t)(uint32_t *spatial, const uint8_t *src,
+                                    ptrdiff_t src_pitch, int w, int h,
+                                    unsigned bits, const int *coef);
+
+/**
+ * Vertical and temporal passes of the columns [x0, x1) of a whole plane.
+ * spatial is NULL without the spatial passes, temporal is NULL without the
+ * temporal one. If init is set, the temporal state is initialized from the
+ * source, as for the first picture.
+ */
+typedef void (*hqdn3d_vertical_t)(uint8_t *dst, ptrdiff_t dst_pitch,
+                                  const uint8_t *src, ptrdiff_t src_pitch,
+                                  const uint32_t *spatial, uint32_t *line,
+                                  uint16_t *ant, int w, int h, int x0, int x1,
+                                  unsigned bits, bool init,
+                                  const int *vertical, const int *temporal);
+
+/*** Scalar ***/
+static inline void hqdn3d_horizontal_row_c(uint32_t *spatial,
+                                           const uint8_t *src, int x, int w,
+                                           uint32_t ant, unsigned bits,
+                                           const int *coef)
+{
+    for (; x < w; x++)
+        spatial[x] = ant = hqdn3d_LowPass(ant, hqdn3d_Load(src, x, bits),
+                                          coef);
+}
+
+static inline void hqdn3d_horizontal_c(uint32_t *spatial, const uint8_t *src,
+                                       ptrdiff_t src_pitch, int w, int h,
+                                       unsigned bits, const int *coef)
+{
+    for (int y = 0; y < h; y++)
+    {
+        /* First pixel on each line doesn't have previous pixel */
+        spatial[0] = hqdn3d_Load(src, 0, bits);
+        hqdn3d_horizontal_row_c(spatial, src, 1, w, spatial[0], bits, coef);
+        spatial += w;
+        src += src_pitch;
     }
 }
 
-static void deNoiseSpacial(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+/* Without the temporal pass, the former implementation filters each sample
+ * of the first row against the first sample, rather than against the
+ * previous filtered one. Keep that for identical output. */
+static inline void hqdn3d_horizontal_first_c(uint32_t *spatial,
+                                             const uint8_t *src, int w,
+                                             unsigned bits, const int *coef)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
+    spatial[0] = hqdn3d_Load(src, 0, bits);
+    for (int x = 1; x < w; x++)
+        spatial[x] = hqdn3d_LowPass(spatial[0], hqdn3d_Load(src, x, bits),
+                                    coef);
+}
 
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+static inline void hqdn3d_vertical_px_c(uint8_t *dst, const uint8_t *src,
+                                        const uint32_t *spatial,
+                                        uint32_t *line, uint16_t *ant,
+                                        int x, int y, unsigned bits, bool init,
+                                        const int *vertical,
+                                        const int *temporal)
+{
+    uint32_t cur = hqdn3d_Load(src, x, bits);
 
-    /* First line has no top neighbor, only left. */
-    for (long X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    if (init)
+        ant[x] = cur >> 8;
+    if (spatial != NULL)
+    {
+        /* First line has no top neighbor */
+        line[x] = (y == 0) ? spatial[x]
+                           : hqdn3d_LowPass(line[x], spatial[x], vertical);
+        cur = line[x];
+    }
+    if (temporal != NULL)
+    {
+        cur = hqdn3d_LowPass(ant[x] << 8, cur, temporal);
+        ant[x] = (cur + 0x1000007F) >> 8;
     }
+    hqdn3d_Store(dst, x, cur, bits);
+}
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
-        }
+static inline void hqdn3d_vertical_c(uint8_t *dst, ptrdiff_t dst_pitch,
+                                     const uint8_t *src, ptrdiff_t src_pitch,
+                                     const uint32_t *spatial, uint32_t *line,
+                                     uint16_t *ant, int w, int h,
+                                     int x0, int x1, unsigned bits, bool init,
+                                     const int *vertical, const int *temporal)
+{
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = x0; x < x1; x++)
+            hqdn3d_vertical_px_c(dst, src, spatial, line, ant, x, y, bits,
+                                 init, vertical, temporal);
+        dst += dst_pitch;
+        src += src_pitch;
+        if (spatial != NULL)
+            spatial += w;
+        ant += w;
     }
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
-{
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
-
-    if(!FrameAnt){
-        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
-        if(!FrameAnt)
-            return;
-        for (long Y = 0; Y < H; Y++){
-            unsigned short* dst=&FrameAnt[Y*W];
-            unsigned char* src=Frame+Y*sStride;
-            for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
-        }
+/*** x86 ***/
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+# define HQDN3D_SIMD_X86 1
+
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i hqdn3d_LowPass_avx2(__m256i prev, __m256i cur,
+                                          const int *coef)
+{
+    __m256i d = _mm256_add_epi32(_mm256_sub_epi32(prev, cur),
+                                 _mm256_set1_epi32(0x10007FF));
+
+    d = _mm256_srai_epi32(d, 12);
+    d = _mm256_max_epi32(d, _mm256_set1_epi32(HQDN3D_COEF_MIN));
+    d = _mm256_min_epi32(d, _mm256_set1_epi32(HQDN3D_COEF_MAX));
+    return _mm256_add_epi32(cur, _mm256_i32gather_epi32(coef, d, 4));
+}
+
+/* 8 samples as 8.16 fixed point */
+__attribute__ ((__target__ ("avx2")))
+static inline __m256i hqdn3d_Load_avx2(const uint8_t *p, int x, unsigned bits)
+{
+    if (bits == 8)
+        return _mm256_slli_epi32(_mm256_cvtepu8_epi32(
+                   _mm_loadl_epi64((const __m128i *)&p[x])), 16);
+    return _mm256_sll_epi32(_mm256_cvtepu16_epi32(
+               _mm_loadu_si128((const __m128i *)&((const uint16_t *)p)[x])),
+               _mm_cvtsi32_si128(24 - bits));
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void hqdn3d_Store_avx2(uint8_t *p, int x, __m256i v,
+                                     unsigned bits)
+{
+    if (bits == 8)
+    {
+        v = _mm256_add_epi32(v, _mm256_set1_epi32(0x10007FFF));
+        v = _mm256_and_si256(_mm256_srli_epi32(v, 16),
+                             _mm256_set1_epi32(0xFF));
+        v = _mm256_packus_epi32(v, v);
+        v = _mm256_packus_epi16(v, v);
+        v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 0, 0,
+                                                             0, 0, 0, 0));
+        _mm_storel_epi64((__m128i *)&p[x], _mm256_castsi256_si128(v));
+    }
+    else
+    {
+        v = _mm256_add_epi32(v, _mm256_set1_epi32((1 << (23 - bits)) - 1));
+        v = _mm256_sra_epi32(v, _mm_cvtsi32_si128(24 - bits));
+        v = _mm256_max_epi32(v, _mm256_setzero_si256());
+        v = _mm256_min_epi32(v, _mm256_set1_epi32((1 << bits) - 1));
+        v = _mm256_packus_epi32(v, v);
+        v = _mm256_permute4x64_epi64(v, 0x08);
+        _mm_storeu_si128((__m128i *)&((uint16_t *)p)[x],
+                         _mm256_castsi256_si128(v));
     }
+}
+
+__attribute__ ((__target__ ("avx2")))
+static inline void hqdn3d_Transpose_avx2(__m256i r[8])
+{
+    __m256i t[8], u[8];
 
-    if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
-        return;
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
     }
-    if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
-        return;
+    for (int i = 0; i < 4; i++)
+    {
+        r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
     }
+}
+
+/* The rows are filtered 8 at a time, one per lane, in blocks of 8x8 samples
+ * transposed in and out of the lanes. */
+__attribute__ ((__target__ ("avx2")))
+static inline void hqdn3d_horizontal_avx2(uint32_t *spatial,
+                                          const uint8_t *src,
+                                          ptrdiff_t src_pitch, int w, int h,
+                                          unsigned bits, const int *coef)
+{
+    int y = 0;
 
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (long X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    for (; y + 8 <= h && w >= 8; y += 8)
+    {
+        __m256i ant = _mm256_setzero_si256();
+        int x = 0;
+
+        for (; x + 8 <= w; x += 8)
+        {
+            __m256i r[8];
+
+            for (int i = 0; i < 8; i++)
+                r[i] = hqdn3d_Load_avx2(src + i * src_pitch, x, bits);
+            hqdn3d_Transpose_avx2(r);
+
+            int j = 0;
+            if (x == 0) /* First pixel on each line has no previous pixel */
+                ant = r[j++];
+            for (; j < 8; j++)
+                r[j] = ant = hqdn3d_LowPass_avx2(ant, r[j], coef);
+
+            hqdn3d_Transpose_avx2(r);
+            for (int i = 0; i < 8; i++)
+                _mm256_storeu_si256((__m256i *)&spatial[i * w + x], r[i]);
+        }
+
+        if (x < w)
+        {
+            uint32_t ants[8];
+
+            _mm256_storeu_si256((__m256i *)ants, ant);
+            for (int i = 0; i < 8; i++)
+                hqdn3d_horizontal_row_c(spatial + i * w, src + i * src_pitch,
+                                        x, w, ants[i], bits, coef);
+        }
+        spatial += 8 * w;
+        src += 8 * src_pitch;
     }
+    hqdn3d_horizontal_c(spatial, src, src_pitch, w, h - y, bits, coef);
+}
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
-        unsigned short* LinePrev=&FrameAnt[Y*W];
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+__attribute__ ((__target__ ("avx2")))
+static inline void hqdn3d_vertical_avx2(uint8_t *dst, ptrdiff_t dst_pitch,
+                                        const uint8_t *src,
+                                        ptrdiff_t src_pitch,
+                                        const uint32_t *spatial,
+                                        uint32_t *line, uint16_t *ant,
+                                        int w, int h, int x0, int x1,
+                                        unsigned bits, bool init,
+                                        const int *vertical,
+                                        const int *temporal)
+{
+    const __m256i round = _mm256_set1_epi32(0x1000007F);
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+
+    for (int y = 0; y < h; y++)
+    {
+        int x = x0;
+
+        for (; x + 8 <= x1; x += 8)
+        {
+            __m256i cur = hqdn3d_Load_avx2(src, x, bits);
+            __m128i *pant = (__m128i *)&ant[x];
+
+            if (init)
+                _mm_storeu_si128(pant, _mm256_castsi256_si128(
+                    _mm256_permute4x64_epi64(_mm256_packus_epi32(
+                        _mm256_srli_epi32(cur, 8), cur), 0x08)));
+            if (spatial != NULL)
+            {
+                __m256i s = _mm256_loadu_si256((const __m256i *)&spatial[x]);
+
+                if (y > 0)
+                    s = hqdn3d_LowPass_avx2(
+                        _mm256_loadu_si256((const __m256i *)&line[x]), s,
+                        vertical);
+                _mm256_storeu_si256((__m256i *)&line[x], s);
+                cur = s;
+            }
+            if (temporal != NULL)
+            {
+                __m256i prev = _mm256_slli_epi32(
+                    _mm256_cvtepu16_epi32(_mm_loadu_si128(pant)), 8);
+                __m256i a;
+
+                cur = hqdn3d_LowPass_avx2(prev, cur, temporal);
+                a = _mm256_and_si256(_mm256_srli_epi32(
+                        _mm256_add_epi32(cur, round), 8), mask);
+                a = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, a), 0x08);
+                _mm_storeu_si128(pant, _mm256_castsi256_si128(a));
+            }
+            hqdn3d_Store_avx2(dst, x, cur, bits);
         }
+        for (; x < x1; x++)
+            hqdn3d_vertical_px_c(dst, src, spatial, line, ant, x, y, bits,
+                                 init, vertical, temporal);
+
+        dst += dst_pitch;
+        src += src_pitch;
+        if (spatial != NULL)
+            spatial += w;
+        ant += w;
     }
 }
+#endif
+
+static inline hqdn3d_horizontal_t hqdn3d_GetHorizontal(void)
+{
+#ifdef HQDN3D_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return hqdn3d_horizontal_avx2;
+#endif
+    return hqdn3d_horizontal_c;
+}
+
+static inline hqdn3d_vertical_t hqdn3d_GetVertical(void)
+{
+#ifdef HQDN3D_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return hqdn3d_vertical_avx2;
+#endif
+    return hqdn3d_vertical_c;
+}
 
+//===========================================================================//
+
+/**
+ * One picture of the filter, for all planes.
+ */
+typedef struct
+{
+    struct
+    {
+        const uint8_t *src;
+        ptrdiff_t src_pitch;
+        uint8_t *dst;
+        ptrdiff_t dst_pitch;
+        int w, h;
+        const int *spatial_coefs;
+        const int *temporal_coefs;
+    } planes[3];
+    struct vf_priv_s *priv;
+    unsigned bits;
+    bool init;
+    hqdn3d_horizontal_t horizontal;
+    hqdn3d_vertical_t vertical;
+} hqdn3d_job_t;
+
+/* Same choice of passes as the original implementation: spatial only if
+ * the temporal strength is zero, temporal only if the spatial one is. */
+static inline bool hqdn3d_HasSpatial(const hqdn3d_job_t *job, int i)
+{
+    return job->planes[i].spatial_coefs[0] != 0;
+}
+
+static inline bool hqdn3d_HasTemporal(const hqdn3d_job_t *job, int i)
+{
+    return !hqdn3d_HasSpatial(job, i) || job->planes[i].temporal_coefs[0];
+}
+
+/* Bands of rows, of 8 rows for the vector kernel */
+static void hqdn3d_SliceHorizontal(void *opaque, unsigned index,
+                                   unsigned count)
+{
+    hqdn3d_job_t *job = opaque;
+
+    for (int i = 0; i < 3; i++)
+    {
+        unsigned start, end;
+
+        if (!hqdn3d_HasSpatial(job, i))
+            continue;
+        vlc_slices_Rows(index, count, job->planes[i].h, 8, &start, &end);
+        job->horizontal(job->priv->Spatial[i] + start * job->planes[i].w,
+                        job->planes[i].src + start * job->planes[i].src_pitch,
+                        job->planes[i].src_pitch, job->planes[i].w,
+                        end - start, job->bits, job->planes[i].spatial_coefs);
+        if (start == 0 && !hqdn3d_HasTemporal(job, i))
+            hqdn3d_horizontal_first_c(job->priv->Spatial[i], job->planes[i].src,
+                                      job->planes[i].w, job->bits,
+                                      job->planes[i].spatial_coefs);
+    }
+}
+
+/* Bands of columns, of whole cache lines of the temporal state */
+static void hqdn3d_SliceVertical(void *opaque, unsigned index, unsigned count)
+{
+    hqdn3d_job_t *job = opaque;
+
+    for (int i = 0; i < 3; i++)
+    {
+        unsigned start, end;
+        bool spatial = hqdn3d_HasSpatial(job, i);
+
+        vlc_slices_Rows(index, count, job->planes[i].w, 32, &start, &end);
+        job->vertical(job->planes[i].dst, job->planes[i].dst_pitch,
+                      job->planes[i].src, job->planes[i].src_pitch,
+                      spatial ? job->priv->Spatial[i] : NULL,
+                      job->priv->Line[i], job->priv->Frame[i],
+                      job->planes[i].w, job->planes[i].h, start, end,
+                      job->bits, job->init, job->planes[i].spatial_coefs,
+                      hqdn3d_HasTemporal(job, i) ? job->planes[i].temporal_coefs
+                                                 : NULL);
+    }
+}
+
+static inline void hqdn3d_Run(vlc_slices_t *slices, hqdn3d_job_t *job)
+{
+    unsigned count = vlc_slices_Count(slices);
+
+    for (int i = 0; i < 3; i++)
+        if (hqdn3d_HasSpatial(job, i))
+        {
+            vlc_slices_Run(slices, count, hqdn3d_SliceHorizontal, job);
+            break;
+        }
+    vlc_slices_Run(slices, count, hqdn3d_SliceVertical, job);
+}
 
 //===========================================================================//
 
@@ -0,0 +1,404 @@
+/*****************************************************************************
+ * mcdenoise.c : motion compensated temporal denoiser
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_slices.h>
+#include "filter_picture.h"
+#include "motion_search.h"
+
+/*
+ * Each picture is averaged with the previous output picture, moved along the
+ * motion of each 8x8 luma block. This is a first order recursive filter along
+ * the motion trajectories, so that still and moving noise are both reduced,
+ * without the trails of a plain temporal filter.
+ *
+ * The weight of the previous picture decreases linearly with the difference
+ * of each pixel, down to zero at the threshold, and blocks that were not
+ * matched well enough are not averaged at all. The rows of blocks are
+ * searched and filtered concurrently.
+ */
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define FILTER_PREFIX "mcdenoise-"
+
+#define STRENGTH_TEXT N_("Strength")
+#define STRENGTH_LONGTEXT N_("Weight of the previous picture for unchanged " \
+    "pixels (0-1). Higher values remove more noise.")
+#define LUMA_THRESHOLD_TEXT N_("Luma threshold")
+#define LUMA_THRESHOLD_LONGTEXT N_("Luma difference above which pixels " \
+    "are not averaged. It should be above the noise level.")
+#define CHROMA_THRESHOLD_TEXT N_("Chroma threshold")
+#define CHROMA_THRESHOLD_LONGTEXT N_("Chroma difference above which pixels " \
+    "are not averaged.")
+#define RANGE_TEXT N_("Search range")
+#define RANGE_LONGTEXT N_("Maximum motion between two pictures, in pixels.")
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads used to filter each " \
+    "picture (0 = one per CPU, 1 = no threading).")
+
+vlc_module_begin ()
+    set_shortname( N_("MC Denoiser") )
+    set_description( N_("Motion compensated temporal denoiser") )
+    set_capability( "video filter", 0 )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+
+    add_float_with_range( FILTER_PREFIX "strength", 0.6, 0.0, 1.0,
+                          STRENGTH_TEXT, STRENGTH_LONGTEXT, false )
+    add_integer_with_range( FILTER_PREFIX "luma-threshold", 12, 1, 255,
+                            LUMA_THRESHOLD_TEXT, LUMA_THRESHOLD_LONGTEXT,
+                            false )
+    add_integer_with_range( FILTER_PREFIX "chroma-threshold", 8, 1, 255,
+                            CHROMA_THRESHOLD_TEXT, CHROMA_THRESHOLD_LONGTEXT,
+                            false )
+    add_integer_with_range( FILTER_PREFIX "range", 16, 1, 64,
+                            RANGE_TEXT, RANGE_LONGTEXT, true )
+    add_integer_with_range( FILTER_PREFIX "threads", 0, 0, 16,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
+
+    add_shortcut( "mcdenoise" )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+static const char *const filter_options[] = {
+    "strength", "luma-threshold", "chroma-threshold", "range", "threads",
+    NULL
+};
+
+/*****************************************************************************
+ * Blending kernels
+ *****************************************************************************/
+
+/* The weight of the previous picture is (max(t - |r - c|, 0) * k) >> 8, out
+ * of 256, with k = 65536 * strength / t. */
+typedef void (*mcdenoise_blend_t)(uint8_t *dst, const uint8_t *cur,
+                                  const uint8_t *ref, int w,
+                                  unsigned t, unsigned k);
+
+static void BlendC(uint8_t *dst, const uint8_t *cur, const uint8_t *ref,
+                   int w, unsigned t, unsigned k)
+{
+    for (int x = 0; x < w; x++)
+    {
+        unsigned d = abs(cur[x] - ref[x]);
+        unsigned wt = ((d < t ? t - d : 0) * k) >> 8;
+
+        dst[x] = (cur[x] * (256 - wt) + ref[x] * wt + 128) >> 8;
+    }
+}
+
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <immintrin.h>
+
+/* Same arithmetic on 16-bit lanes: no intermediate value exceeds 65535 */
+__attribute__ ((__target__ ("sse2")))
+static void BlendSSE2(uint8_t *dst, const uint8_t *cur, const uint8_t *ref,
+                      int w, unsigned t, unsigned k)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vt = _mm_set1_epi16(t);
+    const __m128i vk = _mm_set1_epi16(k);
+    const __m128i one = _mm_set1_epi16(256);
+    const __m128i round = _mm_set1_epi16(128);
+    int x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        __m128i c = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)&cur[x]), zero);
+        __m128i r = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)&ref[x]), zero);
+        __m128i d = _mm_or_si128(_mm_subs_epu16(c, r), _mm_subs_epu16(r, c));
+        __m128i wt = _mm_mulhi_epu16(_mm_slli_epi16(_mm_subs_epu16(vt, d), 8),
+                                     vk);
+        __m128i o = _mm_add_epi16(_mm_mullo_epi16(c, _mm_sub_epi16(one, wt)),
+                                  _mm_mullo_epi16(r, wt));
+
+        o = _mm_srli_epi16(_mm_add_epi16(o, round), 8);
+        _mm_storel_epi64((__m128i *)&dst[x], _mm_packus_epi16(o, o));
+    }
+    BlendC(dst + x, cur + x, ref + x, w - x, t, k);
+}
+#endif
+
+/*****************************************************************************
+ * filter_sys_t
+ *****************************************************************************/
+struct filter_sys_t
+{
+    const vlc_chroma_description_t *chroma;
+    picture_t *p_ref;           /* previous output picture */
+    bool b_ref;
+    me_vector_t *field[2];      /* vectors of the current and last picture */
+    vlc_slices_t *slices;
+    me_sad_t sad;
+    mcdenoise_blend_t blend;
+
+    int i_range;
+    unsigned threshold[2];      /* luma, chroma */
+    unsigned coef[2];
+};
+
+typedef struct
+{
+    filter_sys_t *sys;
+    const picture_t *src;
+    picture_t *dst;
+    me_search_t search;
+    me_vector_t *field;
+} mcdenoise_job_t;
+
+/*****************************************************************************
+ * Filtering
+ *****************************************************************************/
+static void CompensateBlock(const mcdenoise_job_t *job, int bx, int by,
+                            const me_vector_t *v)
+{
+    filter_sys_t *sys = job->sys;
+    const plane_t *luma = &job->src->p[Y_PLANE];
+    int x, y, w, h;
+
+    me_BlockArea(luma, bx, by, &x, &y, &w, &h);
+
+    /* Badly matched blocks would ghost, keep them as they are */
+    bool average = v->sad <= ME_BLOCK * ME_BLOCK * sys->threshold[0];
+
+    for (int i = 0; i < job->src->i_planes; i++)
+    {
+        const plane_t *src = &job->src->p[i];
+        const plane_t *ref = &sys->p_ref->p[i];
+        plane_t *dst = &job->dst->p[i];
+        const int wn = sys->chroma->p[i].w.num, wd = sys->chroma->p[i].w.den;
+        const int hn = sys->chroma->p[i].h.num, hd = sys->chroma->p[i].h.den;
+
+        /* The last blocks extend to the edges of the plane */
+        int px0 = x * wn / wd, py0 = y * hn / hd;
+        int px1 = (x + w == luma->i_visible_pitch) ? src->i_visible_pitch
+                                                   : (x + w) * wn / wd;
+        int py1 = (y + h == luma->i_visible_lines) ? src->i_visible_lines
+                                                   : (y + h) * hn / hd;
+        int vx = v->x * wn / wd, vy = v->y * hn / hd;
+
+        vx = VLC_CLIP(vx, -px0, src->i_visible_pitch - px1);
+        vy = VLC_CLIP(vy, -py0, src->i_visible_lines - py1);
+
+        const unsigned c = (i == Y_PLANE) ? 0 : 1;
+        for (int py = py0; py < py1; py++)
+        {
+            const uint8_t *s = &src->p_pixels[py * src->i_pitch + px0];
+            uint8_t *d = &dst->p_pixels[py * dst->i_pitch + px0];
+
+            if (average)
+                sys->blend(d, s, &ref->p_pixels[(py + vy) * ref->i_pitch
+                                                + px0 + vx],
+                           px1 - px0, sys->threshold[c], sys->coef[c]);
+            else
+                memcpy(d, s, px1 - px0);
+        }
+    }
+}
+
+static void Slice(void *opaque, unsigned index, unsigned count)
+{
+    const mcdenoise_job_t *job = opaque;
+    const int bw = me_BlocksX(job->search.cur);
+    unsigned start, end;
+
+    vlc_slices_Rows(index, count, me_BlocksY(job->search.cur), 1,
+                    &start, &end);
+    for (unsigned by = start; by < end; by++)
+    {
+        me_SearchRow(&job->search, by, job->field);
+        for (int bx = 0; bx < bw; bx++)
+            CompensateBlock(job, bx, by, &job->field[by * bw + bx]);
+    }
+}
+
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic )
+        return NULL;
+
+    picture_t *p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    if( !p_sys->b_ref )
+    {
+        picture_CopyPixels( p_outpic, p_pic );
+        p_sys->b_ref = true;
+        memset( p_sys->field[1], 0, sizeof(me_vector_t)
+                * me_BlocksX( &p_pic->p[Y_PLANE] )
+                * me_BlocksY( &p_pic->p[Y_PLANE] ) );
+    }
+    else
+    {
+        mcdenoise_job_t job = {
+            .sys = p_sys,
+            .src = p_pic,
+            .dst = p_outpic,
+            .search = {
+                .cur = &p_pic->p[Y_PLANE],
+                .ref = &p_sys->p_ref->p[Y_PLANE],
+                .prev = p_sys->field[1],
+                .range = p_sys->i_range,
+                .sad = p_sys->sad,
+            },
+            .field = p_sys->field[0],
+        };
+
+        vlc_slices_Run( p_sys->slices, vlc_slices_Count( p_sys->slices ),
+                        Slice, &job );
+
+        me_vector_t *tmp = p_sys->field[0];
+        p_sys->field[0] = p_sys->field[1];
+        p_sys->field[1] = tmp;
+    }
+
+    /* The output is the reference of the next picture */
+    picture_CopyPixels( p_sys->p_ref, p_outpic );
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
+
+static void Flush( filter_t *p_filter )
+{
+    p_filter->p_sys->b_ref = false;
+}
+
+/*****************************************************************************
+ * Open
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    const video_format_t *p_fmt = &p_filter->fmt_in.video;
+    filter_sys_t *p_sys;
+
+    const vlc_chroma_description_t *p_chroma =
+        vlc_fourcc_GetChromaDescription( p_fmt->i_chroma );
+    if( !p_chroma || p_chroma->plane_count != 3 || p_chroma->pixel_size != 1 )
+    {
+        msg_Err( p_filter, "Unsupported chroma (%4.4s)",
+                 (char*)&p_fmt->i_chroma );
+        return VLC_EGENERIC;
+    }
+    if( p_fmt->i_chroma != p_filter->fmt_out.video.i_chroma )
+    {
+        msg_Err( p_filter, "Input and output chromas don't match" );
+        return VLC_EGENERIC;
+    }
+    if( p_fmt->i_visible_width < ME_BLOCK
+     || p_fmt->i_visible_height < ME_BLOCK )
+        return VLC_EGENERIC;
+
+    p_sys = calloc( 1, sizeof(*p_sys) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    size_t blocks = (p_fmt->i_visible_width / ME_BLOCK)
+                  * (p_fmt->i_visible_height / ME_BLOCK);
+    p_sys->chroma = p_chroma;
+    p_sys->p_ref = picture_NewFromFormat( p_fmt );
+    p_sys->field[0] = malloc( blocks * sizeof(me_vector_t) );
+    p_sys->field[1] = malloc( blocks * sizeof(me_vector_t) );
+    if( !p_sys->p_ref || !p_sys->field[0] || !p_sys->field[1] )
+    {
+        free( p_sys->field[1] );
+        free( p_sys->field[0] );
+        if( p_sys->p_ref )
+            picture_Release( p_sys->p_ref );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    config_ChainParse( p_filter, FILTER_PREFIX, filter_options,
+                       p_filter->p_cfg );
+
+    float f_strength = var_InheritFloat( p_filter, FILTER_PREFIX "strength" );
+    f_strength = VLC_CLIP( f_strength, 0.f, 1.f );
+    p_sys->threshold[0] = var_InheritInteger( p_filter,
+                                              FILTER_PREFIX "luma-threshold" );
+    p_sys->threshold[1] = var_InheritInteger( p_filter,
+                                              FILTER_PREFIX "chroma-threshold" );
+    for( int i = 0; i < 2; i++ )
+    {
+        p_sys->threshold[i] = VLC_CLIP( p_sys->threshold[i], 1, 255 );
+        p_sys->coef[i] = __MIN( lroundf( 65536.f * f_strength
+                                         / p_sys->threshold[i] ), 65535 );
+    }
+    p_sys->i_range = var_InheritInteger( p_filter, FILTER_PREFIX "range" );
+    p_sys->slices = vlc_slices_New( var_InheritInteger( p_filter,
+                                                FILTER_PREFIX "threads" ) );
+
+    p_sys->sad = me_GetSAD();
+    p_sys->blend = BlendC;
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+    if( vlc_CPU_SSE2() )
+        p_sys->blend = BlendSSE2;
+#endif
+
+    msg_Dbg( p_filter, "strength %.2f, thresholds %u/%u, range %d, "
+             "%u thread(s)", f_strength, p_sys->threshold[0],
+             p_sys->threshold[1], p_sys->i_range,
+             vlc_slices_Count( p_sys->slices ) );
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_video_filter = Filter;
+    p_filter->pf_flush = Flush;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Close
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_slices_Delete( p_sys->slices );
+    free( p_sys->field[1] );
+    free( p_sys->field[0] );
+    picture_Release( p_sys->p_ref );
+    free( p_sys );
+}
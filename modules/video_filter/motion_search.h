@@ -0,0 +1,314 @@
+/*****************************************************************************
+ * motion_search.h : block matching motion estimation kernels
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_MOTION_SEARCH_H
+#define VLC_VIDEO_FILTER_MOTION_SEARCH_H
+
+#include <limits.h>
+#include <stdlib.h>
+#include <vlc_cpu.h>
+#include <vlc_picture.h>
+
+/*
+ * Integer pixel motion estimation of the 8x8 blocks of an 8-bit plane.
+ *
+ * Each block is matched against a reference plane, starting from the best of
+ * a few predictors (no motion, the block on the left, and the neighbours in
+ * the field of the previous picture), then refined with diamond patterns of
+ * decreasing size. The search of a block only depends on the blocks on its
+ * left, so that the rows of blocks can be searched concurrently, and the
+ * results do not depend on the number of threads.
+ *
+ * The vector kernels return exactly the same values as the scalar ones.
+ */
+
+#define ME_BLOCK  8
+#define ME_LAMBDA 4     /* cost of one pixel of vector length */
+
+typedef struct
+{
+    int16_t x, y;
+    unsigned sad;       /* sum of absolute differences of the 8x8 block */
+} me_vector_t;
+
+/** Sum of absolute differences of two 8x8 blocks */
+typedef unsigned (*me_sad_t)(const uint8_t *a, ptrdiff_t a_pitch,
+                             const uint8_t *b, ptrdiff_t b_pitch);
+/** Absolute differences of two rows of pixels */
+typedef void (*me_absdiff_t)(uint32_t *dst, const uint8_t *a,
+                             const uint8_t *b, int w);
+
+/*** Scalar ***/
+static inline unsigned me_sad_c(const uint8_t *a, ptrdiff_t a_pitch,
+                                const uint8_t *b, ptrdiff_t b_pitch)
+{
+    unsigned sad = 0;
+
+    for (int y = 0; y < ME_BLOCK; y++, a += a_pitch, b += b_pitch)
+        for (int x = 0; x < ME_BLOCK; x++)
+            sad += abs(a[x] - b[x]);
+    return sad;
+}
+
+static inline void me_absdiff_c(uint32_t *dst, const uint8_t *a,
+                                const uint8_t *b, int w)
+{
+    for (int x = 0; x < w; x++)
+        dst[x] = abs(a[x] - b[x]);
+}
+
+/*** x86 ***/
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# define ME_SIMD_X86 1
+# include <immintrin.h>
+
+__attribute__ ((__target__ ("sse2")))
+static inline unsigned me_sad_sse2(const uint8_t *a, ptrdiff_t a_pitch,
+                                   const uint8_t *b, ptrdiff_t b_pitch)
+{
+    __m128i acc = _mm_setzero_si128();
+
+    /* two rows per register */
+    for (int y = 0; y < ME_BLOCK; y += 2, a += 2 * a_pitch, b += 2 * b_pitch)
+    {
+        __m128i va = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i *)a),
+            _mm_loadl_epi64((const __m128i *)(a + a_pitch)));
+        __m128i vb = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i *)b),
+            _mm_loadl_epi64((const __m128i *)(b + b_pitch)));
+
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+    return _mm_cvtsi128_si32(acc);
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void me_absdiff_sse2(uint32_t *dst, const uint8_t *a,
+                                   const uint8_t *b, int w)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    for (; x + 16 <= w; x += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *)&a[x]);
+        __m128i vb = _mm_loadu_si128((const __m128i *)&b[x]);
+        __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        __m128i lo = _mm_unpacklo_epi8(d, zero);
+        __m128i hi = _mm_unpackhi_epi8(d, zero);
+
+        _mm_storeu_si128((__m128i *)&dst[x],
+                         _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128((__m128i *)&dst[x + 4],
+                         _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128((__m128i *)&dst[x + 8],
+                         _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128((__m128i *)&dst[x + 12],
+                         _mm_unpackhi_epi16(hi, zero));
+    }
+    me_absdiff_c(dst + x, a + x, b + x, w - x);
+}
+#endif
+
+/*** ARM ***/
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+# define ME_SIMD_NEON 1
+# include <arm_neon.h>
+
+static inline unsigned me_sad_neon(const uint8_t *a, ptrdiff_t a_pitch,
+                                   const uint8_t *b, ptrdiff_t b_pitch)
+{
+    uint16x8_t acc = vdupq_n_u16(0);
+
+    for (int y = 0; y < ME_BLOCK; y++, a += a_pitch, b += b_pitch)
+        acc = vabal_u8(acc, vld1_u8(a), vld1_u8(b));
+
+    uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+    return vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+}
+
+static inline void me_absdiff_neon(uint32_t *dst, const uint8_t *a,
+                                   const uint8_t *b, int w)
+{
+    int x = 0;
+
+    for (; x + 8 <= w; x += 8)
+    {
+        uint16x8_t d = vabdl_u8(vld1_u8(&a[x]), vld1_u8(&b[x]));
+
+        vst1q_u32(&dst[x], vmovl_u16(vget_low_u16(d)));
+        vst1q_u32(&dst[x + 4], vmovl_u16(vget_high_u16(d)));
+    }
+    me_absdiff_c(dst + x, a + x, b + x, w - x);
+}
+#endif
+
+/*** Selection ***/
+static inline me_sad_t me_GetSAD(void)
+{
+#ifdef ME_SIMD_X86
+    if (vlc_CPU_SSE2())
+        return me_sad_sse2;
+#endif
+#ifdef ME_SIMD_NEON
+    return me_sad_neon;
+#endif
+    return me_sad_c;
+}
+
+static inline me_absdiff_t me_GetAbsDiff(void)
+{
+#ifdef ME_SIMD_X86
+    if (vlc_CPU_SSE2())
+        return me_absdiff_sse2;
+#endif
+#ifdef ME_SIMD_NEON
+    return me_absdiff_neon;
+#endif
+    return me_absdiff_c;
+}
+
+/*** Search ***/
+
+/**
+ * Block matching parameters, shared by all the rows of one search.
+ */
+typedef struct
+{
+    const plane_t *cur;         /**< plane of the blocks to match */
+    const plane_t *ref;         /**< plane to look for them in */
+    const me_vector_t *prev;    /**< field of the previous search, or NULL */
+    int range;                  /**< maximum vector length on each axis */
+    me_sad_t sad;
+} me_search_t;
+
+static inline int me_BlocksX(const plane_t *p)
+{
+    return p->i_visible_pitch / ME_BLOCK;
+}
+
+static inline int me_BlocksY(const plane_t *p)
+{
+    return p->i_visible_lines / ME_BLOCK;
+}
+
+/**
+ * Pixels of the plane covered by a block, the last blocks of the rows and
+ * columns extend to the edges of the plane.
+ */
+static inline void me_BlockArea(const plane_t *p, int bx, int by,
+                                int *x, int *y, int *w, int *h)
+{
+    *x = bx * ME_BLOCK;
+    *y = by * ME_BLOCK;
+    *w = (bx == me_BlocksX(p) - 1) ? p->i_visible_pitch - *x : ME_BLOCK;
+    *h = (by == me_BlocksY(p) - 1) ? p->i_visible_lines - *y : ME_BLOCK;
+}
+
+typedef struct
+{
+    const uint8_t *block;
+    int x, y;
+    int min_x, max_x, min_y, max_y;
+    me_vector_t best;
+    unsigned cost;
+} me_block_t;
+
+static inline void me_Try(const me_search_t *s, me_block_t *b, int vx, int vy)
+{
+    if (vx < b->min_x || vx > b->max_x || vy < b->min_y || vy > b->max_y)
+        return;
+
+    const uint8_t *ref = s->ref->p_pixels + (b->y + vy) * s->ref->i_pitch
+                       + b->x + vx;
+    unsigned sad = s->sad(b->block, s->cur->i_pitch, ref, s->ref->i_pitch);
+    unsigned cost = sad + ME_LAMBDA * (abs(vx) + abs(vy));
+
+    if (cost < b->cost)
+    {
+        b->best.x = vx;
+        b->best.y = vy;
+        b->best.sad = sad;
+        b->cost = cost;
+    }
+}
+
+/**
+ * Searches the vectors of one row of blocks.
+ *
+ * \param field vectors of the whole plane, the row by is written
+ */
+static inline void me_SearchRow(const me_search_t *s, int by,
+                                me_vector_t *field)
+{
+    static const int8_t diamond[4][2] = { {0,-1}, {-1,0}, {1,0}, {0,1} };
+    const int bw = me_BlocksX(s->cur), bh = me_BlocksY(s->cur);
+    me_vector_t *row = &field[by * bw];
+
+    for (int bx = 0; bx < bw; bx++)
+    {
+        me_block_t b;
+        int w, h;
+
+        me_BlockArea(s->cur, bx, by, &b.x, &b.y, &w, &h);
+        b.block = s->cur->p_pixels + b.y * s->cur->i_pitch + b.x;
+        /* the whole block area must stay inside the reference */
+        b.min_x = __MAX(-s->range, -b.x);
+        b.max_x = __MIN(s->range, s->ref->i_visible_pitch - b.x - w);
+        b.min_y = __MAX(-s->range, -b.y);
+        b.max_y = __MIN(s->range, s->ref->i_visible_lines - b.y - h);
+        b.cost = UINT_MAX;
+
+        me_Try(s, &b, 0, 0);
+        if (bx > 0)
+            me_Try(s, &b, row[bx - 1].x, row[bx - 1].y);
+        if (s->prev != NULL)
+        {
+            const me_vector_t *p = &s->prev[by * bw + bx];
+
+            me_Try(s, &b, p->x, p->y);
+            if (bx + 1 < bw)
+                me_Try(s, &b, p[1].x, p[1].y);
+            if (by > 0)
+                me_Try(s, &b, p[-bw].x, p[-bw].y);
+            if (by + 1 < bh)
+                me_Try(s, &b, p[bw].x, p[bw].y);
+        }
+
+        for (int step = 4; step > 0; step /= 2)
+        {
+            me_vector_t center;
+
+            do
+            {
+                center = b.best;
+                for (int i = 0; i < 4; i++)
+                    me_Try(s, &b, center.x + step * diamond[i][0],
+                           center.y + step * diamond[i][1]);
+            }
+            while (b.best.x != center.x || b.best.y != center.y);
+        }
+        row[bx] = b.best;
+    }
+}
+
+#endif
@@ -35,6 +35,7 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
+#include "motion_search.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -73,6 +74,7 @@ struct filter_sys_t
     picture_t *p_old;
     uint32_t *p_buf;
     uint32_t *p_buf2;
+    me_absdiff_t absdiff;
 
     /* */
     int i_colors;
@@ -116,6 +118,7 @@ static int Create( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     p_sys->is_yuv_planar = is_yuv_planar;
+    p_sys->absdiff = me_GetAbsDiff();
     p_sys->b_old = false;
     p_sys->p_old = picture_NewFromFormat( p_fmt );
     p_sys->p_buf  = calloc( p_fmt->i_width * p_fmt->i_height, sizeof(*p_sys->p_buf) );
@@ -166,10 +169,9 @@ static void PreparePlanar( filter_t *p_filter, picture_t *p_inpic )
      * Substract Y planes
      */
     for( unsigned y = 0; y < p_fmt->i_height; y++ )
-    {
-        for( unsigned x = 0; x < p_fmt->i_width; x++ )
-            p_sys->p_buf2[y*p_fmt->i_width+x] = abs( p_inpix[y*i_src_pitch+x] - p_oldpix[y*i_old_pitch+x] );
-    }
+        p_sys->absdiff( &p_sys->p_buf2[y*p_fmt->i_width],
+                        &p_inpix[y*i_src_pitch], &p_oldpix[y*i_old_pitch],
+                        p_fmt->i_width );
 
     int i_chroma_dx;
     int i_chroma_dy;
@@ -30,8 +30,14 @@
 
 #include <vlc_common.h>
 #include <vlc_aout.h>
+#include <vlc_cpu.h>
 #include "aout_internal.h"
 
+#if defined(HAVE_SSE2_INTRINSICS) && (defined(__i386__) || defined(__x86_64__))
+# include <emmintrin.h>
+# define AOUT_SSE2_STEREO 1
+#endif
+
 /*
  * Formats management (internal and external)
  */
@@ -350,6 +356,40 @@ do { \
     }
 }
 
+#ifdef AOUT_SSE2_STEREO
+/* Stereo is by far the most common layout: (de)interleave 32-bits samples
+ * four at a time. The C loops below handle the remainder. */
+__attribute__ ((__target__ ("sse2")))
+static size_t Interleave2x32SSE2( uint32_t *restrict d, const uint32_t *l,
+                                  const uint32_t *r, size_t samples )
+{
+    size_t i = 0;
+    for( ; i + 4 <= samples; i += 4 )
+    {
+        __m128 a = _mm_loadu_ps( (const float *)(l + i) );
+        __m128 b = _mm_loadu_ps( (const float *)(r + i) );
+        _mm_storeu_ps( (float *)(d + 2 * i), _mm_unpacklo_ps( a, b ) );
+        _mm_storeu_ps( (float *)(d + 2 * i + 4), _mm_unpackhi_ps( a, b ) );
+    }
+    return i;
+}
+
+__attribute__ ((__target__ ("sse2")))
+static size_t Deinterleave2x32SSE2( uint32_t *restrict l, uint32_t *restrict r,
+                                    const uint32_t *s, size_t samples )
+{
+    size_t i = 0;
+    for( ; i + 4 <= samples; i += 4 )
+    {
+        __m128 a = _mm_loadu_ps( (const float *)(s + 2 * i) );
+        __m128 b = _mm_loadu_ps( (const float *)(s + 2 * i + 4) );
+        _mm_storeu_ps( (float *)(l + i), _mm_shuffle_ps( a, b, 0x88 ) );
+        _mm_storeu_ps( (float *)(r + i), _mm_shuffle_ps( a, b, 0xDD ) );
+    }
+    return i;
+}
+#endif
+
 /**
  * Interleaves audio samples within a block of samples.
  * \param dst destination buffer for interleaved samples
@@ -374,6 +414,22 @@ do { \
     } \
 } while(0)
 
+#ifdef AOUT_SSE2_STEREO
+    if( chans == 2 && vlc_CPU_SSE2()
+     && (fourcc == VLC_CODEC_FL32 || fourcc == VLC_CODEC_S32N) )
+    {
+        uint32_t *d = dst;
+        const uint32_t *l = srcv[0], *r = srcv[1];
+        size_t done = Interleave2x32SSE2( d, l, r, samples );
+        for( size_t j = done; j < samples; j++ )
+        {
+            d[2 * j] = l[j];
+            d[2 * j + 1] = r[j];
+        }
+        return;
+    }
+#endif
+
     switch( fourcc )
     {
         case VLC_CODEC_U8:   INTERLEAVE_TYPE(uint8_t);  break;
@@ -410,6 +466,22 @@ do { \
     } \
 } while(0)
 
+#ifdef AOUT_SSE2_STEREO
+    if( chans == 2 && vlc_CPU_SSE2()
+     && (fourcc == VLC_CODEC_FL32 || fourcc == VLC_CODEC_S32N) )
+    {
+        uint32_t *l = dst, *r = l + samples;
+        const uint32_t *s = src;
+        size_t done = Deinterleave2x32SSE2( l, r, s, samples );
+        for( size_t j = done; j < samples; j++ )
+        {
+            l[j] = s[2 * j];
+            r[j] = s[2 * j + 1];
+        }
+        return;
+    }
+#endif
+
     switch( fourcc )
     {
         case VLC_CODEC_U8:   DEINTERLEAVE_TYPE(uint8_t);  break;
@@ -42,6 +42,138 @@
 #include <libvlc.h>
 #include "aout_internal.h"
 
+/*
+ * Output buffers pool
+ *
+ * Filters which cannot work in place get their output buffers from a pool
+ * shared by the whole pipeline. Buffers all have the size of the largest
+ * request seen so far, so that any recycled buffer fits any stage after a
+ * few periods. Buffers can be released from any thread (e.g. by the audio
+ * output), and may outlive the pipeline.
+ */
+#define AOUT_POOL_MAX   8
+#define AOUT_POOL_ALIGN 32
+
+typedef struct aout_pool aout_pool_t;
+
+typedef struct
+{
+    block_t self;
+    aout_pool_t *pool;
+    size_t capacity;
+} aout_pool_block_t;
+
+struct aout_pool
+{
+    vlc_mutex_t lock;
+    unsigned refs; /**< the pipeline, and each buffer in use */
+    size_t size; /**< capacity of new buffers, 0 once the pipeline is gone */
+    unsigned count;
+    aout_pool_block_t *free[AOUT_POOL_MAX];
+};
+
+static aout_pool_t *aout_PoolNew (void)
+{
+    aout_pool_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->refs = 1;
+    pool->size = 0;
+    pool->count = 0;
+    return pool;
+}
+
+static void aout_PoolPurge (aout_pool_t *pool)
+{
+    while (pool->count > 0)
+        free (pool->free[--pool->count]);
+}
+
+static void aout_PoolRelease (aout_pool_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    bool last = --pool->refs == 0;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (last)
+    {
+        aout_PoolPurge (pool);
+        vlc_mutex_destroy (&pool->lock);
+        free (pool);
+    }
+}
+
+static void aout_PoolBlockRelease (block_t *block)
+{
+    aout_pool_block_t *pb = (aout_pool_block_t *)block;
+    aout_pool_t *pool = pb->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (pb->capacity == pool->size && pool->count < AOUT_POOL_MAX)
+    {
+        pool->free[pool->count++] = pb;
+        pb = NULL;
+    }
+    vlc_mutex_unlock (&pool->lock);
+
+    free (pb);
+    aout_PoolRelease (pool);
+}
+
+static block_t *aout_PoolGet (aout_pool_t *pool, size_t size)
+{
+    aout_pool_block_t *pb = NULL;
+
+    vlc_mutex_lock (&pool->lock);
+    if (size > pool->size)
+    {   /* Smaller buffers would not fit any longer */
+        aout_PoolPurge (pool);
+        pool->size = size;
+    }
+    else if (pool->count > 0)
+        pb = pool->free[--pool->count];
+
+    size_t capacity = pool->size;
+    pool->refs++;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (pb == NULL)
+    {
+        pb = malloc (sizeof (*pb) + AOUT_POOL_ALIGN + capacity);
+        if (unlikely(pb == NULL))
+        {
+            aout_PoolRelease (pool);
+            return NULL;
+        }
+        pb->pool = pool;
+        pb->capacity = capacity;
+    }
+
+    uint8_t *buf = (uint8_t *)(pb + 1);
+    buf += (AOUT_POOL_ALIGN - ((uintptr_t)buf % AOUT_POOL_ALIGN))
+           % AOUT_POOL_ALIGN;
+    block_Init (&pb->self, buf, pb->capacity);
+    pb->self.i_buffer = size;
+    pb->self.pf_release = aout_PoolBlockRelease;
+    return &pb->self;
+}
+
+/** Pipeline context shared by all filters, see filter_t.owner */
+struct filter_owner_sys_t
+{
+    const aout_request_vout_t *request_vout;
+    aout_pool_t *pool;
+};
+
+static block_t *aout_FilterBufferNew (filter_t *filter, size_t size)
+{
+    filter_owner_sys_t *owner = filter->owner.sys;
+
+    return aout_PoolGet (owner->pool, size);
+}
+
 static filter_t *CreateFilter (vlc_object_t *obj, const char *type,
                                const char *name, filter_owner_sys_t *owner,
                                const audio_sample_format_t *infmt,
@@ -53,6 +185,8 @@ static filter_t *CreateFilter (vlc_object_t *obj, const char *type,
         return NULL;
 
     filter->owner.sys = owner;
+    if (owner != NULL)
+        filter->owner.audio.buffer_new = aout_FilterBufferNew;
     filter->p_cfg = cfg;
     filter->fmt_in.audio = *infmt;
     filter->fmt_in.i_codec = infmt->i_format;
@@ -351,8 +485,27 @@ struct aout_filters
     unsigned count; /**< Number of filters */
     filter_t *tab[AOUT_MAX_FILTERS]; /**< Configured user filters
         (e.g. equalization) and their conversions */
+
+    filter_owner_sys_t owner; /**< Shared by all filters */
 };
 
+/**
+ * Makes all filters of the pipeline allocate from its buffers pool.
+ */
+static void aout_FiltersSetOwner (aout_filters_t *filters)
+{
+    for (unsigned i = 0; i < filters->count; i++)
+    {
+        filters->tab[i]->owner.sys = &filters->owner;
+        filters->tab[i]->owner.audio.buffer_new = aout_FilterBufferNew;
+    }
+    if (filters->resampler != NULL)
+    {
+        filters->resampler->owner.sys = &filters->owner;
+        filters->resampler->owner.audio.buffer_new = aout_FilterBufferNew;
+    }
+}
+
 /** Callback for visualization selection */
 static int VisualizationCallback (vlc_object_t *obj, const char *var,
                                   vlc_value_t oldval, vlc_value_t newval,
@@ -387,7 +540,8 @@ vout_thread_t *aout_filter_RequestVout (filter_t *filter, vout_thread_t *vout,
      * If you want to use visualization filters from another place, you will
      * need to add a new pf_aout_request_vout callback or store a pointer
      * to aout_request_vout_t inside filter_t (i.e. a level of indirection). */
-    const aout_request_vout_t *req = filter->owner.sys;
+    const filter_owner_sys_t *owner = filter->owner.sys;
+    const aout_request_vout_t *req = owner->request_vout;
     char *visual = var_InheritString (filter->obj.parent, "audio-visual");
     /* NOTE: Disable recycling to always close the filter vout because OpenGL
      * visualizations do not use this function to ask for a context. */
@@ -398,7 +552,7 @@ vout_thread_t *aout_filter_RequestVout (filter_t *filter, vout_thread_t *vout,
 }
 
 static int AppendFilter(vlc_object_t *obj, const char *type, const char *name,
-                        aout_filters_t *restrict filters, const void *owner,
+                        aout_filters_t *restrict filters, filter_owner_sys_t *owner,
                         audio_sample_format_t *restrict infmt,
                         const audio_sample_format_t *restrict outfmt,
                         config_chain_t *cfg)
@@ -411,7 +565,7 @@ static int AppendFilter(vlc_object_t *obj, const char *type, const char *name,
     }
 
     filter_t *filter = CreateFilter (obj, type, name,
-                                     (void *)owner, infmt, outfmt, cfg, false);
+                                     owner, infmt, outfmt, cfg, false);
     if (filter == NULL)
     {
         msg_Err (obj, "cannot add user %s \"%s\" (skipped)", type, name);
@@ -511,6 +665,13 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     filters->resampler = NULL;
     filters->resampling = 0;
     filters->count = 0;
+    filters->owner.request_vout = request_vout;
+    filters->owner.pool = aout_PoolNew ();
+    if (unlikely(filters->owner.pool == NULL))
+    {
+        free (filters);
+        return NULL;
+    }
 
     /* Prepare format structure */
     aout_FormatPrint (obj, "input", infmt);
@@ -534,6 +695,7 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
             }
             filters->count++;
         }
+        aout_FiltersSetOwner (filters);
         return filters;
     }
     if (aout_FormatNbChannels(outfmt) == 0)
@@ -623,7 +785,7 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
         char *visual = var_InheritString (obj, "audio-visual");
         if (visual != NULL && strcasecmp (visual, "none"))
             AppendFilter(obj, "visualization", visual, filters,
-                         request_vout, &input_format, &output_format, NULL);
+                         &filters->owner, &input_format, &output_format, NULL);
         free (visual);
     }
 
@@ -650,12 +812,14 @@ aout_filters_t *aout_FiltersNew (vlc_object_t *obj,
     if (filters->rate_filter == NULL)
         filters->rate_filter = filters->resampler;
 
+    aout_FiltersSetOwner (filters);
     return filters;
 
 error:
     aout_FiltersPipelineDestroy (filters->tab, filters->count);
     if (request_vout != NULL)
         var_DelCallback (obj, "visual", VisualizationCallback, NULL);
+    aout_PoolRelease (filters->owner.pool);
     free (filters);
     return NULL;
 }
@@ -676,6 +840,14 @@ void aout_FiltersDelete (vlc_object_t *obj, aout_filters_t *filters)
     aout_FiltersPipelineDestroy (filters->tab, filters->count);
     if (obj != NULL)
         var_DelCallback (obj, "visual", VisualizationCallback, NULL);
+
+    /* Buffers still in use get freed when released */
+    aout_pool_t *pool = filters->owner.pool;
+    vlc_mutex_lock (&pool->lock);
+    pool->size = 0;
+    aout_PoolPurge (pool);
+    vlc_mutex_unlock (&pool->lock);
+    aout_PoolRelease (pool);
     free (filters);
 }
 
@@ -501,6 +501,10 @@ static int vout_update_format( decoder_t *p_dec )
         case VLC_CODEC_VP8:
             dpb_size = 3;
             break;
+        case VLC_CODEC_VP9:
+        case VLC_CODEC_AV1:
+            dpb_size = 8; /* reference frame slots */
+            break;
         default:
             dpb_size = 2;
             break;
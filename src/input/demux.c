@@ -138,6 +138,96 @@ static const char* DemuxNameFromExtension( char const* ext,
     return result ? result->name : NULL;
 }
 
+/* Enough for three 204 bytes MPEG-TS packets, and most container headers */
+#define DEMUX_SNIFF_SIZE 1024
+
+static bool SniffTS( const uint8_t *p, size_t i_peek )
+{
+    static const uint8_t offsets[] = { 0, 4 }; /* TS and M2TS */
+    static const uint16_t sizes[] = { 188, 192, 204 };
+
+    for( size_t i = 0; i < ARRAY_SIZE( offsets ); i++ )
+        for( size_t j = 0; j < ARRAY_SIZE( sizes ); j++ )
+        {
+            size_t o = offsets[i];
+
+            if( i_peek > o + 2 * sizes[j] && p[o] == 0x47 &&
+                p[o + sizes[j]] == 0x47 && p[o + 2 * sizes[j]] == 0x47 )
+                return true;
+        }
+    return false;
+}
+
+/**
+ * Classifies the stream by the signature of its first bytes.
+ *
+ * This peeks the stream once, so that the demuxers are not all probed in
+ * turn on inputs with high latency. The result is only a hint: the demuxer
+ * still validates the stream, and the other ones are probed if it fails.
+ */
+static const char *DemuxNameFromContent( stream_t *s )
+{
+    static const struct
+    {
+        uint8_t     i_offset;
+        uint8_t     i_size;
+        char const  magic[10];
+        char const  name[8];
+    } signatures[] =
+    {
+        { 0, 4, "\x1A\x45\xDF\xA3", "mkv"   },
+        { 4, 4, "ftyp",             "mp4"   },
+        { 4, 4, "moov",             "mp4"   },
+        { 4, 4, "mdat",             "mp4"   },
+        { 4, 4, "free",             "mp4"   },
+        { 4, 4, "skip",             "mp4"   },
+        { 4, 4, "wide",             "mp4"   },
+        { 8, 4, "AVI ",             "avi"   },
+        /* no WAVE: the ES demuxer must probe it first, for DTS or A52 */
+        { 0, 4, "\x30\x26\xB2\x75", "asf"   },
+        { 0, 4, "OggS",             "ogg"   },
+        { 0, 4, "fLaC",             "flac"  },
+        { 0, 4, "caff",             "caf"   },
+        { 8, 4, "AIFF",             "aiff"  },
+        { 8, 4, "AIFC",             "aiff"  },
+        { 0, 4, ".snd",             "au"    },
+        { 0, 8, "Creative",         "voc"   },
+        { 0, 4, "MThd",             "smf"   },
+        { 0, 4, "NSVf",             "nsv"   },
+        { 0, 4, "NSVs",             "nsv"   },
+        { 0, 4, "BBCD",             "dirac" },
+        { 0, 4, "\x00\x00\x01\xBA", "ps"    },
+        { 0, 4, "\x00\x00\x01\xB3", "mpgv"  },
+        { 0, 4, "\x89PNG",          "image" },
+        { 0, 3, "\xFF\xD8\xFF",     "image" },
+        { 0, 4, "GIF8",             "image" },
+    };
+
+    const uint8_t *p_peek;
+    ssize_t i_peek = vlc_stream_Peek( s, &p_peek, DEMUX_SNIFF_SIZE );
+    if( i_peek <= 0 )
+        return NULL;
+
+    for( size_t i = 0; i < ARRAY_SIZE( signatures ); i++ )
+    {
+        size_t i_end = signatures[i].i_offset + signatures[i].i_size;
+
+        if( (size_t)i_peek >= i_end
+         && !memcmp( p_peek + signatures[i].i_offset, signatures[i].magic,
+                     signatures[i].i_size ) )
+            return signatures[i].name;
+    }
+
+    /* Weaker signatures last */
+    if( SniffTS( p_peek, i_peek ) )
+        return "ts";
+    if( i_peek >= 2 && p_peek[0] == 0xFF && (p_peek[1] & 0xE0) == 0xE0 )
+        return "mpga"; /* MPEG audio or ADTS, both handled by the ES demuxer */
+    if( i_peek >= 2 && p_peek[0] == 0x0B && p_peek[1] == 0x77 )
+        return "a52";
+    return NULL;
+}
+
 /*****************************************************************************
  * demux_New:
  *  if s is NULL then load a access_demux
@@ -249,20 +339,43 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_parent_input,
     if( s != NULL )
     {
         const char *psz_module = NULL;
+        char candidates[20];
 
-        if( !strcmp( p_demux->psz_demux, "any" ) && p_demux->psz_file )
+        if( !strcmp( p_demux->psz_demux, "any" ) )
         {
-            char const* psz_ext = strrchr( p_demux->psz_file, '.' );
+            /* Ranked candidates: content signature, then file extension */
+            const char *psz_content = DemuxNameFromContent( s );
+            const char *psz_extension = NULL;
+
+            if( p_demux->psz_file )
+            {
+                char const* psz_ext = strrchr( p_demux->psz_file, '.' );
 
-            if( psz_ext )
-                psz_module = DemuxNameFromExtension( psz_ext + 1, b_preparsing );
+                if( psz_ext )
+                    psz_extension = DemuxNameFromExtension( psz_ext + 1,
+                                                            b_preparsing );
+            }
+
+            if( psz_content && psz_extension
+             && strcmp( psz_content, psz_extension ) )
+            {
+                snprintf( candidates, sizeof (candidates), "%s,%s",
+                          psz_content, psz_extension );
+                psz_module = candidates;
+            }
+            else
+                psz_module = psz_content ? psz_content : psz_extension;
         }
 
         if( psz_module == NULL )
             psz_module = p_demux->psz_demux;
 
+        mtime_t i_start = mdate();
         p_demux->p_module = vlc_module_load(p_demux, "demux", psz_module,
              !strcmp(psz_module, p_demux->psz_demux), demux_Probe, p_demux);
+        if( !b_preparsing )
+            msg_Dbg( p_obj, "demux probing (candidates \"%s\") took %"PRId64
+                     " us", psz_module, mdate() - i_start );
     }
     else
     {
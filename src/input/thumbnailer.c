@@ -0,0 +1,553 @@
+/*****************************************************************************
+ * thumbnailer.c: keyframe thumbnails extraction
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_block.h>
+#include <vlc_codec.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_input_item.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+#include <vlc_stream.h>
+#include <vlc_thumbnailer.h>
+#include "../libvlc.h"
+
+/* Values of the avcodec-skip-frame and avcodec-skiploopfilter options */
+#define SKIP_NONKEY 3
+#define SKIP_ALL    4
+
+typedef struct thumbnailer_request_t
+{
+    struct thumbnailer_request_t *p_next;
+
+    input_item_t *p_item;
+    mtime_t       i_time;
+    mtime_t       i_timeout;
+    vlc_fourcc_t  i_codec;
+    unsigned      i_width;
+    unsigned      i_height;
+
+    vlc_thumbnailer_cb pf_cb;
+    void              *p_data;
+} thumbnailer_request_t;
+
+struct vlc_thumbnailer_t
+{
+    vlc_object_t *p_obj;
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    thumbnailer_request_t  *p_first;
+    thumbnailer_request_t **pp_last;
+    atomic_bool b_quit;
+
+    unsigned     i_decoder_threads; /* per worker */
+    unsigned     i_workers;
+    vlc_thread_t workers[];
+};
+
+/*****************************************************************************
+ * Extraction of one thumbnail
+ *****************************************************************************/
+
+/* The ES output of the demuxer, which decodes the first video track only */
+struct es_out_id_t
+{
+    int i_cat;
+};
+
+struct es_out_sys_t
+{
+    vlc_thumbnailer_t *p_owner;
+    es_out_id_t       *p_video;
+    decoder_t         *p_packetizer;
+    decoder_t         *p_dec;
+    picture_t         *p_pic;
+};
+
+static int ThumbnailerFormatUpdate( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return 0;
+}
+
+static picture_t *ThumbnailerBufferNew( decoder_t *p_dec )
+{
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static int ThumbnailerQueueVideo( decoder_t *p_dec, picture_t *p_pic )
+{
+    es_out_sys_t *p_sys = p_dec->p_queue_ctx;
+
+    if( p_sys->p_pic == NULL )
+        p_sys->p_pic = p_pic;
+    else
+        picture_Release( p_pic );
+    return 0;
+}
+
+static void DeleteDecoder( decoder_t *p_dec )
+{
+    if( p_dec->p_module )
+        module_unneed( p_dec, p_dec->p_module );
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+    if( p_dec->p_description )
+        vlc_meta_Delete( p_dec->p_description );
+    vlc_object_release( p_dec );
+}
+
+static decoder_t *CreateDecoder( es_out_sys_t *p_sys, const es_format_t *fmt,
+                                 bool b_packetizer )
+{
+    vlc_thumbnailer_t *p_owner = p_sys->p_owner;
+    decoder_t *p_dec = vlc_custom_create( p_owner->p_obj, sizeof( *p_dec ),
+                                          b_packetizer ? "packetizer"
+                                                       : "decoder" );
+    if( unlikely(p_dec == NULL) )
+        return NULL;
+
+    p_dec->p_module = NULL;
+    es_format_Copy( &p_dec->fmt_in, fmt );
+    es_format_Init( &p_dec->fmt_out, VIDEO_ES, 0 );
+    p_dec->b_frame_drop_allowed = false;
+
+    if( b_packetizer )
+    {
+        p_dec->p_module = module_need( p_dec, "packetizer", "$packetizer",
+                                       false );
+    }
+    else
+    {
+        /* Only keyframes are decoded, as fast as possible, and without
+         * hardware acceleration, as the picture is needed in memory */
+        var_Create( p_dec, "avcodec-skip-frame", VLC_VAR_INTEGER );
+        var_SetInteger( p_dec, "avcodec-skip-frame", SKIP_NONKEY );
+        var_Create( p_dec, "avcodec-skiploopfilter", VLC_VAR_INTEGER );
+        var_SetInteger( p_dec, "avcodec-skiploopfilter", SKIP_ALL );
+        var_Create( p_dec, "avcodec-threads", VLC_VAR_INTEGER );
+        var_SetInteger( p_dec, "avcodec-threads", p_owner->i_decoder_threads );
+        var_Create( p_dec, "avcodec-hw", VLC_VAR_STRING );
+        var_SetString( p_dec, "avcodec-hw", "none" );
+
+        p_dec->pf_vout_format_update = ThumbnailerFormatUpdate;
+        p_dec->pf_vout_buffer_new = ThumbnailerBufferNew;
+        p_dec->pf_queue_video = ThumbnailerQueueVideo;
+        p_dec->p_queue_ctx = p_sys;
+
+        p_dec->p_module = module_need( p_dec, "video decoder", "$codec",
+                                       false );
+    }
+
+    if( p_dec->p_module == NULL )
+    {
+        DeleteDecoder( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *fmt )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    es_out_id_t *id = malloc( sizeof( *id ) );
+    if( unlikely(id == NULL) )
+        return NULL;
+
+    id->i_cat = fmt->i_cat;
+    if( fmt->i_cat != VIDEO_ES || p_sys->p_video != NULL )
+        return id;
+
+    /* First video track: load the decoder, and a packetizer if needed */
+    if( !fmt->b_packetized )
+    {
+        p_sys->p_packetizer = CreateDecoder( p_sys, fmt, true );
+        if( p_sys->p_packetizer == NULL )
+            return id;
+        p_sys->p_packetizer->fmt_out.b_packetized = true;
+        fmt = &p_sys->p_packetizer->fmt_out;
+    }
+
+    p_sys->p_dec = CreateDecoder( p_sys, fmt, false );
+    if( p_sys->p_dec == NULL )
+    {
+        if( p_sys->p_packetizer != NULL )
+        {
+            DeleteDecoder( p_sys->p_packetizer );
+            p_sys->p_packetizer = NULL;
+        }
+        return id;
+    }
+
+    p_sys->p_video = id;
+    return id;
+}
+
+static void EsOutDecode( es_out_sys_t *p_sys, block_t *p_block )
+{
+    decoder_t *p_dec = p_sys->p_dec;
+    decoder_t *p_pack = p_sys->p_packetizer;
+
+    if( p_pack == NULL )
+    {
+        p_dec->pf_decode( p_dec, p_block );
+        return;
+    }
+
+    block_t **pp_block = p_block ? &p_block : NULL;
+    block_t *p_au;
+    while( ( p_au = p_pack->pf_packetize( p_pack, pp_block ) ) != NULL )
+    {
+        while( p_au != NULL )
+        {
+            block_t *p_next = p_au->p_next;
+
+            p_au->p_next = NULL;
+            if( p_sys->p_pic == NULL )
+                p_dec->pf_decode( p_dec, p_au );
+            else
+                block_Release( p_au );
+            p_au = p_next;
+        }
+    }
+    if( pp_block == NULL )
+        p_dec->pf_decode( p_dec, NULL );
+}
+
+static void EsOutFlush( es_out_sys_t *p_sys )
+{
+    if( p_sys->p_packetizer != NULL && p_sys->p_packetizer->pf_flush )
+        p_sys->p_packetizer->pf_flush( p_sys->p_packetizer );
+    if( p_sys->p_dec->pf_flush )
+        p_sys->p_dec->pf_flush( p_sys->p_dec );
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( id != p_sys->p_video || p_sys->p_pic != NULL )
+    {
+        block_Release( p_block );
+        return VLC_SUCCESS;
+    }
+
+    EsOutDecode( p_sys, p_block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( id == p_sys->p_video )
+        p_sys->p_video = NULL;
+    free( id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            /* So that demuxers skip the other tracks */
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            bool *pb = va_arg( args, bool * );
+            *pb = id == p_sys->p_video;
+            return VLC_SUCCESS;
+        }
+        case ES_OUT_GET_EMPTY:
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy( es_out_t *out )
+{
+    VLC_UNUSED(out);
+}
+
+static block_t *Extract( vlc_thumbnailer_t *p_owner,
+                         const thumbnailer_request_t *p_req )
+{
+    vlc_object_t *p_obj = p_owner->p_obj;
+    block_t *p_image = NULL;
+
+    char *psz_uri = input_item_GetURI( p_req->p_item );
+    if( psz_uri == NULL )
+        return NULL;
+
+    const char *psz_location = strstr( psz_uri, "://" );
+    psz_location = psz_location ? psz_location + 3 : "";
+
+    es_out_sys_t sys = {
+        .p_owner = p_owner,
+    };
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDel,
+        .pf_control = EsOutControl,
+        .pf_destroy = EsOutDestroy,
+        .p_sys = &sys,
+    };
+
+    stream_t *p_stream = vlc_stream_NewURL( p_obj, psz_uri );
+    if( p_stream == NULL )
+    {
+        msg_Warn( p_obj, "cannot open %s", psz_uri );
+        free( psz_uri );
+        return NULL;
+    }
+
+    demux_t *p_demux = demux_New( p_obj, "any", psz_location, p_stream, &out );
+    if( p_demux == NULL )
+    {
+        msg_Warn( p_obj, "cannot demux %s", psz_uri );
+        vlc_stream_Delete( p_stream );
+        free( psz_uri );
+        return NULL;
+    }
+
+    if( sys.p_video == NULL )
+    {
+        msg_Warn( p_obj, "no video track to decode in %s", psz_uri );
+        goto end;
+    }
+
+    /* Imprecise seeking lands on a keyframe, or decoding skips to one */
+    bool b_seeked = false;
+    if( p_req->i_time > 0 )
+    {
+        if( demux_Control( p_demux, DEMUX_SET_TIME, p_req->i_time, false ) )
+            msg_Dbg( p_obj, "cannot seek %s, using the first keyframe",
+                     psz_uri );
+        else
+            b_seeked = true;
+    }
+
+    mtime_t i_deadline = p_req->i_timeout > 0 ? mdate() + p_req->i_timeout
+                                              : INT64_MAX;
+    for( ;; )
+    {
+        while( sys.p_pic == NULL && sys.p_video != NULL )
+        {
+            if( atomic_load( &p_owner->b_quit ) || mdate() > i_deadline )
+                break;
+
+            if( demux_Demux( p_demux ) != VLC_DEMUXER_SUCCESS )
+            {
+                /* Drain, for streams with a single keyframe */
+                EsOutDecode( &sys, NULL );
+                break;
+            }
+        }
+
+        if( sys.p_pic != NULL || sys.p_video == NULL || !b_seeked
+         || atomic_load( &p_owner->b_quit ) || mdate() > i_deadline )
+            break;
+
+        /* The seek landed at or after the end: start over from the
+         * beginning, as when seeking is not possible */
+        msg_Dbg( p_obj, "nothing to decode after %"PRId64" ms in %s, "
+                 "using the first keyframe", p_req->i_time / 1000, psz_uri );
+        b_seeked = false;
+        EsOutFlush( &sys );
+        if( demux_Control( p_demux, DEMUX_SET_POSITION, 0., false ) )
+            break;
+    }
+
+    if( sys.p_pic != NULL )
+    {
+        video_format_t fmt;
+
+        if( picture_Export( p_obj, &p_image, &fmt, sys.p_pic, p_req->i_codec,
+                            p_req->i_width, p_req->i_height ) )
+            p_image = NULL;
+    }
+    else
+        msg_Warn( p_obj, "no picture decoded from %s", psz_uri );
+
+end:
+    demux_Delete( p_demux );
+    if( sys.p_pic != NULL )
+        picture_Release( sys.p_pic );
+    if( sys.p_dec != NULL )
+        DeleteDecoder( sys.p_dec );
+    if( sys.p_packetizer != NULL )
+        DeleteDecoder( sys.p_packetizer );
+    free( psz_uri );
+    return p_image;
+}
+
+/*****************************************************************************
+ * Workers
+ *****************************************************************************/
+
+static void RequestDelete( thumbnailer_request_t *p_req )
+{
+    input_item_Release( p_req->p_item );
+    free( p_req );
+}
+
+static void *Worker( void *data )
+{
+    vlc_thumbnailer_t *p_owner = data;
+
+    vlc_mutex_lock( &p_owner->lock );
+    for( ;; )
+    {
+        while( p_owner->p_first == NULL && !atomic_load( &p_owner->b_quit ) )
+            vlc_cond_wait( &p_owner->wait, &p_owner->lock );
+        if( atomic_load( &p_owner->b_quit ) )
+            break;
+
+        thumbnailer_request_t *p_req = p_owner->p_first;
+        p_owner->p_first = p_req->p_next;
+        if( p_owner->p_first == NULL )
+            p_owner->pp_last = &p_owner->p_first;
+        vlc_mutex_unlock( &p_owner->lock );
+
+        p_req->pf_cb( p_req->p_data, Extract( p_owner, p_req ) );
+        RequestDelete( p_req );
+
+        vlc_mutex_lock( &p_owner->lock );
+    }
+    vlc_mutex_unlock( &p_owner->lock );
+    return NULL;
+}
+
+#undef vlc_thumbnailer_Create
+vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *p_parent,
+                                           unsigned i_workers,
+                                           unsigned i_threads )
+{
+    if( i_workers == 0 )
+        i_workers = vlc_GetCPUCount();
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+
+    vlc_thumbnailer_t *p_owner =
+        malloc( sizeof( *p_owner ) + i_workers * sizeof( p_owner->workers[0] ) );
+    if( unlikely(p_owner == NULL) )
+        return NULL;
+
+    p_owner->p_obj = vlc_custom_create( p_parent, sizeof( vlc_object_t ),
+                                        "thumbnailer" );
+    if( unlikely(p_owner->p_obj == NULL) )
+    {
+        free( p_owner );
+        return NULL;
+    }
+
+    vlc_mutex_init( &p_owner->lock );
+    vlc_cond_init( &p_owner->wait );
+    p_owner->p_first = NULL;
+    p_owner->pp_last = &p_owner->p_first;
+    atomic_init( &p_owner->b_quit, false );
+    p_owner->i_decoder_threads = __MAX( i_threads / i_workers, 1 );
+    p_owner->i_workers = 0;
+
+    for( unsigned i = 0; i < i_workers; i++ )
+    {
+        if( vlc_clone( &p_owner->workers[i], Worker, p_owner,
+                       VLC_THREAD_PRIORITY_LOW ) )
+            break;
+        p_owner->i_workers++;
+    }
+
+    if( p_owner->i_workers == 0 )
+    {
+        vlc_thumbnailer_Release( p_owner );
+        return NULL;
+    }
+    msg_Dbg( p_owner->p_obj, "%u workers, %u decoder thread(s) each",
+             p_owner->i_workers, p_owner->i_decoder_threads );
+    return p_owner;
+}
+
+int vlc_thumbnailer_Request( vlc_thumbnailer_t *p_owner, input_item_t *p_item,
+                             mtime_t i_time, vlc_fourcc_t i_codec,
+                             unsigned i_width, unsigned i_height,
+                             mtime_t i_timeout, vlc_thumbnailer_cb pf_cb,
+                             void *p_data )
+{
+    thumbnailer_request_t *p_req = malloc( sizeof( *p_req ) );
+    if( unlikely(p_req == NULL) )
+        return VLC_ENOMEM;
+
+    p_req->p_next = NULL;
+    p_req->p_item = input_item_Hold( p_item );
+    p_req->i_time = i_time;
+    p_req->i_timeout = i_timeout;
+    p_req->i_codec = i_codec;
+    p_req->i_width = i_width;
+    p_req->i_height = i_height;
+    p_req->pf_cb = pf_cb;
+    p_req->p_data = p_data;
+
+    vlc_mutex_lock( &p_owner->lock );
+    *p_owner->pp_last = p_req;
+    p_owner->pp_last = &p_req->p_next;
+    vlc_cond_signal( &p_owner->wait );
+    vlc_mutex_unlock( &p_owner->lock );
+    return VLC_SUCCESS;
+}
+
+void vlc_thumbnailer_Release( vlc_thumbnailer_t *p_owner )
+{
+    vlc_mutex_lock( &p_owner->lock );
+    atomic_store( &p_owner->b_quit, true );
+    vlc_cond_broadcast( &p_owner->wait );
+    vlc_mutex_unlock( &p_owner->lock );
+
+    for( unsigned i = 0; i < p_owner->i_workers; i++ )
+        vlc_join( p_owner->workers[i], NULL );
+
+    /* Drop the requests that were not processed */
+    for( thumbnailer_request_t *p_req = p_owner->p_first, *p_next;
+         p_req != NULL; p_req = p_next )
+    {
+        p_next = p_req->p_next;
+        p_req->pf_cb( p_req->p_data, NULL );
+        RequestDelete( p_req );
+    }
+
+    vlc_cond_destroy( &p_owner->wait );
+    vlc_mutex_destroy( &p_owner->lock );
+    vlc_object_release( p_owner->p_obj );
+    free( p_owner );
+}
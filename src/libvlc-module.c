@@ -528,6 +528,15 @@ static const char *const ppsz_pos_descriptions[] =
 #define NETWORK_CACHING_LONGTEXT N_( \
     "Caching value for network resources, in milliseconds." )
 
+#define READAHEAD_DURATION_TEXT N_("Read-ahead duration (ms)")
+#define READAHEAD_DURATION_LONGTEXT N_( \
+    "Amount of data that stream filters try to read ahead, expressed in " \
+    "milliseconds at the measured consumption rate." )
+
+#define READAHEAD_MEMORY_TEXT N_("Read-ahead memory (MiB)")
+#define READAHEAD_MEMORY_LONGTEXT N_( \
+    "Maximum memory used for data read ahead by all the inputs together." )
+
 #define CR_AVERAGE_TEXT N_("Clock reference average counter")
 #define CR_AVERAGE_LONGTEXT N_( \
     "When using the PVR input (or a very irregular source), you should " \
@@ -1914,6 +1923,12 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
     add_module_list( "stream-filter", "stream_filter", NULL,
                      STREAM_FILTER_TEXT, STREAM_FILTER_LONGTEXT, false )
+    add_integer( "readahead-duration", 5000, READAHEAD_DURATION_TEXT,
+                 READAHEAD_DURATION_LONGTEXT, true )
+        change_integer_range( 100, 600000 )
+    add_integer( "readahead-memory", 512, READAHEAD_MEMORY_TEXT,
+                 READAHEAD_MEMORY_LONGTEXT, true )
+        change_integer_range( 1, 1 << 20 )
 
     add_string( "demux-filter", NULL, DEMUX_FILTER_TEXT, DEMUX_FILTER_LONGTEXT, true )
 
@@ -34,6 +34,7 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
 
 #ifndef NDEBUG
 static void BlockNoRelease( block_t *b )
@@ -337,6 +338,127 @@ block_t *block_shm_Alloc (void *addr, size_t length)
 }
 #endif
 
+typedef struct
+{
+    block_t    *source;
+    atomic_uint refs;
+} block_shared_t;
+
+typedef struct
+{
+    block_t         self;
+    block_shared_t *shared;
+} block_slice_t;
+
+static void block_slice_Release (block_t *block)
+{
+    block_slice_t *slice = container_of(block, block_slice_t, self);
+    block_shared_t *shared = slice->shared;
+
+    block_Invalidate (block);
+    free (slice);
+
+    if (atomic_fetch_sub (&shared->refs, 1) == 1)
+    {
+        block_Release (shared->source);
+        free (shared);
+    }
+}
+
+static block_t *block_slice_Alloc (block_shared_t *shared,
+                                   const uint8_t *p, size_t length)
+{
+    block_slice_t *slice = malloc (sizeof (*slice));
+    if (unlikely(slice == NULL))
+        return NULL;
+
+    /* The buffer bounds are the slice bounds, so that block_Realloc() never
+     * writes to the shared data */
+    block_Init (&slice->self, (uint8_t *)p, length);
+    slice->self.pf_release = block_slice_Release;
+    slice->shared = shared;
+    atomic_fetch_add (&shared->refs, 1);
+    return &slice->self;
+}
+
+block_t *block_Share (block_t *block)
+{
+    assert (block->p_next == NULL);
+    if (block->pf_release == block_slice_Release)
+        return block;
+
+    block_shared_t *shared = malloc (sizeof (*shared));
+    if (unlikely(shared == NULL))
+    {
+        block_Release (block);
+        return NULL;
+    }
+
+    shared->source = block;
+    atomic_init (&shared->refs, 0);
+
+    block_t *slice = block_slice_Alloc (shared, block->p_buffer,
+                                        block->i_buffer);
+    if (unlikely(slice == NULL))
+    {
+        free (shared);
+        block_Release (block);
+        return NULL;
+    }
+
+    block_CopyProperties (slice, block);
+    return slice;
+}
+
+block_t *block_Slice (block_t *block, const uint8_t *p, size_t length)
+{
+    if (block->pf_release != block_slice_Release)
+        return NULL;
+
+    block_shared_t *shared = container_of(block, block_slice_t, self)->shared;
+    const block_t *source = shared->source;
+
+    if (p < source->p_buffer
+     || length > source->i_buffer
+     || (size_t)(p - source->p_buffer) > source->i_buffer - length)
+        return NULL;
+
+    return block_slice_Alloc (shared, p, length);
+}
+
+block_t *block_SliceGather (block_t *list)
+{
+    if (list->p_next == NULL || list->pf_release != block_slice_Release)
+        return block_ChainGather (list);
+
+    block_shared_t *shared = container_of(list, block_slice_t, self)->shared;
+    const uint8_t *end = list->p_buffer + list->i_buffer;
+    mtime_t length = list->i_length;
+
+    for (block_t *b = list->p_next; b != NULL; b = b->p_next)
+    {
+        if (b->pf_release != block_slice_Release
+         || container_of(b, block_slice_t, self)->shared != shared
+         || b->p_buffer != end)
+            return block_ChainGather (list);
+        end += b->i_buffer;
+        length += b->i_length;
+    }
+
+    block_t *g = block_slice_Alloc (shared, list->p_buffer,
+                                    end - list->p_buffer);
+    if (unlikely(g == NULL))
+        return block_ChainGather (list);
+
+    g->i_flags = list->i_flags;
+    g->i_pts = list->i_pts;
+    g->i_dts = list->i_dts;
+    g->i_length = length;
+
+    block_ChainRelease (list);
+    return g;
+}
+
 
 #ifdef _WIN32
 # include <io.h>
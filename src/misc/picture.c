@@ -62,7 +62,10 @@ static int AllocatePicture( picture_t *p_pic )
         i_bytes += p->i_pitch * p->i_lines;
     }
 
-    uint8_t *p_data = aligned_alloc( 16, i_bytes );
+    /* Cache line alignment, which also satisfies the widest SIMD loads and
+     * stores of the decoders writing directly into the pictures */
+    i_bytes = (i_bytes + 63) & ~(size_t)63;
+    uint8_t *p_data = aligned_alloc( 64, i_bytes );
     if( i_bytes > 0 && p_data == NULL )
     {
         p_pic->i_planes = 0;
@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * slices.c: slice threading
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_slices.h>
+
+/* Above that, the bands get too thin to be worth a thread */
+#define SLICES_MAX_THREADS 16
+
+struct vlc_slices
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait; /* signaled when slices are available, or on exit */
+    vlc_cond_t  done; /* signaled when the last slice completes */
+
+    void      (*slice)( void *, unsigned, unsigned );
+    void       *opaque;
+    unsigned    count;   /* slices of the current job */
+    unsigned    next;    /* next slice to hand out */
+    unsigned    pending; /* slices not completed yet */
+    bool        quit;
+
+    unsigned     threads;
+    vlc_thread_t workers[];
+};
+
+/* Runs slices of the current job until there are none left to hand out.
+ * Called with the lock held. */
+static void SlicesWork( vlc_slices_t *s )
+{
+    while( s->next < s->count )
+    {
+        void (*slice)( void *, unsigned, unsigned ) = s->slice;
+        void *opaque = s->opaque;
+        unsigned index = s->next++, count = s->count;
+
+        vlc_mutex_unlock( &s->lock );
+        slice( opaque, index, count );
+        vlc_mutex_lock( &s->lock );
+
+        assert( s->pending > 0 );
+        if( --s->pending == 0 )
+            vlc_cond_signal( &s->done );
+    }
+}
+
+static void *SlicesThread( void *data )
+{
+    vlc_slices_t *s = data;
+
+    vlc_mutex_lock( &s->lock );
+    while( !s->quit )
+    {
+        if( s->next < s->count )
+            SlicesWork( s );
+        else
+            vlc_cond_wait( &s->wait, &s->lock );
+    }
+    vlc_mutex_unlock( &s->lock );
+    return NULL;
+}
+
+vlc_slices_t *vlc_slices_New( unsigned threads )
+{
+    if( threads == 0 )
+        threads = vlc_GetCPUCount();
+    threads = __MIN( threads, SLICES_MAX_THREADS );
+    if( threads <= 1 )
+        return NULL;
+
+    vlc_slices_t *s = malloc( sizeof(*s)
+                              + (threads - 1) * sizeof(s->workers[0]) );
+    if( unlikely(s == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &s->lock );
+    vlc_cond_init( &s->wait );
+    vlc_cond_init( &s->done );
+    s->slice = NULL;
+    s->opaque = NULL;
+    s->count = 0;
+    s->next = 0;
+    s->pending = 0;
+    s->quit = false;
+    s->threads = 1;
+
+    for( unsigned i = 0; i < threads - 1; i++ )
+    {
+        if( vlc_clone( &s->workers[i], SlicesThread, s,
+                       VLC_THREAD_PRIORITY_LOW ) )
+            break;
+        s->threads++;
+    }
+
+    if( s->threads == 1 )
+    {
+        vlc_slices_Delete( s );
+        return NULL;
+    }
+    return s;
+}
+
+void vlc_slices_Delete( vlc_slices_t *s )
+{
+    if( s == NULL )
+        return;
+
+    vlc_mutex_lock( &s->lock );
+    s->quit = true;
+    vlc_cond_broadcast( &s->wait );
+    vlc_mutex_unlock( &s->lock );
+
+    for( unsigned i = 0; i < s->threads - 1; i++ )
+        vlc_join( s->workers[i], NULL );
+
+    vlc_cond_destroy( &s->done );
+    vlc_cond_destroy( &s->wait );
+    vlc_mutex_destroy( &s->lock );
+    free( s );
+}
+
+unsigned vlc_slices_Count( const vlc_slices_t *s )
+{
+    return ( s != NULL ) ? s->threads : 1;
+}
+
+void vlc_slices_Run( vlc_slices_t *s, unsigned count,
+                     void (*slice)( void *, unsigned, unsigned ),
+                     void *opaque )
+{
+    if( s == NULL || count <= 1 )
+    {
+        for( unsigned i = 0; i < count; i++ )
+            slice( opaque, i, count );
+        return;
+    }
+
+    vlc_mutex_lock( &s->lock );
+    assert( s->pending == 0 );
+    s->slice = slice;
+    s->opaque = opaque;
+    s->count = count;
+    s->next = 0;
+    s->pending = count;
+    vlc_cond_broadcast( &s->wait );
+
+    SlicesWork( s );
+    while( s->pending > 0 )
+        vlc_cond_wait( &s->done, &s->lock );
+    s->count = s->next = 0;
+    vlc_mutex_unlock( &s->lock );
+}
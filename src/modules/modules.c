@@ -177,11 +177,18 @@ static int module_load (vlc_object_t *obj, module_t *m,
 
     if (m->pf_activate != NULL)
     {
+        mtime_t start = mdate();
         va_list ap;
 
         va_copy (ap, args);
         ret = init (m->pf_activate, ap);
         va_end (ap);
+
+        /* Slow demuxer probes delay the start of playback, track them */
+        if (!strcmp (m->psz_capability, "demux"))
+            msg_Dbg (obj, "demux module \"%s\" probed in %"PRId64" us: %s",
+                     module_get_object (m), mdate() - start,
+                     (ret == VLC_SUCCESS) ? "accepted" : "rejected");
     }
 
     if (ret != VLC_SUCCESS)
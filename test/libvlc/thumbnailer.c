@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * thumbnailer.c: libvlc thumbnailer API test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "test.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+struct results
+{
+    vlc_sem_t done;
+    unsigned  ok;
+};
+
+static void thumbnail_done(void *opaque, libvlc_media_t *md,
+                           const void *data, size_t size)
+{
+    struct results *res = opaque;
+    char *mrl = libvlc_media_get_mrl(md);
+
+    if (data != NULL)
+    {
+        /* PNG signature */
+        assert(size > 8 && !memcmp(data, "\x89PNG", 4));
+        res->ok++;
+    }
+    else
+        log("no thumbnail for %s\n", mrl);
+    free(mrl);
+    vlc_sem_post(&res->done);
+}
+
+/* Thumbnails every file, several times when there are few of them, and
+ * reports the throughput; without arguments, this is only a test */
+int main(int argc, char **argv)
+{
+    const char *default_files[] = { test_default_video };
+    const char **files = default_files;
+    unsigned count = 1, rounds = 1;
+
+    test_init();
+    if (argc > 1)
+    {
+        alarm(0); /* benchmarking, there might be many files */
+        files = (const char **)&argv[1];
+        count = argc - 1;
+        rounds = count < 16 ? 16 / count : 1;
+    }
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    libvlc_thumbnailer_t *thumbnailer = libvlc_thumbnailer_new(vlc, 0, 0);
+    assert(thumbnailer != NULL);
+
+    struct results res = { .ok = 0 };
+    vlc_sem_init(&res.done, 0);
+
+    mtime_t start = mdate();
+    for (unsigned r = 0; r < rounds; r++)
+        for (unsigned i = 0; i < count; i++)
+        {
+            libvlc_media_t *md = libvlc_media_new_path(vlc, files[i]);
+            assert(md != NULL);
+
+            /* 10 seconds in, or the first keyframe of short files */
+            int ret = libvlc_thumbnailer_request(thumbnailer, md, 10000,
+                                                 320, 0, libvlc_thumbnailer_png,
+                                                 5000, thumbnail_done, &res);
+            assert(ret == 0);
+            libvlc_media_release(md);
+        }
+
+    for (unsigned i = 0; i < rounds * count; i++)
+        vlc_sem_wait(&res.done);
+    mtime_t elapsed = mdate() - start;
+
+    log("%u/%u thumbnails in %"PRId64" ms, %.1f files/s\n", res.ok,
+        rounds * count, elapsed / 1000,
+        rounds * count * (double)CLOCK_FREQ / __MAX(elapsed, 1));
+    if (argc <= 1)
+        assert(res.ok == 1);
+
+    libvlc_thumbnailer_release(thumbnailer);
+    vlc_sem_destroy(&res.done);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*****************************************************************************
+ * format.c: tests and benchmarks the PCM conversion kernels
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../modules/audio_filter/converter/format_simd.h"
+
+/* Odd count, so that the scalar tails get tested too */
+#define SAMPLES 65539
+#define RUNS    200
+
+static float   fl32_in[SAMPLES], fl32_ref[SAMPLES], fl32_out[SAMPLES];
+static int16_t s16_in[SAMPLES], s16_ref[SAMPLES], s16_out[SAMPLES];
+static int32_t s32_in[SAMPLES], s32_ref[SAMPLES], s32_out[SAMPLES];
+
+static void report(const char *kernel, const char *isa, size_t bytes,
+                   mtime_t elapsed)
+{
+    if (elapsed <= 0)
+        elapsed = 1;
+    printf("%-10s %-5s %8.1f MB/s\n", kernel, isa,
+           (double)bytes * RUNS * CLOCK_FREQ / elapsed / (1 << 20));
+}
+
+#define BENCH(kernel, isa, bytes, call) do { \
+    mtime_t start = mdate(); \
+    for (unsigned run = 0; run < RUNS; run++) \
+        call; \
+    report(kernel, isa, bytes, mdate() - start); \
+} while (0)
+
+static void test_gain(pcm_gain_fl32_t gain, const char *isa)
+{
+    memcpy(fl32_ref, fl32_in, sizeof(fl32_in));
+    pcm_gain_fl32_c(fl32_ref, SAMPLES, .7f);
+    memcpy(fl32_out, fl32_in, sizeof(fl32_in));
+    gain(fl32_out, SAMPLES, .7f);
+    assert(!memcmp(fl32_out, fl32_ref, sizeof(fl32_out)));
+
+    BENCH("gain fl32", isa, sizeof(fl32_out),
+          gain(fl32_out, SAMPLES, 1.f));
+}
+
+static void test_s16_fl32(pcm_s16_fl32_t cvt, const char *isa)
+{
+    pcm_s16_fl32_c(fl32_ref, s16_in, SAMPLES);
+    cvt(fl32_out, s16_in, SAMPLES);
+    assert(!memcmp(fl32_out, fl32_ref, sizeof(fl32_out)));
+
+    BENCH("s16->fl32", isa, sizeof(s16_in), cvt(fl32_out, s16_in, SAMPLES));
+}
+
+static void test_fl32_s16(pcm_fl32_s16_t cvt, const char *isa)
+{
+    pcm_fl32_s16_c(s16_ref, fl32_in, SAMPLES);
+    cvt(s16_out, fl32_in, SAMPLES);
+    assert(!memcmp(s16_out, s16_ref, sizeof(s16_out)));
+
+    /* in place, as the audio converter does it */
+    memcpy(fl32_out, fl32_in, sizeof(fl32_in));
+    cvt((int16_t *)fl32_out, fl32_out, SAMPLES);
+    assert(!memcmp(fl32_out, s16_ref, sizeof(s16_ref)));
+
+    BENCH("fl32->s16", isa, sizeof(fl32_in), cvt(s16_out, fl32_in, SAMPLES));
+}
+
+static void test_s32_fl32(pcm_s32_fl32_t cvt, const char *isa)
+{
+    pcm_s32_fl32_c(fl32_ref, s32_in, SAMPLES);
+    cvt(fl32_out, s32_in, SAMPLES);
+    assert(!memcmp(fl32_out, fl32_ref, sizeof(fl32_out)));
+
+    BENCH("s32->fl32", isa, sizeof(s32_in), cvt(fl32_out, s32_in, SAMPLES));
+}
+
+static void test_fl32_s32(pcm_fl32_s32_t cvt, const char *isa)
+{
+    pcm_fl32_s32_c(s32_ref, fl32_in, SAMPLES);
+    cvt(s32_out, fl32_in, SAMPLES);
+    /* half-way cases may round differently */
+    for (size_t i = 0; i < SAMPLES; i++)
+        assert(llabs((long long)s32_out[i] - s32_ref[i]) <= 1);
+
+    BENCH("fl32->s32", isa, sizeof(fl32_in), cvt(s32_out, fl32_in, SAMPLES));
+}
+
+static void test_isa(const char *isa, pcm_gain_fl32_t gain,
+                     pcm_s16_fl32_t s16_fl32, pcm_fl32_s16_t fl32_s16,
+                     pcm_s32_fl32_t s32_fl32, pcm_fl32_s32_t fl32_s32)
+{
+    if (gain != NULL)
+        test_gain(gain, isa);
+    if (s16_fl32 != NULL)
+        test_s16_fl32(s16_fl32, isa);
+    if (fl32_s16 != NULL)
+        test_fl32_s16(fl32_s16, isa);
+    if (s32_fl32 != NULL)
+        test_s32_fl32(s32_fl32, isa);
+    if (fl32_s32 != NULL)
+        test_fl32_s32(fl32_s32, isa);
+}
+
+int main(void)
+{
+    srand(0);
+    for (size_t i = 0; i < SAMPLES; i++)
+    {
+        /* mostly in range, with some clipping and exact half steps */
+        fl32_in[i] = (rand() / (float)RAND_MAX) * 2.5f - 1.25f;
+        if (i % 7 == 0)
+            fl32_in[i] = ((rand() % 65536) - 32768 + .5f) / 32768.f;
+        s16_in[i] = rand();
+        s32_in[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    }
+    fl32_in[0] = 1.f;
+    fl32_in[1] = -1.f;
+    fl32_in[2] = 0.f;
+
+    test_isa("C", pcm_gain_fl32_c, pcm_s16_fl32_c, pcm_fl32_s16_c,
+             pcm_s32_fl32_c, pcm_fl32_s32_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_isa("SSE2", pcm_gain_fl32_sse, pcm_s16_fl32_sse2,
+                 pcm_fl32_s16_sse2, pcm_s32_fl32_sse2, pcm_fl32_s32_sse2);
+    if (vlc_CPU_AVX())
+        test_isa("AVX", pcm_gain_fl32_avx, NULL, NULL, NULL, NULL);
+    if (vlc_CPU_AVX2())
+        test_isa("AVX2", NULL, pcm_s16_fl32_avx2, pcm_fl32_s16_avx2,
+                 pcm_s32_fl32_avx2, pcm_fl32_s32_avx2);
+#endif
+#ifdef PCM_SIMD_NEON
+# ifdef __aarch64__
+    test_isa("NEON", pcm_gain_fl32_neon, pcm_s16_fl32_neon,
+             pcm_fl32_s16_neon, pcm_s32_fl32_neon, pcm_fl32_s32_neon);
+# else
+    test_isa("NEON", pcm_gain_fl32_neon, pcm_s16_fl32_neon,
+             NULL, pcm_s32_fl32_neon, NULL);
+# endif
+#endif
+    return 0;
+}
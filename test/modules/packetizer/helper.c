@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * helper.c: tests the startcode finders and the packetizer helper
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+#include "../modules/packetizer/packetizer_helper.h"
+#include "../modules/packetizer/startcode_helper.h"
+
+typedef const uint8_t *(*find_t)( const uint8_t *, const uint8_t * );
+
+static const uint8_t *FindRef( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p > 3; p++ )
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    return NULL;
+}
+
+/* Every startcode of the buffer, from every start and end alignment */
+static void TestFind( const char *name, find_t find,
+                      const uint8_t *buf, size_t size )
+{
+    for( size_t start = 0; start < 64; start++ )
+        for( size_t cut = 0; cut < 64; cut++ )
+        {
+            const uint8_t *p = buf + start, *end = buf + size - cut;
+
+            for( ;; )
+            {
+                const uint8_t *ref = FindRef( p, end );
+                const uint8_t *res = find( p, end );
+
+                assert( res == ref );
+                if( res == NULL )
+                    break;
+                p = res + 1;
+            }
+        }
+
+    mtime_t t = mdate();
+    for( unsigned i = 0; i < 100; i++ )
+        for( const uint8_t *p = buf; (p = find( p, buf + size )); p++ );
+    printf( "%-6s %6"PRId64" us\n", name, mdate() - t );
+}
+
+static void TestFinders( void )
+{
+    const size_t size = 1 << 16;
+    uint8_t *buf = malloc( size );
+    assert( buf != NULL );
+
+    /* Sparse startcodes, plus lots of false positives for zero searches */
+    srand( 0 );
+    for( size_t i = 0; i < size; i++ )
+        buf[i] = ( rand() % 4 ) ? rand() & 3 : 0;
+    for( size_t i = 0; i + 4 < size; i += 1 + rand() % 400 )
+        memcpy( &buf[i], "\x00\x00\x00\x01", 4 );
+    memcpy( &buf[size - 4], "\x00\x00\x01\x65", 4 );
+
+    TestFind( "best", startcode_FindAnnexB, buf, size );
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+        TestFind( "SSE2", startcode_FindAnnexB_SSE2, buf, size );
+#endif
+#ifdef STARTCODE_AVX2
+    if( vlc_CPU_AVX2() )
+        TestFind( "AVX2", startcode_FindAnnexB_AVX2, buf, size );
+#endif
+#ifdef STARTCODE_NEON
+    TestFind( "NEON", startcode_FindAnnexB_NEON, buf, size );
+#endif
+    free( buf );
+}
+
+/* Packetizes NALs, straight from the input or copied */
+static const uint8_t startcode[3] = { 0x00, 0x00, 0x01 };
+
+static void Reset( void *priv, bool broken )
+{
+    VLC_UNUSED(priv); VLC_UNUSED(broken);
+}
+
+static block_t *Parse( void *priv, bool *ts_used, block_t *block )
+{
+    VLC_UNUSED(priv);
+    *ts_used = false;
+    while( block->i_buffer > 5 && block->p_buffer[block->i_buffer - 1] == 0 )
+        block->i_buffer--;
+    return block;
+}
+
+static int Validate( void *priv, block_t *block )
+{
+    VLC_UNUSED(priv); VLC_UNUSED(block);
+    return VLC_SUCCESS;
+}
+
+static block_t *Packetize( const uint8_t *data, size_t size, size_t chunk,
+                           bool slices )
+{
+    packetizer_t pack;
+    block_t *out = NULL, **last = &out;
+
+    packetizer_Init( &pack, startcode, 3, startcode_FindAnnexB,
+                     startcode, 1, 5, Reset, Parse, Validate, NULL );
+    pack.b_slices = slices;
+
+    for( size_t i = 0; i < size; i += chunk )
+    {
+        block_t *in = block_Alloc( __MIN( chunk, size - i ) );
+        assert( in != NULL );
+        memcpy( in->p_buffer, &data[i], in->i_buffer );
+
+        block_t *nal;
+        while( ( nal = packetizer_Packetize( &pack, &in ) ) )
+            block_ChainLastAppend( &last, nal );
+    }
+
+    block_t *nal;
+    while( ( nal = packetizer_Packetize( &pack, NULL ) ) )
+        block_ChainLastAppend( &last, nal );
+
+    packetizer_Clean( &pack );
+    return out;
+}
+
+static void TestPacketizer( void )
+{
+    uint8_t data[4096];
+
+    /* NALs with 3 and 4 bytes startcodes, and zero stuffing */
+    srand( 1 );
+    for( size_t i = 0; i < sizeof (data); i++ )
+        data[i] = 1 + rand() % 255;
+    for( size_t i = 0; i + 6 < sizeof (data); i += 5 + rand() % 200 )
+    {
+        size_t zeros = 2 + rand() % 3;
+        memset( &data[i], 0, zeros );
+        data[i + zeros] = 1;
+    }
+
+    for( size_t chunk = 16; chunk <= sizeof (data); chunk *= 4 )
+    {
+        block_t *copied = Packetize( data, sizeof (data), chunk, false );
+        block_t *sliced = Packetize( data, sizeof (data), chunk, true );
+        int count;
+
+        block_ChainProperties( copied, &count, NULL, NULL );
+        assert( count > 1 );
+
+        for( block_t *a = copied, *b = sliced; a || b;
+             a = a->p_next, b = b->p_next )
+        {
+            assert( a != NULL && b != NULL );
+            assert( a->i_buffer == b->i_buffer );
+            assert( !memcmp( a->p_buffer, b->p_buffer, a->i_buffer ) );
+        }
+
+        block_ChainRelease( copied );
+        block_ChainRelease( sliced );
+    }
+
+    /* With 4 bytes startcodes only, the NALs of a single input block are
+     * consecutive slices, which merge back without copying */
+    for( size_t i = 0; i < sizeof (data); i++ )
+        data[i] = 1 + rand() % 255;
+    for( size_t i = 0; i + 4 < sizeof (data); i += 64 )
+        memcpy( &data[i], "\x00\x00\x00\x01", 4 );
+
+    block_t *sliced = Packetize( data, sizeof (data), sizeof (data), true );
+    int count;
+
+    block_ChainProperties( sliced, &count, NULL, NULL );
+    assert( count == (int)(sizeof (data) / 64) );
+
+    const uint8_t *p = sliced->p_buffer;
+    sliced = block_SliceGather( sliced );
+    assert( sliced->p_next == NULL );
+    assert( sliced->i_buffer == sizeof (data) );
+    assert( sliced->p_buffer == p );
+    assert( !memcmp( sliced->p_buffer, data, sizeof (data) ) );
+    block_Release( sliced );
+}
+
+int main( void )
+{
+    TestFinders();
+    TestPacketizer();
+    return 0;
+}
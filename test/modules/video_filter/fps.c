@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * fps.c: tests the motion interpolation of the fps filter
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdio.h>
+
+#define MODULE_NAME fps
+#define MODULE_STRING "fps"
+#include "../modules/video_filter/fps.c"
+
+/* A textured square moving right over a textured, static background */
+#define WIDTH   160
+#define HEIGHT  64
+#define SIZE    32
+#define TOP     16
+#define STEP    16  /* per picture, so that the edges fall between blocks */
+#define COUNT   4   /* pictures, for the search to get the previous fields */
+#define BLOCKS  ( ( WIDTH / ME_BLOCK ) * ( HEIGHT / ME_BLOCK ) )
+
+static uint8_t Background( int x, int y )
+{
+    return ( ( x * 73 ) ^ ( y * 151 ) ^ ( x * y ) ) & 0xff;
+}
+
+static uint8_t Square( int x, int y )
+{
+    return 0x80 | ( ( ( x * 29 ) ^ ( y * 97 ) ) & 0x7f );
+}
+
+/* Luma of the scene with the square at the given position */
+static uint8_t Scene( int left, int x, int y )
+{
+    if( x >= left && x < left + SIZE && y >= TOP && y < TOP + SIZE )
+        return Square( x - left, y - TOP );
+    return Background( x, y );
+}
+
+static picture_t *Draw( const video_format_t *fmt, int left )
+{
+    picture_t *pic = picture_NewFromFormat( fmt );
+    assert( pic != NULL );
+
+    plane_t *p = &pic->p[Y_PLANE];
+    for( int y = 0; y < p->i_visible_lines; y++ )
+        for( int x = 0; x < p->i_visible_pitch; x++ )
+            p->p_pixels[y * p->i_pitch + x] = Scene( left, x, y );
+    for( int i = 1; i < pic->i_planes; i++ )
+        memset( pic->p[i].p_pixels, 0x80,
+                pic->p[i].i_pitch * pic->p[i].i_lines );
+    return pic;
+}
+
+static void CheckColumns( const picture_t *pic, int left, int x0, int x1 )
+{
+    const plane_t *p = &pic->p[Y_PLANE];
+
+    for( int y = TOP; y < TOP + SIZE; y++ )
+        for( int x = x0; x < x1; x++ )
+        {
+            uint8_t expected = Scene( left, x, y );
+            uint8_t got = p->p_pixels[y * p->i_pitch + x];
+
+            if( got != expected )
+            {
+                fprintf( stderr, "(%d,%d): %u instead of %u\n", x, y,
+                         got, expected );
+                abort();
+            }
+        }
+}
+
+int main( void )
+{
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_I420, WIDTH, HEIGHT,
+                        WIDTH, HEIGHT, 1, 1 );
+
+    filter_sys_t sys = {
+        .chroma = vlc_fourcc_GetChromaDescription( VLC_CODEC_I420 ),
+        .sad = me_GetSAD(),
+        .average = AverageC,
+    };
+    for( int i = 0; i < 2; i++ )
+    {
+        sys.forward[i] = calloc( BLOCKS, sizeof(me_vector_t) );
+        sys.backward[i] = calloc( BLOCKS, sizeof(me_vector_t) );
+        assert( sys.forward[i] != NULL && sys.backward[i] != NULL );
+    }
+
+    picture_t *prev = NULL, *cur = Draw( &fmt, 0 );
+    for( int i = 1; i < COUNT; i++ )
+    {
+        if( prev != NULL )
+            picture_Release( prev );
+        prev = cur;
+        cur = Draw( &fmt, i * STEP );
+        EstimateMotion( &sys, prev, cur );
+    }
+
+    picture_t *mid = picture_NewFromFormat( &fmt );
+    assert( mid != NULL );
+
+    fps_interpolate_job_t job = {
+        .p_sys = &sys,
+        .p_prev = prev,
+        .p_cur = cur,
+        .p_dst = mid,
+        .i_weight = 128,
+    };
+    InterpolateSlice( &job, 0, 1 );
+
+    /* Halfway between the last two pictures */
+    const int left = ( COUNT - 2 ) * STEP + STEP / 2;
+    /* Behind the square, the background being uncovered */
+    CheckColumns( mid, left, left - STEP / 2, left );
+    /* The square itself */
+    CheckColumns( mid, left, left, left + SIZE );
+    /* Ahead of the square, the background being covered */
+    CheckColumns( mid, left, left + SIZE, left + SIZE + STEP / 2 );
+
+    picture_Release( mid );
+    picture_Release( cur );
+    picture_Release( prev );
+    for( int i = 0; i < 2; i++ )
+    {
+        free( sys.forward[i] );
+        free( sys.backward[i] );
+    }
+    return 0;
+}
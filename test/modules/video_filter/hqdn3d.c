@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * hqdn3d.c: tests the hqdn3d denoiser kernels
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_slices.h>
+#include "../modules/video_filter/hqdn3d.h"
+
+/* Small 4:2:0 pictures, not a multiple of the vector width nor of the
+ * bands of rows and columns of the threads */
+#define FRAMES 3
+#define PITCH  96 /* bytes, for 16-bit samples too */
+#define PLANE  (PITCH * 21)
+
+static const int plane_w[3] = { 45, 23, 23 };
+static const int plane_h[3] = { 21, 11, 11 };
+
+static struct vf_priv_s priv;
+static uint8_t src[FRAMES][3][PLANE];
+static uint8_t ref[FRAMES][3][PLANE];
+static uint8_t out[FRAMES][3][PLANE];
+
+/* Gradients with noise, sharp edges and outliers */
+static void Fill(unsigned bits)
+{
+    uint32_t seed = 1;
+
+    for (int f = 0; f < FRAMES; f++)
+        for (int i = 0; i < 3; i++)
+            for (int y = 0; y < plane_h[i]; y++)
+                for (int x = 0; x < plane_w[i]; x++)
+                {
+                    int v = (4 * x + 2 * y + 3 * f) & 255;
+
+                    seed = seed * 1103515245 + 12345;
+                    if (((x / 8) ^ (y / 4)) & 1)
+                        v = 255 - v;
+                    v += (int)(seed >> 16) % 17 - 8;
+                    if ((seed >> 24) == 0)
+                        v = seed & 255;
+                    v = VLC_CLIP(v, 0, 255);
+
+                    if (bits > 8)
+                        ((uint16_t *)&src[f][i][y * PITCH])[x] =
+                            (v << (bits - 8)) | (seed >> (40 - bits));
+                    else
+                        src[f][i][y * PITCH + x] = v;
+                }
+}
+
+static void Filter(vlc_slices_t *slices, hqdn3d_horizontal_t horizontal,
+                   hqdn3d_vertical_t vertical, unsigned bits,
+                   uint8_t dst[FRAMES][3][PLANE])
+{
+    hqdn3d_job_t job = {
+        .priv = &priv,
+        .bits = bits,
+        .init = true,
+        .horizontal = horizontal,
+        .vertical = vertical,
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        size_t pixels = plane_w[i] * plane_h[i];
+
+        priv.Line[i] = malloc(plane_w[i] * sizeof (*priv.Line[i]));
+        priv.Frame[i] = malloc(pixels * sizeof (*priv.Frame[i]));
+        priv.Spatial[i] = malloc(pixels * sizeof (*priv.Spatial[i]));
+        assert(priv.Line[i] && priv.Frame[i] && priv.Spatial[i]);
+
+        job.planes[i].src_pitch = PITCH;
+        job.planes[i].dst_pitch = PITCH;
+        job.planes[i].w = plane_w[i];
+        job.planes[i].h = plane_h[i];
+        job.planes[i].spatial_coefs = priv.Coefs[i == 0 ? 0 : 2];
+        job.planes[i].temporal_coefs = priv.Coefs[i == 0 ? 1 : 3];
+    }
+
+    memset(dst, 0, sizeof (out));
+    for (int f = 0; f < FRAMES; f++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            job.planes[i].src = src[f][i];
+            job.planes[i].dst = dst[f][i];
+        }
+        hqdn3d_Run(slices, &job);
+        job.init = false;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        free(priv.Line[i]);
+        free(priv.Frame[i]);
+        free(priv.Spatial[i]);
+    }
+}
+
+int main(void)
+{
+    /* spatial and temporal, temporal only, spatial only */
+    static const double strengths[][4] = {
+        { 4.0, 6.0, 3.0, 4.5 },
+        { 0.0, 6.0, 0.0, 4.5 },
+        { 4.0, 0.0, 3.0, 0.0 },
+    };
+    vlc_slices_t *slices = vlc_slices_New(4);
+
+    for (size_t s = 0; s < ARRAY_SIZE(strengths); s++)
+    {
+        for (int i = 0; i < 4; i++)
+            PrecalcCoefs(priv.Coefs[i], strengths[s][i]);
+
+        for (unsigned bits = 8; bits <= 10; bits += 2)
+        {
+            Fill(bits);
+            Filter(NULL, hqdn3d_horizontal_c, hqdn3d_vertical_c, bits, ref);
+#ifdef HQDN3D_SIMD_X86
+            if (vlc_CPU_AVX2())
+            {
+                Filter(NULL, hqdn3d_horizontal_avx2, hqdn3d_vertical_avx2,
+                       bits, out);
+                assert(!memcmp(out, ref, sizeof (out)));
+            }
+#endif
+            if (slices != NULL)
+            {
+                Filter(slices, hqdn3d_GetHorizontal(), hqdn3d_GetVertical(),
+                       bits, out);
+                assert(!memcmp(out, ref, sizeof (out)));
+            }
+        }
+    }
+
+    vlc_slices_Delete(slices);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*****************************************************************************
+ * ivtc_metrics.c: tests the IVTC comb and motion metrics
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_slices.h>
+#include "../modules/video_filter/deinterlace/helpers.c"
+
+/* Comb score of a field pair, and blocks with motion between two pictures,
+ * with one kernel over whole pictures */
+static unsigned Comb(deint_comb_line_t comb_line, const picture_t *top,
+                     const picture_t *bot)
+{
+    unsigned score = 0;
+
+    for (int i = 0; i < top->i_planes; i++)
+    {
+        const plane_t *t = &top->p[i], *b = &bot->p[i];
+
+        for (int y = 1; y < t->i_visible_lines - 1; y++)
+        {
+            const plane_t *cur = (y % 2) ? b : t;
+            const plane_t *ngh = (y % 2) ? t : b;
+
+            score += comb_line(&cur->p_pixels[y * cur->i_pitch],
+                               &ngh->p_pixels[(y - 1) * ngh->i_pitch],
+                               &ngh->p_pixels[(y + 1) * ngh->i_pitch],
+                               t->i_visible_pitch);
+        }
+    }
+    return score;
+}
+
+static void Motion(deint_motion_blocks_t motion_blocks, const picture_t *prev,
+                   const picture_t *curr, unsigned counts[3])
+{
+    counts[0] = counts[1] = counts[2] = 0;
+    for (int i = 0; i < prev->i_planes; i++)
+    {
+        const plane_t *p = &prev->p[i], *c = &curr->p[i];
+
+        for (int by = 0; by < p->i_visible_lines / 8; by++)
+            motion_blocks(&p->p_pixels[8 * by * p->i_pitch], p->i_pitch,
+                          &c->p_pixels[8 * by * c->i_pitch], c->i_pitch,
+                          p->i_visible_pitch / 8, counts);
+    }
+}
+
+/* A still background with a moving, noisy area. The bottom field of the
+ * second picture is from a third one, so that the frame combs there. */
+static picture_t *Draw(const video_format_t *fmt, int frame)
+{
+    picture_t *pic = picture_NewFromFormat(fmt);
+    uint32_t seed = frame + 1;
+
+    assert(pic != NULL);
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+            for (int x = 0; x < p->i_visible_pitch; x++)
+            {
+                int f = (frame == 1 && (y & 1)) ? 2 : frame;
+                int v = (x * 5 + y * 3) & 255;
+
+                seed = seed * 1103515245 + 12345;
+                if (x > p->i_visible_pitch / 3 && y > p->i_visible_lines / 4)
+                    v = (v + 60 * f + (seed >> 26)) & 255;
+                p->p_pixels[y * p->i_pitch + x] = v;
+            }
+    }
+    return pic;
+}
+
+static void Check(vlc_slices_t *slices, picture_t *pics[2])
+{
+    unsigned counts[3];
+    int top, bot;
+
+    Motion(deint_motion_blocks_c, pics[0], pics[1], counts);
+    assert(EstimateNumBlocksWithMotion(pics[0], pics[1], &top, &bot,
+                                       slices) == (int)counts[0]);
+    assert(top == (int)counts[1] && bot == (int)counts[2]);
+
+    for (int t = 0; t < 2; t++)
+        for (int b = 0; b < 2; b++)
+            assert(CalculateInterlaceScore(pics[t], pics[b], slices)
+                   == (int)Comb(deint_comb_line_c, pics[t], pics[b]));
+}
+
+#if defined(DEINT_SIMD_X86) || defined(DEINT_SIMD_NEON)
+static void CheckKernels(deint_comb_line_t comb_line,
+                         deint_motion_blocks_t motion_blocks,
+                         picture_t *pics[2])
+{
+    unsigned ref[3], counts[3];
+
+    Motion(deint_motion_blocks_c, pics[0], pics[1], ref);
+    Motion(motion_blocks, pics[0], pics[1], counts);
+    assert(!memcmp(counts, ref, sizeof (ref)));
+    assert(Comb(comb_line, pics[0], pics[1])
+           == Comb(deint_comb_line_c, pics[0], pics[1]));
+}
+#endif
+
+int main(void)
+{
+    /* Not a multiple of the vector width */
+    video_format_t fmt;
+    video_format_Setup(&fmt, VLC_CODEC_I420, 78, 40, 78, 40, 1, 1);
+
+    picture_t *pics[2] = { Draw(&fmt, 0), Draw(&fmt, 1) };
+    unsigned counts[3];
+
+    /* Both detectors have something to find */
+    Motion(deint_motion_blocks_c, pics[0], pics[1], counts);
+    assert(counts[0] > 0 && counts[1] > 0 && counts[2] > 0);
+    assert(Comb(deint_comb_line_c, pics[1], pics[1])
+           > Comb(deint_comb_line_c, pics[0], pics[0]));
+
+#ifdef DEINT_SIMD_X86
+    if (vlc_CPU_SSE2())
+        CheckKernels(deint_comb_line_sse2, deint_motion_blocks_sse2, pics);
+    if (vlc_CPU_AVX2())
+        CheckKernels(deint_comb_line_avx2, deint_motion_blocks_avx2, pics);
+#endif
+#ifdef DEINT_SIMD_NEON
+    CheckKernels(deint_comb_line_neon, deint_motion_blocks_neon, pics);
+#endif
+
+    /* Threaded, whatever the number of CPUs */
+    vlc_slices_t *slices = vlc_slices_New(3);
+    Check(NULL, pics);
+    if (slices != NULL)
+        Check(slices, pics);
+    vlc_slices_Delete(slices);
+
+    picture_Release(pics[1]);
+    picture_Release(pics[0]);
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*****************************************************************************
+ * motion_search.c: tests the block matching motion estimation
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include "../modules/video_filter/motion_search.h"
+
+/* The last blocks of the rows and columns are larger than the others */
+#define WIDTH  61
+#define HEIGHT 45
+#define PITCH  64
+#define BLOCKS ((WIDTH / ME_BLOCK) * (HEIGHT / ME_BLOCK))
+
+/* Motion of the first picture to the second one */
+#define MOTION_X 5
+#define MOTION_Y (-3)
+
+static uint8_t pixels[2][PITCH * HEIGHT];
+static plane_t planes[2];
+
+/* Blurred noise: detailed, but smooth enough for the diamond search to
+ * converge from a few pixels away */
+#define BLUR 4
+
+static uint8_t Texture(const uint8_t *noise, int x, int y)
+{
+    unsigned sum = 0;
+
+    for (int dy = -BLUR; dy <= BLUR; dy++)
+        for (int dx = -BLUR; dx <= BLUR; dx++)
+            sum += noise[(y + dy + 16) * (PITCH + 32) + x + dx + 16];
+    return sum / ((2 * BLUR + 1) * (2 * BLUR + 1));
+}
+
+static void Draw(void)
+{
+    static uint8_t noise[(HEIGHT + 32) * (PITCH + 32)];
+    uint32_t seed = 1;
+
+    for (size_t i = 0; i < sizeof (noise); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        noise[i] = seed >> 24;
+    }
+
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < PITCH; x++)
+        {
+            pixels[0][y * PITCH + x] = Texture(noise, x, y);
+            pixels[1][y * PITCH + x] = Texture(noise, x - MOTION_X,
+                                               y - MOTION_Y);
+        }
+
+    for (int i = 0; i < 2; i++)
+    {
+        planes[i].p_pixels = pixels[i];
+        planes[i].i_lines = planes[i].i_visible_lines = HEIGHT;
+        planes[i].i_pitch = PITCH;
+        planes[i].i_visible_pitch = WIDTH;
+        planes[i].i_pixel_pitch = 1;
+    }
+}
+
+static void Search(const me_vector_t *prev, bool reverse, me_vector_t *field)
+{
+    const me_search_t search = {
+        .cur = &planes[1],
+        .ref = &planes[0],
+        .prev = prev,
+        .range = 16,
+        .sad = me_GetSAD(),
+    };
+    const int rows = me_BlocksY(&planes[1]);
+
+    for (int i = 0; i < rows; i++)
+        me_SearchRow(&search, reverse ? rows - 1 - i : i, field);
+}
+
+#if defined(ME_SIMD_X86) || defined(ME_SIMD_NEON)
+static void CheckKernels(me_sad_t sad, me_absdiff_t absdiff)
+{
+    uint32_t ref[WIDTH], res[WIDTH];
+
+    for (int y = 0; y + ME_BLOCK <= HEIGHT; y += 5)
+        for (int x = 0; x + ME_BLOCK <= WIDTH; x += 3)
+        {
+            const uint8_t *a = &pixels[0][y * PITCH + x];
+            const uint8_t *b = &pixels[1][(HEIGHT - ME_BLOCK - y) * PITCH
+                                          + WIDTH - ME_BLOCK - x];
+
+            assert(sad(a, PITCH, b, PITCH) == me_sad_c(a, PITCH, b, PITCH));
+        }
+
+    for (int w = 1; w <= WIDTH; w++)
+    {
+        me_absdiff_c(ref, pixels[0], pixels[1], w);
+        absdiff(res, pixels[0], pixels[1], w);
+        assert(!memcmp(ref, res, w * sizeof (*res)));
+    }
+}
+#endif
+
+/* Each block that moved from within the first picture is found exactly,
+ * the others have no vector pointing outside of it */
+static void Check(const me_vector_t *field)
+{
+    const int bw = me_BlocksX(&planes[1]), bh = me_BlocksY(&planes[1]);
+
+    for (int by = 0; by < bh; by++)
+        for (int bx = 0; bx < bw; bx++)
+        {
+            const me_vector_t *v = &field[by * bw + bx];
+            int x, y, w, h;
+
+            me_BlockArea(&planes[1], bx, by, &x, &y, &w, &h);
+            if (x >= MOTION_X && y + h - MOTION_Y <= HEIGHT)
+                assert(v->x == -MOTION_X && v->y == -MOTION_Y && v->sad == 0);
+            assert(x + v->x >= 0 && x + v->x + w <= WIDTH);
+            assert(y + v->y >= 0 && y + v->y + h <= HEIGHT);
+        }
+}
+
+int main(void)
+{
+    static me_vector_t field[3][BLOCKS];
+
+    Draw();
+#ifdef ME_SIMD_X86
+    if (vlc_CPU_SSE2())
+        CheckKernels(me_sad_sse2, me_absdiff_sse2);
+#endif
+#ifdef ME_SIMD_NEON
+    CheckKernels(me_sad_neon, me_absdiff_neon);
+#endif
+
+    Search(NULL, false, field[0]);
+    Check(field[0]);
+
+    /* The rows can be searched in any order, as the threads do */
+    Search(NULL, true, field[1]);
+    assert(!memcmp(field[0], field[1], sizeof (field[0])));
+
+    /* With the previous field as predictor, and in any order again */
+    Search(field[0], false, field[1]);
+    Check(field[1]);
+    Search(field[0], true, field[2]);
+    assert(!memcmp(field[1], field[2], sizeof (field[1])));
+    return 0;
+}
@@ -34,6 +34,8 @@
 
 #ifndef TEST_NET
 #define RAND_FILE_SIZE (25 * 1024 * 1024)
+/* not a multiple of any block size, the reads at the end are short */
+#define ODD_FILE_SIZE (RAND_FILE_SIZE / 8 + 4093)
 #else
 #define HTTP_URL "http://streams.videolan.org/streams/ogm/MJPEG.ogm"
 #define HTTP_MD5 "4eaf9e8837759b670694398a33f02bc0"
@@ -360,36 +362,55 @@ fill_rand( int i_fd, size_t i_size )
     }
     assert( i_written == i_size );
 }
-#endif
 
-int
-main( void )
+static void
+test_file( size_t i_size )
 {
     struct reader *pp_readers[3];
-
-    test_init();
-
-#ifndef TEST_NET
+    unsigned int i_readers = 2;
     char psz_tmp_path[] = "/tmp/libvlc_XXXXXX";
     char *psz_url;
     int i_tmp_fd;
 
-    log( "Test random file with libc, and stream\n" );
+    log( "Test random file of %zu bytes with libc, and stream\n", i_size );
     i_tmp_fd = vlc_mkstemp( psz_tmp_path );
-    fill_rand( i_tmp_fd, RAND_FILE_SIZE );
     assert( i_tmp_fd != -1 );
+    fill_rand( i_tmp_fd, i_size );
     assert( asprintf( &psz_url, "file://%s", psz_tmp_path ) != -1 );
 
     assert( ( pp_readers[0] = libc_open( psz_tmp_path ) ) );
     assert( ( pp_readers[1] = stream_open( psz_url ) ) );
+    free( psz_url );
 
-    test( pp_readers, 2, NULL );
-    for( unsigned int i = 0; i < 2; ++i )
-        pp_readers[i]->pf_close( pp_readers[i] );
+    /* The io_uring access, only built on Linux, is never used for file://
+     * URLs: it is compared with the file system access */
+    assert( asprintf( &psz_url, "uring://%s", psz_tmp_path ) != -1 );
+    if( ( pp_readers[2] = stream_open( psz_url ) ) )
+    {
+        pp_readers[2]->psz_name = "uring";
+        i_readers++;
+    }
     free( psz_url );
 
+    test( pp_readers, i_readers, NULL );
+    for( unsigned int i = 0; i < i_readers; ++i )
+        pp_readers[i]->pf_close( pp_readers[i] );
+
     close( i_tmp_fd );
+    unlink( psz_tmp_path );
+}
+#endif
+
+int
+main( void )
+{
+    test_init();
+
+#ifndef TEST_NET
+    test_file( RAND_FILE_SIZE );
+    test_file( ODD_FILE_SIZE );
 #else
+    struct reader *pp_readers[1];
 
     log( "Test http url with stream\n" );
     alarm( 0 );